@@ -5,16 +5,34 @@
 
 #include "abstractanimation.h"
 #include "debug_animations.h"
+#include "renderloop.h"
+
+#include <KLocalizedString>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
 
 AbstractAnimation::AbstractAnimation(QObject *parent)
-    : QTimeLine(1000, parent)
+    : QObject(parent)
+    , m_running {false}
+    , m_updatesPending {false}
+    , m_queueUpdates {false}
+    , m_frameBudget {0}
+    , m_frameTime {0}
+    , m_overBudget {false}
+    , m_canvas {nullptr}
+    , m_framePresented {false}
+    , m_firstFrame {true}
 {
-    // Our animations run forever by default.
-    setLoopCount(0);
 }
 
 AbstractAnimation::~AbstractAnimation() noexcept
 {
+    if (m_running && m_renderLoop) {
+        m_renderLoop->removeAnimation(this);
+    }
 }
 
 LedStrip *AbstractAnimation::ledStrip() const
@@ -25,8 +43,380 @@ LedStrip *AbstractAnimation::ledStrip() const
 void AbstractAnimation::setLedStrip(LedStrip *ledStrip)
 {
     if (m_ledStrip != ledStrip) {
+        // Rendering on a render thread goes to a canvas instead.
         m_ledStrip = ledStrip;
 
         Q_EMIT ledStripChanged();
     }
 }
+
+RenderLoop *AbstractAnimation::renderLoop() const
+{
+    return m_renderLoop;
+}
+
+void AbstractAnimation::setRenderLoop(RenderLoop *renderLoop)
+{
+    if (m_renderLoop == renderLoop) {
+        return;
+    }
+
+    if (m_running && m_renderLoop) {
+        m_renderLoop->removeAnimation(this);
+    }
+
+    m_renderLoop = renderLoop;
+
+    if (m_running) {
+        if (m_renderLoop) {
+            m_renderLoop->addAnimation(this);
+        } else {
+            stop();
+        }
+    }
+}
+
+bool AbstractAnimation::running() const
+{
+    return m_running;
+}
+
+void AbstractAnimation::start()
+{
+    if (m_running) {
+        return;
+    }
+
+    if (!m_renderLoop) {
+        qCWarning(HYELICHT_ANIMATIONS) << i18n("Cannot start animation '%1' without a render loop.", name());
+        return;
+    }
+
+    m_running = true;
+
+    updateRenderState([this]() {
+        m_frame = Frame();
+        m_firstFrame = true;
+        m_previousFrame.clear();
+    });
+
+    m_renderLoop->addAnimation(this);
+
+    Q_EMIT runningChanged(m_running);
+}
+
+void AbstractAnimation::stop()
+{
+    if (!m_running) {
+        return;
+    }
+
+    m_running = false;
+
+    if (m_renderLoop) {
+        m_renderLoop->removeAnimation(this);
+    }
+
+    Q_EMIT runningChanged(m_running);
+}
+
+void AbstractAnimation::renderOffline(int delta, bool restart /* Defaults to false */)
+{
+    if (m_running) {
+        qCWarning(HYELICHT_ANIMATIONS) << i18n("Cannot render animation '%1' offline while it is running.", name());
+        return;
+    }
+
+    if (restart) {
+        m_frame = Frame();
+        m_firstFrame = true;
+    }
+
+    renderFrame(nextFrame(delta, 0));
+}
+
+int AbstractAnimation::frameBudget() const
+{
+    return m_frameBudget.load(std::memory_order_relaxed);
+}
+
+void AbstractAnimation::setFrameBudget(int budget)
+{
+    budget = std::max(0, budget);
+
+    if (frameBudget() != budget) {
+        m_frameBudget.store(budget, std::memory_order_relaxed);
+        updateRenderState([this]() { m_overBudget = false; });
+
+        Q_EMIT frameBudgetChanged();
+    }
+}
+
+qint64 AbstractAnimation::frameTime() const
+{
+    return m_frameTime.load(std::memory_order_relaxed);
+}
+
+QVector<QPair<int, int>> AbstractAnimation::squares() const
+{
+    return m_guiSquares;
+}
+
+void AbstractAnimation::setSquares(const QVector<QPair<int, int>> &squares)
+{
+    if (m_guiSquares != squares) {
+        m_guiSquares = squares;
+        updateRenderState([this, squares]() { m_squares = squares; });
+
+        Q_EMIT squaresChanged();
+    }
+}
+
+QVector<QPair<int, int>> AbstractAnimation::region() const
+{
+    return m_guiRegion;
+}
+
+void AbstractAnimation::setRegion(const QVector<QPair<int, int>> &region)
+{
+    if (m_guiRegion != region) {
+        m_guiRegion = region;
+        updateRenderState([this, region]() { m_region = region; });
+
+        Q_EMIT regionChanged();
+    }
+}
+
+void AbstractAnimation::updateRenderState(std::function<void()> update)
+{
+    if (!m_queueUpdates) {
+        update();
+        return;
+    }
+
+    QMutexLocker locker(&m_updatesMutex);
+    m_updates.append(std::move(update));
+    m_updatesPending.store(true, std::memory_order_release);
+}
+
+LedStrip *AbstractAnimation::canvas() const
+{
+    return m_canvas ? m_canvas : m_ledStrip.data();
+}
+
+void AbstractAnimation::presentFrame()
+{
+    m_framePresented = true;
+
+    // The render loop picks the frame up from the canvas.
+    if (m_canvas) {
+        return;
+    }
+
+    if (m_ledStrip) {
+        m_ledStrip->update();
+    }
+
+    Q_EMIT frameComplete();
+}
+
+QVector<QPair<int, int>> AbstractAnimation::paintRanges() const
+{
+    const LedStrip *ledStrip {canvas()};
+
+    if (!ledStrip) {
+        return {};
+    }
+
+    return paintRanges(m_region, ledStrip->count());
+}
+
+QVector<QPair<int, int>> AbstractAnimation::paintRanges(const QVector<QPair<int, int>> &region, int count)
+{
+    if (region.isEmpty()) {
+        return {QPair<int, int>(0, count - 1)};
+    }
+
+    QVector<QPair<int, int>> ranges;
+    ranges.reserve(region.size());
+
+    for (const QPair<int, int> &range : region) {
+        if (range.first >= 0 && range.first <= range.second && range.second < count) {
+            ranges.append(range);
+        }
+    }
+
+    return ranges;
+}
+
+AbstractAnimation::LedLayout AbstractAnimation::ledLayout() const
+{
+    return ledLayout(m_squares, m_region);
+}
+
+AbstractAnimation::LedLayout AbstractAnimation::ledLayout(const QVector<QPair<int, int>> &squares,
+    const QVector<QPair<int, int>> &region)
+{
+    LedLayout layout;
+
+    const int squareCount {static_cast<int>(squares.size())};
+
+    // Squares come in rows from the top left, while the strip runs through
+    // the rows in alternating directions. Neighbors in a row are the same
+    // distance apart on the strip everywhere; any other distance starts a
+    // new row.
+    const int step {squareCount > 1 ? std::abs(squares.at(1).first - squares.at(0).first) : 0};
+    const auto sameRow = [&](int i, int j) {
+        return std::abs(squares.at(i).first - squares.at(j).first) == step;
+    };
+
+    int row {0};
+    int rowStart {0};
+
+    for (int i {0}; i < squareCount; ++i) {
+        if (i > 0 && !sameRow(i, i - 1)) {
+            ++row;
+            rowStart = i;
+        }
+
+        const QPair<int, int> &square {squares.at(i)};
+        const int column {i - rowStart};
+
+        bool reversed {false};
+
+        if (column > 0) {
+            reversed = square.first < squares.at(i - 1).first;
+        } else if (i + 1 < squareCount && sameRow(i, i + 1)) {
+            reversed = squares.at(i + 1).first < square.first;
+        }
+
+        // Regions are made up of whole compartments, e.g. for zones.
+        const bool painted {region.isEmpty() || std::any_of(region.cbegin(), region.cend(),
+            [&](const QPair<int, int> &range) {
+                return range.first <= square.first && square.second <= range.second;
+            }
+        )};
+
+        if (!painted) {
+            continue;
+        }
+
+        const int leds {square.second - square.first + 1};
+
+        for (int led {0}; led < leds; ++led) {
+            const float position {(led + 0.5f) / leds};
+
+            layout.leds.append(square.first + led);
+            layout.x.append(column + (reversed ? 1.0f - position : position));
+            layout.y.append(row + 0.5f);
+            layout.squares.append(i);
+        }
+    }
+
+    return layout;
+}
+
+void AbstractAnimation::setQueueUpdates(bool queue)
+{
+    m_queueUpdates = queue;
+
+    // Called once the render thread is done with the animation.
+    if (!queue) {
+        applyUpdates();
+    }
+}
+
+void AbstractAnimation::applyUpdates()
+{
+    if (!m_updatesPending.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    QVector<std::function<void()>> updates;
+
+    {
+        QMutexLocker locker(&m_updatesMutex);
+        updates.swap(m_updates);
+        m_updatesPending.store(false, std::memory_order_relaxed);
+    }
+
+    for (const std::function<void()> &update : std::as_const(updates)) {
+        update();
+    }
+}
+
+void AbstractAnimation::updateFrameTime(qint64 duration)
+{
+    const qint64 average {m_frameTime.load(std::memory_order_relaxed)};
+    m_frameTime.store(average ? (average * 15 + duration) / 16 : duration,
+        std::memory_order_relaxed);
+
+    const int budget {frameBudget()};
+
+    if (!budget) {
+        return;
+    }
+
+    // Only report crossing the budget, not every frame over it.
+    const bool overBudget {frameTime() > budget};
+
+    if (overBudget && !m_overBudget) {
+        qCWarning(HYELICHT_ANIMATIONS) << i18n("Animation '%1' takes %2 µs per frame, exceeding its budget of %3 µs.",
+            name(), frameTime(), budget);
+    }
+
+    m_overBudget = overBudget;
+}
+
+AbstractAnimation::Frame AbstractAnimation::nextFrame(int delta, int dropped)
+{
+    m_frame.delta = delta;
+    m_frame.dropped = dropped;
+
+    if (m_firstFrame) {
+        m_firstFrame = false;
+    } else {
+        m_frame.time += delta;
+        m_frame.index += 1 + dropped;
+    }
+
+    return m_frame;
+}
+
+int AbstractAnimation::measureChange()
+{
+    const LedStrip *ledStrip {canvas()};
+
+    if (!ledStrip) {
+        return 0;
+    }
+
+    const int count {ledStrip->count()};
+    const uint8_t *current {reinterpret_cast<const uint8_t *>(ledStrip->constData())};
+
+    // Everything is new without a previous frame to compare to.
+    if (m_previousFrame.size() != count) {
+        m_previousFrame.resize(count);
+        memcpy(m_previousFrame.data(), current, count * sizeof(uint32_t));
+
+        return 255;
+    }
+
+    uint8_t *previous {reinterpret_cast<uint8_t *>(m_previousFrame.data())};
+    int change {0};
+
+    // Compares all bytes of each LED, so changes to the global brightness
+    // bits count as well.
+    for (const QPair<int, int> &range : paintRanges()) {
+        const int first {range.first * 4};
+        const int last {(range.second + 1) * 4};
+
+        for (int i {first}; i < last; ++i) {
+            change = std::max(change, std::abs(current[i] - previous[i]));
+        }
+
+        memcpy(previous + first, current + first, last - first);
+    }
+
+    return change;
+}
@@ -5,27 +5,43 @@
 
 #pragma once
 
-#include <QTimeLine>
+#include "hyelicht_core_export.h"
+
+#include <QMutex>
+#include <QObject>
+#include <QPair>
 #include <QPointer>
+#include <QVector>
 
 #include "ledstrip.h"
 
+#include <atomic>
+#include <functional>
+
+class RenderLoop;
+
 //! Abstract base class for LED strip animations operating on LedStrip
 /*!
  * \ingroup Animation
  *
- * Extends QTimeLine with useful defaults and member-based access to a LedStrip instance.
+ * Provides member-based access to a LedStrip instance and frame timing by a RenderLoop.
+ *
+ * AbstractAnimations are set on a ShelfModel instance by calling its ShelfModel::setAnimation method,
+ * which also sets the \ref renderLoop.
  *
- * AbstractAnimations are set on a ShelfModel instance by calling its ShelfModel::setAnimation method.
+ * \attention AbstractAnimations must provide a \ref name, implement \ref renderFrame and call
+ * \ref presentFrame after painting a frame.
  *
- * \attention AbstractAnimations must provide a \ref name and emit the \ref frameComplete signal.
+ * \ref renderFrame may be called on a render thread (see RenderLoop::threaded). Subclasses must
+ * paint into \ref canvas rather than \ref ledStrip, change state \ref renderFrame uses from
+ * elsewhere only through \ref updateRenderState, and call \ref stop in their destructor.
  *
- * AbstractAnimations loop forever by default.
+ * AbstractAnimations run until stopped.
  *
  * \sa ShelfModel
- * \sa QTimeLine
+ * \sa RenderLoop
  */
-class AbstractAnimation : public QTimeLine
+class HYELICHT_CORE_EXPORT AbstractAnimation : public QObject
 {
     Q_OBJECT
 
@@ -42,7 +58,44 @@ class AbstractAnimation : public QTimeLine
     */
     Q_PROPERTY(LedStrip* ledStrip READ ledStrip WRITE setLedStrip NOTIFY ledStripChanged)
 
+    //! Whether the animation is running.
+    /*!
+    * \sa start
+    * \sa stop
+    * \sa runningChanged
+    */
+    Q_PROPERTY(bool running READ running NOTIFY runningChanged)
+
+    //! CPU time budget for rendering a frame, in microseconds.
+    /*!
+    * A warning is logged when the measured \ref frameTime exceeds the budget. \c 0
+    * disables the check.
+    *
+    * Defaults to \c 0.
+    *
+    * \sa setFrameBudget
+    * \sa frameBudgetChanged
+    * \sa frameTime
+    */
+    Q_PROPERTY(int frameBudget READ frameBudget WRITE setFrameBudget NOTIFY frameBudgetChanged)
+
     public:
+        //! Timing of a frame passed to \ref renderFrame.
+        struct Frame {
+            int delta {0}; //!< Time since the previous frame in milliseconds.
+            qint64 time {0}; //!< Time since the animation started in milliseconds.
+            qint64 index {0}; //!< Number of frames since the animation started, including dropped ones.
+            int dropped {0}; //!< Number of frames dropped since the previous frame.
+        };
+
+        //! Positions of the painted LEDs on the shelf front, see \ref ledLayout.
+        struct LedLayout {
+            QVector<int> leds; //!< Index of each LED on the strip.
+            QVector<float> x; //!< Position from the left, in compartments.
+            QVector<float> y; //!< Position from the top, in compartments; centered in the row.
+            QVector<float> squares; //!< Index of the compartment, row by row from the top left.
+        };
+
         //! Create an animation.
         /*!
         * @param parent Parent object
@@ -76,6 +129,133 @@ class AbstractAnimation : public QTimeLine
         */
         void setLedStrip(LedStrip *ledStrip);
 
+        //! The RenderLoop rendering frames of this animation while it runs.
+        /*!
+        * Defaults to \c nullptr.
+        *
+        * @return A RenderLoop.
+        * \sa setRenderLoop
+        */
+        RenderLoop *renderLoop() const;
+
+        //! Set the RenderLoop rendering frames of this animation while it runs.
+        /*!
+        * A running animation moves to the new loop.
+        *
+        * @param renderLoop A RenderLoop.
+        * \sa renderLoop
+        */
+        void setRenderLoop(RenderLoop *renderLoop);
+
+        //! Whether the animation is running.
+        /*!
+        * @return Animation running or stopped.
+        * \sa running (property)
+        * \sa start
+        * \sa stop
+        * \sa runningChanged
+        */
+        bool running() const;
+
+        //! Start the animation.
+        /*!
+        * Requires a \ref renderLoop.
+        *
+        * \sa stop
+        * \sa running
+        */
+        Q_INVOKABLE void start();
+
+        //! Stop the animation.
+        /*!
+        * \sa start
+        * \sa running
+        */
+        Q_INVOKABLE void stop();
+
+        //! Render the next frame right away, without a render loop.
+        /*!
+        * Paints straight into \ref ledStrip, for rendering frames ahead of time or
+        * back to back, e.g. to bake an AnimationClip or to benchmark. Does nothing
+        * while the animation is \ref running.
+        *
+        * @param delta Time since the previous frame in milliseconds.
+        * @param restart Whether to start over at the first frame, at time \c 0.
+        * \sa renderFrame
+        */
+        void renderOffline(int delta, bool restart = false);
+
+        //! The CPU time budget for rendering a frame.
+        /*!
+        * @return Budget in microseconds, or \c 0 for none.
+        * \sa frameBudget (property)
+        * \sa setFrameBudget
+        * \sa frameBudgetChanged
+        */
+        int frameBudget() const;
+
+        //! Set the CPU time budget for rendering a frame.
+        /*!
+        * @param budget Budget in microseconds, or \c 0 for none.
+        * \sa frameBudget
+        * \sa frameBudgetChanged
+        */
+        void setFrameBudget(int budget);
+
+        //! Time spent in \ref renderFrame, as measured by the \ref renderLoop.
+        /*!
+        * Smoothed over recent frames.
+        *
+        * @return Duration in microseconds.
+        * \sa frameBudget
+        */
+        qint64 frameTime() const;
+
+        //! The LED ranges of the shelf compartments.
+        /*!
+        * Set by ShelfModel for animations that simulate something per compartment.
+        * Ranges are in compartment order, i.e. by row and column. Animations must
+        * still confine their painting to \ref region.
+        *
+        * Defaults to an empty list.
+        *
+        * @return A list of LED ranges.
+        * \sa setSquares
+        * \sa squaresChanged
+        */
+        QVector<QPair<int, int>> squares() const;
+
+        //! Set the LED ranges of the shelf compartments.
+        /*!
+        * @param squares A list of LED ranges.
+        * \sa squares
+        * \sa squaresChanged
+        */
+        void setSquares(const QVector<QPair<int, int>> &squares);
+
+        //! The ranges of LEDs in \ref ledStrip this animation paints.
+        /*!
+        * Each range is a pair of first and last LED index. An empty region covers
+        * the entire strip.
+        *
+        * Defaults to an empty region.
+        *
+        * @return A list of LED ranges.
+        * \sa setRegion
+        * \sa regionChanged
+        */
+        QVector<QPair<int, int>> region() const;
+
+        //! Set the ranges of LEDs in \ref ledStrip this animation paints.
+        /*!
+        * Used to confine an animation to part of the strip, e.g. a ShelfZone.
+        *
+        * @param region A list of LED ranges, or an empty list for the entire strip.
+        * \sa region
+        * \sa regionChanged
+        */
+        void setRegion(const QVector<QPair<int, int>> &region);
+
     Q_SIGNALS:
         //! The LedStrip this animation operates on has changed.
         /*!
@@ -84,14 +264,162 @@ class AbstractAnimation : public QTimeLine
         */
         void ledStripChanged() const;
 
-        //! Subclasses must emit this signal after they have finished painting a frame.
+        //! The animation has been started or stopped.
+        /*!
+        * @param running Animation running or stopped.
+        * \sa running
+        */
+        void runningChanged(bool running) const;
+
+        //! A frame has been painted into \ref ledStrip.
         /*!
-        * A subclass will commonly perform painting operations on its \ref ledStrip in
-        * response to a \c QTimeLine::valueChanged signal. After painting is concluded
-        * for a frame it must emit this signal.
+        * Emitted on the GUI thread after a frame finished with \ref presentFrame has
+        * arrived in \ref ledStrip.
         */
         void frameComplete() const;
 
+        //! The ranges of LEDs this animation paints have changed.
+        /*!
+        * \sa region
+        * \sa setRegion
+        */
+        void regionChanged() const;
+
+        //! The CPU time budget for rendering a frame has changed.
+        /*!
+        * \sa frameBudget
+        * \sa setFrameBudget
+        */
+        void frameBudgetChanged() const;
+
+        //! The LED ranges of the shelf compartments have changed.
+        /*!
+        * \sa squares
+        * \sa setSquares
+        */
+        void squaresChanged() const;
+
     protected:
+        //! Render a frame.
+        /*!
+        * Called by \ref renderLoop on each of its ticks while the animation is running,
+        * on a render thread if RenderLoop::threaded.
+        *
+        * When the loop can't keep up, it drops frames rather than slowing down, and
+        * the next frame covers the time of the dropped ones. Animations should
+        * therefore derive their state from the elapsed time rather than the number
+        * of calls, and may skip painting if nothing changes in a frame.
+        *
+        * @param frame Timing of the frame.
+        */
+        virtual void renderFrame(const Frame &frame) = 0;
+
+        //! The LedStrip to paint frames into.
+        /*!
+        * This is \ref ledStrip, or a private copy of it when rendering on a render
+        * thread.
+        *
+        * \ref renderFrame runs at the frame rate and should not allocate; buffers it
+        * needs beyond the canvas belong in members, sized when the LEDs to paint
+        * change.
+        *
+        * @return A LedStrip, or \c nullptr without \ref ledStrip.
+        */
+        LedStrip *canvas() const;
+
+        //! Conclude painting a frame into \ref canvas.
+        /*!
+        * Hands the frame to the \ref renderLoop to be written out, which then emits
+        * \ref frameComplete. The loop writes each strip out once per frame, together
+        * with any other animations painting into it, so animations never call
+        * LedStrip::show themselves.
+        */
+        void presentFrame();
+
+        //! Change state \ref renderFrame uses.
+        /*!
+        * While the animation is rendered on a render thread, \p update is queued and
+        * runs there right before the next frame, in order with other updates.
+        * Otherwise it runs right away. Either way, the caller never waits for a frame
+        * in progress.
+        *
+        * State changed this way belongs to \ref renderFrame; property getters and
+        * other code on the GUI thread must keep their own copy rather than read it.
+        *
+        * @param update Function changing the state.
+        */
+        void updateRenderState(std::function<void()> update);
+
+        //! The ranges of LEDs to paint in the current frame.
+        /*!
+        * Resolves an empty \ref region to the entire strip and drops ranges that
+        * lie outside of it.
+        *
+        * @return A list of LED ranges.
+        */
+        QVector<QPair<int, int>> paintRanges() const;
+
+        //! Where the LEDs of \ref squares within \ref region sit on the shelf front.
+        /*!
+        * Derived from the ranges of \ref squares alone: neighbors in a row are the
+        * same distance apart on the strip, and rows run in alternating directions.
+        * Walls between compartments are left out.
+        *
+        * Call from \ref renderFrame or an update passed to \ref updateRenderState.
+        *
+        * @return Positions of the LEDs, in order of \ref squares.
+        */
+        LedLayout ledLayout() const;
+
+        //! Where the LEDs of a set of compartments sit on the shelf front.
+        /*!
+        * Safe to call from any thread, e.g. with \ref squares and \ref region to
+        * prepare state on the GUI thread.
+        *
+        * @param squares LED ranges of the shelf compartments.
+        * @param region Ranges of LEDs to include, or an empty list for all.
+        * @return Positions of the LEDs, in order of \p squares.
+        */
+        static LedLayout ledLayout(const QVector<QPair<int, int>> &squares,
+            const QVector<QPair<int, int>> &region);
+
         QPointer<LedStrip> m_ledStrip; //!< LedStrip instance to operate on.
+        QVector<QPair<int, int>> m_region; //!< Ranges of LEDs to operate on, as seen by \ref renderFrame.
+        QVector<QPair<int, int>> m_squares; //!< Ranges of LEDs of the shelf compartments, as seen by \ref renderFrame.
+
+    private:
+        friend class RenderLoop;
+
+        static QVector<QPair<int, int>> paintRanges(const QVector<QPair<int, int>> &region, int count);
+
+        void setQueueUpdates(bool queue);
+        void applyUpdates();
+        void updateFrameTime(qint64 duration);
+        Frame nextFrame(int delta, int dropped);
+        int measureChange();
+
+        QPointer<RenderLoop> m_renderLoop;
+        bool m_running;
+
+        // Property values; m_region and m_squares follow them through updates.
+        QVector<QPair<int, int>> m_guiRegion;
+        QVector<QPair<int, int>> m_guiSquares;
+
+        // Updates to apply on the render thread before its next frame. The
+        // mutex is only held to queue or take them.
+        QMutex m_updatesMutex;
+        QVector<std::function<void()>> m_updates;
+        std::atomic<bool> m_updatesPending;
+        bool m_queueUpdates;
+
+        std::atomic<int> m_frameBudget;
+        std::atomic<qint64> m_frameTime;
+        bool m_overBudget;
+
+        LedStrip *m_canvas;
+        bool m_framePresented;
+        QVector<uint32_t> m_previousFrame; // Last frame measured by measureChange.
+
+        Frame m_frame;
+        bool m_firstFrame;
 };
@@ -0,0 +1,109 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "animationcatalog.h"
+#include "abstractanimation.h"
+#include "animationfactory.h"
+#include "debug_animations.h"
+
+#include <KLocalizedString>
+
+#include <QPluginLoader>
+#include <QTimer>
+
+#include <algorithm>
+
+AnimationCatalog::AnimationCatalog(QObject *parent)
+    : QObject(parent)
+{
+    // Only reads the metadata; libraries are loaded on first use.
+    const QList<KPluginMetaData> plugins {KPluginMetaData::findPlugins(QStringLiteral("hyelicht/animations"))};
+
+    for (const KPluginMetaData &metaData : plugins) {
+        if (m_plugins.contains(metaData.pluginId())) {
+            continue;
+        }
+
+        m_plugins.insert(metaData.pluginId(), {metaData, new QPluginLoader {metaData.fileName(), this}, 0});
+    }
+}
+
+AnimationCatalog *AnimationCatalog::self()
+{
+    static AnimationCatalog catalog;
+    return &catalog;
+}
+
+QVector<KPluginMetaData> AnimationCatalog::plugins() const
+{
+    QVector<KPluginMetaData> plugins;
+    plugins.reserve(m_plugins.size());
+
+    for (const Plugin &plugin : m_plugins) {
+        plugins.append(plugin.metaData);
+    }
+
+    std::sort(plugins.begin(), plugins.end(), [](const KPluginMetaData &a, const KPluginMetaData &b) {
+        return a.pluginId() < b.pluginId();
+    });
+
+    return plugins;
+}
+
+AbstractAnimation *AnimationCatalog::create(const QString &pluginId, QObject *parent)
+{
+    auto it {m_plugins.find(pluginId)};
+
+    if (it == m_plugins.end()) {
+        qCWarning(HYELICHT_ANIMATIONS) << i18n("No animation plugin with the id '%1' is installed.", pluginId);
+        return nullptr;
+    }
+
+    AnimationFactory *factory {qobject_cast<AnimationFactory *>(it->loader->instance())};
+
+    if (!factory) {
+        qCWarning(HYELICHT_ANIMATIONS) << i18n("Unable to load the animation plugin '%1': %2", pluginId,
+            it->loader->errorString());
+        return nullptr;
+    }
+
+    AbstractAnimation *animation {factory->create(parent)};
+
+    if (!animation) {
+        return nullptr;
+    }
+
+    ++it->instances;
+
+    QObject::connect(animation, &QObject::destroyed, this, [=]() { release(pluginId); });
+
+    return animation;
+}
+
+bool AnimationCatalog::isLoaded(const QString &pluginId) const
+{
+    const auto it {m_plugins.constFind(pluginId)};
+
+    return it != m_plugins.constEnd() && it->loader->isLoaded();
+}
+
+void AnimationCatalog::release(const QString &pluginId)
+{
+    auto it {m_plugins.find(pluginId)};
+
+    if (it == m_plugins.end() || --it->instances > 0) {
+        return;
+    }
+
+    // The animation's destructor is still running code from the library,
+    // so wait for control to return to the event loop.
+    QTimer::singleShot(0, this, [=]() {
+        auto it {m_plugins.find(pluginId)};
+
+        if (it != m_plugins.end() && !it->instances && it->loader->isLoaded()) {
+            it->loader->unload();
+        }
+    });
+}
@@ -0,0 +1,79 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "hyelicht_core_export.h"
+
+#include <KPluginMetaData>
+
+#include <QHash>
+#include <QObject>
+#include <QVector>
+
+class AbstractAnimation;
+class QPluginLoader;
+
+//! Catalog of the installed animation plugins
+/*!
+ * \ingroup Animation
+ *
+ * Finds the animation plugins (see AnimationFactory) when first used, reading
+ * only their metadata. A plugin's library is loaded when the first instance of
+ * its animation is created with \ref create, and unloaded again once the last
+ * one has been destroyed. Startup time and memory use therefore don't grow with
+ * the number of installed animations.
+ *
+ * \sa AnimationFactory
+ * \sa AnimationLoader
+ */
+class HYELICHT_CORE_EXPORT AnimationCatalog : public QObject
+{
+    Q_OBJECT
+
+    public:
+        //! The catalog shared by the application.
+        /*!
+        * @return An AnimationCatalog.
+        */
+        static AnimationCatalog *self();
+
+        //! The metadata of the installed animation plugins.
+        /*!
+        * @return Plugin metadata, sorted by plugin id.
+        */
+        QVector<KPluginMetaData> plugins() const;
+
+        //! Create an animation from a plugin.
+        /*!
+        * Loads the plugin's library if needed.
+        *
+        * @param pluginId Id of the plugin, e.g. \c noise.
+        * @param parent Parent object
+        * @return A new animation, or \c nullptr if the plugin is not installed or
+        * fails to load.
+        */
+        AbstractAnimation *create(const QString &pluginId, QObject *parent = nullptr);
+
+        //! Whether a plugin's library is currently loaded.
+        /*!
+        * @param pluginId Id of the plugin.
+        * @return Library loaded or not.
+        */
+        bool isLoaded(const QString &pluginId) const;
+
+    private:
+        struct Plugin {
+            KPluginMetaData metaData;
+            QPluginLoader *loader;
+            int instances;
+        };
+
+        explicit AnimationCatalog(QObject *parent = nullptr);
+
+        void release(const QString &pluginId);
+
+        QHash<QString, Plugin> m_plugins;
+};
@@ -0,0 +1,52 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include <QObject>
+
+class AbstractAnimation;
+
+//! Interface implemented by the root object of an animation plugin
+/*!
+ * \ingroup Animation
+ *
+ * Plugins are Qt plugins with this interface's IID and a JSON metadata file in
+ * the KPluginMetaData format, installed to the \c hyelicht/animations plugin
+ * namespace. The plugin id in the metadata names the animation.
+ *
+ * \code
+ * class MyPlugin : public QObject, public AnimationFactory
+ * {
+ *     Q_OBJECT
+ *     Q_PLUGIN_METADATA(IID AnimationFactory_iid FILE "myanimation.json")
+ *     Q_INTERFACES(AnimationFactory)
+ *
+ *     public:
+ *         AbstractAnimation *create(QObject *parent) override
+ *         {
+ *             return new MyAnimation(parent);
+ *         }
+ * };
+ * \endcode
+ *
+ * \sa AnimationCatalog
+ */
+class AnimationFactory
+{
+    public:
+        virtual ~AnimationFactory() = default;
+
+        //! Create an instance of the plugin's animation.
+        /*!
+        * @param parent Parent object
+        * @return A new animation.
+        */
+        virtual AbstractAnimation *create(QObject *parent) = 0;
+};
+
+#define AnimationFactory_iid "com.hyerimandeike.hyelicht.AnimationFactory/1.0"
+
+Q_DECLARE_INTERFACE(AnimationFactory, AnimationFactory_iid)
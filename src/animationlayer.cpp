@@ -0,0 +1,125 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "animationlayer.h"
+#include "renderloop.h"
+
+#include <algorithm>
+
+AnimationLayer::AnimationLayer(QObject *parent)
+    : QObject(parent)
+    , m_enabled {true}
+    , m_animation {nullptr}
+    , m_blendMode {LedStrip::Replace}
+    , m_opacity {1.0}
+{
+}
+
+AnimationLayer::~AnimationLayer()
+{
+    // The animation may outlive us, don't leave it painting into the buffer.
+    if (m_animation) {
+        m_animation->stop();
+        m_animation->setLedStrip(nullptr);
+    }
+}
+
+bool AnimationLayer::enabled() const
+{
+    return m_enabled;
+}
+
+void AnimationLayer::setEnabled(bool enabled)
+{
+    if (m_enabled != enabled) {
+        m_enabled = enabled;
+
+        // ShelfModel starts or stops the animation and calls `updateAnimation`.
+        Q_EMIT enabledChanged();
+    }
+}
+
+AbstractAnimation *AnimationLayer::animation() const
+{
+    return m_animation;
+}
+
+void AnimationLayer::setAnimation(AbstractAnimation *animation)
+{
+    if (m_animation != animation) {
+        if (m_animation) {
+            m_animation->disconnect(this);
+            m_animation->stop();
+            m_animation->setLedStrip(nullptr);
+        }
+
+        m_animation = animation;
+
+        if (m_animation) {
+            QObject::connect(m_animation, &AbstractAnimation::destroyed, this,
+                &AnimationLayer::animationChanged);
+            QObject::connect(m_animation, &AbstractAnimation::frameComplete, this,
+                &AnimationLayer::painted);
+        }
+
+        // ShelfModel starts the animation and calls `updateAnimation`.
+        Q_EMIT animationChanged();
+    }
+}
+
+LedStrip::BlendMode AnimationLayer::blendMode() const
+{
+    return m_blendMode;
+}
+
+void AnimationLayer::setBlendMode(LedStrip::BlendMode mode)
+{
+    if (m_blendMode != mode) {
+        m_blendMode = mode;
+
+        Q_EMIT blendModeChanged();
+    }
+}
+
+qreal AnimationLayer::opacity() const
+{
+    return m_opacity;
+}
+
+void AnimationLayer::setOpacity(qreal opacity)
+{
+    opacity = std::clamp(opacity, 0.0, 1.0);
+
+    if (m_opacity != opacity) {
+        m_opacity = opacity;
+
+        Q_EMIT opacityChanged();
+    }
+}
+
+const LedStrip *AnimationLayer::buffer() const
+{
+    return &m_buffer;
+}
+
+void AnimationLayer::updateAnimation(RenderLoop *renderLoop, int count,
+    const QVector<QPair<int, int>> &region, bool run)
+{
+    if (!m_animation) {
+        return;
+    }
+
+    if (!run) {
+        m_animation->stop();
+        return;
+    }
+
+    m_buffer.setCount(count);
+
+    m_animation->setLedStrip(&m_buffer);
+    m_animation->setRegion(region);
+    m_animation->setRenderLoop(renderLoop);
+    m_animation->start();
+}
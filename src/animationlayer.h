@@ -0,0 +1,213 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "hyelicht_core_export.h"
+
+#include <QObject>
+#include <QPair>
+#include <QPointer>
+#include <QVector>
+
+#include "abstractanimation.h"
+#include "ledstrip.h"
+
+class RenderLoop;
+
+//! An animation composited on top of the shelf
+/*!
+ * \ingroup Animation
+ *
+ * Runs an AbstractAnimation that paints into a private buffer rather than the
+ * shelf's LedStrip. The buffer is blended on top of the painted shelf by the
+ * LedStrip during output (see LedStrip::setLayers), using \ref blendMode and
+ * \ref opacity. This allows stacking effects, e.g. a flicker on top of painted
+ * compartments or a sparkle on top of a slow gradient, without the animations
+ * overwriting each other or the painted compartments.
+ *
+ * Layers are added to a ShelfModel via its ShelfModel::layers property. They
+ * cover the compartments not owned by a ShelfZone and run while the shelf is
+ * enabled.
+ *
+ * \sa ShelfModel
+ * \sa AbstractAnimation
+ */
+class HYELICHT_CORE_EXPORT AnimationLayer : public QObject
+{
+    Q_OBJECT
+
+    //! Toggle the layer.
+    /*!
+    * Defaults to \c true.
+    *
+    * \sa setEnabled
+    * \sa enabledChanged
+    */
+    Q_PROPERTY(bool enabled READ enabled WRITE setEnabled NOTIFY enabledChanged)
+
+    //! Animation painting this layer.
+    /*!
+    * Defaults to \c nullptr.
+    *
+    * \sa setAnimation
+    * \sa animationChanged
+    */
+    Q_PROPERTY(AbstractAnimation* animation READ animation WRITE setAnimation NOTIFY animationChanged)
+
+    //! How the layer is combined with the colors below it.
+    /*!
+    * Defaults to \c LedStrip::Replace.
+    *
+    * \sa setBlendMode
+    * \sa blendModeChanged
+    */
+    Q_PROPERTY(LedStrip::BlendMode blendMode READ blendMode WRITE setBlendMode NOTIFY blendModeChanged)
+
+    //! The layer opacity.
+    /*!
+    * Opacity is set in a range between \c 0.0 and \c 1.0.
+    *
+    * Defaults to \c 1.0.
+    *
+    * \sa setOpacity
+    * \sa opacityChanged
+    */
+    Q_PROPERTY(qreal opacity READ opacity WRITE setOpacity NOTIFY opacityChanged)
+
+    public:
+        //! Create an animation layer.
+        /*!
+        * @param parent Parent object
+        */
+        explicit AnimationLayer(QObject *parent = nullptr);
+        ~AnimationLayer() override;
+
+        //! Whether the layer is on.
+        /*!
+        * @return Layer on or off.
+        * \sa enabled (property)
+        * \sa setEnabled
+        * \sa enabledChanged
+        */
+        bool enabled() const;
+
+        //! Turn the layer on or off.
+        /*!
+        * @param enabled Layer on or off.
+        * \sa enabled
+        * \sa enabledChanged
+        */
+        void setEnabled(bool enabled);
+
+        //! The animation painting this layer.
+        /*!
+        * @return An animation.
+        * \sa animation (property)
+        * \sa setAnimation
+        * \sa animationChanged
+        */
+        AbstractAnimation *animation() const;
+
+        //! Set the animation painting this layer.
+        /*!
+        * @param animation An animation.
+        * \sa animation
+        * \sa animationChanged
+        */
+        void setAnimation(AbstractAnimation *animation);
+
+        //! How the layer is combined with the colors below it.
+        /*!
+        * @return A blend mode.
+        * \sa blendMode (property)
+        * \sa setBlendMode
+        * \sa blendModeChanged
+        */
+        LedStrip::BlendMode blendMode() const;
+
+        //! Set how the layer is combined with the colors below it.
+        /*!
+        * @param mode A blend mode.
+        * \sa blendMode
+        * \sa blendModeChanged
+        */
+        void setBlendMode(LedStrip::BlendMode mode);
+
+        //! The layer opacity.
+        /*!
+        * @return Opacity between \c 0.0 and \c 1.0.
+        * \sa opacity (property)
+        * \sa setOpacity
+        * \sa opacityChanged
+        */
+        qreal opacity() const;
+
+        //! Set the layer opacity.
+        /*!
+        * @param opacity Opacity between \c 0.0 and \c 1.0.
+        * \sa opacity
+        * \sa opacityChanged
+        */
+        void setOpacity(qreal opacity);
+
+        //! The buffer the \ref animation paints into.
+        /*!
+        * @return A LedStrip that is never written out itself.
+        */
+        const LedStrip *buffer() const;
+
+        //! Run or stop the \ref animation.
+        /*!
+        * Called by ShelfModel.
+        *
+        * @param renderLoop RenderLoop to render the animation.
+        * @param count Number of LEDs in the shelf's LedStrip.
+        * @param region Ranges of LEDs the animation paints.
+        * @param run Run or stop the animation.
+        */
+        void updateAnimation(RenderLoop *renderLoop, int count,
+            const QVector<QPair<int, int>> &region, bool run);
+
+    Q_SIGNALS:
+        //! The layer has been turned on or off.
+        /*!
+        * \sa enabled
+        * \sa setEnabled
+        */
+        void enabledChanged() const;
+
+        //! The animation painting this layer has changed.
+        /*!
+        * \sa animation
+        * \sa setAnimation
+        */
+        void animationChanged() const;
+
+        //! How the layer is combined with the colors below it has changed.
+        /*!
+        * \sa blendMode
+        * \sa setBlendMode
+        */
+        void blendModeChanged() const;
+
+        //! The layer opacity has changed.
+        /*!
+        * \sa opacity
+        * \sa setOpacity
+        */
+        void opacityChanged() const;
+
+        //! The animation has painted a new frame into the \ref buffer.
+        void painted() const;
+
+    private:
+        LedStrip m_buffer;
+
+        bool m_enabled;
+        QPointer<AbstractAnimation> m_animation;
+        LedStrip::BlendMode m_blendMode;
+        qreal m_opacity;
+};
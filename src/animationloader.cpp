@@ -0,0 +1,88 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "animationloader.h"
+#include "animationcatalog.h"
+#include "debug_animations.h"
+
+#include <KLocalizedString>
+
+AnimationLoader::AnimationLoader(QObject *parent)
+    : QObject(parent)
+{
+}
+
+AnimationLoader::~AnimationLoader()
+{
+}
+
+QString AnimationLoader::plugin() const
+{
+    return m_plugin;
+}
+
+void AnimationLoader::setPlugin(const QString &plugin)
+{
+    if (m_plugin != plugin) {
+        m_plugin = plugin;
+
+        updateAnimation();
+
+        Q_EMIT pluginChanged();
+    }
+}
+
+QVariantMap AnimationLoader::properties() const
+{
+    return m_properties;
+}
+
+void AnimationLoader::setProperties(const QVariantMap &properties)
+{
+    if (m_properties != properties) {
+        m_properties = properties;
+
+        applyProperties();
+
+        Q_EMIT propertiesChanged();
+    }
+}
+
+AbstractAnimation *AnimationLoader::animation() const
+{
+    return m_animation;
+}
+
+void AnimationLoader::updateAnimation()
+{
+    // Deferred, so users of the old animation can switch away from it
+    // first rather than seeing it destroyed.
+    if (m_animation) {
+        m_animation->stop();
+        m_animation->deleteLater();
+        m_animation = nullptr;
+    }
+
+    if (!m_plugin.isEmpty()) {
+        m_animation = AnimationCatalog::self()->create(m_plugin, this);
+        applyProperties();
+    }
+
+    Q_EMIT animationChanged();
+}
+
+void AnimationLoader::applyProperties()
+{
+    if (!m_animation) {
+        return;
+    }
+
+    for (auto it {m_properties.constBegin()}; it != m_properties.constEnd(); ++it) {
+        if (!m_animation->setProperty(it.key().toUtf8().constData(), it.value())) {
+            qCWarning(HYELICHT_ANIMATIONS) << i18n("Animation '%1' has no property '%2' that accepts: %3",
+                m_animation->name(), it.key(), it.value().toString());
+        }
+    }
+}
@@ -0,0 +1,147 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "hyelicht_core_export.h"
+
+#include <QObject>
+#include <QPointer>
+#include <QVariantMap>
+
+#include "abstractanimation.h"
+
+//! Creates an animation from a plugin for use in QML
+/*!
+ * \ingroup Animation
+ *
+ * Holds an instance of the animation provided by the plugin named by \ref plugin,
+ * e.g. to set as ShelfModel::animation. The instance is replaced when \ref plugin
+ * changes, and the plugin's library unloaded once no longer used (see
+ * AnimationCatalog).
+ *
+ * \code
+ * ShelfModel {
+ *     readonly property AnimationLoader noiseLoader: AnimationLoader {
+ *         plugin: "noise"
+ *         properties: ({ effect: "Aurora", speed: 0.5 })
+ *     }
+ *
+ *     animation: noiseLoader.animation
+ * }
+ * \endcode
+ *
+ * \sa AnimationCatalog
+ * \sa ShelfModel
+ */
+class HYELICHT_CORE_EXPORT AnimationLoader : public QObject
+{
+    Q_OBJECT
+
+    //! Id of the animation plugin to create the animation from.
+    /*!
+    * Defaults to an empty string, for no animation.
+    *
+    * \sa setPlugin
+    * \sa pluginChanged
+    */
+    Q_PROPERTY(QString plugin READ plugin WRITE setPlugin NOTIFY pluginChanged)
+
+    //! Property values to set on the animation.
+    /*!
+    * Names properties of the animation. Enum values may be given by name.
+    *
+    * \sa setProperties
+    * \sa propertiesChanged
+    */
+    Q_PROPERTY(QVariantMap properties READ properties WRITE setProperties NOTIFY propertiesChanged)
+
+    //! The animation created from \ref plugin.
+    /*!
+    * \c nullptr while \ref plugin is empty or fails to load.
+    *
+    * \sa animationChanged
+    */
+    Q_PROPERTY(AbstractAnimation* animation READ animation NOTIFY animationChanged)
+
+    public:
+        //! Create an animation loader.
+        /*!
+        * @param parent Parent object
+        */
+        explicit AnimationLoader(QObject *parent = nullptr);
+        ~AnimationLoader() override;
+
+        //! The id of the animation plugin to create the animation from.
+        /*!
+        * @return A plugin id.
+        * \sa plugin (property)
+        * \sa setPlugin
+        * \sa pluginChanged
+        */
+        QString plugin() const;
+
+        //! Set the id of the animation plugin to create the animation from.
+        /*!
+        * @param plugin A plugin id, or an empty string for no animation.
+        * \sa plugin
+        * \sa pluginChanged
+        */
+        void setPlugin(const QString &plugin);
+
+        //! The property values to set on the animation.
+        /*!
+        * @return Values by property name.
+        * \sa properties (property)
+        * \sa setProperties
+        * \sa propertiesChanged
+        */
+        QVariantMap properties() const;
+
+        //! Set the property values to set on the animation.
+        /*!
+        * @param properties Values by property name.
+        * \sa properties
+        * \sa propertiesChanged
+        */
+        void setProperties(const QVariantMap &properties);
+
+        //! The animation created from \ref plugin.
+        /*!
+        * @return An animation, or \c nullptr.
+        * \sa animation (property)
+        * \sa animationChanged
+        */
+        AbstractAnimation *animation() const;
+
+    Q_SIGNALS:
+        //! The id of the animation plugin has changed.
+        /*!
+        * \sa plugin
+        * \sa setPlugin
+        */
+        void pluginChanged() const;
+
+        //! The property values to set on the animation have changed.
+        /*!
+        * \sa properties
+        * \sa setProperties
+        */
+        void propertiesChanged() const;
+
+        //! The animation has been replaced.
+        /*!
+        * \sa animation
+        */
+        void animationChanged() const;
+
+    private:
+        void updateAnimation();
+        void applyProperties();
+
+        QString m_plugin;
+        QVariantMap m_properties;
+        QPointer<AbstractAnimation> m_animation;
+};
@@ -0,0 +1,350 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "animationclip.h"
+#include "abstractanimation.h"
+#include "debug_animations.h"
+#include "ledstrip.h"
+
+#include <KLocalizedString>
+
+#include <QByteArray>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char clipMagic[4] {'H', 'Y', 'C', 'L'};
+const quint32 clipVersion {1};
+
+struct ClipHeader {
+    char magic[4];
+    quint32 version;
+    quint32 count;
+    quint32 frameCount;
+    quint32 interval;
+    quint32 nameSize; // In bytes, padded to a multiple of four.
+    quint32 reserved[2];
+};
+
+static_assert(sizeof(ClipHeader) == 32, "Unexpected clip file header size");
+
+void appendWords(QByteArray &out, const quint32 *words, int count)
+{
+    out.append(reinterpret_cast<const char *>(words), count * sizeof(quint32));
+}
+
+// Appends the runs of LEDs in `current` that differ from `previous`, each
+// as the number of LEDs skipped since the last run, the run length and the
+// LED data.
+void appendDelta(QByteArray &out, const uint32_t *previous, const uint32_t *current, int count)
+{
+    int position {0};
+    int i {0};
+
+    while (true) {
+        while (i < count && current[i] == previous[i]) {
+            ++i;
+        }
+
+        if (i == count) {
+            break;
+        }
+
+        const int first {i};
+        int last {i};
+
+        while (i < count) {
+            if (current[i] != previous[i]) {
+                last = ++i;
+                continue;
+            }
+
+            // Short gaps cost no more to store than the header of a new run.
+            if (i - last >= 2) {
+                break;
+            }
+
+            ++i;
+        }
+
+        const quint32 run[2] {static_cast<quint32>(first - position), static_cast<quint32>(last - first)};
+        appendWords(out, run, 2);
+        appendWords(out, current + first, last - first);
+
+        position = last;
+        i = last;
+    }
+}
+
+}
+
+AnimationClip::AnimationClip(const QString &fileName)
+    : m_data {nullptr}
+    , m_size {0}
+    , m_count {0}
+    , m_frameCount {0}
+    , m_interval {0}
+    , m_offsets {nullptr}
+{
+    if (!fileName.isEmpty()) {
+        open(fileName);
+    }
+}
+
+AnimationClip::~AnimationClip()
+{
+    close();
+}
+
+QString AnimationClip::fileName() const
+{
+    return m_file.fileName();
+}
+
+bool AnimationClip::open(const QString &fileName)
+{
+    close();
+
+    m_file.setFileName(fileName);
+
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qCWarning(HYELICHT_ANIMATIONS) << i18n("Unable to open the clip file: %1", m_file.errorString());
+        return false;
+    }
+
+    m_size = m_file.size();
+    m_data = m_size >= static_cast<qint64>(sizeof(ClipHeader)) ? m_file.map(0, m_size) : nullptr;
+
+    const ClipHeader *header {reinterpret_cast<const ClipHeader *>(m_data)};
+
+    bool valid {header
+        && memcmp(header->magic, clipMagic, sizeof(clipMagic)) == 0
+        && header->version == clipVersion
+        && header->count > 0 && header->count <= 0xFFFFFF
+        && header->frameCount > 0 && header->frameCount <= 0xFFFFFF
+        && header->interval > 0
+        && header->nameSize % 4 == 0};
+
+    const qint64 offsetsStart {static_cast<qint64>(sizeof(ClipHeader)) + (valid ? header->nameSize : 0)};
+    const qint64 offsetsSize {valid ? (header->frameCount + 2) * static_cast<qint64>(sizeof(quint32)) : 0};
+
+    valid = valid && offsetsStart + offsetsSize <= m_size;
+
+    if (valid) {
+        m_offsets = reinterpret_cast<const quint32 *>(m_data + offsetsStart);
+
+        // The keyframe holds every LED.
+        valid = m_offsets[0] == offsetsStart + offsetsSize
+            && m_offsets[1] - m_offsets[0] == header->count * sizeof(uint32_t);
+
+        // Walk the runs of each delta once, so playback can trust them.
+        for (quint32 i {1}; valid && i <= header->frameCount; ++i) {
+            const quint32 start {m_offsets[i]};
+            const quint32 end {m_offsets[i + 1]};
+
+            if (start > end || end > m_size || start % 4 || end % 4) {
+                valid = false;
+                break;
+            }
+
+            const quint32 *word {reinterpret_cast<const quint32 *>(m_data + start)};
+            const quint32 *wordsEnd {reinterpret_cast<const quint32 *>(m_data + end)};
+            quint64 position {0};
+
+            while (valid && word < wordsEnd) {
+                valid = wordsEnd - word >= 2
+                    && static_cast<quint64>(wordsEnd - word - 2) >= word[1];
+
+                if (valid) {
+                    position += static_cast<quint64>(word[0]) + word[1];
+                    valid = position <= header->count;
+                    word += 2 + word[1];
+                }
+            }
+        }
+    }
+
+    if (!valid) {
+        qCWarning(HYELICHT_ANIMATIONS) << i18n("Ignoring invalid clip file: %1", fileName);
+        close();
+        return false;
+    }
+
+    m_name = QString::fromUtf8(reinterpret_cast<const char *>(m_data + sizeof(ClipHeader)),
+        strnlen(reinterpret_cast<const char *>(m_data + sizeof(ClipHeader)), header->nameSize));
+    m_count = header->count;
+    m_frameCount = header->frameCount;
+    m_interval = header->interval;
+
+    return true;
+}
+
+void AnimationClip::close()
+{
+    if (m_data) {
+        m_file.unmap(const_cast<uchar *>(m_data));
+        m_data = nullptr;
+    }
+
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+
+    m_size = 0;
+    m_name.clear();
+    m_count = 0;
+    m_frameCount = 0;
+    m_interval = 0;
+    m_offsets = nullptr;
+}
+
+bool AnimationClip::isValid() const
+{
+    return m_offsets;
+}
+
+QString AnimationClip::name() const
+{
+    return m_name;
+}
+
+int AnimationClip::count() const
+{
+    return m_count;
+}
+
+int AnimationClip::frameCount() const
+{
+    return m_frameCount;
+}
+
+int AnimationClip::interval() const
+{
+    return m_interval;
+}
+
+void AnimationClip::applyKeyframe(uint32_t *data) const
+{
+    memcpy(data, m_data + m_offsets[0], m_count * sizeof(uint32_t));
+}
+
+void AnimationClip::applyFrame(int index, uint32_t *data) const
+{
+    const quint32 *word {reinterpret_cast<const quint32 *>(m_data + m_offsets[index + 1])};
+    const quint32 *end {reinterpret_cast<const quint32 *>(m_data + m_offsets[index + 2])};
+    int position {0};
+
+    while (word < end) {
+        position += word[0];
+
+        const quint32 length {word[1]};
+        memcpy(data + position, word + 2, length * sizeof(uint32_t));
+
+        position += length;
+        word += 2 + length;
+    }
+}
+
+bool AnimationClip::bake(AbstractAnimation *animation, const BakeOptions &options,
+    const QString &fileName)
+{
+    if (!animation || options.count < 1 || options.frames < 1 || options.interval < 1) {
+        qCWarning(HYELICHT_ANIMATIONS) << i18n("bake: Invalid clip parameters.");
+        return false;
+    }
+
+    const int count {options.count};
+    const int frames {options.frames};
+    const int crossfade {std::clamp(options.crossfade, 0, frames)};
+
+    // A disabled strip never opens the SPI device.
+    LedStrip ledStrip {count};
+    ledStrip.clear();
+
+    animation->setLedStrip(&ledStrip);
+    animation->setRegion({});
+    animation->setSquares(options.squares);
+
+    for (int elapsed {0}; elapsed < options.warmup; elapsed += options.interval) {
+        animation->renderOffline(options.interval, elapsed == 0 /* restart */);
+    }
+
+    QVector<uint32_t> rendered((frames + crossfade) * count);
+
+    for (int i {0}; i < frames + crossfade; ++i) {
+        animation->renderOffline(options.interval, i == 0 && options.warmup <= 0 /* restart */);
+        memcpy(rendered.data() + i * count, ledStrip.constData(), count * sizeof(uint32_t));
+    }
+
+    animation->setLedStrip(nullptr);
+
+    // Blend the frames rendered past the end into the beginning, so the last
+    // frame leads into the first.
+    for (int i {0}; i < crossfade; ++i) {
+        const int weight {(256 * (i + 1)) / (crossfade + 1)};
+        uint8_t *out {reinterpret_cast<uint8_t *>(rendered.data() + i * count)};
+        const uint8_t *in {reinterpret_cast<const uint8_t *>(rendered.constData() + (frames + i) * count)};
+
+        for (int led {0}; led < count; ++led) {
+            for (int channel {1}; channel < 4; ++channel) {
+                const int index {led * 4 + channel};
+                out[index] = (in[index] * (256 - weight) + out[index] * weight) >> 8;
+            }
+        }
+    }
+
+    QByteArray name {animation->name().toUtf8()};
+    name.append(4 - (name.size() % 4), '\0');
+
+    ClipHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, clipMagic, sizeof(clipMagic));
+    header.version = clipVersion;
+    header.count = count;
+    header.frameCount = frames;
+    header.interval = options.interval;
+    header.nameSize = name.size();
+
+    const quint32 dataStart {static_cast<quint32>(sizeof(ClipHeader) + name.size()
+        + (frames + 2) * sizeof(quint32))};
+
+    QVector<quint32> offsets;
+    offsets.reserve(frames + 2);
+
+    QByteArray data;
+    offsets.append(dataStart);
+    appendWords(data, rendered.constData(), count);
+
+    for (int i {0}; i < frames; ++i) {
+        const uint32_t *previous {rendered.constData() + (i ? i - 1 : frames - 1) * count};
+
+        offsets.append(dataStart + data.size());
+        appendDelta(data, previous, rendered.constData() + i * count, count);
+    }
+
+    offsets.append(dataStart + data.size());
+
+    QSaveFile file {fileName};
+
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(HYELICHT_ANIMATIONS) << i18n("Unable to write the clip file: %1", file.errorString());
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(name);
+    file.write(reinterpret_cast<const char *>(offsets.constData()), offsets.size() * sizeof(quint32));
+    file.write(data);
+
+    if (!file.commit()) {
+        qCWarning(HYELICHT_ANIMATIONS) << i18n("Unable to write the clip file: %1", file.errorString());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,126 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "hyelicht_core_export.h"
+
+#include <QFile>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+#include <cstdint>
+
+class AbstractAnimation;
+
+//! A pre-rendered, looping sequence of animation frames in a memory-mapped file
+/*!
+ * \ingroup Animation
+ *
+ * Clips are created by rendering an AbstractAnimation ahead of time with \ref bake
+ * and played back by ClipAnimation, turning expensive effects into copying a
+ * few bytes per frame.
+ *
+ * The file consists of a fixed-size header, the clip name, a table of frame
+ * offsets, a keyframe holding the full first frame, and one delta per frame.
+ * Each delta only stores the runs of LEDs that changed from the previous frame,
+ * in the LedStrip data format. The delta of the first frame is relative to the
+ * last, so clips loop without a seam.
+ *
+ * Files are validated once when opened and then read straight from the mapping.
+ *
+ * \sa ClipAnimation
+ */
+class HYELICHT_CORE_EXPORT AnimationClip
+{
+    public:
+        //! Parameters for baking a clip.
+        struct BakeOptions {
+            int count {0}; //!< Number of LEDs.
+            QVector<QPair<int, int>> squares; //!< LED ranges of the shelf compartments.
+            int frames {300}; //!< Number of frames in the clip.
+            int interval {33}; //!< Time between frames in milliseconds.
+            int warmup {0}; //!< Time to run the animation before recording, in milliseconds.
+            int crossfade {0}; //!< Number of frames blended across the loop point.
+        };
+
+        //! Create a clip.
+        /*!
+        * @param fileName Path to the clip file.
+        */
+        explicit AnimationClip(const QString &fileName = QString());
+        ~AnimationClip();
+
+        //! Path to the clip file.
+        QString fileName() const;
+
+        //! Map and validate a clip file.
+        /*!
+        * Unmaps a previously opened file.
+        *
+        * @param fileName Path to the clip file.
+        * @return Whether the file is a valid clip.
+        */
+        bool open(const QString &fileName);
+
+        //! Unmap and close the clip file.
+        void close();
+
+        //! Whether a valid clip is open.
+        bool isValid() const;
+
+        //! The name of the baked animation.
+        QString name() const;
+
+        //! The number of LEDs per frame.
+        int count() const;
+
+        //! The number of frames in the clip.
+        int frameCount() const;
+
+        //! The time between frames in milliseconds.
+        int interval() const;
+
+        //! Write the full first frame.
+        /*!
+        * @param data Buffer of \ref count LEDs.
+        */
+        void applyKeyframe(uint32_t *data) const;
+
+        //! Advance a frame to the next one.
+        /*!
+        * @param index Index of the frame to advance to. Index \c 0 follows the last frame.
+        * @param data Buffer of \ref count LEDs holding the previous frame.
+        */
+        void applyFrame(int index, uint32_t *data) const;
+
+        //! Render an animation into a clip file.
+        /*!
+        * Renders \ref BakeOptions::frames frames at a fixed interval with
+        * AbstractAnimation::renderOffline. With \ref BakeOptions::crossfade, that
+        * many frames are rendered past the end of the clip and blended into its
+        * beginning.
+        *
+        * @param animation Animation to render. Its \ref AbstractAnimation::ledStrip is
+        * replaced.
+        * @param options Clip parameters.
+        * @param fileName Path to the clip file to write.
+        * @return Success.
+        */
+        static bool bake(AbstractAnimation *animation, const BakeOptions &options,
+            const QString &fileName);
+
+    private:
+        QFile m_file;
+        const uchar *m_data;
+        qint64 m_size;
+
+        QString m_name;
+        int m_count;
+        int m_frameCount;
+        int m_interval;
+        const quint32 *m_offsets;
+};
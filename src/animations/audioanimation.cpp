@@ -0,0 +1,249 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "audioanimation.h"
+#include "debug_animations.h"
+#include "ledstrip.h"
+
+#include <KLocalizedString>
+
+#include <QDeadlineTimer>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const qint64 statisticsInterval {10000}; // Milliseconds.
+
+const float flashDecay {5.0f}; // Full flash per second.
+const float flashStrength {0.6f};
+
+// Hues from red for the bass to violet for the treble.
+const float highestHue {0.8f};
+
+}
+
+AudioAnimation::AudioAnimation(QObject *parent)
+    : AbstractAnimation(parent)
+    , m_columnCount {0}
+    , m_rowCount {0}
+    , m_flash {0.0f}
+    , m_renderedCapture {0}
+    , m_latencySum {0}
+    , m_latencyMax {0}
+    , m_latencyCount {0}
+{
+    setFrameBudget(1000);
+
+    QObject::connect(&m_input, &AudioInput::sourceChanged, this, &AudioAnimation::sourceChanged);
+    QObject::connect(&m_input, &AudioInput::sampleRateChanged, this, &AudioAnimation::sampleRateChanged);
+    QObject::connect(&m_input, &AudioInput::channelsChanged, this, &AudioAnimation::channelsChanged);
+
+    // Capture only while running.
+    QObject::connect(this, &AbstractAnimation::runningChanged, this,
+        [this](bool running) {
+            if (running) {
+                m_statisticsClock.start();
+                m_input.start();
+            } else {
+                m_input.stop();
+            }
+        }
+    );
+
+    // frameComplete precedes writing out the LED strip, so measure once
+    // control returns to the event loop.
+    QObject::connect(this, &AbstractAnimation::frameComplete, this,
+        [this]() {
+            const qint64 captureTime {m_renderedCapture.exchange(0)};
+
+            if (captureTime) {
+                QMetaObject::invokeMethod(this, [this, captureTime]() { measureLatency(captureTime); },
+                    Qt::QueuedConnection);
+            }
+        }
+    );
+
+    const auto queueLayout = [this]() {
+        updateRenderState([this]() { updateLayout(); });
+    };
+
+    QObject::connect(this, &AbstractAnimation::squaresChanged, this, queueLayout);
+    QObject::connect(this, &AbstractAnimation::regionChanged, this, queueLayout);
+}
+
+AudioAnimation::~AudioAnimation()
+{
+    stop();
+}
+
+QString AudioAnimation::name() const
+{
+    return i18n("Audio");
+}
+
+QString AudioAnimation::source() const
+{
+    return m_input.source();
+}
+
+void AudioAnimation::setSource(const QString &source)
+{
+    if (m_input.source() == source) {
+        return;
+    }
+
+    m_input.setSource(source);
+
+    if (running()) {
+        m_input.stop();
+        m_input.start();
+    }
+}
+
+int AudioAnimation::sampleRate() const
+{
+    return m_input.sampleRate();
+}
+
+void AudioAnimation::setSampleRate(int sampleRate)
+{
+    m_input.setSampleRate(sampleRate);
+}
+
+int AudioAnimation::channels() const
+{
+    return m_input.channels();
+}
+
+void AudioAnimation::setChannels(int channels)
+{
+    m_input.setChannels(channels);
+}
+
+void AudioAnimation::renderFrame(const Frame &frame)
+{
+    LedStrip *ledStrip {canvas()};
+
+    if (!ledStrip) {
+        stop();
+        return;
+    }
+
+    const bool heard {m_input.takeFeatures(m_features)};
+
+    if (heard && m_features.onset) {
+        m_flash = 1.0f;
+    }
+
+    // Nothing new to show.
+    if (!heard && m_flash <= 0.0f) {
+        return;
+    }
+
+    const int leds {static_cast<int>(m_layout.leds.size())};
+
+    if (!leds) {
+        return;
+    }
+
+    // Each column shows the loudest of its bands.
+    float *levels {m_levels.data()};
+
+    for (int column {0}; column < m_columnCount; ++column) {
+        const int first {column * AudioFeatures::Bands / m_columnCount};
+        const int last {std::max(first + 1, (column + 1) * AudioFeatures::Bands / m_columnCount)};
+
+        levels[column] = *std::max_element(m_features.levels + first, m_features.levels + last);
+    }
+
+    const float flash {m_flash * flashStrength};
+    const int count {ledStrip->count()};
+    uint8_t *data {reinterpret_cast<uint8_t *>(ledStrip->data())};
+
+    for (int i {0}; i < leds; ++i) {
+        const int led {m_layout.leds.at(i)};
+
+        if (led >= count) {
+            continue;
+        }
+
+        const int column {m_columns.at(i)};
+
+        // Rows fill up from the bottom, the topmost one partially.
+        const float fill {std::clamp(levels[column] * m_rowCount - m_rows.at(i), 0.0f, 1.0f)};
+        const QColor &color {m_colors.at(column)};
+
+        const auto mix = [&](float component) {
+            return static_cast<uint8_t>(std::lround((component * fill * (1.0f - flash) + flash) * 255.0f));
+        };
+
+        uint8_t *ptr {data + led * 4};
+        ptr[1] = mix(color.blueF());
+        ptr[2] = mix(color.greenF());
+        ptr[3] = mix(color.redF());
+    }
+
+    m_flash = std::max(0.0f, m_flash - flashDecay * frame.delta / 1000.0f);
+
+    if (heard) {
+        m_renderedCapture = m_features.captureTime;
+    }
+
+    presentFrame();
+}
+
+void AudioAnimation::updateLayout()
+{
+    m_layout = ledLayout();
+
+    const int leds {static_cast<int>(m_layout.leds.size())};
+
+    m_columnCount = 0;
+    m_rowCount = 0;
+
+    for (int i {0}; i < leds; ++i) {
+        m_columnCount = std::max(m_columnCount, static_cast<int>(m_layout.x.at(i)) + 1);
+        m_rowCount = std::max(m_rowCount, static_cast<int>(m_layout.y.at(i)) + 1);
+    }
+
+    m_columns.resize(leds);
+    m_rows.resize(leds);
+
+    for (int i {0}; i < leds; ++i) {
+        m_columns[i] = static_cast<int>(m_layout.x.at(i));
+        m_rows[i] = m_rowCount - 1 - static_cast<int>(m_layout.y.at(i));
+    }
+
+    m_levels.resize(m_columnCount);
+    m_colors.resize(m_columnCount);
+
+    for (int column {0}; column < m_columnCount; ++column) {
+        m_colors[column] = QColor::fromHsvF(highestHue * column / std::max(1, m_columnCount - 1), 1.0f, 1.0f);
+    }
+}
+
+void AudioAnimation::measureLatency(qint64 captureTime)
+{
+    const int latency {static_cast<int>((QDeadlineTimer::current(Qt::PreciseTimer).deadlineNSecs()
+        - captureTime) / 1000)};
+
+    m_latencySum += latency;
+    m_latencyMax = std::max(m_latencyMax, latency);
+    ++m_latencyCount;
+
+    if (m_statisticsClock.isValid() && m_statisticsClock.elapsed() >= statisticsInterval) {
+        qCDebug(HYELICHT_ANIMATIONS) << i18n("Audio latency: %1 µs on average, %2 µs at most, over "
+            "%3 frames.", m_latencySum / m_latencyCount, m_latencyMax, m_latencyCount);
+
+        m_statisticsClock.restart();
+        m_latencySum = 0;
+        m_latencyMax = 0;
+        m_latencyCount = 0;
+    }
+
+    Q_EMIT latencyMeasured(latency);
+}
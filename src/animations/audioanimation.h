@@ -0,0 +1,183 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "abstractanimation.h"
+#include "audioinput.h"
+
+#include <QColor>
+#include <QElapsedTimer>
+#include <QVector>
+
+#include <atomic>
+
+//! Animation turning the shelf into a spectrum analyzer
+/*!
+ * \ingroup Animation
+ *
+ * Captures audio with an AudioInput while running. Each column of compartments
+ * shows a range of frequency bands, from the bass on the left to the treble on
+ * the right, filling up from the bottom row with their loudness. Beat onsets
+ * flash the shelf white.
+ *
+ * Every frame shows the newest analyzed audio. How long audio takes from being
+ * captured to being written out to the LED strip is reported by
+ * \ref latencyMeasured.
+ *
+ * \sa AudioInput
+ * \sa AbstractAnimation
+ */
+class AudioAnimation : public AbstractAnimation
+{
+    Q_OBJECT
+
+    //! Where to capture audio from.
+    /*!
+    * See AudioInput::source. Takes effect immediately while running.
+    *
+    * \sa setSource
+    * \sa sourceChanged
+    */
+    Q_PROPERTY(QString source READ source WRITE setSource NOTIFY sourceChanged)
+
+    //! Sample rate of ALSA and FIFO sources in Hz.
+    /*!
+    * \sa AudioInput::sampleRate
+    * \sa sampleRateChanged
+    */
+    Q_PROPERTY(int sampleRate READ sampleRate WRITE setSampleRate NOTIFY sampleRateChanged)
+
+    //! Number of channels of ALSA and FIFO sources.
+    /*!
+    * \sa AudioInput::channels
+    * \sa channelsChanged
+    */
+    Q_PROPERTY(int channels READ channels WRITE setChannels NOTIFY channelsChanged)
+
+    public:
+        //! Create an audio animation.
+        /*!
+        * @param parent Parent object
+        */
+        explicit AudioAnimation(QObject *parent = nullptr);
+        ~AudioAnimation() override;
+
+        //! The name of this animation.
+        /*!
+        * @return "Audio".
+        */
+        QString name() const override;
+
+        //! Where to capture audio from.
+        /*!
+        * @return A source.
+        * \sa source (property)
+        * \sa setSource
+        * \sa sourceChanged
+        */
+        QString source() const;
+
+        //! Set where to capture audio from.
+        /*!
+        * @param source A source, see AudioInput::source.
+        * \sa source
+        * \sa sourceChanged
+        */
+        void setSource(const QString &source);
+
+        //! The sample rate of ALSA and FIFO sources.
+        /*!
+        * @return Sample rate in Hz.
+        * \sa sampleRate (property)
+        * \sa setSampleRate
+        * \sa sampleRateChanged
+        */
+        int sampleRate() const;
+
+        //! Set the sample rate of ALSA and FIFO sources.
+        /*!
+        * @param sampleRate Sample rate in Hz.
+        * \sa sampleRate
+        * \sa sampleRateChanged
+        */
+        void setSampleRate(int sampleRate);
+
+        //! The number of channels of ALSA and FIFO sources.
+        /*!
+        * @return \c 1 or \c 2.
+        * \sa channels (property)
+        * \sa setChannels
+        * \sa channelsChanged
+        */
+        int channels() const;
+
+        //! Set the number of channels of ALSA and FIFO sources.
+        /*!
+        * @param channels \c 1 or \c 2.
+        * \sa channels
+        * \sa channelsChanged
+        */
+        void setChannels(int channels);
+
+    Q_SIGNALS:
+        //! Where to capture audio from has changed.
+        /*!
+        * \sa source
+        * \sa setSource
+        */
+        void sourceChanged() const;
+
+        //! The sample rate of ALSA and FIFO sources has changed.
+        /*!
+        * \sa sampleRate
+        * \sa setSampleRate
+        */
+        void sampleRateChanged() const;
+
+        //! The number of channels of ALSA and FIFO sources has changed.
+        /*!
+        * \sa channels
+        * \sa setChannels
+        */
+        void channelsChanged() const;
+
+        //! A frame showing new audio has been written out.
+        /*!
+        * Emitted on the GUI thread once the LED strip has been updated.
+        *
+        * @param microseconds Time from capturing the newest audio shown in the
+        * frame until the frame was written out.
+        */
+        void latencyMeasured(int microseconds) const;
+
+    protected:
+        void renderFrame(const Frame &frame) override;
+
+    private:
+        void updateLayout();
+        void measureLatency(qint64 captureTime);
+
+        AudioInput m_input;
+
+        LedLayout m_layout;
+        QVector<int> m_columns; // Per painted LED.
+        QVector<int> m_rows; // Per painted LED, counted from the bottom.
+        QVector<float> m_levels; // Per column.
+        QVector<QColor> m_colors; // Per column.
+        int m_columnCount;
+        int m_rowCount;
+
+        AudioFeatures m_features;
+        float m_flash;
+
+        // When the audio shown in the latest rendered frame was captured.
+        std::atomic<qint64> m_renderedCapture;
+
+        QElapsedTimer m_statisticsClock;
+        qint64 m_latencySum;
+        int m_latencyMax;
+        int m_latencyCount;
+};
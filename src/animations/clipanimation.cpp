@@ -0,0 +1,110 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "clipanimation.h"
+#include "ledstrip.h"
+
+#include <KLocalizedString>
+
+#include <algorithm>
+#include <cstring>
+
+ClipAnimation::ClipAnimation(QObject *parent)
+    : AbstractAnimation(parent)
+    , m_clip {std::make_shared<AnimationClip>()}
+    , m_position {-1}
+    , m_startTime {0}
+{
+}
+
+ClipAnimation::~ClipAnimation()
+{
+    stop();
+}
+
+QString ClipAnimation::name() const
+{
+    return m_clipName.isEmpty() ? i18n("Clip") : m_clipName;
+}
+
+QString ClipAnimation::source() const
+{
+    return m_source;
+}
+
+void ClipAnimation::setSource(const QString &source)
+{
+    if (m_source == source) {
+        return;
+    }
+
+    m_source = source;
+
+    // Opened here, so the render thread only ever switches over.
+    std::shared_ptr<AnimationClip> clip {std::make_shared<AnimationClip>()};
+
+    if (!m_source.isEmpty()) {
+        clip->open(m_source);
+    }
+
+    m_clipName = clip->name();
+
+    updateRenderState([this, clip]() {
+        m_clip = clip;
+
+        // Decoding happens in this buffer, so frames can be applied in full
+        // and only the region copied out.
+        m_frame.fill(0, m_clip->count());
+        m_position = -1;
+    });
+
+    Q_EMIT sourceChanged();
+}
+
+void ClipAnimation::renderFrame(const Frame &frame)
+{
+    LedStrip *ledStrip {canvas()};
+
+    if (!ledStrip) {
+        stop();
+        return;
+    }
+
+    if (!m_clip->isValid()) {
+        return;
+    }
+
+    // Start over from the keyframe when started or given a new clip.
+    if (m_position < 0 || !frame.index) {
+        m_clip->applyKeyframe(m_frame.data());
+        m_position = 0;
+        m_startTime = frame.time;
+    } else {
+        // Follow the clock, so dropped frames don't slow playback down.
+        const int frameCount {m_clip->frameCount()};
+        const int position {static_cast<int>(((frame.time - m_startTime) / m_clip->interval()) % frameCount)};
+
+        if (position == m_position) {
+            return;
+        }
+
+        while (m_position != position) {
+            m_position = (m_position + 1) % frameCount;
+            m_clip->applyFrame(m_position, m_frame.data());
+        }
+    }
+
+    const int count {std::min(ledStrip->count(), m_clip->count())};
+    uint32_t *data {ledStrip->data()};
+
+    for (const QPair<int, int> &range : paintRanges()) {
+        if (range.first < count) {
+            memcpy(data + range.first, m_frame.constData() + range.first,
+                (std::min(range.second, count - 1) - range.first + 1) * sizeof(uint32_t));
+        }
+    }
+
+    presentFrame();
+}
@@ -0,0 +1,96 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "hyelicht_core_export.h"
+
+#include "abstractanimation.h"
+#include "animationclip.h"
+
+#include <QString>
+#include <QVector>
+
+#include <memory>
+
+//! Animation playing back a pre-rendered AnimationClip
+/*!
+ * \ingroup Animation
+ *
+ * Loops a clip baked with AnimationClip::bake at the clip's frame interval. Each
+ * frame applies the clip's stored changes to the previous one and copies the
+ * result into the LedStrip, so even effects that are expensive to compute cost
+ * next to nothing to play.
+ *
+ * Clips baked for a different number of LEDs are played back on as many LEDs as
+ * both have in common.
+ *
+ * \sa AnimationClip
+ * \sa AbstractAnimation
+ */
+class HYELICHT_CORE_EXPORT ClipAnimation : public AbstractAnimation
+{
+    Q_OBJECT
+
+    //! Path to the clip file to play.
+    /*!
+    * \sa setSource
+    * \sa sourceChanged
+    */
+    Q_PROPERTY(QString source READ source WRITE setSource NOTIFY sourceChanged)
+
+    public:
+        //! Create a clip animation.
+        /*!
+        * @param parent Parent object
+        */
+        explicit ClipAnimation(QObject *parent = nullptr);
+        ~ClipAnimation() override;
+
+        //! The name of this animation.
+        /*!
+        * @return The name of the animation the clip was baked from, or "Clip".
+        */
+        QString name() const override;
+
+        //! The path to the clip file to play.
+        /*!
+        * @return A file path.
+        * \sa source (property)
+        * \sa setSource
+        * \sa sourceChanged
+        */
+        QString source() const;
+
+        //! Set the path to the clip file to play.
+        /*!
+        * @param source A file path.
+        * \sa source
+        * \sa sourceChanged
+        */
+        void setSource(const QString &source);
+
+    Q_SIGNALS:
+        //! The path to the clip file to play has changed.
+        /*!
+        * \sa source
+        * \sa setSource
+        */
+        void sourceChanged() const;
+
+    protected:
+        void renderFrame(const Frame &frame) override;
+
+    private:
+        QString m_source;
+        QString m_clipName;
+
+        // Only used by renderFrame, or through updateRenderState.
+        std::shared_ptr<AnimationClip> m_clip;
+
+        QVector<uint32_t> m_frame;
+        int m_position;
+        qint64 m_startTime;
+};
@@ -0,0 +1,923 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "expression.h"
+
+#include <KLocalizedString>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+#include <utility>
+
+namespace {
+
+// Number of LEDs held by a register.
+const int blockSize {256};
+
+// Keep formulas from the HTTP API from exhausting the stack or memory.
+const int maxNodes {1024};
+const int maxDepth {64};
+
+enum class Operation : uint8_t {
+    Add, Subtract, Multiply, Divide, Modulo, Power,
+    Negate, Not,
+    Less, LessEqual, Greater, GreaterEqual, Equal, NotEqual, And, Or,
+    Select,
+    Sin, Cos, Tan, Asin, Acos, Atan, Atan2,
+    Sqrt, Exp, Log, Abs, Sign, Floor, Ceil, Fract,
+    Min, Max, Clamp, Mix, Step, Smoothstep, Random,
+    Count
+};
+
+struct Function {
+    const char *name;
+    Operation operation;
+    int arity;
+};
+
+const Function functions[] {
+    {"sin", Operation::Sin, 1},
+    {"cos", Operation::Cos, 1},
+    {"tan", Operation::Tan, 1},
+    {"asin", Operation::Asin, 1},
+    {"acos", Operation::Acos, 1},
+    {"atan", Operation::Atan, 1},
+    {"atan2", Operation::Atan2, 2},
+    {"sqrt", Operation::Sqrt, 1},
+    {"exp", Operation::Exp, 1},
+    {"log", Operation::Log, 1},
+    {"pow", Operation::Power, 2},
+    {"abs", Operation::Abs, 1},
+    {"sign", Operation::Sign, 1},
+    {"floor", Operation::Floor, 1},
+    {"ceil", Operation::Ceil, 1},
+    {"fract", Operation::Fract, 1},
+    {"mod", Operation::Modulo, 2},
+    {"min", Operation::Min, 2},
+    {"max", Operation::Max, 2},
+    {"clamp", Operation::Clamp, 3},
+    {"mix", Operation::Mix, 3},
+    {"step", Operation::Step, 2},
+    {"smoothstep", Operation::Smoothstep, 3},
+    {"rand", Operation::Random, 1}
+};
+
+// The variables, numbered like the registers and scalars holding them.
+enum Input {
+    X,
+    Y,
+    Square,
+    Time
+};
+
+const int inputRegisters {3};
+
+// t as copied into registers wraps after a whole number of turns, keeping
+// sin(t), cos(2 * t) and the like continuous, since a float only resolves
+// milliseconds for a few hours.
+const double timePeriod {1000 * 2 * M_PI}; // Seconds.
+
+inline float hash(float value)
+{
+    uint32_t h;
+    std::memcpy(&h, &value, sizeof(h));
+
+    h ^= h >> 16;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15;
+    h *= 0x846CA68Bu;
+    h ^= h >> 16;
+
+    return (h >> 8) * (1.0f / 16777216.0f);
+}
+
+template<Operation operation, typename T>
+inline T compute(T a, [[maybe_unused]] T b, [[maybe_unused]] T c)
+{
+    if constexpr (operation == Operation::Add) {
+        return a + b;
+    } else if constexpr (operation == Operation::Subtract) {
+        return a - b;
+    } else if constexpr (operation == Operation::Multiply) {
+        return a * b;
+    } else if constexpr (operation == Operation::Divide) {
+        return a / b;
+    } else if constexpr (operation == Operation::Modulo) {
+        return a - b * std::floor(a / b);
+    } else if constexpr (operation == Operation::Power) {
+        return std::pow(a, b);
+    } else if constexpr (operation == Operation::Negate) {
+        return -a;
+    } else if constexpr (operation == Operation::Not) {
+        return a == T {0} ? T {1} : T {0};
+    } else if constexpr (operation == Operation::Less) {
+        return a < b ? T {1} : T {0};
+    } else if constexpr (operation == Operation::LessEqual) {
+        return a <= b ? T {1} : T {0};
+    } else if constexpr (operation == Operation::Greater) {
+        return a > b ? T {1} : T {0};
+    } else if constexpr (operation == Operation::GreaterEqual) {
+        return a >= b ? T {1} : T {0};
+    } else if constexpr (operation == Operation::Equal) {
+        return a == b ? T {1} : T {0};
+    } else if constexpr (operation == Operation::NotEqual) {
+        return a != b ? T {1} : T {0};
+    } else if constexpr (operation == Operation::And) {
+        return a != T {0} && b != T {0} ? T {1} : T {0};
+    } else if constexpr (operation == Operation::Or) {
+        return a != T {0} || b != T {0} ? T {1} : T {0};
+    } else if constexpr (operation == Operation::Select) {
+        return a != T {0} ? b : c;
+    } else if constexpr (operation == Operation::Sin) {
+        return std::sin(a);
+    } else if constexpr (operation == Operation::Cos) {
+        return std::cos(a);
+    } else if constexpr (operation == Operation::Tan) {
+        return std::tan(a);
+    } else if constexpr (operation == Operation::Asin) {
+        return std::asin(a);
+    } else if constexpr (operation == Operation::Acos) {
+        return std::acos(a);
+    } else if constexpr (operation == Operation::Atan) {
+        return std::atan(a);
+    } else if constexpr (operation == Operation::Atan2) {
+        return std::atan2(a, b);
+    } else if constexpr (operation == Operation::Sqrt) {
+        return std::sqrt(a);
+    } else if constexpr (operation == Operation::Exp) {
+        return std::exp(a);
+    } else if constexpr (operation == Operation::Log) {
+        return std::log(a);
+    } else if constexpr (operation == Operation::Abs) {
+        return std::abs(a);
+    } else if constexpr (operation == Operation::Sign) {
+        return a > T {0} ? T {1} : (a < T {0} ? T {-1} : T {0});
+    } else if constexpr (operation == Operation::Floor) {
+        return std::floor(a);
+    } else if constexpr (operation == Operation::Ceil) {
+        return std::ceil(a);
+    } else if constexpr (operation == Operation::Fract) {
+        return a - std::floor(a);
+    } else if constexpr (operation == Operation::Min) {
+        return std::min(a, b);
+    } else if constexpr (operation == Operation::Max) {
+        return std::max(a, b);
+    } else if constexpr (operation == Operation::Clamp) {
+        return std::min(std::max(a, b), c);
+    } else if constexpr (operation == Operation::Mix) {
+        return a + (b - a) * c;
+    } else if constexpr (operation == Operation::Step) {
+        return b < a ? T {0} : T {1};
+    } else if constexpr (operation == Operation::Smoothstep) {
+        const T t {std::min(std::max((c - a) / (b - a), T {0}), T {1})};
+        return t * t * (T {3} - T {2} * t);
+    } else {
+        static_assert(operation == Operation::Random);
+        return hash(static_cast<float>(a));
+    }
+}
+
+// Runs an operation across a block of values. Unused operands alias the
+// first one.
+template<typename T>
+using Kernel = void (*)(T *, const T *, const T *, const T *, int);
+
+template<Operation operation, typename T>
+void run(T *destination, const T *a, const T *b, const T *c, int count)
+{
+    for (int i {0}; i < count; ++i) {
+        destination[i] = compute<operation, T>(a[i], b[i], c[i]);
+    }
+}
+
+template<typename T, std::size_t... operation>
+constexpr std::array<Kernel<T>, sizeof...(operation)> makeKernels(std::index_sequence<operation...>)
+{
+    return {{&run<static_cast<Operation>(operation), T>...}};
+}
+
+// For registers, holding blocks of LEDs.
+const std::array<Kernel<float>, static_cast<std::size_t>(Operation::Count)> kernels {
+    makeKernels<float>(std::make_index_sequence<static_cast<std::size_t>(Operation::Count)>())
+};
+
+// For the uniform program, so that the parts of a formula depending on t
+// alone stay exact however large t grows.
+const std::array<Kernel<double>, static_cast<std::size_t>(Operation::Count)> scalarKernels {
+    makeKernels<double>(std::make_index_sequence<static_cast<std::size_t>(Operation::Count)>())
+};
+
+struct Node {
+    enum Kind {
+        Number,
+        Variable,
+        Apply
+    };
+
+    Kind kind {Number};
+    float value {0.0f}; // Number
+    Input input {X}; // Variable
+    Operation operation {Operation::Add}; // Apply
+    int arguments[3] {-1, -1, -1};
+    int argumentCount {0};
+
+    bool varying {false}; // Differs between LEDs.
+    int scalar {-1}; // Slot once compiled into the uniform program.
+    int broadcast {-1}; // Register the scalar is copied to.
+};
+
+}
+
+// Parses formulas and generates the programs of an Expression.
+class ExpressionCompiler
+{
+    public:
+        explicit ExpressionCompiler(const QString &source)
+            : m_source {source}
+            , m_position {0}
+            , m_depth {0}
+            , m_registerCount {0}
+        {
+        }
+
+        bool compile(Expression &expression);
+
+    private:
+        // Each returns the index of a node, or -1 after failing.
+        int parseConditional();
+        int parseOr();
+        int parseAnd();
+        int parseComparison();
+        int parseSum();
+        int parseProduct();
+        int parseUnary();
+        int parsePower();
+        int parsePrimary();
+
+        void skipSpace();
+        bool atEnd();
+        bool accept(QLatin1StringView token);
+        int fail(const QString &message);
+
+        int number(float value);
+        int variable(Input input);
+        int apply(Operation operation, std::initializer_list<int> arguments);
+
+        void prepare(int node, Expression &expression);
+        int uniform(int node, Expression &expression);
+        int varying(int node, int top, Expression &expression);
+
+        const QString m_source;
+        int m_position;
+        int m_depth;
+        QString m_errorString;
+
+        QVector<Node> m_nodes;
+        int m_registerCount;
+};
+
+bool ExpressionCompiler::compile(Expression &expression)
+{
+    expression.m_uniformProgram.clear();
+    expression.m_scalars = {0.0}; // t, see evaluate
+    expression.m_broadcasts.clear();
+    expression.m_program.clear();
+    expression.m_registers.clear();
+    expression.m_outputs.clear();
+
+    QVector<int> roots;
+
+    if (m_source.trimmed().isEmpty()) {
+        fail(i18n("The expression is empty."));
+    } else {
+        do {
+            const int root {parseConditional()};
+
+            if (root < 0) {
+                break;
+            }
+
+            roots.append(root);
+        } while (accept(QLatin1StringView(",")));
+
+        if (m_errorString.isEmpty() && !atEnd()) {
+            fail(i18n("Unexpected '%1' at position %2.", m_source.at(m_position), m_position + 1));
+        }
+    }
+
+    if (!m_errorString.isEmpty()) {
+        expression.m_errorString = m_errorString;
+        return false;
+    }
+
+    // Values that are the same for all LEDs are computed once and copied
+    // into registers, so the program per block only reads registers.
+    m_registerCount = inputRegisters;
+
+    for (const int root : std::as_const(roots)) {
+        prepare(root, expression);
+    }
+
+    int top {m_registerCount};
+
+    for (const int root : std::as_const(roots)) {
+        const int output {varying(root, top, expression)};
+        expression.m_outputs.append(output);
+
+        // Results stay in their register while the next one is computed.
+        if (output >= top) {
+            top = output + 1;
+        }
+    }
+
+    expression.m_registers.resize(m_registerCount * blockSize);
+    expression.m_errorString.clear();
+
+    return true;
+}
+
+int ExpressionCompiler::parseConditional()
+{
+    const int condition {parseOr()};
+
+    if (condition < 0 || !accept(QLatin1StringView("?"))) {
+        return condition;
+    }
+
+    const int a {parseConditional()};
+
+    if (a < 0) {
+        return -1;
+    }
+
+    if (!accept(QLatin1StringView(":"))) {
+        return fail(i18n("Expected ':' at position %1.", m_position + 1));
+    }
+
+    const int b {parseConditional()};
+
+    return b < 0 ? -1 : apply(Operation::Select, {condition, a, b});
+}
+
+int ExpressionCompiler::parseOr()
+{
+    int node {parseAnd()};
+
+    while (node >= 0 && accept(QLatin1StringView("||"))) {
+        const int operand {parseAnd()};
+        node = operand < 0 ? -1 : apply(Operation::Or, {node, operand});
+    }
+
+    return node;
+}
+
+int ExpressionCompiler::parseAnd()
+{
+    int node {parseComparison()};
+
+    while (node >= 0 && accept(QLatin1StringView("&&"))) {
+        const int operand {parseComparison()};
+        node = operand < 0 ? -1 : apply(Operation::And, {node, operand});
+    }
+
+    return node;
+}
+
+int ExpressionCompiler::parseComparison()
+{
+    // Longer tokens first, so "<=" isn't taken for "<".
+    static const std::pair<QLatin1StringView, Operation> comparisons[] {
+        {QLatin1StringView("<="), Operation::LessEqual},
+        {QLatin1StringView(">="), Operation::GreaterEqual},
+        {QLatin1StringView("=="), Operation::Equal},
+        {QLatin1StringView("!="), Operation::NotEqual},
+        {QLatin1StringView("<"), Operation::Less},
+        {QLatin1StringView(">"), Operation::Greater}
+    };
+
+    int node {parseSum()};
+
+    while (node >= 0) {
+        const auto it {std::find_if(std::cbegin(comparisons), std::cend(comparisons),
+            [this](const std::pair<QLatin1StringView, Operation> &comparison) {
+                return accept(comparison.first);
+            }
+        )};
+
+        if (it == std::cend(comparisons)) {
+            break;
+        }
+
+        const int operand {parseSum()};
+        node = operand < 0 ? -1 : apply(it->second, {node, operand});
+    }
+
+    return node;
+}
+
+int ExpressionCompiler::parseSum()
+{
+    int node {parseProduct()};
+
+    while (node >= 0) {
+        Operation operation;
+
+        if (accept(QLatin1StringView("+"))) {
+            operation = Operation::Add;
+        } else if (accept(QLatin1StringView("-"))) {
+            operation = Operation::Subtract;
+        } else {
+            break;
+        }
+
+        const int operand {parseProduct()};
+        node = operand < 0 ? -1 : apply(operation, {node, operand});
+    }
+
+    return node;
+}
+
+int ExpressionCompiler::parseProduct()
+{
+    int node {parseUnary()};
+
+    while (node >= 0) {
+        Operation operation;
+
+        if (accept(QLatin1StringView("*"))) {
+            operation = Operation::Multiply;
+        } else if (accept(QLatin1StringView("/"))) {
+            operation = Operation::Divide;
+        } else if (accept(QLatin1StringView("%"))) {
+            operation = Operation::Modulo;
+        } else {
+            break;
+        }
+
+        const int operand {parseUnary()};
+        node = operand < 0 ? -1 : apply(operation, {node, operand});
+    }
+
+    return node;
+}
+
+int ExpressionCompiler::parseUnary()
+{
+    // Every nested expression passes through here.
+    if (m_depth >= maxDepth) {
+        return fail(i18n("The expression is nested too deeply."));
+    }
+
+    ++m_depth;
+
+    int node {-1};
+
+    if (accept(QLatin1StringView("-"))) {
+        const int operand {parseUnary()};
+        node = operand < 0 ? -1 : apply(Operation::Negate, {operand});
+    } else if (accept(QLatin1StringView("!"))) {
+        const int operand {parseUnary()};
+        node = operand < 0 ? -1 : apply(Operation::Not, {operand});
+    } else if (accept(QLatin1StringView("+"))) {
+        node = parseUnary();
+    } else {
+        node = parsePower();
+    }
+
+    --m_depth;
+
+    return node;
+}
+
+int ExpressionCompiler::parsePower()
+{
+    const int base {parsePrimary()};
+
+    if (base < 0 || !accept(QLatin1StringView("^"))) {
+        return base;
+    }
+
+    // Right-associative, and binds tighter than a sign on the left.
+    const int exponent {parseUnary()};
+
+    return exponent < 0 ? -1 : apply(Operation::Power, {base, exponent});
+}
+
+int ExpressionCompiler::parsePrimary()
+{
+    if (atEnd()) {
+        return fail(i18n("Unexpected end of the expression."));
+    }
+
+    const int start {m_position};
+    const QChar c {m_source.at(m_position)};
+
+    if (c.isDigit() || c == QLatin1Char('.')) {
+        while (m_position < m_source.size() && (m_source.at(m_position).isDigit()
+            || m_source.at(m_position) == QLatin1Char('.'))) {
+            ++m_position;
+        }
+
+        if (m_position < m_source.size() && (m_source.at(m_position) == QLatin1Char('e')
+            || m_source.at(m_position) == QLatin1Char('E'))) {
+            ++m_position;
+
+            if (m_position < m_source.size() && (m_source.at(m_position) == QLatin1Char('+')
+                || m_source.at(m_position) == QLatin1Char('-'))) {
+                ++m_position;
+            }
+
+            while (m_position < m_source.size() && m_source.at(m_position).isDigit()) {
+                ++m_position;
+            }
+        }
+
+        bool ok {false};
+        const float value {QStringView(m_source).mid(start, m_position - start).toFloat(&ok)};
+
+        if (!ok) {
+            return fail(i18n("Invalid number at position %1.", start + 1));
+        }
+
+        return number(value);
+    }
+
+    if (c.isLetter() || c == QLatin1Char('_')) {
+        while (m_position < m_source.size() && (m_source.at(m_position).isLetterOrNumber()
+            || m_source.at(m_position) == QLatin1Char('_'))) {
+            ++m_position;
+        }
+
+        const QString name {m_source.mid(start, m_position - start)};
+
+        if (accept(QLatin1StringView("("))) {
+            const auto function {std::find_if(std::cbegin(functions), std::cend(functions),
+                [&name](const Function &function) {
+                    return name == QLatin1StringView(function.name);
+                }
+            )};
+
+            if (function == std::cend(functions)) {
+                return fail(i18n("Unknown function '%1' at position %2.", name, start + 1));
+            }
+
+            int arguments[3] {-1, -1, -1};
+            int count {0};
+
+            if (!accept(QLatin1StringView(")"))) {
+                do {
+                    const int argument {parseConditional()};
+
+                    if (argument < 0) {
+                        return -1;
+                    }
+
+                    if (count < 3) {
+                        arguments[count] = argument;
+                    }
+
+                    ++count;
+                } while (accept(QLatin1StringView(",")));
+
+                if (!accept(QLatin1StringView(")"))) {
+                    return fail(i18n("Expected ')' at position %1.", m_position + 1));
+                }
+            }
+
+            if (count != function->arity) {
+                return fail(i18np("'%2' takes one argument.", "'%2' takes %1 arguments.",
+                    function->arity, name));
+            }
+
+            switch (count) {
+                case 1:
+                    return apply(function->operation, {arguments[0]});
+                case 2:
+                    return apply(function->operation, {arguments[0], arguments[1]});
+                default:
+                    return apply(function->operation, {arguments[0], arguments[1], arguments[2]});
+            }
+        }
+
+        if (name == QLatin1StringView("x")) {
+            return variable(X);
+        } else if (name == QLatin1StringView("y")) {
+            return variable(Y);
+        } else if (name == QLatin1StringView("i")) {
+            return variable(Square);
+        } else if (name == QLatin1StringView("t")) {
+            return variable(Time);
+        } else if (name == QLatin1StringView("pi")) {
+            return number(static_cast<float>(M_PI));
+        }
+
+        return fail(i18n("Unknown name '%1' at position %2.", name, start + 1));
+    }
+
+    if (accept(QLatin1StringView("("))) {
+        const int node {parseConditional()};
+
+        if (node < 0) {
+            return -1;
+        }
+
+        if (!accept(QLatin1StringView(")"))) {
+            return fail(i18n("Expected ')' at position %1.", m_position + 1));
+        }
+
+        return node;
+    }
+
+    return fail(i18n("Unexpected '%1' at position %2.", c, start + 1));
+}
+
+void ExpressionCompiler::skipSpace()
+{
+    while (m_position < m_source.size() && m_source.at(m_position).isSpace()) {
+        ++m_position;
+    }
+}
+
+bool ExpressionCompiler::atEnd()
+{
+    skipSpace();
+
+    return m_position >= m_source.size();
+}
+
+bool ExpressionCompiler::accept(QLatin1StringView token)
+{
+    skipSpace();
+
+    if (QStringView(m_source).mid(m_position).startsWith(token)) {
+        m_position += token.size();
+        return true;
+    }
+
+    return false;
+}
+
+int ExpressionCompiler::fail(const QString &message)
+{
+    // The first error is the one to fix.
+    if (m_errorString.isEmpty()) {
+        m_errorString = message;
+    }
+
+    return -1;
+}
+
+int ExpressionCompiler::number(float value)
+{
+    if (m_nodes.size() >= maxNodes) {
+        return fail(i18n("The expression is too long."));
+    }
+
+    Node node;
+    node.kind = Node::Number;
+    node.value = value;
+    m_nodes.append(node);
+
+    return static_cast<int>(m_nodes.size()) - 1;
+}
+
+int ExpressionCompiler::variable(Input input)
+{
+    if (m_nodes.size() >= maxNodes) {
+        return fail(i18n("The expression is too long."));
+    }
+
+    Node node;
+    node.kind = Node::Variable;
+    node.input = input;
+    node.varying = input != Time;
+    m_nodes.append(node);
+
+    return static_cast<int>(m_nodes.size()) - 1;
+}
+
+int ExpressionCompiler::apply(Operation operation, std::initializer_list<int> arguments)
+{
+    Node node;
+    node.kind = Node::Apply;
+    node.operation = operation;
+
+    bool constant {true};
+
+    for (const int argument : arguments) {
+        const Node &argumentNode {m_nodes.at(argument)};
+        node.arguments[node.argumentCount++] = argument;
+        node.varying = node.varying || argumentNode.varying;
+        constant = constant && argumentNode.kind == Node::Number;
+    }
+
+    // Fold operations on constants right away.
+    if (constant) {
+        float values[3] {};
+
+        for (int i {0}; i < node.argumentCount; ++i) {
+            values[i] = m_nodes.at(node.arguments[i]).value;
+        }
+
+        float result;
+        kernels[static_cast<std::size_t>(operation)](&result, &values[0], &values[1], &values[2], 1);
+
+        return number(result);
+    }
+
+    if (m_nodes.size() >= maxNodes) {
+        return fail(i18n("The expression is too long."));
+    }
+
+    m_nodes.append(node);
+
+    return static_cast<int>(m_nodes.size()) - 1;
+}
+
+void ExpressionCompiler::prepare(int node, Expression &expression)
+{
+    Node &n {m_nodes[node]};
+
+    if (!n.varying) {
+        n.broadcast = m_registerCount++;
+        expression.m_broadcasts.append({n.broadcast, uniform(node, expression)});
+        return;
+    }
+
+    if (n.kind == Node::Apply) {
+        for (int i {0}; i < n.argumentCount; ++i) {
+            prepare(n.arguments[i], expression);
+        }
+    }
+}
+
+int ExpressionCompiler::uniform(int node, Expression &expression)
+{
+    Node &n {m_nodes[node]};
+
+    if (n.scalar >= 0) {
+        return n.scalar;
+    }
+
+    switch (n.kind) {
+        case Node::Number:
+            n.scalar = expression.m_scalars.size();
+            expression.m_scalars.append(n.value);
+            break;
+        case Node::Variable:
+            // The only uniform variable.
+            n.scalar = 0;
+            break;
+        case Node::Apply: {
+            Expression::Instruction instruction {static_cast<uint8_t>(n.operation), 0, {0, 0, 0}};
+
+            for (int i {0}; i < n.argumentCount; ++i) {
+                instruction.operands[i] = static_cast<uint16_t>(uniform(n.arguments[i], expression));
+            }
+
+            for (int i {n.argumentCount}; i < 3; ++i) {
+                instruction.operands[i] = instruction.operands[0];
+            }
+
+            n.scalar = expression.m_scalars.size();
+            expression.m_scalars.append(0.0);
+
+            instruction.destination = static_cast<uint16_t>(n.scalar);
+            expression.m_uniformProgram.append(instruction);
+            break;
+        }
+    }
+
+    return n.scalar;
+}
+
+int ExpressionCompiler::varying(int node, int top, Expression &expression)
+{
+    const Node &n {m_nodes.at(node)};
+
+    if (!n.varying) {
+        return n.broadcast;
+    }
+
+    if (n.kind == Node::Variable) {
+        return n.input;
+    }
+
+    // Temporaries are allocated like a stack from top: each argument's
+    // result holds its register until the operation has run, which then
+    // writes to the lowest of them.
+    Expression::Instruction instruction {static_cast<uint8_t>(n.operation), static_cast<uint16_t>(top),
+        {0, 0, 0}};
+    int next {top};
+
+    for (int i {0}; i < n.argumentCount; ++i) {
+        const int operand {varying(n.arguments[i], next, expression)};
+        instruction.operands[i] = static_cast<uint16_t>(operand);
+
+        if (operand >= next) {
+            next = operand + 1;
+        }
+    }
+
+    for (int i {n.argumentCount}; i < 3; ++i) {
+        instruction.operands[i] = instruction.operands[0];
+    }
+
+    m_registerCount = std::max(m_registerCount, top + 1);
+    expression.m_program.append(instruction);
+
+    return top;
+}
+
+Expression::Expression()
+{
+}
+
+Expression::~Expression()
+{
+}
+
+bool Expression::compile(const QString &source)
+{
+    m_source = source;
+
+    ExpressionCompiler compiler {source};
+    return compiler.compile(*this);
+}
+
+bool Expression::isValid() const
+{
+    return !m_outputs.isEmpty();
+}
+
+QString Expression::source() const
+{
+    return m_source;
+}
+
+QString Expression::errorString() const
+{
+    return m_errorString;
+}
+
+int Expression::components() const
+{
+    return m_outputs.size();
+}
+
+int Expression::instructionCount() const
+{
+    return m_uniformProgram.size() + m_program.size();
+}
+
+void Expression::evaluate(const Inputs &inputs, float *const *outputs)
+{
+    if (!isValid()) {
+        return;
+    }
+
+    double *scalars {m_scalars.data()};
+    scalars[0] = inputs.time;
+
+    for (const Instruction &instruction : std::as_const(m_uniformProgram)) {
+        scalarKernels[instruction.operation](scalars + instruction.destination,
+            scalars + instruction.operands[0], scalars + instruction.operands[1],
+            scalars + instruction.operands[2], 1);
+    }
+
+    float *registers {m_registers.data()};
+
+    // Narrowed to float only here.
+    for (const QPair<int, int> &broadcast : std::as_const(m_broadcasts)) {
+        const double value {broadcast.second == 0 ? std::fmod(scalars[0], timePeriod)
+            : scalars[broadcast.second]};
+        std::fill_n(registers + broadcast.first * blockSize, blockSize, static_cast<float>(value));
+    }
+
+    const int components {static_cast<int>(m_outputs.size())};
+
+    for (int start {0}; start < inputs.count; start += blockSize) {
+        const int count {std::min(blockSize, inputs.count - start)};
+
+        std::copy_n(inputs.x + start, count, registers + X * blockSize);
+        std::copy_n(inputs.y + start, count, registers + Y * blockSize);
+        std::copy_n(inputs.squares + start, count, registers + Square * blockSize);
+
+        for (const Instruction &instruction : std::as_const(m_program)) {
+            kernels[instruction.operation](registers + instruction.destination * blockSize,
+                registers + instruction.operands[0] * blockSize,
+                registers + instruction.operands[1] * blockSize,
+                registers + instruction.operands[2] * blockSize,
+                count);
+        }
+
+        for (int component {0}; component < components; ++component) {
+            std::copy_n(registers + m_outputs.at(component) * blockSize, count, outputs[component] + start);
+        }
+    }
+}
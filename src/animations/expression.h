@@ -0,0 +1,134 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "hyelicht_core_export.h"
+
+#include <QString>
+#include <QVector>
+
+#include <cstdint>
+
+//! A formula evaluated for all LEDs of the shelf at once
+/*!
+ * \ingroup Animation
+ *
+ * Formulas are made of numbers, the variables \c x and \c y (the position of an
+ * LED from the top left, in compartments), \c i (the index of its compartment),
+ * \c t (time in seconds) and the constant \c pi, combined with:
+ *
+ * - The operators <tt>+ - * / % ^</tt> (modulo wraps like GLSL's \c mod, \c ^ is
+ *   a power), comparisons <tt>< <= > >= == !=</tt>, <tt>&& || !</tt> and
+ *   <tt>a ? b : c</tt>. Comparisons and logic yield \c 0 or \c 1.
+ * - The functions \c sin, \c cos, \c tan, \c asin, \c acos, \c atan, \c atan2,
+ *   \c sqrt, \c exp, \c log, \c pow, \c abs, \c sign, \c floor, \c ceil, \c fract,
+ *   \c mod, \c min, \c max, \c clamp, \c mix, \c step, \c smoothstep and \c rand,
+ *   a hash of its argument from \c 0 to \c 1.
+ *
+ * A formula yields one value, or several separated by commas.
+ *
+ * \ref compile parses a formula once and folds its constant parts. The parts
+ * that depend on \c t alone become a short program run once per \ref evaluate
+ * in double precision, so e.g. <tt>fract(t / 10)</tt> stays smooth however long
+ * the animation runs. Where \c t itself is combined with \c x, \c y or \c i,
+ * it wraps after 1000 · 2π seconds to keep float precision, which periodic
+ * functions like <tt>sin(x - t)</tt> don't show.
+ * The rest becomes bytecode for a register machine whose registers each hold a
+ * block of 256 LEDs. \ref evaluate runs each instruction across a whole block
+ * in a tight loop the compiler can vectorize, so the cost of decoding an
+ * instruction is shared by all LEDs of the block and the registers stay in the
+ * L1 cache.
+ *
+ * \sa ExpressionAnimation
+ */
+class HYELICHT_CORE_EXPORT Expression
+{
+    public:
+        //! The variables to evaluate an expression for.
+        struct Inputs {
+            const float *x {nullptr}; //!< \c x of each LED.
+            const float *y {nullptr}; //!< \c y of each LED.
+            const float *squares {nullptr}; //!< \c i of each LED.
+            int count {0}; //!< Number of LEDs.
+            double time {0.0}; //!< \c t.
+        };
+
+        //! Create an empty, invalid expression.
+        Expression();
+        ~Expression();
+
+        //! Compile a formula, replacing the current one.
+        /*!
+        * @param source The formula.
+        * @return Whether the formula is valid. See \ref errorString if not.
+        */
+        bool compile(const QString &source);
+
+        //! Whether a formula has been compiled successfully.
+        /*!
+        * @return Valid or not.
+        */
+        bool isValid() const;
+
+        //! The formula last passed to \ref compile.
+        /*!
+        * @return A formula.
+        */
+        QString source() const;
+
+        //! Why the formula last passed to \ref compile is invalid.
+        /*!
+        * @return A translated error message, or an empty string.
+        */
+        QString errorString() const;
+
+        //! The number of values the formula yields.
+        /*!
+        * @return Number of comma-separated values, or \c 0 if invalid.
+        */
+        int components() const;
+
+        //! The number of instructions the formula compiled into.
+        /*!
+        * @return Instructions run per frame and per block of LEDs.
+        */
+        int instructionCount() const;
+
+        //! Evaluate the formula for each LED.
+        /*!
+        * Does nothing if invalid.
+        *
+        * @param inputs The variables.
+        * @param outputs One array of \ref Inputs::count values per \ref components.
+        */
+        void evaluate(const Inputs &inputs, float *const *outputs);
+
+    private:
+        friend class ExpressionCompiler;
+
+        struct Instruction {
+            uint8_t operation;
+            uint16_t destination;
+            uint16_t operands[3];
+        };
+
+        QString m_source;
+        QString m_errorString;
+
+        // Run once per evaluation on m_scalars, which start with t and the
+        // constants.
+        QVector<Instruction> m_uniformProgram;
+        QVector<double> m_scalars;
+
+        // Scalars copied into whole registers once per evaluation, as
+        // pairs of register and scalar.
+        QVector<QPair<int, int>> m_broadcasts;
+
+        // Run per block of LEDs on m_registers, which start with x, y and i.
+        QVector<Instruction> m_program;
+        QVector<float> m_registers;
+        QVector<int> m_outputs; // Register holding each component.
+};
@@ -0,0 +1,154 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "expressionanimation.h"
+#include "debug_animations.h"
+#include "ledstrip.h"
+
+#include <KLocalizedString>
+
+#include <utility>
+
+namespace {
+
+// Also maps NaN, e.g. from a division by zero, to 0.
+inline uint8_t toByte(float value)
+{
+    return static_cast<uint8_t>((value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f) * 255.0f + 0.5f);
+}
+
+}
+
+ExpressionAnimation::ExpressionAnimation(QObject *parent)
+    : AbstractAnimation(parent)
+{
+    setExpression(QStringLiteral("0.5 + 0.5 * sin(x - t), 0.2 + 0.2 * sin(y * 2 + t * 0.7), "
+        "0.5 + 0.5 * cos(x + y - t * 1.3)"));
+
+    setFrameBudget(1000);
+
+    const auto queueLayout = [this]() {
+        updateRenderState([this]() { updateLayout(); });
+    };
+
+    QObject::connect(this, &AbstractAnimation::squaresChanged, this, queueLayout);
+    QObject::connect(this, &AbstractAnimation::regionChanged, this, queueLayout);
+}
+
+ExpressionAnimation::~ExpressionAnimation()
+{
+    stop();
+}
+
+QString ExpressionAnimation::name() const
+{
+    return i18n("Expression");
+}
+
+QString ExpressionAnimation::expression() const
+{
+    return m_expression;
+}
+
+void ExpressionAnimation::setExpression(const QString &expression)
+{
+    if (m_expression == expression) {
+        return;
+    }
+
+    m_expression = expression;
+
+    // Compiled aside, so an invalid formula leaves the current one running.
+    Expression program;
+    QString errorString;
+
+    if (!program.compile(expression)) {
+        errorString = program.errorString();
+    } else if (program.components() != 1 && program.components() != 3) {
+        errorString = i18n("The expression must yield one value for white, or three for red, green and blue.");
+    }
+
+    if (errorString.isEmpty()) {
+        qCDebug(HYELICHT_ANIMATIONS) << i18n("Compiled expression into %1 instructions.",
+            program.instructionCount());
+
+        updateRenderState([this, program = std::move(program)]() { m_program = program; });
+    } else {
+        qCWarning(HYELICHT_ANIMATIONS) << i18n("Invalid expression '%1': %2", expression, errorString);
+    }
+
+    Q_EMIT expressionChanged();
+
+    if (m_errorString != errorString) {
+        m_errorString = errorString;
+        Q_EMIT errorStringChanged();
+    }
+}
+
+QString ExpressionAnimation::errorString() const
+{
+    return m_errorString;
+}
+
+void ExpressionAnimation::renderFrame(const Frame &frame)
+{
+    LedStrip *ledStrip {canvas()};
+
+    if (!ledStrip) {
+        stop();
+        return;
+    }
+
+    const int leds {static_cast<int>(m_layout.leds.size())};
+
+    if (!leds || !m_program.isValid()) {
+        return;
+    }
+
+    Expression::Inputs inputs;
+    inputs.x = m_layout.x.constData();
+    inputs.y = m_layout.y.constData();
+    inputs.squares = m_layout.squares.constData();
+    inputs.count = leds;
+
+    inputs.time = frame.time / 1000.0;
+
+    // A single value is painted in white.
+    const int components {m_program.components()};
+    float *const outputs[3] {m_values[0].data(), m_values[components >= 3 ? 1 : 0].data(),
+        m_values[components >= 3 ? 2 : 0].data()};
+
+    m_program.evaluate(inputs, outputs);
+
+    const int count {ledStrip->count()};
+    uint8_t *data {reinterpret_cast<uint8_t *>(ledStrip->data())};
+    const float *red {outputs[0]};
+    const float *green {outputs[1]};
+    const float *blue {outputs[2]};
+
+    for (int i {0}; i < leds; ++i) {
+        const int led {m_layout.leds.at(i)};
+
+        if (led >= count) {
+            continue;
+        }
+
+        uint8_t *ptr {data + led * 4};
+        ptr[1] = toByte(blue[i]);
+        ptr[2] = toByte(green[i]);
+        ptr[3] = toByte(red[i]);
+    }
+
+    presentFrame();
+}
+
+void ExpressionAnimation::updateLayout()
+{
+    m_layout = ledLayout();
+
+    for (QVector<float> &values : m_values) {
+        values.resize(m_layout.leds.size());
+    }
+}
@@ -0,0 +1,118 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "abstractanimation.h"
+#include "expression.h"
+
+#include <QVector>
+
+//! Animation painting each LED with a formula of its position and time
+/*!
+ * \ingroup Animation
+ *
+ * Evaluates \ref expression for every LED of the shelf front on each frame. The
+ * formula yields either three values for red, green and blue, or a single one
+ * for white, each from \c 0.0 to \c 1.0. See Expression for the syntax.
+ *
+ * \code
+ * 0.5 + 0.5 * sin(x - t), 0.2, 0.5 + 0.5 * cos(y + t)
+ * \endcode
+ *
+ * The formula is compiled once when set, rather than interpreted per LED.
+ * An invalid formula is reported by \ref errorString, and the previous one
+ * stays on the shelf.
+ *
+ * \sa Expression
+ * \sa AbstractAnimation
+ */
+class ExpressionAnimation : public AbstractAnimation
+{
+    Q_OBJECT
+
+    //! The formula to paint the LEDs with.
+    /*!
+    * \sa setExpression
+    * \sa expressionChanged
+    */
+    Q_PROPERTY(QString expression READ expression WRITE setExpression NOTIFY expressionChanged)
+
+    //! Why \ref expression is invalid.
+    /*!
+    * Empty while \ref expression is valid.
+    *
+    * \sa errorStringChanged
+    */
+    Q_PROPERTY(QString errorString READ errorString NOTIFY errorStringChanged)
+
+    public:
+        //! Create an expression animation.
+        /*!
+        * @param parent Parent object
+        */
+        explicit ExpressionAnimation(QObject *parent = nullptr);
+        ~ExpressionAnimation() override;
+
+        //! The name of this animation.
+        /*!
+        * @return "Expression".
+        */
+        QString name() const override;
+
+        //! The formula to paint the LEDs with.
+        /*!
+        * @return A formula.
+        * \sa expression (property)
+        * \sa setExpression
+        * \sa expressionChanged
+        */
+        QString expression() const;
+
+        //! Set the formula to paint the LEDs with.
+        /*!
+        * @param expression A formula yielding one or three values.
+        * \sa expression
+        * \sa expressionChanged
+        */
+        void setExpression(const QString &expression);
+
+        //! Why the formula is invalid.
+        /*!
+        * @return A translated error message, or an empty string.
+        * \sa errorString (property)
+        * \sa errorStringChanged
+        */
+        QString errorString() const;
+
+    Q_SIGNALS:
+        //! The formula to paint the LEDs with has changed.
+        /*!
+        * \sa expression
+        * \sa setExpression
+        */
+        void expressionChanged() const;
+
+        //! Why the formula is invalid has changed.
+        /*!
+        * \sa errorString
+        */
+        void errorStringChanged() const;
+
+    protected:
+        void renderFrame(const Frame &frame) override;
+
+    private:
+        void updateLayout();
+
+        QString m_expression;
+        QString m_errorString;
+        Expression m_program;
+
+        LedLayout m_layout;
+
+        // Per painted LED and component.
+        QVector<float> m_values[3];
+};
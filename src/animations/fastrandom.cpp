@@ -0,0 +1,102 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "fastrandom.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Expands the seed into the generator state, as recommended by the
+// xoshiro authors.
+uint64_t splitMix64(uint64_t &x)
+{
+    uint64_t z {(x += 0x9e3779b97f4a7c15ULL)};
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+}
+
+FastRandom::FastRandom(quint64 seed)
+{
+    this->seed(seed);
+}
+
+void FastRandom::seed(quint64 seed)
+{
+    uint64_t x {seed};
+
+    for (int lane {0}; lane < Lanes; ++lane) {
+        const uint64_t a {splitMix64(x)};
+        const uint64_t b {splitMix64(x)};
+
+        m_state[0][lane] = static_cast<uint32_t>(a);
+        m_state[1][lane] = static_cast<uint32_t>(a >> 32);
+        m_state[2][lane] = static_cast<uint32_t>(b);
+        m_state[3][lane] = static_cast<uint32_t>(b >> 32);
+    }
+}
+
+void FastRandom::next(uint32_t *out)
+{
+    uint32_t *s0 {m_state[0]};
+    uint32_t *s1 {m_state[1]};
+    uint32_t *s2 {m_state[2]};
+    uint32_t *s3 {m_state[3]};
+
+    // Each lane is an independent xoshiro128+ stream.
+    for (int lane {0}; lane < Lanes; ++lane) {
+        out[lane] = s0[lane] + s3[lane];
+
+        const uint32_t t {s1[lane] << 9};
+
+        s2[lane] ^= s0[lane];
+        s3[lane] ^= s1[lane];
+        s1[lane] ^= s2[lane];
+        s0[lane] ^= s3[lane];
+        s2[lane] ^= t;
+        s3[lane] = (s3[lane] << 11) | (s3[lane] >> 21);
+    }
+}
+
+void FastRandom::fill(uint32_t *data, int count)
+{
+    int i {0};
+
+    for (; i + Lanes <= count; i += Lanes) {
+        next(data + i);
+    }
+
+    if (i < count) {
+        uint32_t tail[Lanes];
+        next(tail);
+        memcpy(data + i, tail, (count - i) * sizeof(uint32_t));
+    }
+}
+
+void FastRandom::fillBounded(uint8_t *data, int count, int bound)
+{
+    bound = std::clamp(bound, 1, 256);
+
+    uint32_t block[Lanes];
+    int i {0};
+
+    while (i < count) {
+        next(block);
+
+        const int n {std::min(Lanes, count - i)};
+
+        // Scales the upper 16 bits into range with a multiply and shift
+        // instead of a division.
+        for (int lane {0}; lane < n; ++lane) {
+            data[i + lane] = static_cast<uint8_t>(((block[lane] >> 16) * static_cast<uint32_t>(bound)) >> 16);
+        }
+
+        i += n;
+    }
+}
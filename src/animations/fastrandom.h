@@ -0,0 +1,64 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "hyelicht_core_export.h"
+
+#include <QtGlobal>
+
+#include <cstdint>
+
+//! Fast pseudo-random number generator for animations
+/*!
+ * \ingroup Animation
+ *
+ * Implements xoshiro128+ with several independent streams advanced in lockstep,
+ * so that generating a batch of values, e.g. one per LED for a whole frame, is a
+ * simple loop the compiler can vectorize.
+ *
+ * The upper bits of each value are of higher quality than the lower bits, which
+ * \ref fillBounded takes into account. Not suitable for anything but visuals.
+ *
+ * \sa FireAnimation
+ * \sa FlameAnimation
+ */
+class HYELICHT_CORE_EXPORT FastRandom
+{
+    public:
+        //! Create a generator.
+        /*!
+        * @param seed Seed value.
+        */
+        explicit FastRandom(quint64 seed = 0);
+
+        //! Reset the generator.
+        /*!
+        * @param seed Seed value.
+        */
+        void seed(quint64 seed);
+
+        //! Fill a buffer with random values.
+        /*!
+        * @param data Buffer to fill.
+        * @param count Number of values to generate.
+        */
+        void fill(uint32_t *data, int count);
+
+        //! Fill a buffer with random values in a range.
+        /*!
+        * @param data Buffer to fill.
+        * @param count Number of values to generate.
+        * @param bound Exclusive upper bound of the values, at most \c 256.
+        */
+        void fillBounded(uint8_t *data, int count, int bound);
+
+    private:
+        static const int Lanes {8};
+
+        void next(uint32_t *out);
+
+        uint32_t m_state[4][Lanes];
+};
@@ -9,58 +9,70 @@
 
 #include <KLocalizedString>
 
+#include <algorithm>
+#include <random>
+
 FireAnimation::FireAnimation(QObject *parent)
     : AbstractAnimation(parent)
     , m_baseColor {255, 96, 12}
-    , m_skipFrame {false}
-    , m_e {m_rd()}
-    , m_distColor {0, 100}
-    , m_distInterval {40, 60}
+    , m_nextChange {0}
+    , m_random {std::random_device {}()}
 {
-    QObject::connect(this, &AbstractAnimation::valueChanged, this,
-        [=](qreal value) {
-            Q_UNUSED(value)
-
-            if (!m_ledStrip) {
-                m_skipFrame = false;
-                stop();
-                return;
-            }
-
-            if (m_skipFrame) {
-                m_skipFrame = false;
-                return;
-            }
-
-            for (int i {0}; i < m_ledStrip->count(); ++i) {
-                const int flicker {m_distColor(m_e)};
-
-                m_ledStrip->setColor(i, {
-                        std::max(0, m_baseColor.red() - flicker),
-                        std::max(0, m_baseColor.green() - flicker),
-                        std::max(0, m_baseColor.blue() - flicker)
-                    }
-                );
-            }
-
-            m_ledStrip->show();
-            Q_EMIT frameComplete();
-
-            blockSignals(true);
-            setUpdateInterval(m_distInterval(m_e));
-            m_skipFrame = true;
-            stop();
-            start();
-            blockSignals(false);
-        }
-    );
 }
 
 FireAnimation::~FireAnimation()
 {
+    stop();
 }
 
 QString FireAnimation::name() const
 {
     return i18n("Fire");
 }
+
+void FireAnimation::renderFrame(const Frame &frame)
+{
+    LedStrip *ledStrip {canvas()};
+
+    if (!ledStrip) {
+        stop();
+        return;
+    }
+
+    // The flicker changes at a randomized interval between 40 and 60 ms,
+    // independent of the render loop's frame rate. The first frame is
+    // painted right away.
+    if (frame.index && frame.time < m_nextChange) {
+        return;
+    }
+
+    uint8_t interval {0};
+    m_random.fillBounded(&interval, 1, 21);
+
+    m_nextChange = frame.time + 40 + interval;
+
+    // Generate the flicker for the entire frame in one batch.
+    const int count {ledStrip->count()};
+    m_flicker.resize(count);
+    m_random.fillBounded(m_flicker.data(), count, 101);
+
+    const int red {m_baseColor.red()};
+    const int green {m_baseColor.green()};
+    const int blue {m_baseColor.blue()};
+
+    // Paint straight into the strip data; the ranges are already checked
+    // against the strip length.
+    uint8_t *data {reinterpret_cast<uint8_t *>(ledStrip->data())};
+    const uint8_t *flicker {m_flicker.constData()};
+
+    for (const QPair<int, int> &range : paintRanges()) {
+        for (int i {range.first}; i <= range.second; ++i) {
+            uint8_t *ptr {data + i * 4};
+            ptr[1] = std::max(0, blue - flicker[i]);
+            ptr[2] = std::max(0, green - flicker[i]);
+            ptr[3] = std::max(0, red - flicker[i]);
+        }
+    }
+
+    presentFrame();
+}
@@ -5,12 +5,13 @@
 
 #pragma once
 
+#include "hyelicht_core_export.h"
+
 #include "abstractanimation.h"
+#include "fastrandom.h"
 
 #include <QColor>
-
-#include <algorithm>
-#include <random>
+#include <QVector>
 
 //! Simple fire animation to turn the shelf into a digital fireplace
 /*!
@@ -19,10 +20,9 @@
  * Animates every LED in the LedStrip instance, rather than the compartments of the shelf.
  *
  * \sa AbstractAnimation
- * \sa QTimeLine
  * \sa ShelfModel
  */
-class FireAnimation : public AbstractAnimation
+class HYELICHT_CORE_EXPORT FireAnimation : public AbstractAnimation
 {
     Q_OBJECT
 
@@ -40,13 +40,13 @@ class FireAnimation : public AbstractAnimation
         */
         QString name() const override;
 
+    protected:
+        void renderFrame(const Frame &frame) override;
+
     private:
         QColor m_baseColor;
-        bool m_skipFrame;
-
+        qint64 m_nextChange;
 
-    std::random_device m_rd;
-    std::mt19937 m_e;
-    std::uniform_int_distribution<int> m_distColor;
-    std::uniform_int_distribution<int> m_distInterval;
+        FastRandom m_random;
+        QVector<uint8_t> m_flicker;
 };
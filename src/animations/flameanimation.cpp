@@ -0,0 +1,238 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "flameanimation.h"
+#include "ledstrip.h"
+
+#include <KLocalizedString>
+
+#include <algorithm>
+#include <random>
+
+namespace {
+
+const int gridHeight {8};
+const int maxGridWidth {64};
+
+const int stepInterval {25}; // Milliseconds per simulation step.
+const int maxSteps {3}; // Don't try to catch up on long stalls.
+
+const int cooling {24}; // Maximum heat lost per cell and step.
+const int sparking {56}; // Chance out of 256 for a spark per bottom cell and step.
+
+}
+
+FlameAnimation::FlameAnimation(QObject *parent)
+    : AbstractAnimation(parent)
+    , m_elapsed {0}
+    , m_gridWidth {0}
+    , m_random {std::random_device {}()}
+{
+    // Black body palette: black, red, orange, yellow, white.
+    for (int i {0}; i < 256; ++i) {
+        const int t {(i * 191) / 255};
+        const uint8_t ramp {static_cast<uint8_t>((t & 0x3F) << 2)};
+
+        uint8_t *color {m_palette[i]};
+
+        if (t & 0x80) {
+            color[0] = ramp;
+            color[1] = 255;
+            color[2] = 255;
+        } else if (t & 0x40) {
+            color[0] = 0;
+            color[1] = ramp;
+            color[2] = 255;
+        } else {
+            color[0] = 0;
+            color[1] = 0;
+            color[2] = ramp;
+        }
+    }
+
+    setFrameBudget(2000);
+
+    QObject::connect(this, &AbstractAnimation::squaresChanged, this,
+        [this]() { updateRenderState([this]() { updateGrid(); }); });
+    QObject::connect(this, &AbstractAnimation::regionChanged, this,
+        [this]() { updateRenderState([this]() { updatePaintedSquares(); }); });
+}
+
+FlameAnimation::~FlameAnimation()
+{
+    stop();
+}
+
+QString FlameAnimation::name() const
+{
+    return i18n("Flames");
+}
+
+void FlameAnimation::renderFrame(const Frame &frame)
+{
+    if (!canvas()) {
+        stop();
+        return;
+    }
+
+    if (m_heat.isEmpty()) {
+        return;
+    }
+
+    m_elapsed += frame.delta;
+
+    const int steps {std::min(maxSteps, m_elapsed / stepInterval)};
+
+    if (!steps) {
+        return;
+    }
+
+    m_elapsed = m_elapsed >= maxSteps * stepInterval ? 0 : m_elapsed % stepInterval;
+
+    for (int i {0}; i < steps; ++i) {
+        step();
+    }
+
+    paint();
+
+    presentFrame();
+}
+
+void FlameAnimation::updateGrid()
+{
+    int width {0};
+
+    for (const QPair<int, int> &square : std::as_const(m_squares)) {
+        width = std::max(width, square.second - square.first + 1);
+    }
+
+    m_gridWidth = std::clamp(width, 0, maxGridWidth);
+
+    const int cells {m_gridWidth * gridHeight * static_cast<int>(m_squares.size())};
+    m_heat.fill(0, cells);
+    m_noise.resize(cells + 2 * m_gridWidth * m_squares.size());
+
+    updatePaintedSquares();
+}
+
+void FlameAnimation::updatePaintedSquares()
+{
+    m_paintedSquares.resize(m_squares.size());
+
+    // Regions are made up of whole compartments, e.g. for zones. Squares
+    // beyond the end of the strip are skipped when painting.
+    for (int i {0}; i < m_squares.size(); ++i) {
+        const QPair<int, int> &square {m_squares.at(i)};
+
+        if (m_region.isEmpty()) {
+            m_paintedSquares[i] = true;
+            continue;
+        }
+
+        m_paintedSquares[i] = std::any_of(m_region.cbegin(), m_region.cend(),
+            [&](const QPair<int, int> &range) {
+                return range.first <= square.first && square.second <= range.second;
+            }
+        );
+    }
+}
+
+void FlameAnimation::step()
+{
+    const int width {m_gridWidth};
+    const int cells {width * gridHeight};
+
+    m_random.fillBounded(m_noise.data(), static_cast<int>(m_noise.size()), 256);
+
+    uint8_t *heat {m_heat.data()};
+    const uint8_t *noise {m_noise.constData()};
+
+    for (int square {0}; square < m_squares.size(); ++square) {
+        uint8_t *grid {heat + square * cells};
+
+        // Every cell cools down a little.
+        for (int i {0}; i < cells; ++i) {
+            grid[i] = std::max(0, grid[i] - ((noise[i] * cooling) >> 8));
+        }
+
+        noise += cells;
+
+        // Heat rises and spreads sideways. Going top to bottom means the
+        // rows below still hold the previous step's values.
+        for (int y {gridHeight - 1}; y > 0; --y) {
+            uint8_t *row {grid + y * width};
+            const uint8_t *below {row - width};
+            const uint8_t *below2 {y > 1 ? row - 2 * width : below};
+
+            if (width == 1) {
+                row[0] = (3 * below[0] + below2[0]) / 4;
+                continue;
+            }
+
+            row[0] = (2 * below[0] + below[1] + below2[0] + below[0]) / 5;
+
+            for (int x {1}; x < width - 1; ++x) {
+                row[x] = (below[x - 1] + 2 * below[x] + below[x + 1] + below2[x]) / 5;
+            }
+
+            row[width - 1] = (below[width - 2] + 2 * below[width - 1] + below[width - 1]
+                + below2[width - 1]) / 5;
+        }
+
+        // Sparks ignite at the bottom.
+        for (int x {0}; x < width; ++x) {
+            if (noise[x] < sparking) {
+                grid[x] = std::min(255, grid[x] + 160 + (noise[width + x] >> 2));
+            }
+        }
+
+        noise += 2 * width;
+    }
+}
+
+void FlameAnimation::paint()
+{
+    const int width {m_gridWidth};
+    const int cells {width * gridHeight};
+    LedStrip *ledStrip {canvas()};
+    const int count {ledStrip->count()};
+
+    uint8_t *data {reinterpret_cast<uint8_t *>(ledStrip->data())};
+    const uint8_t *heat {m_heat.constData()};
+
+    uint8_t columns[maxGridWidth];
+
+    for (int square {0}; square < m_squares.size(); ++square) {
+        const QPair<int, int> &range {m_squares.at(square)};
+
+        if (!m_paintedSquares.at(square) || range.second >= count) {
+            continue;
+        }
+
+        const uint8_t *grid {heat + square * cells};
+
+        // Taller flames make for a hotter column. Averaging over half the
+        // grid height keeps the glow of the embers visible.
+        for (int x {0}; x < width; ++x) {
+            int sum {0};
+
+            for (int y {0}; y < gridHeight; ++y) {
+                sum += grid[y * width + x];
+            }
+
+            columns[x] = std::min(255, sum / (gridHeight / 2));
+        }
+
+        const int leds {range.second - range.first + 1};
+
+        for (int i {0}; i < leds; ++i) {
+            const uint8_t *color {m_palette[columns[(i * width) / leds]]};
+            uint8_t *ptr {data + (range.first + i) * 4};
+            ptr[1] = color[0];
+            ptr[2] = color[1];
+            ptr[3] = color[2];
+        }
+    }
+}
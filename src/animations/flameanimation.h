@@ -0,0 +1,70 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "abstractanimation.h"
+#include "fastrandom.h"
+
+#include <QVector>
+
+//! Fire animation simulating flames rising in each shelf compartment
+/*!
+ * \ingroup Animation
+ *
+ * Runs a small heat propagation simulation per compartment (see
+ * AbstractAnimation::squares): a grid as wide as the compartment's LEDs (up to
+ * a fixed maximum) and a few cells high. Sparks ignite at the bottom, heat rises
+ * and spreads sideways while cooling down, and each LED shows the heat of the
+ * grid column above it through a black body color palette.
+ *
+ * The simulation advances in fixed time steps independent of the frame rate.
+ * Its state lives in flat buffers that are only reallocated when the shelf
+ * geometry changes. The default \ref frameBudget is 2 ms.
+ *
+ * Walls between compartments are not painted.
+ *
+ * \sa AbstractAnimation
+ * \sa FireAnimation
+ * \sa ShelfModel
+ */
+class FlameAnimation : public AbstractAnimation
+{
+    Q_OBJECT
+
+    public:
+        //! Create a flame animation.
+        /*!
+        * @param parent Parent object
+        */
+        explicit FlameAnimation(QObject *parent = nullptr);
+        ~FlameAnimation() override;
+
+        //! The name of this animation.
+        /*!
+        * @return "Flames".
+        */
+        QString name() const override;
+
+    protected:
+        void renderFrame(const Frame &frame) override;
+
+    private:
+        void updateGrid();
+        void updatePaintedSquares();
+        void step();
+        void paint();
+
+        int m_elapsed;
+
+        int m_gridWidth;
+        QVector<uint8_t> m_heat;
+        QVector<uint8_t> m_noise;
+        QVector<bool> m_paintedSquares;
+
+        uint8_t m_palette[256][3];
+
+        FastRandom m_random;
+};
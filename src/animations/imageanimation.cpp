@@ -0,0 +1,326 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "imageanimation.h"
+#include "debug_animations.h"
+#include "ledstrip.h"
+
+#include <KLocalizedString>
+
+#include <QImage>
+#include <QImageReader>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// About two minutes at 30 frames per second.
+const int maximumFrames {3600};
+
+// Browsers show frames with shorter delays for 100 ms, and GIFs are made to
+// look right in browsers.
+const int minimumDelay {20}; // Milliseconds.
+const int defaultDelay {100}; // Milliseconds.
+
+struct LinearTable {
+    LinearTable()
+    {
+        for (int i {0}; i < 256; ++i) {
+            const float value {i / 255.0f};
+            values[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+    }
+
+    float values[256];
+};
+
+inline uint8_t fromLinear(float value)
+{
+    value = std::clamp(value, 0.0f, 1.0f);
+    value = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+
+    return static_cast<uint8_t>(std::lround(value * 255.0f));
+}
+
+}
+
+ImageAnimation::ImageAnimation(QObject *parent)
+    : AbstractAnimation(parent)
+    , m_loading {false}
+    , m_generation {0}
+    , m_position {-1}
+    , m_startTime {0}
+{
+    QObject::connect(this, &AbstractAnimation::squaresChanged, this, &ImageAnimation::load);
+    QObject::connect(this, &AbstractAnimation::regionChanged, this, &ImageAnimation::load);
+}
+
+ImageAnimation::~ImageAnimation()
+{
+    stop();
+
+    // Cancels all loads.
+    ++m_generation;
+
+    for (const std::unique_ptr<QThread> &loader : m_loaders) {
+        loader->wait();
+    }
+}
+
+QString ImageAnimation::name() const
+{
+    return i18n("Image");
+}
+
+QString ImageAnimation::source() const
+{
+    return m_source;
+}
+
+void ImageAnimation::setSource(const QString &source)
+{
+    if (m_source != source) {
+        m_source = source;
+
+        load();
+
+        Q_EMIT sourceChanged();
+    }
+}
+
+bool ImageAnimation::loading() const
+{
+    return m_loading;
+}
+
+QString ImageAnimation::errorString() const
+{
+    return m_errorString;
+}
+
+void ImageAnimation::renderFrame(const Frame &frame)
+{
+    LedStrip *ledStrip {canvas()};
+
+    if (!ledStrip) {
+        stop();
+        return;
+    }
+
+    if (m_frames.ends.isEmpty()) {
+        return;
+    }
+
+    // Start over from the first frame when started or given a new image.
+    int position {0};
+
+    if (m_position < 0 || !frame.index) {
+        m_startTime = frame.time;
+    } else {
+        // Follow the clock, so dropped frames don't slow playback down.
+        const qint64 time {(frame.time - m_startTime) % m_frames.ends.constLast()};
+        position = static_cast<int>(std::upper_bound(m_frames.ends.cbegin(), m_frames.ends.cend(), time)
+            - m_frames.ends.cbegin());
+
+        if (position == m_position) {
+            return;
+        }
+    }
+
+    m_position = position;
+
+    const int leds {static_cast<int>(m_frames.leds.size())};
+    const int count {ledStrip->count()};
+    const uint8_t *colors {reinterpret_cast<const uint8_t *>(m_frames.colors.constData() + position * leds)};
+    uint8_t *data {reinterpret_cast<uint8_t *>(ledStrip->data())};
+
+    for (int i {0}; i < leds; ++i) {
+        const int led {m_frames.leds.at(i)};
+
+        if (led < count) {
+            memcpy(data + led * 4 + 1, colors + i * 4 + 1, 3);
+        }
+    }
+
+    presentFrame();
+}
+
+ImageAnimation::Frames ImageAnimation::decode(const QString &source, const LedLayout &layout,
+    const std::atomic<int> &generation, int current)
+{
+    static const LinearTable linear;
+
+    Frames frames;
+    frames.leds = layout.leds;
+
+    const int leds {static_cast<int>(layout.leds.size())};
+
+    if (!leds) {
+        return frames;
+    }
+
+    // The area each LED covers on the shelf front, in compartments.
+    int columns {0};
+    int rows {0};
+    QVector<int> ledsPerSquare;
+
+    for (int i {0}; i < leds; ++i) {
+        columns = std::max(columns, static_cast<int>(layout.x.at(i)) + 1);
+        rows = std::max(rows, static_cast<int>(layout.y.at(i)) + 1);
+
+        const int square {static_cast<int>(layout.squares.at(i))};
+
+        if (square >= ledsPerSquare.size()) {
+            ledsPerSquare.resize(square + 1);
+        }
+
+        ++ledsPerSquare[square];
+    }
+
+    QImageReader reader(source);
+    reader.setAutoTransform(true);
+
+    qint64 end {0};
+
+    while (reader.canRead() && frames.ends.size() < maximumFrames) {
+        if (generation.load(std::memory_order_relaxed) != current) {
+            return {};
+        }
+
+        QImage image {reader.read()};
+
+        if (image.isNull()) {
+            break;
+        }
+
+        const int delay {reader.nextImageDelay()};
+        end += delay >= minimumDelay ? delay : defaultDelay;
+        frames.ends.append(end);
+
+        // Transparent areas turn black.
+        image.convertTo(QImage::Format_RGBA8888_Premultiplied);
+
+        const float scaleX {static_cast<float>(image.width()) / columns};
+        const float scaleY {static_cast<float>(image.height()) / rows};
+
+        const qsizetype offset {frames.colors.size()};
+        frames.colors.resize(offset + leds);
+        uint8_t *out {reinterpret_cast<uint8_t *>(frames.colors.data() + offset)};
+
+        for (int i {0}; i < leds; ++i) {
+            const float halfWidth {0.5f / ledsPerSquare.at(static_cast<int>(layout.squares.at(i)))};
+            const float top {std::floor(layout.y.at(i))};
+
+            const float x0 {(layout.x.at(i) - halfWidth) * scaleX};
+            const float x1 {(layout.x.at(i) + halfWidth) * scaleX};
+            const float y0 {top * scaleY};
+            const float y1 {(top + 1.0f) * scaleY};
+
+            // Pixels partially covered count in proportion.
+            float sum[3] {0.0f, 0.0f, 0.0f};
+            float area {0.0f};
+
+            for (int y {static_cast<int>(y0)}; y < std::min(static_cast<int>(std::ceil(y1)), image.height()); ++y) {
+                const float weightY {std::min(y + 1.0f, y1) - std::max(static_cast<float>(y), y0)};
+                const uchar *line {image.constScanLine(y)};
+
+                for (int x {static_cast<int>(x0)}; x < std::min(static_cast<int>(std::ceil(x1)), image.width()); ++x) {
+                    const float weight {weightY * (std::min(x + 1.0f, x1) - std::max(static_cast<float>(x), x0))};
+                    const uchar *pixel {line + x * 4};
+
+                    sum[0] += linear.values[pixel[0]] * weight;
+                    sum[1] += linear.values[pixel[1]] * weight;
+                    sum[2] += linear.values[pixel[2]] * weight;
+                    area += weight;
+                }
+            }
+
+            uint8_t *ptr {out + i * 4};
+            ptr[0] = 0;
+
+            if (area > 0.0f) {
+                ptr[1] = fromLinear(sum[2] / area);
+                ptr[2] = fromLinear(sum[1] / area);
+                ptr[3] = fromLinear(sum[0] / area);
+            } else {
+                ptr[1] = ptr[2] = ptr[3] = 0;
+            }
+        }
+    }
+
+    if (frames.ends.isEmpty()) {
+        frames.errorString = reader.errorString();
+    } else if (reader.canRead()) {
+        qCWarning(HYELICHT_ANIMATIONS) << i18n("Only showing the first %1 frames of %2.", maximumFrames, source);
+    }
+
+    return frames;
+}
+
+void ImageAnimation::load()
+{
+    const LedLayout layout {ledLayout(squares(), region())};
+
+    const int generation {++m_generation};
+
+    if (m_source.isEmpty()) {
+        finishLoading(generation, Frames {});
+        return;
+    }
+
+    QThread *loader {QThread::create([this, source = m_source, layout, generation]() {
+        const Frames frames {decode(source, layout, m_generation, generation)};
+
+        if (m_generation == generation) {
+            QMetaObject::invokeMethod(this, [this, generation, frames]() { finishLoading(generation, frames); },
+                Qt::QueuedConnection);
+        }
+    })};
+
+    loader->setObjectName(QStringLiteral("ImageLoader"));
+
+    QObject::connect(loader, &QThread::finished, this,
+        [this, loader]() {
+            m_loaders.erase(std::find_if(m_loaders.begin(), m_loaders.end(),
+                [=](const std::unique_ptr<QThread> &other) { return other.get() == loader; }));
+        }, Qt::QueuedConnection);
+
+    m_loaders.emplace_back(loader);
+    loader->start(QThread::LowPriority);
+
+    if (!m_loading) {
+        m_loading = true;
+        Q_EMIT loadingChanged();
+    }
+}
+
+void ImageAnimation::finishLoading(int generation, const Frames &frames)
+{
+    if (generation != m_generation) {
+        return;
+    }
+
+    // An image that failed to load leaves the previous one on the shelf.
+    if (frames.errorString.isEmpty()) {
+        updateRenderState([this, frames]() {
+            m_frames = frames;
+            m_position = -1;
+        });
+    } else {
+        qCWarning(HYELICHT_ANIMATIONS) << i18n("Failed to load image %1: %2", m_source, frames.errorString);
+    }
+
+    if (m_errorString != frames.errorString) {
+        m_errorString = frames.errorString;
+        Q_EMIT errorStringChanged();
+    }
+
+    if (m_loading) {
+        m_loading = false;
+        Q_EMIT loadingChanged();
+    }
+}
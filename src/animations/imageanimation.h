@@ -0,0 +1,161 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "abstractanimation.h"
+
+#include <QString>
+#include <QThread>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//! Animation showing a still image or playing an animated one across the shelf
+/*!
+ * \ingroup Animation
+ *
+ * Stretches the image over the compartments of the shelf front, see
+ * AbstractAnimation::ledLayout. Any format supported by QImageReader works,
+ * including the frames of animated GIF and WebP files, which loop with their
+ * own frame delays.
+ *
+ * Images are decoded and scaled down once, on a thread of their own, so
+ * setting \ref source never blocks the GUI. Each LED gets the average color of
+ * the area of the image it covers, computed in linear light. The results are
+ * stored per frame in the byte layout of LedStrip, so playback only copies
+ * colors and neither decodes, scales nor allocates.
+ *
+ * Layout changes scale the image again. Until loading finishes, the previous
+ * image stays on the shelf.
+ *
+ * \sa AbstractAnimation
+ */
+class ImageAnimation : public AbstractAnimation
+{
+    Q_OBJECT
+
+    //! Path to the image file to show.
+    /*!
+    * \sa setSource
+    * \sa sourceChanged
+    */
+    Q_PROPERTY(QString source READ source WRITE setSource NOTIFY sourceChanged)
+
+    //! Whether \ref source is being loaded.
+    /*!
+    * \sa loadingChanged
+    */
+    Q_PROPERTY(bool loading READ loading NOTIFY loadingChanged)
+
+    //! Why \ref source could not be loaded.
+    /*!
+    * Empty after loading succeeded.
+    *
+    * \sa errorStringChanged
+    */
+    Q_PROPERTY(QString errorString READ errorString NOTIFY errorStringChanged)
+
+    public:
+        //! Create an image animation.
+        /*!
+        * @param parent Parent object
+        */
+        explicit ImageAnimation(QObject *parent = nullptr);
+        ~ImageAnimation() override;
+
+        //! The name of this animation.
+        /*!
+        * @return "Image".
+        */
+        QString name() const override;
+
+        //! The path to the image file to show.
+        /*!
+        * @return A file path.
+        * \sa source (property)
+        * \sa setSource
+        * \sa sourceChanged
+        */
+        QString source() const;
+
+        //! Set the path to the image file to show.
+        /*!
+        * Loading starts right away, in the background.
+        *
+        * @param source A file path.
+        * \sa source
+        * \sa sourceChanged
+        */
+        void setSource(const QString &source);
+
+        //! Whether the image is being loaded.
+        /*!
+        * @return Loading or not.
+        * \sa loading (property)
+        * \sa loadingChanged
+        */
+        bool loading() const;
+
+        //! Why the image could not be loaded.
+        /*!
+        * @return A translated error message, or an empty string.
+        * \sa errorString (property)
+        * \sa errorStringChanged
+        */
+        QString errorString() const;
+
+    Q_SIGNALS:
+        //! The path to the image file to show has changed.
+        /*!
+        * \sa source
+        * \sa setSource
+        */
+        void sourceChanged() const;
+
+        //! Loading the image has started or finished.
+        /*!
+        * \sa loading
+        */
+        void loadingChanged() const;
+
+        //! Why the image could not be loaded has changed.
+        /*!
+        * \sa errorString
+        */
+        void errorStringChanged() const;
+
+    protected:
+        void renderFrame(const Frame &frame) override;
+
+    private:
+        // Frames scaled to the LEDs of a shelf front.
+        struct Frames {
+            QVector<int> leds; // Index of each painted LED on the strip.
+            QVector<uint32_t> colors; // LED data per frame and painted LED; brightness bytes unused.
+            QVector<qint64> ends; // When each frame ends, in milliseconds from the start of the loop.
+            QString errorString; // Why loading failed, or an empty string.
+        };
+
+        static Frames decode(const QString &source, const LedLayout &layout,
+            const std::atomic<int> &generation, int current);
+
+        void load();
+        void finishLoading(int generation, const Frames &frames);
+
+        QString m_source;
+        bool m_loading;
+        QString m_errorString;
+
+        // Loads in progress; all but the newest are cancelled.
+        std::vector<std::unique_ptr<QThread>> m_loaders;
+        std::atomic<int> m_generation;
+
+        Frames m_frames;
+        int m_position;
+        qint64 m_startTime;
+};
@@ -0,0 +1,412 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "noiseanimation.h"
+#include "fastrandom.h"
+#include "ledstrip.h"
+
+#include <KLocalizedString>
+
+#include <QColor>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+
+namespace {
+
+struct NoiseTables {
+    // Doubled, so lookups of summed indices don't need to wrap.
+    uint8_t permutation[512];
+
+    float gradientX[16];
+    float gradientY[16];
+    float gradientZ[16];
+};
+
+// The twelve directions to the edges of a cube, padded to a power of two
+// by repeating four of them.
+const int gradients[16][3] {
+    {1, 1, 0}, {-1, 1, 0}, {1, -1, 0}, {-1, -1, 0},
+    {1, 0, 1}, {-1, 0, 1}, {1, 0, -1}, {-1, 0, -1},
+    {0, 1, 1}, {0, -1, 1}, {0, 1, -1}, {0, -1, -1},
+    {1, 1, 0}, {0, -1, 1}, {-1, 1, 0}, {0, -1, -1}
+};
+
+const NoiseTables &noiseTables()
+{
+    static const NoiseTables tables {[]() {
+        NoiseTables tables;
+
+        // A fixed seed draws the same pattern on every run, e.g. for baked
+        // clips.
+        FastRandom random {0x6879656C};
+        uint32_t values[256];
+        random.fill(values, 256);
+
+        for (int i {0}; i < 256; ++i) {
+            tables.permutation[i] = static_cast<uint8_t>(i);
+        }
+
+        for (int i {255}; i > 0; --i) {
+            std::swap(tables.permutation[i], tables.permutation[values[i] % (i + 1)]);
+        }
+
+        for (int i {0}; i < 256; ++i) {
+            tables.permutation[256 + i] = tables.permutation[i];
+        }
+
+        for (int i {0}; i < 16; ++i) {
+            tables.gradientX[i] = gradients[i][0];
+            tables.gradientY[i] = gradients[i][1];
+            tables.gradientZ[i] = gradients[i][2];
+        }
+
+        return tables;
+    }()};
+
+    return tables;
+}
+
+struct PaletteStop {
+    int position;
+    int red;
+    int green;
+    int blue;
+};
+
+inline float fade(float t)
+{
+    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+inline float lerp(float a, float b, float t)
+{
+    return a + t * (b - a);
+}
+
+// Maps noise from -1.0 to 1.0 onto a palette index.
+inline uint8_t paletteIndex(float noise)
+{
+    return static_cast<uint8_t>(std::clamp((noise + 1.0f) * 127.5f, 0.0f, 255.0f));
+}
+
+// The noise repeats every 256 lattice cells, so wrapping positions keeps
+// them precise on long runs.
+inline float wrap(double position)
+{
+    return static_cast<float>(std::fmod(position, 256.0));
+}
+
+}
+
+NoiseAnimation::NoiseAnimation(QObject *parent)
+    : AbstractAnimation(parent)
+    , m_effect {Plasma}
+    , m_speed {1.0}
+    , m_scale {1.0}
+    , m_parameters {Plasma, 1.0, 1.0}
+    , m_time {0.0}
+{
+    updatePalette();
+
+    setFrameBudget(1000);
+
+    const auto queueLayout = [this]() {
+        updateRenderState([this]() { updateLayout(); });
+    };
+
+    QObject::connect(this, &AbstractAnimation::squaresChanged, this, queueLayout);
+    QObject::connect(this, &AbstractAnimation::regionChanged, this, queueLayout);
+}
+
+NoiseAnimation::~NoiseAnimation()
+{
+    stop();
+}
+
+QString NoiseAnimation::name() const
+{
+    return i18n("Noise");
+}
+
+NoiseAnimation::Effect NoiseAnimation::effect() const
+{
+    return m_effect;
+}
+
+void NoiseAnimation::setEffect(Effect effect)
+{
+    if (m_effect != effect) {
+        m_effect = effect;
+
+        updateRenderState([this, effect]() {
+            m_parameters.effect = effect;
+            updatePalette();
+        });
+
+        Q_EMIT effectChanged();
+    }
+}
+
+qreal NoiseAnimation::speed() const
+{
+    return m_speed;
+}
+
+void NoiseAnimation::setSpeed(qreal speed)
+{
+    speed = std::clamp(speed, 0.0, 10.0);
+
+    if (m_speed != speed) {
+        m_speed = speed;
+        updateRenderState([this, speed]() { m_parameters.speed = speed; });
+
+        Q_EMIT speedChanged();
+    }
+}
+
+qreal NoiseAnimation::scale() const
+{
+    return m_scale;
+}
+
+void NoiseAnimation::setScale(qreal scale)
+{
+    scale = std::clamp(scale, 0.1, 10.0);
+
+    if (m_scale != scale) {
+        m_scale = scale;
+        updateRenderState([this, scale]() { m_parameters.scale = scale; });
+
+        Q_EMIT scaleChanged();
+    }
+}
+
+void NoiseAnimation::renderFrame(const Frame &frame)
+{
+    LedStrip *ledStrip {canvas()};
+
+    if (!ledStrip) {
+        stop();
+        return;
+    }
+
+    if (m_leds.isEmpty()) {
+        return;
+    }
+
+    // Accumulated rather than derived from the frame time, so changing the
+    // speed doesn't make the noise jump.
+    m_time += frame.delta / 1000.0 * m_parameters.speed;
+
+    const float frequency {static_cast<float>(1.0 / m_parameters.scale)};
+    const int leds {static_cast<int>(m_leds.size())};
+
+    float *noise {m_noise.data()};
+    float *octave {m_octave.data()};
+    uint8_t *values {m_values.data()};
+
+    switch (m_parameters.effect) {
+        case Plasma: {
+            sample(frequency, frequency, 0.0f, 0.0f, wrap(m_time * 0.3), noise);
+            sample(frequency * 2.0f, frequency * 2.0f, 17.0f, 31.0f, wrap(m_time * 0.5 + 64.0), octave);
+
+            // The hues also cycle on their own. The palette wraps around.
+            const float shift {wrap(m_time * 12.0)};
+
+            for (int i {0}; i < leds; ++i) {
+                values[i] = static_cast<uint8_t>(static_cast<int>((noise[i] + 0.5f * octave[i])
+                    * 160.0f + shift) & 0xFF);
+            }
+
+            break;
+        }
+        case Drift: {
+            sample(frequency * 0.7f, frequency * 0.7f, 0.0f, 0.0f, wrap(m_time * 0.1), noise);
+
+            for (int i {0}; i < leds; ++i) {
+                values[i] = paletteIndex(noise[i] * 1.4f);
+            }
+
+            break;
+        }
+        case Aurora: {
+            // Stretched vertically, so the bands hang down the shelf.
+            sample(frequency, frequency * 0.25f, wrap(m_time * 0.05), 0.0f, wrap(m_time * 0.2), noise);
+
+            // Bright where the noise crosses zero.
+            for (int i {0}; i < leds; ++i) {
+                const float band {std::max(0.0f, 1.0f - std::abs(noise[i]) * 3.0f)};
+                values[i] = static_cast<uint8_t>(band * band * 255.0f);
+            }
+
+            break;
+        }
+        case Ocean: {
+            sample(frequency * 0.8f, frequency * 0.8f, wrap(m_time * 0.25), 0.0f,
+                wrap(m_time * 0.15), noise);
+            sample(frequency * 1.6f, frequency * 1.6f, wrap(-m_time * 0.4), 9.0f,
+                wrap(m_time * 0.2 + 128.0), octave);
+
+            for (int i {0}; i < leds; ++i) {
+                values[i] = paletteIndex(noise[i] + 0.5f * octave[i]);
+            }
+
+            break;
+        }
+    }
+
+    const int count {ledStrip->count()};
+    uint8_t *data {reinterpret_cast<uint8_t *>(ledStrip->data())};
+
+    for (int i {0}; i < leds; ++i) {
+        const int led {m_leds.at(i)};
+
+        if (led >= count) {
+            continue;
+        }
+
+        const uint8_t *color {m_palette[values[i]]};
+        uint8_t *ptr {data + led * 4};
+        ptr[1] = color[0];
+        ptr[2] = color[1];
+        ptr[3] = color[2];
+    }
+
+    presentFrame();
+}
+
+void NoiseAnimation::updateLayout()
+{
+    LedLayout layout {ledLayout()};
+    m_leds = std::move(layout.leds);
+    m_x = std::move(layout.x);
+    m_y = std::move(layout.y);
+
+    const int leds {static_cast<int>(m_leds.size())};
+    m_cellX.resize(leds);
+    m_cellY.resize(leds);
+    m_fractionX.resize(leds);
+    m_fractionY.resize(leds);
+    m_noise.resize(leds);
+    m_octave.resize(leds);
+    m_values.resize(leds);
+}
+
+void NoiseAnimation::updatePalette()
+{
+    // Entries are in the byte order of the LedStrip data: blue, green, red.
+    if (m_parameters.effect == Plasma) {
+        for (int i {0}; i < 256; ++i) {
+            const QColor color {QColor::fromHsv((i * 360) / 256, 255, 255)};
+            m_palette[i][0] = color.blue();
+            m_palette[i][1] = color.green();
+            m_palette[i][2] = color.red();
+        }
+
+        return;
+    }
+
+    QVector<PaletteStop> stops;
+
+    switch (m_parameters.effect) {
+        case Plasma:
+            break;
+        case Drift:
+            stops = {{0, 4, 4, 28}, {100, 30, 20, 120}, {180, 90, 30, 160}, {255, 20, 140, 180}};
+            break;
+        case Aurora:
+            stops = {{0, 0, 0, 0}, {90, 0, 40, 10}, {180, 20, 200, 80}, {230, 30, 220, 180},
+                {255, 150, 120, 255}};
+            break;
+        case Ocean:
+            stops = {{0, 0, 4, 24}, {128, 0, 40, 120}, {205, 0, 120, 200}, {242, 120, 220, 255},
+                {255, 230, 250, 255}};
+            break;
+    }
+
+    for (int stop {1}; stop < stops.size(); ++stop) {
+        const PaletteStop &from {stops.at(stop - 1)};
+        const PaletteStop &to {stops.at(stop)};
+        const int span {to.position - from.position};
+
+        for (int i {from.position}; i <= to.position; ++i) {
+            const int t {i - from.position};
+            m_palette[i][0] = from.blue + ((to.blue - from.blue) * t) / span;
+            m_palette[i][1] = from.green + ((to.green - from.green) * t) / span;
+            m_palette[i][2] = from.red + ((to.red - from.red) * t) / span;
+        }
+    }
+}
+
+void NoiseAnimation::sample(float frequencyX, float frequencyY, float offsetX, float offsetY,
+    float z, float *out)
+{
+    const NoiseTables &tables {noiseTables()};
+    const uint8_t *permutation {tables.permutation};
+    const float *gradientX {tables.gradientX};
+    const float *gradientY {tables.gradientY};
+    const float *gradientZ {tables.gradientZ};
+
+    const int leds {static_cast<int>(m_leds.size())};
+    const float *x {m_x.constData()};
+    const float *y {m_y.constData()};
+    int *cellX {m_cellX.data()};
+    int *cellY {m_cellY.data()};
+    float *fractionX {m_fractionX.data()};
+    float *fractionY {m_fractionY.data()};
+
+    // Lattice cells and positions within them. Free of table lookups, so
+    // this loop vectorizes.
+    for (int i {0}; i < leds; ++i) {
+        const float px {x[i] * frequencyX + offsetX};
+        const float py {y[i] * frequencyY + offsetY};
+        const float floorX {std::floor(px)};
+        const float floorY {std::floor(py)};
+
+        cellX[i] = static_cast<int>(floorX) & 0xFF;
+        cellY[i] = static_cast<int>(floorY) & 0xFF;
+        fractionX[i] = px - floorX;
+        fractionY[i] = py - floorY;
+    }
+
+    // All LEDs share the same time.
+    const float floorZ {std::floor(z)};
+    const int cellZ {static_cast<int>(floorZ) & 0xFF};
+    const float fz {z - floorZ};
+    const float w {fade(fz)};
+
+    const auto grad = [&](int hash, float dx, float dy, float dz) {
+        const int gradient {permutation[hash] & 0xF};
+        return gradientX[gradient] * dx + gradientY[gradient] * dy + gradientZ[gradient] * dz;
+    };
+
+    for (int i {0}; i < leds; ++i) {
+        const float fx {fractionX[i]};
+        const float fy {fractionY[i]};
+        const float u {fade(fx)};
+        const float v {fade(fy)};
+
+        const int a {permutation[cellX[i]] + cellY[i]};
+        const int b {permutation[cellX[i] + 1] + cellY[i]};
+        const int aa {permutation[a] + cellZ};
+        const int ab {permutation[a + 1] + cellZ};
+        const int ba {permutation[b] + cellZ};
+        const int bb {permutation[b + 1] + cellZ};
+
+        const float front {lerp(
+            lerp(grad(aa, fx, fy, fz), grad(ba, fx - 1.0f, fy, fz), u),
+            lerp(grad(ab, fx, fy - 1.0f, fz), grad(bb, fx - 1.0f, fy - 1.0f, fz), u),
+            v)};
+        const float back {lerp(
+            lerp(grad(aa + 1, fx, fy, fz - 1.0f), grad(ba + 1, fx - 1.0f, fy, fz - 1.0f), u),
+            lerp(grad(ab + 1, fx, fy - 1.0f, fz - 1.0f), grad(bb + 1, fx - 1.0f, fy - 1.0f, fz - 1.0f), u),
+            v)};
+
+        out[i] = lerp(front, back, w);
+    }
+}
@@ -0,0 +1,203 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "abstractanimation.h"
+
+#include <QVector>
+
+//! Ambient animations drawn from gradient noise flowing across the shelf
+/*!
+ * \ingroup Animation
+ *
+ * Samples three-dimensional gradient noise at the position of each LED on the
+ * shelf front, with time as the third dimension, and maps it to colors through
+ * a palette chosen by \ref effect.
+ *
+ * LED positions are derived once from AbstractAnimation::squares, see
+ * AbstractAnimation::ledLayout. Walls between compartments are not painted.
+ *
+ * Noise is evaluated for all LEDs at once from flat arrays. A first pass
+ * computes lattice cells and interpolation weights, which the compiler can
+ * vectorize; a second one looks up gradients in a 512-byte permutation table and
+ * a 16-entry gradient table, which stay in the L1 cache. Palettes are 256-entry
+ * lookup tables rebuilt only when the effect changes. The default \ref
+ * frameBudget is 1 ms.
+ *
+ * \sa AbstractAnimation
+ * \sa ShelfModel
+ */
+class NoiseAnimation : public AbstractAnimation
+{
+    Q_OBJECT
+
+    //! The look of the animation.
+    /*!
+    * Defaults to \c Plasma.
+    *
+    * \sa setEffect
+    * \sa effectChanged
+    */
+    Q_PROPERTY(Effect effect READ effect WRITE setEffect NOTIFY effectChanged)
+
+    //! How fast the noise flows, as a factor of the effect's natural pace.
+    /*!
+    * Clamped to a range of \c 0.0 to \c 10.0. At \c 0.0, the animation holds still.
+    *
+    * Defaults to \c 1.0.
+    *
+    * \sa setSpeed
+    * \sa speedChanged
+    */
+    Q_PROPERTY(qreal speed READ speed WRITE setSpeed NOTIFY speedChanged)
+
+    //! Size of the noise features in compartments.
+    /*!
+    * Clamped to a range of \c 0.1 to \c 10.0.
+    *
+    * Defaults to \c 1.0.
+    *
+    * \sa setScale
+    * \sa scaleChanged
+    */
+    Q_PROPERTY(qreal scale READ scale WRITE setScale NOTIFY scaleChanged)
+
+    public:
+        //! Used to choose the look of the animation.
+        enum Effect {
+            Plasma, //!< Two octaves of noise cycling through the hues.
+            Drift,  //!< A single slow octave in deep blues and violets.
+            Aurora, //!< Bright bands of green and teal wandering across a dark shelf.
+            Ocean   //!< Two octaves flowing in opposite directions in shades of blue.
+        };
+        Q_ENUM(Effect)
+
+        //! Create a noise animation.
+        /*!
+        * @param parent Parent object
+        */
+        explicit NoiseAnimation(QObject *parent = nullptr);
+        ~NoiseAnimation() override;
+
+        //! The name of this animation.
+        /*!
+        * @return "Noise".
+        */
+        QString name() const override;
+
+        //! The look of the animation.
+        /*!
+        * @return An effect.
+        * \sa effect (property)
+        * \sa setEffect
+        * \sa effectChanged
+        */
+        Effect effect() const;
+
+        //! Set the look of the animation.
+        /*!
+        * @param effect An effect.
+        * \sa effect
+        * \sa effectChanged
+        */
+        void setEffect(Effect effect);
+
+        //! How fast the noise flows.
+        /*!
+        * @return Factor of the effect's natural pace.
+        * \sa speed (property)
+        * \sa setSpeed
+        * \sa speedChanged
+        */
+        qreal speed() const;
+
+        //! Set how fast the noise flows.
+        /*!
+        * @param speed Factor of the effect's natural pace, from \c 0.0 to \c 10.0.
+        * \sa speed
+        * \sa speedChanged
+        */
+        void setSpeed(qreal speed);
+
+        //! The size of the noise features.
+        /*!
+        * @return Size in compartments.
+        * \sa scale (property)
+        * \sa setScale
+        * \sa scaleChanged
+        */
+        qreal scale() const;
+
+        //! Set the size of the noise features.
+        /*!
+        * @param scale Size in compartments, from \c 0.1 to \c 10.0.
+        * \sa scale
+        * \sa scaleChanged
+        */
+        void setScale(qreal scale);
+
+    Q_SIGNALS:
+        //! The look of the animation has changed.
+        /*!
+        * \sa effect
+        * \sa setEffect
+        */
+        void effectChanged() const;
+
+        //! How fast the noise flows has changed.
+        /*!
+        * \sa speed
+        * \sa setSpeed
+        */
+        void speedChanged() const;
+
+        //! The size of the noise features has changed.
+        /*!
+        * \sa scale
+        * \sa setScale
+        */
+        void scaleChanged() const;
+
+    protected:
+        void renderFrame(const Frame &frame) override;
+
+    private:
+        void updateLayout();
+        void updatePalette();
+        void sample(float frequencyX, float frequencyY, float offsetX, float offsetY, float z,
+            float *out);
+
+        Effect m_effect;
+        qreal m_speed;
+        qreal m_scale;
+
+        // The properties as seen by renderFrame.
+        struct Parameters {
+            Effect effect;
+            qreal speed;
+            qreal scale;
+        };
+
+        Parameters m_parameters;
+
+        double m_time; // Seconds at the effect's pace.
+
+        // Per painted LED.
+        QVector<int> m_leds;
+        QVector<float> m_x;
+        QVector<float> m_y;
+
+        // Scratch space for sampling, sized along with the above.
+        QVector<int> m_cellX;
+        QVector<int> m_cellY;
+        QVector<float> m_fractionX;
+        QVector<float> m_fractionY;
+        QVector<float> m_noise;
+        QVector<float> m_octave;
+        QVector<uint8_t> m_values;
+
+        uint8_t m_palette[256][3];
+};
@@ -0,0 +1,23 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "animationfactory.h"
+#include "noiseanimation.h"
+
+//! Plugin providing NoiseAnimation
+class NoisePlugin : public QObject, public AnimationFactory
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID AnimationFactory_iid FILE "noise.json")
+    Q_INTERFACES(AnimationFactory)
+
+    public:
+        AbstractAnimation *create(QObject *parent) override
+        {
+            return new NoiseAnimation(parent);
+        }
+};
+
+#include "noiseplugin.moc"
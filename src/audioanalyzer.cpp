@@ -0,0 +1,176 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "audioanalyzer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const float lowestFrequency {40.0f};
+const float highestFrequency {16000.0f};
+
+// Levels span this far below the peak of their band.
+const float dynamicRange {40.0f}; // dB
+
+// Peaks never drop below this, so silence isn't amplified into noise.
+const float peakFloor {-60.0f}; // dB
+
+// Nor further below the overall peak, so quiet bands stay dim next to loud
+// ones.
+const float bandPeakRange {24.0f}; // dB
+
+const float peakDecay {6.0f}; // dB per second
+const float levelRelease {2.5f}; // Full range per second
+
+// Onsets are detected in the bands below about 250 Hz.
+const int bassBands {5};
+const float onsetSensitivity {1.5f}; // Standard deviations above the mean
+const float minimumFlux {6.0f}; // dB
+const float onsetHoldOff {0.12f}; // Seconds
+
+inline float decibels(float power)
+{
+    return 10.0f * std::log10(power + 1e-10f);
+}
+
+}
+
+AudioAnalyzer::AudioAnalyzer(int sampleRate)
+    : m_sampleRate {std::max(sampleRate, 8000)}
+    , m_fft {WindowSize}
+{
+    m_window.resize(WindowSize);
+
+    for (int i {0}; i < WindowSize; ++i) {
+        m_window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * M_PI * i / (WindowSize - 1)));
+    }
+
+    m_samples.resize(WindowSize);
+    m_weighted.resize(WindowSize);
+    m_power.resize(WindowSize / 2 + 1);
+
+    // Logarithmically spaced, at least one bin wide.
+    const float highest {std::min(highestFrequency, m_sampleRate * 0.45f)};
+
+    for (int band {0}; band <= AudioFeatures::Bands; ++band) {
+        const float frequency {lowestFrequency * std::pow(highest / lowestFrequency,
+            static_cast<float>(band) / AudioFeatures::Bands)};
+        int bin {static_cast<int>(std::lround(frequency * WindowSize / m_sampleRate))};
+
+        if (band > 0) {
+            bin = std::max(bin, m_bandStart[band - 1] + 1);
+        }
+
+        m_bandStart[band] = std::clamp(bin, 1, WindowSize / 2 + 1);
+    }
+
+    m_flux.resize(std::max(8, m_sampleRate / HopSize));
+
+    reset();
+}
+
+int AudioAnalyzer::sampleRate() const
+{
+    return m_sampleRate;
+}
+
+void AudioAnalyzer::reset()
+{
+    std::fill(m_samples.begin(), m_samples.end(), 0.0f);
+    std::fill(m_flux.begin(), m_flux.end(), 0.0f);
+
+    std::fill(std::begin(m_peaks), std::end(m_peaks), peakFloor);
+    std::fill(std::begin(m_previous), std::end(m_previous), peakFloor - dynamicRange);
+    std::fill(std::begin(m_levels), std::end(m_levels), 0.0f);
+    m_peak = peakFloor;
+    m_level = 0.0f;
+
+    m_fluxIndex = 0;
+    m_holdOff = 0;
+}
+
+void AudioAnalyzer::analyze(const float *samples, AudioFeatures &features)
+{
+    float *window {m_samples.data()};
+    memmove(window, window + HopSize, (WindowSize - HopSize) * sizeof(float));
+    memcpy(window + WindowSize - HopSize, samples, HopSize * sizeof(float));
+
+    float *weighted {m_weighted.data()};
+    const float *hann {m_window.constData()};
+
+    for (int i {0}; i < WindowSize; ++i) {
+        weighted[i] = window[i] * hann[i];
+    }
+
+    m_fft.powerSpectrum(weighted, m_power.data());
+
+    // A full-scale sine comes to about 0 dB: the Hann window sums to half
+    // the window size.
+    const float scale {4.0f / (static_cast<float>(WindowSize) * WindowSize)};
+    const float hop {static_cast<float>(HopSize) / m_sampleRate};
+    const float decay {peakDecay * hop};
+    const float release {levelRelease * hop};
+
+    const float *power {m_power.constData()};
+    float total {0.0f};
+    float flux {0.0f};
+
+    for (int band {0}; band < AudioFeatures::Bands; ++band) {
+        float energy {0.0f};
+
+        for (int bin {m_bandStart[band]}; bin < m_bandStart[band + 1]; ++bin) {
+            energy += power[bin];
+        }
+
+        energy *= scale;
+        total += energy;
+
+        const float db {decibels(energy)};
+        m_peaks[band] = std::max({db, m_peaks[band] - decay, m_peak - bandPeakRange, peakFloor});
+
+        const float level {std::clamp((db - m_peaks[band] + dynamicRange) / dynamicRange, 0.0f, 1.0f)};
+        m_levels[band] = std::max(level, m_levels[band] - release);
+        features.levels[band] = m_levels[band];
+
+        if (band < bassBands) {
+            flux += std::max(0.0f, db - m_previous[band]);
+        }
+
+        m_previous[band] = db;
+    }
+
+    const float db {decibels(total)};
+    m_peak = std::max({db, m_peak - decay, peakFloor});
+    m_level = std::max(std::clamp((db - m_peak + dynamicRange) / dynamicRange, 0.0f, 1.0f),
+        m_level - release);
+    features.level = m_level;
+
+    // An onset rises well above the flux of the last second.
+    const int history {static_cast<int>(m_flux.size())};
+    float mean {0.0f};
+    float squares {0.0f};
+
+    for (const float value : std::as_const(m_flux)) {
+        mean += value;
+        squares += value * value;
+    }
+
+    mean /= history;
+    const float deviation {std::sqrt(std::max(0.0f, squares / history - mean * mean))};
+
+    features.onset = !m_holdOff && flux > minimumFlux && flux > mean + onsetSensitivity * deviation;
+
+    if (features.onset) {
+        m_holdOff = static_cast<int>(onsetHoldOff / hop);
+    } else if (m_holdOff) {
+        --m_holdOff;
+    }
+
+    m_flux[m_fluxIndex] = flux;
+    m_fluxIndex = (m_fluxIndex + 1) % history;
+}
@@ -0,0 +1,93 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "fft.h"
+
+#include <QVector>
+
+//! What AudioAnalyzer extracts from a block of audio
+/*!
+ * \ingroup Backend
+ */
+struct AudioFeatures {
+    static const int Bands {16}; //!< Number of frequency bands.
+
+    qint64 captureTime {0}; //!< When the newest sample was captured, in nanoseconds of the QDeadlineTimer clock.
+    float levels[Bands] {}; //!< Loudness per frequency band, from low to high, each from \c 0.0 to \c 1.0.
+    float level {0.0f}; //!< Overall loudness from \c 0.0 to \c 1.0.
+    bool onset {false}; //!< Whether a beat starts in the block.
+};
+
+//! Turns a stream of audio samples into band levels and beat onsets
+/*!
+ * \ingroup Backend
+ *
+ * Takes blocks of \ref HopSize mono samples. Each block completes a window of the
+ * last \ref WindowSize samples, which is weighted with a Hann window and
+ * transformed with a preallocated Fft. The power spectrum is summed into
+ * \ref AudioFeatures::Bands logarithmically spaced bands from 40 Hz to 16 kHz.
+ *
+ * Band levels are relative to a peak per band that follows the music and slowly
+ * falls during quiet passages, so the levels span their range at any volume.
+ * Levels rise immediately and fall gradually.
+ *
+ * Onsets are detected from the rise in energy of the bass bands (spectral flux),
+ * against a threshold adapting to the last second of music.
+ *
+ * Nothing is allocated after construction.
+ *
+ * \sa AudioInput
+ */
+class AudioAnalyzer
+{
+    public:
+        static const int WindowSize {1024}; //!< Number of samples transformed at once.
+        static const int HopSize {256}; //!< Number of samples per block.
+
+        //! Create an analyzer.
+        /*!
+        * @param sampleRate Sample rate of the audio in Hz.
+        */
+        explicit AudioAnalyzer(int sampleRate);
+
+        //! The sample rate of the audio.
+        /*!
+        * @return Sample rate in Hz.
+        */
+        int sampleRate() const;
+
+        //! Analyze the next block of samples.
+        /*!
+        * @param samples \ref HopSize mono samples from \c -1.0 to \c 1.0.
+        * @param features Receives the features, except for
+        * AudioFeatures::captureTime.
+        */
+        void analyze(const float *samples, AudioFeatures &features);
+
+        //! Forget the audio analyzed so far, e.g. after a gap.
+        void reset();
+
+    private:
+        int m_sampleRate;
+        Fft m_fft;
+
+        QVector<float> m_window;
+        QVector<float> m_samples; // The last WindowSize samples.
+        QVector<float> m_weighted;
+        QVector<float> m_power;
+
+        int m_bandStart[AudioFeatures::Bands + 1]; // Bins, the last one ending the last band.
+        float m_peaks[AudioFeatures::Bands]; // In dB.
+        float m_previous[AudioFeatures::Bands]; // In dB.
+        float m_levels[AudioFeatures::Bands];
+        float m_peak;
+        float m_level;
+
+        QVector<float> m_flux; // Ring buffer of the last second.
+        int m_fluxIndex;
+        int m_holdOff; // Blocks until the next onset may be reported.
+};
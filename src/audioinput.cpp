@@ -0,0 +1,572 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "audioinput.h"
+#include "debug_audio.h"
+
+#include <KLocalizedString>
+
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#ifdef HAVE_ALSA
+#include <alsa/asoundlib.h>
+#endif
+
+namespace {
+
+const qint64 statisticsInterval {10000}; // Milliseconds.
+const int pollTimeout {100}; // Milliseconds; how quickly a stop request is noticed.
+
+inline float fromS16(const char *data)
+{
+    return qFromLittleEndian<qint16>(data) / 32768.0f;
+}
+
+}
+
+// Delivers blocks of AudioAnalyzer::HopSize mono samples.
+class AudioSource
+{
+    public:
+        virtual ~AudioSource() = default;
+
+        virtual int sampleRate() const = 0;
+
+        // Blocks until a full block was read, or returns false if stopping
+        // or on a fatal error.
+        virtual bool read(float *samples, const std::atomic<bool> &stopping) = 0;
+};
+
+namespace {
+
+// Decodes a whole WAV file up front, then plays it in real time and loops.
+class WavSource : public AudioSource
+{
+    public:
+        static std::unique_ptr<WavSource> open(const QString &path)
+        {
+            QFile file(path);
+
+            if (!file.open(QIODevice::ReadOnly)) {
+                qCWarning(HYELICHT_AUDIO) << i18n("Failed to open WAV file %1: %2", path, file.errorString());
+                return {};
+            }
+
+            const QByteArray data {file.readAll()};
+
+            if (data.size() < 12 || !data.startsWith("RIFF") || data.mid(8, 4) != "WAVE") {
+                qCWarning(HYELICHT_AUDIO) << i18n("%1 is not a WAV file.", path);
+                return {};
+            }
+
+            int format {0};
+            int channels {0};
+            int sampleRate {0};
+            int bits {0};
+            QByteArrayView samples;
+
+            for (qsizetype offset {12}; offset + 8 <= data.size();) {
+                const QByteArray id {data.mid(offset, 4)};
+                const qsizetype size {qFromLittleEndian<quint32>(data.constData() + offset + 4)};
+                const char *chunk {data.constData() + offset + 8};
+                const qsizetype available {std::min(size, data.size() - offset - 8)};
+
+                if (id == "fmt " && available >= 16) {
+                    format = qFromLittleEndian<quint16>(chunk);
+                    channels = qFromLittleEndian<quint16>(chunk + 2);
+                    sampleRate = qFromLittleEndian<quint32>(chunk + 4);
+                    bits = qFromLittleEndian<quint16>(chunk + 14);
+
+                    // WAVE_FORMAT_EXTENSIBLE keeps the actual format in the sub-format GUID.
+                    if (format == 0xFFFE && available >= 26) {
+                        format = qFromLittleEndian<quint16>(chunk + 24);
+                    }
+                } else if (id == "data") {
+                    samples = QByteArrayView {chunk, available};
+                }
+
+                offset += 8 + size + (size & 1);
+            }
+
+            const bool pcm16 {format == 1 && bits == 16};
+            const bool float32 {format == 3 && bits == 32};
+
+            if ((!pcm16 && !float32) || channels < 1 || sampleRate < 8000) {
+                qCWarning(HYELICHT_AUDIO) << i18n("%1 must contain 16-bit integer or 32-bit float PCM audio "
+                    "at 8 kHz or more.", path);
+                return {};
+            }
+
+            const qsizetype frameSize {channels * bits / 8};
+            const qsizetype frames {samples.size() / frameSize};
+
+            if (frames < AudioAnalyzer::HopSize) {
+                qCWarning(HYELICHT_AUDIO) << i18n("%1 contains too little audio.", path);
+                return {};
+            }
+
+            std::unique_ptr<WavSource> source {new WavSource(sampleRate)};
+            source->m_samples.resize(frames);
+
+            for (qsizetype frame {0}; frame < frames; ++frame) {
+                const char *sample {samples.data() + frame * frameSize};
+                float sum {0.0f};
+
+                for (int channel {0}; channel < channels; ++channel) {
+                    sum += pcm16 ? fromS16(sample + channel * 2)
+                        : qFromLittleEndian<float>(sample + channel * 4);
+                }
+
+                source->m_samples[frame] = sum / channels;
+            }
+
+            return source;
+        }
+
+        int sampleRate() const override
+        {
+            return m_sampleRate;
+        }
+
+        bool read(float *samples, const std::atomic<bool> &stopping) override
+        {
+            const auto now {std::chrono::steady_clock::now()};
+
+            if (m_next.time_since_epoch().count() == 0 || m_next < now - m_block * 4) {
+                m_next = now;
+            }
+
+            m_next += m_block;
+
+            // Like a capture device, deliver the block once it has been played.
+            while (std::chrono::steady_clock::now() < m_next) {
+                if (stopping.load(std::memory_order_relaxed)) {
+                    return false;
+                }
+
+                std::this_thread::sleep_until(std::min(m_next,
+                    std::chrono::steady_clock::now() + std::chrono::milliseconds(pollTimeout)));
+            }
+
+            const qsizetype length {m_samples.size()};
+
+            for (int i {0}; i < AudioAnalyzer::HopSize; ++i) {
+                samples[i] = m_samples.at(m_position);
+                m_position = (m_position + 1) % length;
+            }
+
+            return !stopping.load(std::memory_order_relaxed);
+        }
+
+    private:
+        explicit WavSource(int sampleRate)
+            : m_sampleRate {sampleRate}
+            , m_block {std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(static_cast<double>(AudioAnalyzer::HopSize) / sampleRate))}
+            , m_position {0}
+        {
+        }
+
+        int m_sampleRate;
+        std::chrono::steady_clock::duration m_block;
+        std::chrono::steady_clock::time_point m_next;
+
+        QVector<float> m_samples;
+        qsizetype m_position;
+};
+
+// Raw signed 16-bit little endian PCM from a named pipe. Waits for writers
+// to come and go.
+class FifoSource : public AudioSource
+{
+    public:
+        static std::unique_ptr<FifoSource> open(const QString &path, int sampleRate, int channels)
+        {
+            const int fd {::open(QFile::encodeName(path).constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC)};
+
+            if (fd < 0) {
+                qCWarning(HYELICHT_AUDIO) << i18n("Failed to open FIFO %1: %2", path,
+                    QString::fromLocal8Bit(strerror(errno)));
+                return {};
+            }
+
+            return std::unique_ptr<FifoSource>(new FifoSource(fd, sampleRate, channels));
+        }
+
+        ~FifoSource() override
+        {
+            ::close(m_fd);
+        }
+
+        int sampleRate() const override
+        {
+            return m_sampleRate;
+        }
+
+        bool read(float *samples, const std::atomic<bool> &stopping) override
+        {
+            const qsizetype blockSize {m_buffer.size()};
+
+            while (m_filled < blockSize) {
+                if (stopping.load(std::memory_order_relaxed)) {
+                    return false;
+                }
+
+                pollfd descriptor {m_fd, POLLIN, 0};
+
+                if (poll(&descriptor, 1, pollTimeout) <= 0) {
+                    continue;
+                }
+
+                const ssize_t bytes {::read(m_fd, m_buffer.data() + m_filled, blockSize - m_filled)};
+
+                if (bytes > 0) {
+                    m_filled += bytes;
+                } else if (bytes == 0) {
+                    // No writer; poll keeps reporting a hang-up until one opens the pipe.
+                    std::this_thread::sleep_for(std::chrono::milliseconds(pollTimeout));
+                } else if (errno != EAGAIN && errno != EINTR) {
+                    qCWarning(HYELICHT_AUDIO) << i18n("Failed to read from FIFO: %1",
+                        QString::fromLocal8Bit(strerror(errno)));
+                    return false;
+                }
+            }
+
+            for (int i {0}; i < AudioAnalyzer::HopSize; ++i) {
+                const char *frame {m_buffer.constData() + i * m_channels * 2};
+                float sum {0.0f};
+
+                for (int channel {0}; channel < m_channels; ++channel) {
+                    sum += fromS16(frame + channel * 2);
+                }
+
+                samples[i] = sum / m_channels;
+            }
+
+            m_filled = 0;
+
+            return true;
+        }
+
+    private:
+        FifoSource(int fd, int sampleRate, int channels)
+            : m_fd {fd}
+            , m_sampleRate {sampleRate}
+            , m_channels {channels}
+            , m_filled {0}
+        {
+            m_buffer.resize(AudioAnalyzer::HopSize * channels * 2);
+        }
+
+        int m_fd;
+        int m_sampleRate;
+        int m_channels;
+
+        QByteArray m_buffer;
+        qsizetype m_filled;
+};
+
+#ifdef HAVE_ALSA
+class AlsaSource : public AudioSource
+{
+    public:
+        static std::unique_ptr<AlsaSource> open(const QString &device, int sampleRate, int channels)
+        {
+            snd_pcm_t *pcm {nullptr};
+            int error {snd_pcm_open(&pcm, device.toLocal8Bit().constData(), SND_PCM_STREAM_CAPTURE,
+                SND_PCM_NONBLOCK)};
+
+            if (error >= 0) {
+                // A short buffer keeps blocks from waiting in the device.
+                error = snd_pcm_set_params(pcm, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED,
+                    channels, sampleRate, 1, 10000);
+            }
+
+            if (error < 0) {
+                qCWarning(HYELICHT_AUDIO) << i18n("Failed to open ALSA capture device %1: %2", device,
+                    QString::fromLocal8Bit(snd_strerror(error)));
+
+                if (pcm) {
+                    snd_pcm_close(pcm);
+                }
+
+                return {};
+            }
+
+            return std::unique_ptr<AlsaSource>(new AlsaSource(pcm, sampleRate, channels));
+        }
+
+        ~AlsaSource() override
+        {
+            snd_pcm_close(m_pcm);
+        }
+
+        int sampleRate() const override
+        {
+            return m_sampleRate;
+        }
+
+        bool read(float *samples, const std::atomic<bool> &stopping) override
+        {
+            snd_pcm_sframes_t filled {0};
+
+            while (filled < AudioAnalyzer::HopSize) {
+                if (stopping.load(std::memory_order_relaxed)) {
+                    return false;
+                }
+
+                snd_pcm_wait(m_pcm, pollTimeout);
+
+                snd_pcm_sframes_t frames {snd_pcm_readi(m_pcm, m_buffer.data() + filled * m_channels,
+                    AudioAnalyzer::HopSize - filled)};
+
+                if (frames == -EAGAIN) {
+                    continue;
+                } else if (frames < 0) {
+                    // Recovers from overruns, e.g. after the thread was descheduled.
+                    frames = snd_pcm_recover(m_pcm, frames, 1);
+
+                    if (frames < 0) {
+                        qCWarning(HYELICHT_AUDIO) << i18n("Failed to read from ALSA capture device: %1",
+                            QString::fromLocal8Bit(snd_strerror(static_cast<int>(frames))));
+                        return false;
+                    }
+
+                    continue;
+                }
+
+                filled += frames;
+            }
+
+            for (int i {0}; i < AudioAnalyzer::HopSize; ++i) {
+                float sum {0.0f};
+
+                for (int channel {0}; channel < m_channels; ++channel) {
+                    sum += m_buffer.at(i * m_channels + channel) / 32768.0f;
+                }
+
+                samples[i] = sum / m_channels;
+            }
+
+            return true;
+        }
+
+    private:
+        AlsaSource(snd_pcm_t *pcm, int sampleRate, int channels)
+            : m_pcm {pcm}
+            , m_sampleRate {sampleRate}
+            , m_channels {channels}
+        {
+            m_buffer.resize(AudioAnalyzer::HopSize * channels);
+        }
+
+        snd_pcm_t *m_pcm;
+        int m_sampleRate;
+        int m_channels;
+
+        QVector<qint16> m_buffer;
+};
+#endif
+
+}
+
+AudioInput::AudioInput(QObject *parent)
+    : QObject(parent)
+    , m_sampleRate {48000}
+    , m_channels {2}
+    , m_stopping {false}
+{
+}
+
+AudioInput::~AudioInput()
+{
+    stop();
+}
+
+QString AudioInput::source() const
+{
+    return m_source;
+}
+
+void AudioInput::setSource(const QString &source)
+{
+    if (m_source != source) {
+        m_source = source;
+
+        Q_EMIT sourceChanged();
+    }
+}
+
+int AudioInput::sampleRate() const
+{
+    return m_sampleRate;
+}
+
+void AudioInput::setSampleRate(int sampleRate)
+{
+    if (sampleRate < 8000 || sampleRate > 192000) {
+        qCWarning(HYELICHT_AUDIO) << i18n("setSampleRate: %1 Hz requested, but must be between "
+            "8000 and 192000.", sampleRate);
+        return;
+    }
+
+    if (m_sampleRate != sampleRate) {
+        m_sampleRate = sampleRate;
+
+        Q_EMIT sampleRateChanged();
+    }
+}
+
+int AudioInput::channels() const
+{
+    return m_channels;
+}
+
+void AudioInput::setChannels(int channels)
+{
+    if (channels != 1 && channels != 2) {
+        qCWarning(HYELICHT_AUDIO) << i18n("setChannels: %1 channels requested, but must be 1 or 2.",
+            channels);
+        return;
+    }
+
+    if (m_channels != channels) {
+        m_channels = channels;
+
+        Q_EMIT channelsChanged();
+    }
+}
+
+bool AudioInput::running() const
+{
+    return m_thread != nullptr;
+}
+
+void AudioInput::start()
+{
+    if (m_thread) {
+        return;
+    }
+
+    if (m_source.startsWith(QLatin1String("alsa:"))) {
+#ifdef HAVE_ALSA
+        m_capture = AlsaSource::open(m_source.mid(5), m_sampleRate, m_channels);
+#else
+        qCWarning(HYELICHT_AUDIO) << i18n("Cannot capture from %1: hyelicht was built without ALSA.",
+            m_source);
+#endif
+    } else if (m_source.startsWith(QLatin1String("fifo:"))) {
+        m_capture = FifoSource::open(m_source.mid(5), m_sampleRate, m_channels);
+    } else if (!m_source.isEmpty()) {
+        m_capture = WavSource::open(m_source.startsWith(QLatin1String("wav:")) ? m_source.mid(4) : m_source);
+    }
+
+    if (!m_capture) {
+        return;
+    }
+
+    // Drop what a previous run left behind.
+    AudioFeatures features;
+    while (m_features.pop(features)) {}
+
+    m_stopping = false;
+    m_thread.reset(QThread::create([this, source = m_capture.get()]() { capture(source); }));
+    m_thread->setObjectName(QStringLiteral("AudioThread"));
+
+    // Stop once capture fails on its own.
+    QObject::connect(m_thread.get(), &QThread::finished, this,
+        [this, thread = m_thread.get()]() {
+            if (m_thread.get() == thread) {
+                stop();
+            }
+        }, Qt::QueuedConnection);
+
+    m_thread->start(QThread::TimeCriticalPriority);
+
+    Q_EMIT runningChanged(true);
+}
+
+void AudioInput::stop()
+{
+    if (!m_thread) {
+        return;
+    }
+
+    m_stopping = true;
+    m_thread->wait();
+    m_thread.reset();
+    m_capture.reset();
+
+    Q_EMIT runningChanged(false);
+}
+
+bool AudioInput::takeFeatures(AudioFeatures &features)
+{
+    AudioFeatures next;
+    bool taken {false};
+    bool onset {false};
+
+    while (m_features.pop(next)) {
+        onset = onset || next.onset;
+        features = next;
+        taken = true;
+    }
+
+    features.onset = onset;
+
+    return taken;
+}
+
+void AudioInput::capture(AudioSource *source)
+{
+    AudioAnalyzer analyzer {source->sampleRate()};
+    QVector<float> samples(AudioAnalyzer::HopSize);
+    AudioFeatures features;
+
+    QElapsedTimer statisticsClock;
+    statisticsClock.start();
+    qint64 analysisTime {0};
+    int blocks {0};
+    int droppedBlocks {0};
+
+    while (source->read(samples.data(), m_stopping)) {
+        features.captureTime = QDeadlineTimer::current(Qt::PreciseTimer).deadlineNSecs();
+
+        analyzer.analyze(samples.constData(), features);
+
+        analysisTime += QDeadlineTimer::current(Qt::PreciseTimer).deadlineNSecs() - features.captureTime;
+        ++blocks;
+
+        // Nobody is picking up features. Only the consumer may take them out
+        // of the queue, so the new block is dropped and the next pick-up sees
+        // the blocks queued before the queue filled up.
+        if (!m_features.push(features)) {
+            ++droppedBlocks;
+        }
+
+        if (statisticsClock.elapsed() >= statisticsInterval) {
+            qCDebug(HYELICHT_AUDIO) << i18n("Analyzed %1 blocks at %2 µs each; %3 dropped.", blocks,
+                analysisTime / 1000 / blocks, droppedBlocks);
+
+            statisticsClock.restart();
+            analysisTime = 0;
+            blocks = 0;
+            droppedBlocks = 0;
+        }
+    }
+}
@@ -0,0 +1,217 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "hyelicht_core_export.h"
+
+#include "audioanalyzer.h"
+#include "spscqueue.h"
+
+#include <QObject>
+#include <QThread>
+
+#include <atomic>
+#include <memory>
+
+class AudioSource;
+
+//! Captures audio on a thread of its own and analyzes it as it comes in
+/*!
+ * \ingroup Backend
+ *
+ * Reads mono or stereo PCM audio from \ref source in blocks of
+ * AudioAnalyzer::HopSize samples, e.g. 5.3 ms at 48 kHz, and analyzes each block
+ * right away with an AudioAnalyzer. The features are handed to a single consumer,
+ * usually an animation rendering on another thread, through a lock-free
+ * SpscQueue and picked up with \ref takeFeatures.
+ *
+ * Sources are given as:
+ *
+ * - \c alsa:<em>device</em>, e.g. \c alsa:default, for an ALSA capture device.
+ *   Requires hyelicht to be built with ALSA.
+ * - \c fifo:<em>path</em> for a named pipe delivering raw signed 16-bit little
+ *   endian PCM, e.g. from a music player, at \ref sampleRate with \ref channels.
+ * - The path of a WAV file, played in real time and looped, e.g. for testing.
+ *   Its own sample rate and channels apply.
+ *
+ * \sa AudioAnalyzer
+ */
+class HYELICHT_CORE_EXPORT AudioInput : public QObject
+{
+    Q_OBJECT
+
+    //! Where to capture audio from.
+    /*!
+    * See the class description for the format. Changes take effect on the next
+    * \ref start.
+    *
+    * \sa setSource
+    * \sa sourceChanged
+    */
+    Q_PROPERTY(QString source READ source WRITE setSource NOTIFY sourceChanged)
+
+    //! Sample rate of ALSA and FIFO sources in Hz.
+    /*!
+    * Defaults to \c 48000.
+    *
+    * \sa setSampleRate
+    * \sa sampleRateChanged
+    */
+    Q_PROPERTY(int sampleRate READ sampleRate WRITE setSampleRate NOTIFY sampleRateChanged)
+
+    //! Number of channels of ALSA and FIFO sources: \c 1 or \c 2.
+    /*!
+    * Channels are mixed down to mono. Defaults to \c 2.
+    *
+    * \sa setChannels
+    * \sa channelsChanged
+    */
+    Q_PROPERTY(int channels READ channels WRITE setChannels NOTIFY channelsChanged)
+
+    //! Whether audio is being captured.
+    /*!
+    * \sa start
+    * \sa stop
+    * \sa runningChanged
+    */
+    Q_PROPERTY(bool running READ running NOTIFY runningChanged)
+
+    public:
+        //! Create an audio input.
+        /*!
+        * @param parent Parent object
+        */
+        explicit AudioInput(QObject *parent = nullptr);
+        ~AudioInput() override;
+
+        //! Where to capture audio from.
+        /*!
+        * @return A source.
+        * \sa source (property)
+        * \sa setSource
+        * \sa sourceChanged
+        */
+        QString source() const;
+
+        //! Set where to capture audio from.
+        /*!
+        * @param source A source.
+        * \sa source
+        * \sa sourceChanged
+        */
+        void setSource(const QString &source);
+
+        //! The sample rate of ALSA and FIFO sources.
+        /*!
+        * @return Sample rate in Hz.
+        * \sa sampleRate (property)
+        * \sa setSampleRate
+        * \sa sampleRateChanged
+        */
+        int sampleRate() const;
+
+        //! Set the sample rate of ALSA and FIFO sources.
+        /*!
+        * @param sampleRate Sample rate in Hz.
+        * \sa sampleRate
+        * \sa sampleRateChanged
+        */
+        void setSampleRate(int sampleRate);
+
+        //! The number of channels of ALSA and FIFO sources.
+        /*!
+        * @return \c 1 or \c 2.
+        * \sa channels (property)
+        * \sa setChannels
+        * \sa channelsChanged
+        */
+        int channels() const;
+
+        //! Set the number of channels of ALSA and FIFO sources.
+        /*!
+        * @param channels \c 1 or \c 2.
+        * \sa channels
+        * \sa channelsChanged
+        */
+        void setChannels(int channels);
+
+        //! Whether audio is being captured.
+        /*!
+        * @return Running or not.
+        * \sa running (property)
+        * \sa runningChanged
+        */
+        bool running() const;
+
+        //! Start capturing audio from \ref source.
+        /*!
+        * Failing to open the source is logged, and leaves the input stopped.
+        *
+        * \sa stop
+        */
+        Q_INVOKABLE void start();
+
+        //! Stop capturing audio.
+        /*!
+        * \sa start
+        */
+        Q_INVOKABLE void stop();
+
+        //! Pick up the features of the audio analyzed since the last call.
+        /*!
+        * Only to be called by a single consumer, on any thread. Blocks analyzed
+        * while the queue was full are dropped, so after a pause in calling
+        * this, the first call returns features up to a queue's length old.
+        *
+        * @param features Receives the features of the newest queued block, with
+        * AudioFeatures::onset set if any of the blocks had an onset.
+        * @return Whether any audio was analyzed since the last call.
+        */
+        bool takeFeatures(AudioFeatures &features);
+
+    Q_SIGNALS:
+        //! Where to capture audio from has changed.
+        /*!
+        * \sa source
+        * \sa setSource
+        */
+        void sourceChanged() const;
+
+        //! The sample rate of ALSA and FIFO sources has changed.
+        /*!
+        * \sa sampleRate
+        * \sa setSampleRate
+        */
+        void sampleRateChanged() const;
+
+        //! The number of channels of ALSA and FIFO sources has changed.
+        /*!
+        * \sa channels
+        * \sa setChannels
+        */
+        void channelsChanged() const;
+
+        //! Audio capture has started or stopped.
+        /*!
+        * @param running Running or not.
+        * \sa running
+        */
+        void runningChanged(bool running) const;
+
+    private:
+        void capture(AudioSource *source);
+
+        QString m_source;
+        int m_sampleRate;
+        int m_channels;
+
+        std::unique_ptr<AudioSource> m_capture;
+        std::unique_ptr<QThread> m_thread;
+        std::atomic<bool> m_stopping;
+
+        // About a third of a second at 48 kHz.
+        SpscQueue<AudioFeatures, 64> m_features;
+};
@@ -0,0 +1,409 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+// Measures the frame time of every available animation across shelf sizes.
+//
+// Creates the built-in Fire animation and one of each installed animation
+// plugin, and renders frames back to back into a disabled LedStrip. Reports
+// the distribution of frame times, the heap allocations per frame and, where
+// perf_event is available, the cache misses per frame. Results can be written
+// as JSON, to compare before and after a change.
+//
+// Plugins are looked up like in the application; to use those of a build
+// directory, point QT_PLUGIN_PATH at its bin/ directory.
+
+#include "abstractanimation.h"
+#include "animationcatalog.h"
+#include "animations/fireanimation.h"
+#include "ledstrip.h"
+#include "shelfmodel.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDeadlineTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::atomic<quint64> allocations {0};
+
+}
+
+#ifdef __GLIBC__
+// Counts every heap allocation in the process, including those of Qt
+// containers, which bypass operator new.
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+}
+
+const bool countsAllocations {true};
+#else
+const bool countsAllocations {false};
+#endif
+
+namespace {
+
+struct Shape {
+    int rows;
+    int columns;
+};
+
+// From a single Kallax up to a wall-sized build.
+const Shape shapes[] {
+    {4, 5},
+    {10, 10},
+    {25, 40},
+    {50, 100},
+};
+
+const int density {20};
+const int wallThickness {1};
+
+const int frameInterval {16}; // Milliseconds, as at 60 frames per second.
+const int warmupFrames {60};
+
+// Hardware cache misses of this thread, if the kernel lets us count them.
+class CacheMissCounter
+{
+    public:
+        CacheMissCounter()
+            : m_fd {-1}
+        {
+#ifdef __linux__
+            perf_event_attr attributes {};
+            attributes.size = sizeof(attributes);
+            attributes.type = PERF_TYPE_HARDWARE;
+            attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+            attributes.disabled = 1;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+
+            m_fd = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+        }
+
+        ~CacheMissCounter()
+        {
+#ifdef __linux__
+            if (m_fd >= 0) {
+                close(m_fd);
+            }
+#endif
+        }
+
+        bool isValid() const
+        {
+            return m_fd >= 0;
+        }
+
+        void start()
+        {
+#ifdef __linux__
+            if (m_fd >= 0) {
+                ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+        }
+
+        quint64 stop()
+        {
+            quint64 count {0};
+
+#ifdef __linux__
+            if (m_fd >= 0) {
+                ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+
+                if (read(m_fd, &count, sizeof(count)) != sizeof(count)) {
+                    count = 0;
+                }
+            }
+#endif
+
+            return count;
+        }
+
+    private:
+        int m_fd;
+};
+
+struct Result {
+    QString animation;
+    int leds;
+    int squares;
+    int frames;
+    qint64 mean; // Nanoseconds.
+    qint64 p50;
+    qint64 p99;
+    qint64 max;
+    double allocations; // Per frame.
+    double cacheMisses; // Per frame, or negative if not counted.
+};
+
+inline qint64 now()
+{
+    return QDeadlineTimer::current(Qt::PreciseTimer).deadlineNSecs();
+}
+
+bool setProperties(AbstractAnimation *animation, const QString &id, const QStringList &assignments)
+{
+    const QString prefix {id + QLatin1Char(':')};
+
+    for (const QString &assignment : assignments) {
+        if (!assignment.startsWith(prefix)) {
+            continue;
+        }
+
+        const qsizetype separator {assignment.indexOf(QLatin1Char('='))};
+
+        if (separator <= prefix.size()) {
+            QTextStream(stderr) << QStringLiteral("Invalid property assignment, expected "
+                "animation:name=value: %1\n").arg(assignment);
+            return false;
+        }
+
+        const QString name {assignment.mid(prefix.size(), separator - prefix.size())};
+
+        if (!animation->setProperty(name.toUtf8().constData(), assignment.mid(separator + 1))) {
+            QTextStream(stderr) << QStringLiteral("Animation '%1' has no property '%2' that accepts: %3\n")
+                .arg(id, name, assignment.mid(separator + 1));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+
+    const QCommandLineOption animationOption {{QStringLiteral("a"), QStringLiteral("animation")},
+        QStringLiteral("Only measure this animation: 'fire' or a plugin id. Can be given more than once."),
+        QStringLiteral("id")};
+    const QCommandLineOption framesOption {{QStringLiteral("f"), QStringLiteral("frames")},
+        QStringLiteral("The number of frames to measure per animation and shelf size."),
+        QStringLiteral("frames"), QStringLiteral("1000")};
+    const QCommandLineOption propertyOption {{QStringLiteral("p"), QStringLiteral("property")},
+        QStringLiteral("Set a property of an animation, e.g. 'noise:effect=Aurora'. Can be given more than once."),
+        QStringLiteral("animation:name=value")};
+    const QCommandLineOption jsonOption {{QStringLiteral("j"), QStringLiteral("json")},
+        QStringLiteral("Write the results as JSON to this file."),
+        QStringLiteral("file")};
+
+    parser.addOptions({animationOption, framesOption, propertyOption, jsonOption});
+    parser.process(app);
+
+    const int frames {std::max(1, parser.value(framesOption).toInt())};
+
+    QStringList ids {parser.values(animationOption)};
+
+    if (ids.isEmpty()) {
+        ids.append(QStringLiteral("fire"));
+
+        for (const KPluginMetaData &plugin : AnimationCatalog::self()->plugins()) {
+            ids.append(plugin.pluginId());
+        }
+    }
+
+    QTextStream out(stdout);
+
+    out << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8\n")
+        .arg(QStringLiteral("animation"), -12)
+        .arg(QStringLiteral("leds"), 8)
+        .arg(QStringLiteral("mean"), 10)
+        .arg(QStringLiteral("p50"), 10)
+        .arg(QStringLiteral("p99"), 10)
+        .arg(QStringLiteral("max"), 10)
+        .arg(QStringLiteral("allocs"), 8)
+        .arg(QStringLiteral("misses"), 10);
+    out.flush();
+
+    CacheMissCounter cacheMisses;
+    QVector<qint64> times(frames);
+    QVector<Result> results;
+
+    for (const QString &id : std::as_const(ids)) {
+        std::unique_ptr<AbstractAnimation> animation {id == QLatin1String("fire")
+            ? new FireAnimation : AnimationCatalog::self()->create(id)};
+
+        if (!animation) {
+            QTextStream(stderr) << QStringLiteral("Unknown animation: %1\n").arg(id);
+            continue;
+        }
+
+        if (!setProperties(animation.get(), id, parser.values(propertyOption))) {
+            return 1;
+        }
+
+        for (const Shape &shape : shapes) {
+            // Derives the strip length and compartments the same way as the shelf.
+            ShelfModel shelfModel;
+            shelfModel.setRemotingEnabled(false);
+            shelfModel.setDensity(density);
+            shelfModel.setWallThickness(wallThickness);
+            shelfModel.setColumns(shape.columns);
+            shelfModel.setRows(shape.rows);
+
+            const int count {shelfModel.ledCount()};
+
+            // A disabled strip never opens the SPI device, so no hardware is
+            // needed to run this.
+            LedStrip ledStrip(count);
+            ledStrip.setEnabled(false);
+
+            animation->setLedStrip(&ledStrip);
+            animation->setSquares(shelfModel.squareRanges());
+
+            // Some animations prepare in the background, e.g. loading images.
+            const QDeadlineTimer loadingDeadline {10000};
+
+            while (animation->property("loading").toBool() && !loadingDeadline.hasExpired()) {
+                QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 100);
+            }
+
+            for (int i {0}; i < warmupFrames; ++i) {
+                animation->renderOffline(frameInterval, i == 0 /* restart */);
+            }
+
+            const quint64 allocationsBefore {allocations.load(std::memory_order_relaxed)};
+            cacheMisses.start();
+
+            for (int i {0}; i < frames; ++i) {
+                const qint64 start {now()};
+                animation->renderOffline(frameInterval);
+                times[i] = now() - start;
+            }
+
+            const quint64 misses {cacheMisses.stop()};
+            const quint64 allocated {allocations.load(std::memory_order_relaxed) - allocationsBefore};
+
+            animation->setLedStrip(nullptr);
+
+            qint64 sum {0};
+
+            for (const qint64 time : std::as_const(times)) {
+                sum += time;
+            }
+
+            std::sort(times.begin(), times.end());
+
+            Result result;
+            result.animation = id;
+            result.leds = count;
+            result.squares = static_cast<int>(shelfModel.squareRanges().size());
+            result.frames = frames;
+            result.mean = sum / frames;
+            result.p50 = times.at(frames / 2);
+            result.p99 = times.at(std::min(frames - 1, frames * 99 / 100));
+            result.max = times.constLast();
+            result.allocations = countsAllocations ? static_cast<double>(allocated) / frames : -1.0;
+            result.cacheMisses = cacheMisses.isValid() ? static_cast<double>(misses) / frames : -1.0;
+            results.append(result);
+
+            const auto perFrame = [](double value) {
+                return value < 0.0 ? QStringLiteral("-") : QString::number(value, 'f', 1);
+            };
+
+            out << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8\n")
+                .arg(id, -12)
+                .arg(count, 8)
+                .arg(result.mean, 10)
+                .arg(result.p50, 10)
+                .arg(result.p99, 10)
+                .arg(result.max, 10)
+                .arg(perFrame(result.allocations), 8)
+                .arg(perFrame(result.cacheMisses), 10);
+            out.flush();
+        }
+    }
+
+    out << QStringLiteral("\nAll times are in nanoseconds per frame; allocations and cache misses "
+        "are per frame.\n");
+
+    if (parser.isSet(jsonOption)) {
+        QJsonArray array;
+
+        for (const Result &result : std::as_const(results)) {
+            QJsonObject object {
+                {QStringLiteral("animation"), result.animation},
+                {QStringLiteral("leds"), result.leds},
+                {QStringLiteral("squares"), result.squares},
+                {QStringLiteral("frames"), result.frames},
+                {QStringLiteral("meanNs"), result.mean},
+                {QStringLiteral("p50Ns"), result.p50},
+                {QStringLiteral("p99Ns"), result.p99},
+                {QStringLiteral("maxNs"), result.max},
+            };
+
+            // Left out where they could not be counted.
+            if (result.allocations >= 0.0) {
+                object.insert(QStringLiteral("allocationsPerFrame"), result.allocations);
+            }
+
+            if (result.cacheMisses >= 0.0) {
+                object.insert(QStringLiteral("cacheMissesPerFrame"), result.cacheMisses);
+            }
+
+            array.append(object);
+        }
+
+        QFile file(parser.value(jsonOption));
+
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            || file.write(QJsonDocument(QJsonObject {
+                    {QStringLiteral("frameInterval"), frameInterval},
+                    {QStringLiteral("results"), array}
+                }).toJson()) < 0) {
+            QTextStream(stderr) << QStringLiteral("Failed to write %1: %2\n").arg(file.fileName(), file.errorString());
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,156 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+// Measures how long audio takes from being captured to reaching the LED strip
+// in the Audio animation, end to end through the audio thread, the render
+// thread and the GUI thread.
+//
+// Plays the WAV file given as the first argument, or a generated one with a
+// bass drum hit every half second, in real time for the number of seconds
+// given as the second argument.
+
+#include "animations/audioanimation.h"
+#include "ledstrip.h"
+#include "shelfmodel.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QTemporaryFile>
+#include <QTextStream>
+#include <QTimer>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int sampleRate {48000};
+const int defaultDuration {10}; // Seconds.
+
+// Writes two seconds of mono 16-bit PCM.
+bool writeBeats(QIODevice *device)
+{
+    const int frames {sampleRate * 2};
+
+    QDataStream stream(device);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    stream.writeRawData("RIFF", 4);
+    stream << quint32(36 + frames * 2);
+    stream.writeRawData("WAVEfmt ", 8);
+    stream << quint32(16) << quint16(1) << quint16(1) << quint32(sampleRate)
+        << quint32(sampleRate * 2) << quint16(2) << quint16(16);
+    stream.writeRawData("data", 4);
+    stream << quint32(frames * 2);
+
+    for (int i {0}; i < frames; ++i) {
+        const double t {static_cast<double>(i % (sampleRate / 2)) / sampleRate};
+
+        // A decaying 60 Hz hit over a quiet hiss.
+        const double hit {std::sin(2.0 * M_PI * 60.0 * t) * std::exp(-t * 20.0)};
+        const double hiss {((i * 7919) % 200 - 100) / 10000.0};
+
+        stream << qint16(std::lround((hit * 0.8 + hiss) * 32767.0));
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QTextStream out(stdout);
+
+    const QStringList arguments {app.arguments()};
+    QString fileName {arguments.value(1)};
+    const int duration {arguments.size() > 2 ? arguments.at(2).toInt() : defaultDuration};
+
+    QTemporaryFile beats(QStringLiteral("XXXXXX.wav"));
+
+    if (fileName.isEmpty()) {
+        if (!beats.open() || !writeBeats(&beats)) {
+            out << QStringLiteral("Failed to write a WAV file.\n");
+            return 1;
+        }
+
+        beats.close();
+        fileName = beats.fileName();
+    }
+
+    // A disabled strip never opens the SPI device, so no hardware is
+    // needed to run this.
+    LedStrip ledStrip;
+    ledStrip.setEnabled(false);
+
+    ShelfModel model;
+    model.setRemotingEnabled(false);
+    model.setAnimateBrightnessTransitions(false);
+    model.setAnimateAverageColorTransitions(false);
+    model.setDensity(20);
+    model.setWallThickness(1);
+    model.setColumns(5);
+    model.setRows(4);
+    model.setLedStrip(&ledStrip);
+    model.setThreadedRendering(true);
+    model.setEnabled(true);
+
+    AudioAnimation animation;
+    animation.setSource(fileName);
+
+    QVector<int> latencies;
+    QObject::connect(&animation, &AudioAnimation::latencyMeasured, &app,
+        [&](int microseconds) { latencies.append(microseconds); });
+
+    model.setAnimation(&animation);
+    model.setAnimating(true);
+
+    QTimer::singleShot(duration * 1000, &app, &QCoreApplication::quit);
+    app.exec();
+
+    model.setAnimating(false);
+
+    if (latencies.isEmpty()) {
+        out << QStringLiteral("No frames showed audio from %1.\n").arg(fileName);
+        return 1;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+
+    const auto percentile = [&](int percent) {
+        return latencies.at(std::min<qsizetype>(latencies.size() - 1, latencies.size() * percent / 100));
+    };
+
+    qint64 sum {0};
+
+    for (const int latency : std::as_const(latencies)) {
+        sum += latency;
+    }
+
+    out << QStringLiteral("%1 %2 %3 %4 %5 %6\n")
+        .arg(QStringLiteral("frames"), 8)
+        .arg(QStringLiteral("mean"), 10)
+        .arg(QStringLiteral("p50"), 10)
+        .arg(QStringLiteral("p95"), 10)
+        .arg(QStringLiteral("p99"), 10)
+        .arg(QStringLiteral("max"), 10);
+
+    out << QStringLiteral("%1 %2 %3 %4 %5 %6\n")
+        .arg(latencies.size(), 8)
+        .arg(sum / latencies.size(), 10)
+        .arg(percentile(50), 10)
+        .arg(percentile(95), 10)
+        .arg(percentile(99), 10)
+        .arg(latencies.constLast(), 10);
+
+    out << QStringLiteral("\nAll times are in microseconds from capturing a block of audio to writing "
+        "out the frame showing it. Filling a block takes another %1 µs at %2 Hz, and the "
+        "disabled strip skips the SPI transfer.\n")
+        .arg(AudioAnalyzer::HopSize * 1000000 / sampleRate).arg(sampleRate);
+
+    return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+// Measures the cost of evaluating an Expression for all LEDs of a frame
+// across strip lengths.
+//
+// Compares the bytecode against the same formula written in C++ and built
+// with the application, which is as fast as the formula can run.
+
+#include "animations/expression.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+namespace {
+
+// From a single Kallax up to a wall-sized build.
+const int counts[] {416, 1000, 2500, 10000};
+
+struct Formula {
+    QString source;
+    int components;
+    std::function<void(const float *, const float *, float, int, float *const *)> native;
+};
+
+const Formula formulas[] {
+    {
+        QStringLiteral("0.5 + 0.5 * sin(x - t), 0.2 + 0.2 * sin(y * 2 + t * 0.7), "
+            "0.5 + 0.5 * cos(x + y - t * 1.3)"),
+        3,
+        [](const float *x, const float *y, float t, int count, float *const *out) {
+            for (int i {0}; i < count; ++i) {
+                out[0][i] = 0.5f + 0.5f * std::sin(x[i] - t);
+                out[1][i] = 0.2f + 0.2f * std::sin(y[i] * 2.0f + t * 0.7f);
+                out[2][i] = 0.5f + 0.5f * std::cos(x[i] + y[i] - t * 1.3f);
+            }
+        }
+    },
+    {
+        QStringLiteral("smoothstep(0.5, 0, abs(fract(x * 0.25 - t * 0.2) - 0.5)) * (0.5 + 0.5 * sin(y * 3 + t))"),
+        1,
+        [](const float *x, const float *y, float t, int count, float *const *out) {
+            for (int i {0}; i < count; ++i) {
+                const float p {x[i] * 0.25f - t * 0.2f};
+                const float d {std::abs(p - std::floor(p) - 0.5f)};
+                const float s {std::min(std::max((d - 0.5f) / (0.0f - 0.5f), 0.0f), 1.0f)};
+                out[0][i] = s * s * (3.0f - 2.0f * s) * (0.5f + 0.5f * std::sin(y[i] * 3.0f + t));
+            }
+        }
+    }
+};
+
+// Returns the average time per iteration in nanoseconds.
+qreal measure(int iterations, const std::function<void()> &func)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i {0}; i < iterations; ++i) {
+        func();
+    }
+
+    return static_cast<qreal>(timer.nsecsElapsed()) / iterations;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QTextStream out(stdout);
+
+    for (const Formula &formula : formulas) {
+        Expression expression;
+
+        const qreal compile {measure(1000, [&]() {
+            expression.compile(formula.source);
+        })};
+
+        out << formula.source << QStringLiteral("\n");
+        out << QStringLiteral("%1 instructions, compiled in %2 ns\n\n")
+            .arg(expression.instructionCount())
+            .arg(compile, 0, 'f', 0);
+
+        out << QStringLiteral("%1 %2 %3 %4\n")
+            .arg(QStringLiteral("leds"), 8)
+            .arg(QStringLiteral("native"), 14)
+            .arg(QStringLiteral("expression"), 14)
+            .arg(QStringLiteral("ratio"), 10);
+
+        for (const int count : counts) {
+            // Rows of five compartments of twenty LEDs, as on the shelf.
+            std::vector<float> x(count);
+            std::vector<float> y(count);
+            std::vector<float> squares(count);
+
+            for (int i {0}; i < count; ++i) {
+                x[i] = (i % 100) / 20.0f;
+                y[i] = i / 100 + 0.5f;
+                squares[i] = i / 20;
+            }
+
+            std::vector<float> values[3] {std::vector<float>(count), std::vector<float>(count),
+                std::vector<float>(count)};
+            float *const outputs[3] {values[0].data(), values[1].data(), values[2].data()};
+
+            const int iterations {std::max(20, 2000000 / count)};
+            float time {0.0f};
+
+            const qreal native {measure(iterations, [&]() {
+                time += 0.016f;
+                formula.native(x.data(), y.data(), time, count, outputs);
+            })};
+
+            Expression::Inputs inputs;
+            inputs.x = x.data();
+            inputs.y = y.data();
+            inputs.squares = squares.data();
+            inputs.count = count;
+
+            const qreal current {measure(iterations, [&]() {
+                inputs.time += 0.016f;
+                expression.evaluate(inputs, outputs);
+            })};
+
+            out << QStringLiteral("%1 %2 %3 %4\n")
+                .arg(count, 8)
+                .arg(native, 14, 'f', 0)
+                .arg(current, 14, 'f', 0)
+                .arg(current / native, 10, 'f', 2);
+            out.flush();
+        }
+
+        out << QStringLiteral("\n");
+    }
+
+    out << QStringLiteral("All times are in nanoseconds per frame.\n");
+
+    return 0;
+}
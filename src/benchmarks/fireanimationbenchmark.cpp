@@ -0,0 +1,111 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+// Measures the cost of painting a FireAnimation frame across strip lengths.
+//
+// Compares the current implementation against the previous one, which drew
+// a value from std::mt19937 per LED and painted it with LedStrip::setColor.
+
+#include "animations/fireanimation.h"
+#include "ledstrip.h"
+
+#include <QColor>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include <algorithm>
+#include <functional>
+#include <random>
+
+namespace {
+
+// From a single Kallax up to a wall-sized build.
+const int counts[] {416, 1000, 2500, 10000, 50000};
+
+// Exposes the frame function to the benchmark.
+class BenchmarkFireAnimation : public FireAnimation
+{
+    public:
+        using FireAnimation::renderFrame;
+};
+
+// Returns the average time per iteration in nanoseconds.
+qreal measure(int iterations, const std::function<void()> &func)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i {0}; i < iterations; ++i) {
+        func();
+    }
+
+    return static_cast<qreal>(timer.nsecsElapsed()) / iterations;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QTextStream out(stdout);
+
+    out << QStringLiteral("%1 %2 %3 %4\n")
+        .arg(QStringLiteral("leds"), 8)
+        .arg(QStringLiteral("previous"), 14)
+        .arg(QStringLiteral("current"), 14)
+        .arg(QStringLiteral("speedup"), 10);
+
+    for (const int count : counts) {
+        // A disabled strip never opens the SPI device, so no hardware is
+        // needed to run this.
+        LedStrip ledStrip(count);
+        ledStrip.setEnabled(false);
+
+        const int iterations {std::max(20, 2000000 / count)};
+
+        const QColor baseColor {255, 96, 12};
+        std::mt19937 e {std::random_device {}()};
+        std::uniform_int_distribution<int> distColor {0, 100};
+
+        const qreal previous {measure(iterations, [&]() {
+            for (int i {0}; i < count; ++i) {
+                const int flicker {distColor(e)};
+
+                ledStrip.setColor(i, {
+                        std::max(0, baseColor.red() - flicker),
+                        std::max(0, baseColor.green() - flicker),
+                        std::max(0, baseColor.blue() - flicker)
+                    }
+                );
+            }
+        })};
+
+        BenchmarkFireAnimation animation;
+        animation.setLedStrip(&ledStrip);
+
+        // Longer than the flicker interval, so every call paints a frame.
+        AbstractAnimation::Frame frame;
+        frame.delta = 1000;
+
+        const qreal current {measure(iterations, [&]() {
+            frame.time += frame.delta;
+            ++frame.index;
+            animation.renderFrame(frame);
+        })};
+
+        out << QStringLiteral("%1 %2 %3 %4\n")
+            .arg(count, 8)
+            .arg(previous, 14, 'f', 0)
+            .arg(current, 14, 'f', 0)
+            .arg(previous / current, 10, 'f', 2);
+        out.flush();
+    }
+
+    out << QStringLiteral("\nAll times are in nanoseconds per frame.\n");
+
+    return 0;
+}
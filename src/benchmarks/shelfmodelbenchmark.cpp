@@ -0,0 +1,150 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+// Measures the cost of the hot ShelfModel operations across shelf sizes.
+//
+// Per-square operations (reads and writes) should stay flat as the shelf
+// grows, while whole-shelf operations should grow linearly with the number
+// of LEDs.
+
+#include "ledstrip.h"
+#include "shelfmodel.h"
+
+#include <QColor>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include <functional>
+
+namespace {
+
+struct Shape {
+    int rows;
+    int columns;
+};
+
+// From a single Kallax up to a wall-sized build.
+const Shape shapes[] {
+    {4, 5},
+    {10, 10},
+    {20, 25},
+    {25, 40},
+    {50, 50},
+    {50, 100},
+    {100, 100},
+};
+
+const int density {20};
+const int wallThickness {1};
+
+// Returns the average time per iteration in microseconds.
+qreal measure(int iterations, const std::function<void(int)> &func)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i {0}; i < iterations; ++i) {
+        func(i);
+    }
+
+    return (timer.nsecsElapsed() / 1000.0) / iterations;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QTextStream out(stdout);
+
+    out << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+        .arg(QStringLiteral("squares"), 8)
+        .arg(QStringLiteral("leds"), 8)
+        .arg(QStringLiteral("geometry"), 12)
+        .arg(QStringLiteral("read"), 12)
+        .arg(QStringLiteral("write"), 12)
+        .arg(QStringLiteral("average"), 12)
+        .arg(QStringLiteral("fill"), 12)
+        .arg(QStringLiteral("brightness"), 12)
+        .arg(QStringLiteral("frame"), 12);
+
+    const QColor colors[] {QColor(Qt::red), QColor(Qt::blue)};
+
+    for (const Shape &shape : shapes) {
+        // A disabled strip never opens the SPI device, so no hardware is
+        // needed to run this.
+        LedStrip ledStrip;
+        ledStrip.setEnabled(false);
+
+        ShelfModel model;
+        model.setRemotingEnabled(false);
+        model.setAnimateBrightnessTransitions(false);
+        model.setAnimateAverageColorTransitions(false);
+        model.setDensity(density);
+        model.setWallThickness(wallThickness);
+        model.setLedStrip(&ledStrip);
+        model.setEnabled(true);
+
+        const qreal geometry {measure(1, [&](int) {
+            model.setColumns(shape.columns);
+            model.setRows(shape.rows);
+        })};
+
+        const int squares {model.rowCount()};
+
+        // Per-square reads, as done by views after a change.
+        const qreal read {measure(squares, [&](int i) {
+            model.data(model.index(i, 0), ShelfModel::AverageColor);
+        })};
+
+        // Per-square writes, as done when painting on the shelf.
+        const qreal write {measure(squares, [&](int i) {
+            model.setData(model.index(i, 0), colors[i % 2], Qt::EditRole);
+        })};
+
+        const qreal average {measure(1000, [&](int) {
+            model.averageColor();
+        })};
+
+        // Whole-shelf operations.
+        const qreal fill {measure(20, [&](int i) {
+            model.setAverageColor(colors[i % 2]);
+        })};
+
+        const qreal brightness {measure(20, [&](int i) {
+            model.setBrightness(i % 2 ? 1.0 : 0.5);
+        })};
+
+        // An animation frame: the strip is rewritten behind the model's back,
+        // followed by views re-reading every square.
+        const qreal frame {measure(20, [&](int i) {
+            ledStrip.fill(0, ledStrip.count() - 1, colors[i % 2]);
+
+            for (int square {0}; square < squares; ++square) {
+                model.data(model.index(square, 0), ShelfModel::AverageColor);
+            }
+
+            model.averageColor();
+        })};
+
+        out << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+            .arg(squares, 8)
+            .arg(ledStrip.count(), 8)
+            .arg(geometry, 12, 'f', 2)
+            .arg(read, 12, 'f', 2)
+            .arg(write, 12, 'f', 2)
+            .arg(average, 12, 'f', 2)
+            .arg(fill, 12, 'f', 2)
+            .arg(brightness, 12, 'f', 2)
+            .arg(frame, 12, 'f', 2);
+        out.flush();
+    }
+
+    out << QStringLiteral("\nAll times are in microseconds per operation.\n");
+
+    return 0;
+}
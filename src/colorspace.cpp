@@ -0,0 +1,114 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "colorspace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+// Steps for encoding linear light; fine enough that neighboring entries
+// never differ by more than one sRGB step.
+const int encodeSteps {4095};
+
+struct Tables {
+    Tables()
+    {
+        for (int i {0}; i < 256; ++i) {
+            const double value {i / 255.0};
+
+            decode[i] = value <= 0.04045 ? value / 12.92
+                : std::pow((value + 0.055) / 1.055, 2.4);
+        }
+
+        for (int i {0}; i <= encodeSteps; ++i) {
+            const double value {static_cast<double>(i) / encodeSteps};
+            const double encoded {value <= 0.0031308 ? value * 12.92
+                : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055};
+
+            encode[i] = static_cast<uint8_t>(std::lround(encoded * 255.0));
+        }
+    }
+
+    float decode[256]; // sRGB to linear light.
+    uint8_t encode[encodeSteps + 1]; // Linear light to sRGB.
+};
+
+const Tables &tables()
+{
+    static const Tables tables;
+    return tables;
+}
+
+inline int encode(const Tables &tables, float value)
+{
+    return tables.encode[std::lround(std::clamp(value, 0.0f, 1.0f) * encodeSteps)];
+}
+
+inline float lerp(float from, float to, float progress)
+{
+    // Exact at both ends, unlike `from + (to - from) * progress`.
+    return from * (1.0f - progress) + to * progress;
+}
+
+}
+
+ColorSpace::Oklab ColorSpace::toOklab(QRgb color)
+{
+    const Tables &t {tables()};
+
+    const float r {t.decode[qRed(color)]};
+    const float g {t.decode[qGreen(color)]};
+    const float b {t.decode[qBlue(color)]};
+
+    const float l {std::cbrt(0.4122214708f * r + 0.5363325363f * g + 0.0514459929f * b)};
+    const float m {std::cbrt(0.2119034982f * r + 0.6806995451f * g + 0.1073969566f * b)};
+    const float s {std::cbrt(0.0883024619f * r + 0.2817188376f * g + 0.6299787005f * b)};
+
+    return Oklab {
+        0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s,
+        1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s,
+        0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s
+    };
+}
+
+QRgb ColorSpace::fromOklab(const Oklab &color)
+{
+    const float l_ {color.L + 0.3963377774f * color.a + 0.2158037573f * color.b};
+    const float m_ {color.L - 0.1055613458f * color.a - 0.0638541728f * color.b};
+    const float s_ {color.L - 0.0894841775f * color.a - 1.2914855480f * color.b};
+
+    const float l {l_ * l_ * l_};
+    const float m {m_ * m_ * m_};
+    const float s {s_ * s_ * s_};
+
+    const Tables &t {tables()};
+
+    return qRgb(encode(t, 4.0767416621f * l - 3.3077115913f * m + 0.2309699292f * s),
+        encode(t, -1.2684380046f * l + 2.6097574011f * m - 0.3413193965f * s),
+        encode(t, -0.0041960863f * l - 0.7034186147f * m + 1.7076147010f * s));
+}
+
+ColorSpace::Oklab ColorSpace::mix(const Oklab &from, const Oklab &to, qreal progress)
+{
+    const float p {static_cast<float>(progress)};
+
+    return Oklab {lerp(from.L, to.L, p), lerp(from.a, to.a, p), lerp(from.b, to.b, p)};
+}
+
+qreal ColorSpace::toLightness(qreal brightness)
+{
+    // OKLab lightness is the cube root of luminance for grays.
+    return std::cbrt(std::clamp(brightness, 0.0, 1.0));
+}
+
+qreal ColorSpace::fromLightness(qreal lightness)
+{
+    const qreal clamped {std::clamp(lightness, 0.0, 1.0)};
+
+    return clamped * clamped * clamped;
+}
@@ -0,0 +1,79 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include <QColor>
+
+//! Conversions for interpolating colors and brightness perceptually
+/*!
+ * \ingroup Backend
+ *
+ * Colors are interpolated in the OKLab color space, in which equal steps look
+ * like equal changes. Unlike interpolating sRGB values, this keeps e.g. a
+ * transition from red to green from passing through a muddy brown.
+ *
+ * The conversions between sRGB and linear light use precomputed tables, so
+ * the only costly step left is the cube root when converting to OKLab, which
+ * is done once per transition rather than once per frame. Converting back
+ * from an interpolated color is a few multiplications and a table lookup.
+ *
+ * \sa EasingTable
+ */
+class ColorSpace
+{
+    public:
+        //! A color in the OKLab color space.
+        struct Oklab {
+            float L {0.0f}; //!< Lightness, \c 0.0 to \c 1.0.
+            float a {0.0f}; //!< Green-red axis.
+            float b {0.0f}; //!< Blue-yellow axis.
+        };
+
+        //! Convert an sRGB color to OKLab.
+        /*!
+        * @param color An sRGB color, the alpha channel is ignored.
+        * @return The color in OKLab.
+        */
+        static Oklab toOklab(QRgb color);
+
+        //! Convert an OKLab color to sRGB.
+        /*!
+        * Colors outside the sRGB gamut are clipped.
+        *
+        * @param color A color in OKLab.
+        * @return An opaque sRGB color.
+        */
+        static QRgb fromOklab(const Oklab &color);
+
+        //! Interpolate between two OKLab colors.
+        /*!
+        * @param from The color at \p progress \c 0.0.
+        * @param to The color at \p progress \c 1.0, returned exactly.
+        * @param progress Progress from \c 0.0 to \c 1.0.
+        * @return The interpolated color.
+        */
+        static Oklab mix(const Oklab &from, const Oklab &to, qreal progress);
+
+        //! Perceived lightness of a brightness level.
+        /*!
+        * Interpolating lightness rather than brightness makes fades appear to
+        * progress evenly, instead of most of the visible change happening
+        * near black.
+        *
+        * @param brightness A brightness level from \c 0.0 to \c 1.0.
+        * @return The OKLab lightness of gray at that level.
+        * \sa fromLightness
+        */
+        static qreal toLightness(qreal brightness);
+
+        //! Brightness level of a perceived lightness.
+        /*!
+        * @param lightness A lightness from \c 0.0 to \c 1.0.
+        * @return The brightness level, \c 0.0 and \c 1.0 exactly at the ends.
+        * \sa toLightness
+        */
+        static qreal fromLightness(qreal lightness);
+};
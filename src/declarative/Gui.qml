@@ -464,6 +464,39 @@ Window {
                         }
                     }
 
+                    BasicButton {
+                        id: scenesButton
+
+                        width: colorButton.width
+                        height: width
+
+                        visible: Qt.isQtObject(model) && model.scenes.length > 0
+
+                        source: "qrc:///assets/icons/scenes.svg"
+
+                        checkable: true
+
+                        onClicked: {
+                            if (displayController) {
+                                displayController.resetIdleTimeout();
+                            }
+                        }
+
+                        onCheckedChanged: {
+                            if (checked) {
+                                scenesPopup.open();
+                            }
+                        }
+
+                        Connections {
+                            target: scenesPopup
+
+                            function onClosed() {
+                                scenesButton.checked = false;
+                            }
+                        }
+                    }
+
                     states: [
                         State {
                             name: "landscape"
@@ -546,6 +579,22 @@ Window {
         }
     }
 
+    ScenesPopup {
+        id: scenesPopup
+
+        width: parent.width
+
+        scenes: Qt.isQtObject(model) ? model.scenes : []
+
+        onPicked: function (name) {
+            if (displayController) {
+                displayController.resetIdleTimeout();
+            }
+
+            model.recallScene(name, true);
+        }
+    }
+
     Loader {
         id: curtainLoader
 
@@ -0,0 +1,115 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+import QtQuick
+import QtQuick.Controls
+import QtQuick.Effects
+
+//! Popup UI item listing the stored scenes to recall one
+/*!
+ * \ingroup GUI
+ *
+ */
+Popup {
+    id: popup
+
+    //! Names of the scenes to offer.
+    /*!
+    * \sa picked
+    */
+    property var scenes: []
+
+    //! The user picked a scene, closing the popup.
+    /*!
+    * @param name Name of the scene.
+    * \sa scenes
+    */
+    signal picked(string name)
+
+    leftPadding: Theme.proportion(gui, 0.029) + Onboard.leftMargin
+    rightPadding: Theme.proportion(gui, 0.029) + Onboard.rightMargin
+
+    topPadding: Theme.proportion(gui, 0.029) + Onboard.topMargin
+    bottomPadding: Theme.proportion(gui, 0.029) + Onboard.bottomMargin
+
+    modal: true
+
+    onOpenedChanged: {
+        if (opened) {
+            autoCloseTimer.restart();
+        }
+    }
+
+    background: Item {
+        Rectangle {
+            id: bgRect
+
+            anchors.fill: parent
+
+            color: Theme.windowBackgroundColor
+        }
+
+        MultiEffect {
+            anchors.fill: parent
+
+            opacity: 0.6
+
+            shadowEnabled: true
+            shadowHorizontalOffset: 0.0
+            shadowVerticalOffset: 1
+            shadowBlur: 0.5
+            blurMax: 64
+
+            source: bgRect
+        }
+    }
+
+    contentItem: Flow {
+        spacing: Theme.proportion(gui, 0.029)
+
+        Repeater {
+            model: popup.scenes
+
+            delegate: AbstractButton {
+                id: sceneButton
+
+                width: sceneText.width + (2 * Theme.proportion(gui, 0.029))
+                height: Theme.proportion(gui, 0.129)
+
+                background: Rectangle {
+                    radius: height * 0.14
+
+                    color: sceneButton.pressed ? Theme.activeButtonColor : Theme.inactiveButtonColor
+                }
+
+                Text {
+                    id: sceneText
+
+                    anchors.centerIn: parent
+
+                    text: modelData
+                    color: sceneButton.pressed ? Theme.windowBackgroundColor : Theme.windowForegroundColor
+                    font.pixelSize: Theme.proportion(gui, 0.042)
+                    font.family: Theme.fontFamily
+                    font.weight: Font.DemiBold
+                }
+
+                onClicked: {
+                    popup.picked(modelData);
+                    popup.close();
+                }
+            }
+        }
+    }
+
+    Timer {
+        id: autoCloseTimer
+
+        interval: 6000
+        repeat: false
+
+        onTriggered: popup.close()
+    }
+}
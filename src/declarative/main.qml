@@ -48,11 +48,48 @@ NonVisualItem {
             animateBrightnessTransitions: Settings.animateBrightnessTransitions
             animateAverageColorTransitions: Settings.animateAverageColorTransitions
             transitionDuration: Settings.transitionDuration
+            frameRate: Settings.frameRate
+            threadedRendering: Settings.threadedRendering
+            adaptiveFrameRate: Settings.adaptiveFrameRate
 
-            animation: FireAnimation {}
+            readonly property FireAnimation fireAnimation: FireAnimation {}
+
+            // Only maps the clip file while selected.
+            readonly property ClipAnimation clipAnimation: ClipAnimation {
+                source: Settings.animation === "Clip" ? Settings.clipSource : ""
+            }
+
+            // Other animations are plugins, loaded only while selected.
+            readonly property AnimationLoader pluginAnimation: AnimationLoader {
+                plugin: Settings.animation !== "Fire" && Settings.animation !== "Clip"
+                    ? Settings.animation.toLowerCase() : ""
+                properties: {
+                    switch (Settings.animation) {
+                        case "Noise": return {
+                            "effect": Settings.noiseEffect,
+                            "speed": Settings.noiseSpeed,
+                            "scale": Settings.noiseScale
+                        };
+                        case "Expression": return {"expression": Settings.expression};
+                        case "Audio": return {
+                            "source": Settings.audioSource,
+                            "sampleRate": Settings.audioSampleRate,
+                            "channels": Settings.audioChannels
+                        };
+                        case "Image": return {"source": Settings.imageSource};
+                        default: return {};
+                    }
+                }
+            }
+
+            animation: Settings.animation === "Clip" ? clipAnimation
+                : pluginAnimation.animation ?? fireAnimation
 
             remotingEnabled: Startup.remotingApi
             listenAddress: Startup.remotingListenAddress
+
+            stateFileName: Startup.stateFileName
+            sceneFileName: Startup.sceneFileName
         }
     }
 
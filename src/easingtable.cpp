@@ -0,0 +1,45 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "easingtable.h"
+
+#include <vector>
+
+EasingTable::EasingTable(QEasingCurve::Type type)
+    : m_type {type}
+{
+    const QEasingCurve curve {type};
+
+    for (int i {0}; i <= Size; ++i) {
+        m_values[i] = curve.valueForProgress(static_cast<qreal>(i) / Size);
+    }
+}
+
+const EasingTable *EasingTable::forType(QEasingCurve::Type type)
+{
+    // Built once for every type, which also makes it safe to use from any
+    // thread.
+    static const std::vector<EasingTable> tables {[]() {
+        std::vector<EasingTable> tables;
+        tables.reserve(QEasingCurve::BezierSpline);
+
+        for (int i {0}; i < QEasingCurve::BezierSpline; ++i) {
+            tables.push_back(EasingTable(static_cast<QEasingCurve::Type>(i)));
+        }
+
+        return tables;
+    }()};
+
+    if (type < 0 || type >= QEasingCurve::BezierSpline) {
+        type = QEasingCurve::Linear;
+    }
+
+    return &tables[type];
+}
+
+QEasingCurve::Type EasingTable::type() const
+{
+    return m_type;
+}
@@ -0,0 +1,60 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include <QEasingCurve>
+
+#include <algorithm>
+
+//! A precomputed easing curve
+/*!
+ * \ingroup Backend
+ *
+ * Samples a \c QEasingCurve once and interpolates between the samples, so
+ * evaluating the curve on every frame costs a lookup instead of the curve's
+ * formula. The error is far below what a color or brightness level can show.
+ *
+ * Tables are shared and built for all curve types at once on first use; see
+ * \ref forType.
+ *
+ * \sa ColorSpace
+ */
+class EasingTable
+{
+    public:
+        //! The shared table for an easing curve type.
+        /*!
+        * @param type A curve type up to, but excluding, \c QEasingCurve::BezierSpline.
+        *     Other types fall back to \c QEasingCurve::Linear.
+        * @return A table that lives for the lifetime of the application.
+        */
+        static const EasingTable *forType(QEasingCurve::Type type);
+
+        //! The curve type the table was sampled from.
+        QEasingCurve::Type type() const;
+
+        //! Evaluate the curve.
+        /*!
+        * @param progress Progress from \c 0.0 to \c 1.0, clamped.
+        * @return The eased progress, exactly the curve's value at the ends.
+        */
+        inline qreal valueForProgress(qreal progress) const
+        {
+            const qreal position {std::clamp(progress, 0.0, 1.0) * Size};
+            const int i {std::min(static_cast<int>(position), Size - 1)};
+            const qreal fraction {position - i};
+
+            return m_values[i] * (1.0 - fraction) + m_values[i + 1] * fraction;
+        }
+
+    private:
+        static const int Size {256};
+
+        EasingTable(QEasingCurve::Type type = QEasingCurve::Linear);
+
+        QEasingCurve::Type m_type;
+        float m_values[Size + 1];
+};
@@ -0,0 +1,117 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "fft.h"
+
+#include <cmath>
+
+Fft::Fft(int size)
+    : m_size {size}
+{
+    Q_ASSERT(size >= 4 && !(size & (size - 1)));
+
+    const int half {size / 2};
+
+    m_bitReverse.resize(half);
+
+    int bits {0};
+
+    while ((1 << bits) < half) {
+        ++bits;
+    }
+
+    for (int i {0}; i < half; ++i) {
+        int reversed {0};
+
+        for (int bit {0}; bit < bits; ++bit) {
+            reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+        }
+
+        m_bitReverse[i] = reversed;
+    }
+
+    m_twiddleReal.resize(half / 2);
+    m_twiddleImaginary.resize(half / 2);
+
+    for (int k {0}; k < half / 2; ++k) {
+        const double angle {-2.0 * M_PI * k / half};
+        m_twiddleReal[k] = static_cast<float>(std::cos(angle));
+        m_twiddleImaginary[k] = static_cast<float>(std::sin(angle));
+    }
+
+    m_splitReal.resize(half + 1);
+    m_splitImaginary.resize(half + 1);
+
+    for (int k {0}; k <= half; ++k) {
+        const double angle {-2.0 * M_PI * k / size};
+        m_splitReal[k] = static_cast<float>(std::cos(angle));
+        m_splitImaginary[k] = static_cast<float>(std::sin(angle));
+    }
+
+    m_real.resize(half);
+    m_imaginary.resize(half);
+}
+
+int Fft::size() const
+{
+    return m_size;
+}
+
+void Fft::powerSpectrum(const float *samples, float *power)
+{
+    const int half {m_size / 2};
+    float *re {m_real.data()};
+    float *im {m_imaginary.data()};
+
+    // Even samples become the real parts, odd ones the imaginary parts.
+    for (int i {0}; i < half; ++i) {
+        const int j {m_bitReverse.at(i)};
+        re[j] = samples[2 * i];
+        im[j] = samples[2 * i + 1];
+    }
+
+    for (int length {2}; length <= half; length *= 2) {
+        const int span {length / 2};
+        const int stride {half / length};
+
+        for (int start {0}; start < half; start += length) {
+            for (int j {0}; j < span; ++j) {
+                const float wr {m_twiddleReal.at(j * stride)};
+                const float wi {m_twiddleImaginary.at(j * stride)};
+
+                const int a {start + j};
+                const int b {a + span};
+
+                const float tr {wr * re[b] - wi * im[b]};
+                const float ti {wr * im[b] + wi * re[b]};
+
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+
+    // Separate the spectra of the even and odd samples, which are
+    // conjugate-symmetric, and combine them into that of all samples.
+    for (int k {0}; k <= half; ++k) {
+        const int a {k % half};
+        const int b {(half - k) % half};
+
+        const float evenReal {0.5f * (re[a] + re[b])};
+        const float evenImaginary {0.5f * (im[a] - im[b])};
+        const float oddReal {0.5f * (im[a] + im[b])};
+        const float oddImaginary {-0.5f * (re[a] - re[b])};
+
+        const float wr {m_splitReal.at(k)};
+        const float wi {m_splitImaginary.at(k)};
+
+        const float real {evenReal + wr * oddReal - wi * oddImaginary};
+        const float imaginary {evenImaginary + wr * oddImaginary + wi * oddReal};
+
+        power[k] = real * real + imaginary * imaginary;
+    }
+}
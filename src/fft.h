@@ -0,0 +1,58 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include <QVector>
+
+//! Fast Fourier transform of real-valued samples
+/*!
+ * \ingroup Backend
+ *
+ * A plan for transforms of one size: the bit-reversal permutation and all
+ * twiddle factors are computed once on construction, along with the working
+ * memory, so \ref powerSpectrum neither computes trigonometry nor allocates.
+ *
+ * The \c N real samples are transformed as \c N/2 complex ones with an
+ * iterative radix-2 FFT, whose result is then split into the spectrum of the
+ * real input, halving the work of a complex transform of size \c N.
+ *
+ * \sa AudioAnalyzer
+ */
+class Fft
+{
+    public:
+        //! Create a plan.
+        /*!
+        * @param size Number of samples per transform; a power of two of at least \c 4.
+        */
+        explicit Fft(int size);
+
+        //! The number of samples per transform.
+        /*!
+        * @return A power of two.
+        */
+        int size() const;
+
+        //! Compute the power spectrum of real samples.
+        /*!
+        * @param samples \ref size samples.
+        * @param power Receives the squared magnitudes of the \c size / 2 + 1 frequency
+        * bins from 0 Hz to half the sample rate.
+        */
+        void powerSpectrum(const float *samples, float *power);
+
+    private:
+        int m_size;
+
+        QVector<int> m_bitReverse; // Permutation of the complex input.
+        QVector<float> m_twiddleReal; // exp(-2πik / (size / 2))
+        QVector<float> m_twiddleImaginary;
+        QVector<float> m_splitReal; // exp(-2πik / size)
+        QVector<float> m_splitImaginary;
+
+        QVector<float> m_real;
+        QVector<float> m_imaginary;
+};
@@ -0,0 +1,46 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "framebuffer.h"
+
+FrameBuffer::FrameBuffer()
+    : m_shared {1}
+    , m_write {0}
+    , m_read {2}
+{
+}
+
+uint32_t *FrameBuffer::beginWrite(int count)
+{
+    QVector<uint32_t> &buffer {m_buffers[m_write]};
+    buffer.resize(count);
+
+    return buffer.data();
+}
+
+void FrameBuffer::publish()
+{
+    // Release the frame to the reader and take over whichever buffer it
+    // left in the middle.
+    const int previous {m_shared.exchange(m_write | NewFrame, std::memory_order_acq_rel)};
+    m_write = previous & IndexMask;
+}
+
+bool FrameBuffer::acquire()
+{
+    if (!(m_shared.load(std::memory_order_relaxed) & NewFrame)) {
+        return false;
+    }
+
+    const int previous {m_shared.exchange(m_read, std::memory_order_acq_rel)};
+    m_read = previous & IndexMask;
+
+    return true;
+}
+
+const QVector<uint32_t> &FrameBuffer::frame() const
+{
+    return m_buffers[m_read];
+}
@@ -0,0 +1,76 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include <QVector>
+
+#include <atomic>
+#include <cstdint>
+
+//! Lock-free triple buffer handing LED frames from one thread to another
+/*!
+ * \ingroup Backend
+ *
+ * A single writer renders into \ref beginWrite and hands the frame over with
+ * \ref publish, while a single reader picks up the most recently published frame
+ * with \ref acquire. Neither side ever waits for the other: the writer always has
+ * a buffer to render into, and the reader always has a complete frame. Frames the
+ * reader did not get to in time are dropped.
+ *
+ * Each side only touches its own buffer; ownership is exchanged with a single
+ * atomic operation.
+ *
+ * \sa RenderLoop
+ */
+class FrameBuffer
+{
+    public:
+        //! Create a frame buffer.
+        FrameBuffer();
+
+        //! The buffer to render the next frame into.
+        /*!
+        * Only to be called by the writer.
+        *
+        * @param count Number of LEDs in the frame.
+        * @return Pointer to \p count LED values in the LedStrip data format.
+        * \sa publish
+        */
+        uint32_t *beginWrite(int count);
+
+        //! Hand the frame rendered into \ref beginWrite over to the reader.
+        /*!
+        * Only to be called by the writer.
+        */
+        void publish();
+
+        //! Pick up the most recently published frame.
+        /*!
+        * Only to be called by the reader.
+        *
+        * @return Whether a frame was published since the last call.
+        * \sa frame
+        */
+        bool acquire();
+
+        //! The frame picked up by the last call to \ref acquire.
+        /*!
+        * Only to be called by the reader.
+        *
+        * @return LED values in the LedStrip data format.
+        */
+        const QVector<uint32_t> &frame() const;
+
+    private:
+        static const int IndexMask {0x3};
+        static const int NewFrame {0x4};
+
+        QVector<uint32_t> m_buffers[3];
+
+        std::atomic<int> m_shared;
+        int m_write;
+        int m_read;
+};
@@ -14,6 +14,8 @@
 #include <QMetaProperty>
 #include <qnamespace.h>
 
+#include <algorithm>
+
 #ifdef HYELICHT_BUILD_ONBOARD
 #include <QTcpServer>
 #include <QHttpServer>
@@ -29,6 +31,7 @@ HttpServer::HttpServer(QObject *parent)
     , m_httpServer {new QHttpServer {this}}
 #endif
     , m_model {nullptr}
+    , m_routesRegistered {false}
     , m_createdByQml {false}
     , m_complete {false}
 {
@@ -102,17 +105,6 @@ void HttpServer::setModel(ShelfModel *model)
     if (m_model != model) {
         m_model = model;
 
-        if (m_model) {
-            QObject::connect(m_model, &QAbstractListModel::destroyed,
-                this, &HttpServer::updateHandler);
-            QObject::connect(m_model, &QAbstractListModel::rowsInserted,
-                this, &HttpServer::updateHandler);
-            QObject::connect(m_model, &QAbstractListModel::rowsRemoved,
-                this, &HttpServer::updateHandler);
-            QObject::connect(m_model, &QAbstractListModel::modelReset,
-                this, &HttpServer::updateHandler);
-        }
-
         if (!m_createdByQml || m_complete) {
             updateHandler();
         }
@@ -160,24 +152,31 @@ void HttpServer::updateServer()
 void HttpServer::updateHandler()
 {
 #ifdef HYELICHT_BUILD_ONBOARD
-    if (!m_model) {
+    // Routes look up the current model when handling a request, so they
+    // only need to be registered once.
+    if (!m_model || m_routesRegistered) {
         return;
     }
 
+    m_routesRegistered = true;
+
     m_httpServer->route(QStringLiteral("/v1/shelf"), [&](const QHttpServerRequest &request,
         QHttpServerResponder &responder) {
         QHttpHeaders headers;
         headers.replaceOrAppend(QHttpHeaders::WellKnownHeader::Allow, QStringLiteral("GET"));
 
         if (request.method() == QHttpServerRequest::Method::Get) {
+            // Reads never touch the live state, see `ShelfModel::snapshot`.
+            const auto snapshot {m_model->snapshot()};
+
             QJsonObject response {
-                {QStringLiteral("enabled"), m_model->enabled()},
-                {QStringLiteral("brightness"), m_model->brightness()},
-                {QStringLiteral("averageColor"), m_model->averageColor().name(QColor::HexRgb)},
-                {QStringLiteral("rows"), m_model->rows()},
-                {QStringLiteral("columns"), m_model->columns()},
-                {QStringLiteral("squares"), m_model->rowCount()},
-                {QStringLiteral("animating"), m_model->animating()}
+                {QStringLiteral("enabled"), snapshot->enabled},
+                {QStringLiteral("brightness"), snapshot->brightness},
+                {QStringLiteral("averageColor"), QColor {snapshot->averageColor}.name(QColor::HexRgb)},
+                {QStringLiteral("rows"), snapshot->rows},
+                {QStringLiteral("columns"), snapshot->columns},
+                {QStringLiteral("squares"), static_cast<int>(snapshot->squares.size())},
+                {QStringLiteral("animating"), snapshot->animating}
             };
 
             responder.write(QJsonDocument {response}, headers);
@@ -186,21 +185,226 @@ void HttpServer::updateHandler()
         }
     });
 
-    m_httpServer->route(QStringLiteral("/v1/shelf/enabled"), propHandler("enabled"));
-    m_httpServer->route(QStringLiteral("/v1/shelf/brightness"), propHandler("brightness"));
-    m_httpServer->route(QStringLiteral("/v1/shelf/averageColor"), propHandler("averageColor"));
-    m_httpServer->route(QStringLiteral("/v1/shelf/animating"), propHandler("animating"));
+    // Changes are queued with the model and applied with the next frame, so
+    // responses echo the accepted values.
+    m_httpServer->route(QStringLiteral("/v1/shelf/enabled"),
+        propHandler("enabled", ShelfModel::Command::SetEnabled));
+    m_httpServer->route(QStringLiteral("/v1/shelf/brightness"),
+        propHandler("brightness", ShelfModel::Command::SetBrightness));
+    m_httpServer->route(QStringLiteral("/v1/shelf/averageColor"),
+        propHandler("averageColor", ShelfModel::Command::SetAverageColor));
+    m_httpServer->route(QStringLiteral("/v1/shelf/animating"),
+        propHandler("animating", ShelfModel::Command::SetAnimating));
+
+    // Exposes the settings of whichever animation the shelf has, e.g. the
+    // effect, speed and scale of a NoiseAnimation.
+    m_httpServer->route(QStringLiteral("/v1/shelf/animation"), [&](const QHttpServerRequest &request,
+        QHttpServerResponder &responder) {
+        QHttpHeaders headers;
+        headers.replaceOrAppend(QHttpHeaders::WellKnownHeader::Allow, QStringLiteral("GET, PUT"));
+
+        AbstractAnimation *animation {m_model->animation()};
+
+        if (!animation) {
+            responder.write(headers, QHttpServerResponder::StatusCode::NotFound);
+            return;
+        }
+
+        if (request.method() == QHttpServerRequest::Method::Get) {
+            responder.write(QJsonDocument {animationToJson(animation)}, headers);
+            return;
+        } else if (request.method() == QHttpServerRequest::Method::Put) {
+            QJsonParseError jsonStatus;
+            const QJsonDocument &document = QJsonDocument::fromJson(request.body(), &jsonStatus);
+
+            if (jsonStatus.error == QJsonParseError::NoError && document.isObject()) {
+                const QMetaObject *metaObject {animation->metaObject()};
+                const QJsonObject &object {document.object()};
+                QList<QPair<QMetaProperty, QVariant>> values;
+
+                // Checked up front, so a bad value leaves the animation untouched.
+                for (auto it {object.constBegin()}; it != object.constEnd(); ++it) {
+                    const int propIndex {metaObject->indexOfProperty(it.key().toUtf8().constData())};
+                    QVariant value;
+
+                    // Properties of the base class, e.g. the LedStrip, are off limits.
+                    if (propIndex < AbstractAnimation::staticMetaObject.propertyCount()
+                        || !metaObject->property(propIndex).isWritable()
+                        || !jsonToAnimationProperty(metaObject->property(propIndex), it.value(), &value)) {
+                        QJsonObject response {{QStringLiteral("error"),
+                            i18n("Invalid animation property or value: %1", it.key())}};
+                        responder.write(QJsonDocument {response}, headers,
+                            QHttpServerResponder::StatusCode::BadRequest);
+                        return;
+                    }
+
+                    values.append({metaObject->property(propIndex), value});
+                }
+
+                for (const QPair<QMetaProperty, QVariant> &value : std::as_const(values)) {
+                    if (!value.first.write(animation, value.second)) {
+                        QJsonObject response {{QStringLiteral("error"),
+                            i18n("Invalid animation property or value: %1",
+                                QString::fromLatin1(value.first.name()))}};
+                        responder.write(QJsonDocument {response}, headers,
+                            QHttpServerResponder::StatusCode::BadRequest);
+                        return;
+                    }
+                }
+
+                responder.write(QJsonDocument {animationToJson(animation)}, headers);
+                return;
+            }
+        } else {
+            responder.write(headers, QHttpServerResponder::StatusCode::MethodNotAllowed);
+            return;
+        }
+
+        responder.write(headers, QHttpServerResponder::StatusCode::BadRequest);
+    });
+
+    // Recalls a stored scene, e.g. `{"scene": "Evening", "animate": true}`.
+    m_httpServer->route(QStringLiteral("/v1/shelf/scene"), [&](const QHttpServerRequest &request,
+        QHttpServerResponder &responder) {
+        QHttpHeaders headers;
+        headers.replaceOrAppend(QHttpHeaders::WellKnownHeader::Allow, QStringLiteral("PUT"));
+
+        if (request.method() != QHttpServerRequest::Method::Put) {
+            responder.write(headers, QHttpServerResponder::StatusCode::MethodNotAllowed);
+            return;
+        }
+
+        QJsonParseError jsonStatus;
+        const QJsonDocument &document = QJsonDocument::fromJson(request.body(), &jsonStatus);
+
+        if (jsonStatus.error == QJsonParseError::NoError && document.isObject()) {
+            const QString &name {document.object().value(QStringLiteral("scene")).toString()};
+
+            if (!m_model->scenes().contains(name)) {
+                responder.write(headers, QHttpServerResponder::StatusCode::NotFound);
+                return;
+            }
+
+            ShelfModel::Command command {ShelfModel::Command::RecallScene, name};
+            command.animate = document.object().value(QStringLiteral("animate")).toBool();
+
+            if (!m_model->postCommand(command)) {
+                responder.write(headers, QHttpServerResponder::StatusCode::ServiceUnavailable);
+                return;
+            }
+
+            QJsonObject response {{QStringLiteral("scene"), name}};
+            responder.write(QJsonDocument {response}, headers);
+            return;
+        }
+
+        responder.write(headers, QHttpServerResponder::StatusCode::BadRequest);
+    });
+
+    m_httpServer->route(QStringLiteral("/v1/scenes"), [&](const QHttpServerRequest &request,
+        QHttpServerResponder &responder) {
+        QHttpHeaders headers;
+        headers.replaceOrAppend(QHttpHeaders::WellKnownHeader::Allow, QStringLiteral("GET"));
+
+        if (request.method() == QHttpServerRequest::Method::Get) {
+            QJsonObject response {{QStringLiteral("scenes"), QJsonArray::fromStringList(m_model->scenes())}};
+            responder.write(QJsonDocument {response}, headers);
+        } else {
+            responder.write(headers, QHttpServerResponder::StatusCode::MethodNotAllowed);
+        }
+    });
+
+    // Stores what the shelf currently shows as a scene, or removes one.
+    m_httpServer->route(QStringLiteral("/v1/scenes/<arg>"), [&](QString name,
+        const QHttpServerRequest &request, QHttpServerResponder &responder) {
+        QHttpHeaders headers;
+        headers.replaceOrAppend(QHttpHeaders::WellKnownHeader::Allow, QStringLiteral("PUT, DELETE"));
+
+        if (request.method() == QHttpServerRequest::Method::Put) {
+            if (!m_model->saveScene(name)) {
+                responder.write(headers, QHttpServerResponder::StatusCode::BadRequest);
+                return;
+            }
+        } else if (request.method() == QHttpServerRequest::Method::Delete) {
+            if (!m_model->removeScene(name)) {
+                responder.write(headers, QHttpServerResponder::StatusCode::NotFound);
+                return;
+            }
+        } else {
+            responder.write(headers, QHttpServerResponder::StatusCode::MethodNotAllowed);
+            return;
+        }
+
+        QJsonObject response {{QStringLiteral("scenes"), QJsonArray::fromStringList(m_model->scenes())}};
+        responder.write(QJsonDocument {response}, headers);
+    });
+
+    // Uploads a Timeline to play back on the shelf, or stops it.
+    m_httpServer->route(QStringLiteral("/v1/timeline"), [&](const QHttpServerRequest &request,
+        QHttpServerResponder &responder) {
+        QHttpHeaders headers;
+        headers.replaceOrAppend(QHttpHeaders::WellKnownHeader::Allow, QStringLiteral("GET, PUT, DELETE"));
+
+        auto printStatus = [&]() {
+            QJsonObject response {
+                {QStringLiteral("running"), m_model->timelineRunning()},
+                {QStringLiteral("position"), m_model->timelinePosition()},
+                {QStringLiteral("duration"), m_model->timeline().duration()},
+                {QStringLiteral("loop"), m_model->timeline().loop()}
+            };
+
+            responder.write(QJsonDocument {response}, headers);
+        };
+
+        if (request.method() == QHttpServerRequest::Method::Get) {
+            printStatus();
+            return;
+        } else if (request.method() == QHttpServerRequest::Method::Put) {
+            QJsonParseError jsonStatus;
+            const QJsonDocument &document = QJsonDocument::fromJson(request.body(), &jsonStatus);
+
+            if (jsonStatus.error == QJsonParseError::NoError && document.isObject()) {
+                Timeline timeline;
+                QString errorString;
+
+                if (!Timeline::fromJson(document.object(), m_model->rowCount(), &timeline, &errorString)) {
+                    QJsonObject response {{QStringLiteral("error"), errorString}};
+                    responder.write(QJsonDocument {response}, headers,
+                        QHttpServerResponder::StatusCode::BadRequest);
+                    return;
+                }
+
+                if (m_model->playTimeline(timeline)) {
+                    printStatus();
+                    return;
+                }
+            }
+        } else if (request.method() == QHttpServerRequest::Method::Delete) {
+            m_model->stopTimeline();
+            printStatus();
+            return;
+        } else {
+            responder.write(headers, QHttpServerResponder::StatusCode::MethodNotAllowed);
+            return;
+        }
+
+        responder.write(headers, QHttpServerResponder::StatusCode::BadRequest);
+    });
 
     m_httpServer->route(QStringLiteral("/v1/squares"), [=](const QHttpServerRequest &request,
         QHttpServerResponder &responder) {
         QHttpHeaders headers;
         headers.replaceOrAppend(QHttpHeaders::WellKnownHeader::Allow, QStringLiteral("GET"));
 
-        auto printSquares = [&]() {
+        // Colors not applied yet are shown as requested.
+        auto printSquares = [&](const QHash<int, QVariant> &pending = QHash<int, QVariant>()) {
+            const auto snapshot {m_model->snapshot()};
             QJsonArray items;
 
-            for (int i {0}; i < m_model->rowCount(); ++i) {
-                QJsonObject square {rowToJson(m_model->index(i, 0))};
+            for (int i {0}; i < snapshot->squares.size(); ++i) {
+                QJsonObject square {squareToJson(pending.contains(i)
+                    ? pending.value(i).value<QColor>().rgb() : snapshot->squares.at(i))};
+
                 square.insert(QStringLiteral("id"), i);
                 square.insert(QStringLiteral("self"), QStringLiteral("/v1/squares/%1").arg(QString::number(i)));
                 items.append(square);
@@ -224,12 +428,22 @@ void HttpServer::updateHandler()
                 const QHash<int, QVariant> &newData {jsonToModelRole(document,
                     QStringLiteral("averageColor"))};
 
-                if (!newData.isEmpty()) {
-                    for (const int row : newData.keys()) {
-                        m_model->setData(m_model->index(row, 0), newData[row]);
+                // Nothing is applied unless all colors are.
+                const bool valid {std::all_of(newData.cbegin(), newData.cend(),
+                    [](const QVariant &value) { return value.value<QColor>().isValid(); })};
+
+                if (!newData.isEmpty() && valid) {
+                    for (auto it {newData.constBegin()}; it != newData.constEnd(); ++it) {
+                        ShelfModel::Command command {ShelfModel::Command::SetSquareColor, it.value()};
+                        command.square = it.key();
+
+                        if (!m_model->postCommand(command)) {
+                            responder.write(headers, QHttpServerResponder::StatusCode::ServiceUnavailable);
+                            return;
+                        }
                     }
 
-                    printSquares();
+                    printSquares(newData);
                     return;
                 }
             }
@@ -240,57 +454,76 @@ void HttpServer::updateHandler()
         responder.write(headers, QHttpServerResponder::StatusCode::BadRequest);
     });
 
-    for (int i {0}; i < m_model->rowCount(); ++i) {
-        m_httpServer->route(QLatin1StringView("/v1/squares/%1").arg(QString::number(i)),
-            [&](const QHttpServerRequest &request,
-            QHttpServerResponder &responder) {
-            QHttpHeaders headers;
-            headers.replaceOrAppend(QHttpHeaders::WellKnownHeader::Allow, QStringLiteral("GET"));
+    // Square routes take the square index as an argument, so they don't need to
+    // be registered again when the number of squares changes.
+    m_httpServer->route(QStringLiteral("/v1/squares/<arg>"), [=](int i, const QHttpServerRequest &request,
+        QHttpServerResponder &responder) {
+        QHttpHeaders headers;
+        headers.replaceOrAppend(QHttpHeaders::WellKnownHeader::Allow, QStringLiteral("GET"));
+
+        if (!m_model || i < 0 || i >= m_model->rowCount()) {
+            responder.write(headers, QHttpServerResponder::StatusCode::NotFound);
+            return;
+        }
+
+        if (request.method() == QHttpServerRequest::Method::Get) {
+            const auto snapshot {m_model->snapshot()};
 
-            if (request.method() == QHttpServerRequest::Method::Get) {
-                responder.write(QJsonDocument {rowToJson(m_model->index(i, 0))}, headers);
+            if (i >= snapshot->squares.size()) {
+                responder.write(headers, QHttpServerResponder::StatusCode::NotFound);
                 return;
-            } else if (request.method() == QHttpServerRequest::Method::Put) {
-                QJsonParseError jsonStatus;
-                const QJsonDocument &document = QJsonDocument::fromJson(request.body(), &jsonStatus);
-
-                if (jsonStatus.error == QJsonParseError::NoError && document.object().size() >= 1) {
-                    // Don't expose per-square brightness to the frontends for the moment.
-                    const QJsonValue &value {document.object().value(QStringLiteral("averageColor"))};
-
-                    if (value != QJsonValue::Undefined) {
-                        const QModelIndex &modelIndex {m_model->index(i, 0)};
-                        m_model->setData(modelIndex, value.toVariant());
-                        responder.write(QJsonDocument {rowToJson(modelIndex)}, headers);
+            }
+
+            responder.write(QJsonDocument {squareToJson(snapshot->squares.at(i))}, headers);
+            return;
+        } else if (request.method() == QHttpServerRequest::Method::Put) {
+            QJsonParseError jsonStatus;
+            const QJsonDocument &document = QJsonDocument::fromJson(request.body(), &jsonStatus);
+
+            if (jsonStatus.error == QJsonParseError::NoError && document.object().size() >= 1) {
+                // Don't expose per-square brightness to the frontends for the moment.
+                const QJsonValue &value {document.object().value(QStringLiteral("averageColor"))};
+
+                if (value.toVariant().value<QColor>().isValid()) {
+                    ShelfModel::Command command {ShelfModel::Command::SetSquareColor, value.toVariant()};
+                    command.square = i;
+
+                    if (!m_model->postCommand(command)) {
+                        responder.write(headers, QHttpServerResponder::StatusCode::ServiceUnavailable);
                         return;
                     }
+
+                    responder.write(QJsonDocument {squareToJson(value.toVariant().value<QColor>().rgb())},
+                        headers);
+                    return;
                 }
-            } else {
-                responder.write(headers, QHttpServerResponder::StatusCode::MethodNotAllowed);
             }
+        } else {
+            responder.write(headers, QHttpServerResponder::StatusCode::MethodNotAllowed);
+        }
 
-            responder.write(headers, QHttpServerResponder::StatusCode::BadRequest);
-        });
+        responder.write(headers, QHttpServerResponder::StatusCode::BadRequest);
+    });
 
-        // Don't expose per-square brightness to the frontends for the moment.
-        // m_handler->registerMethod(QString("v1/squares/%1/brightness").arg(i), this,
-        //     modelRowHandler("brightness", i, ShelfModel::Brightness), true /* readAll */);
-        m_httpServer->route(QLatin1StringView("/v1/squares/%1/averageColor").arg(QString::number(i)),
-            modelRowHandler("averageColor", i, Qt::EditRole));
-    }
+    // Don't expose per-square brightness to the frontends for the moment.
+    // m_httpServer->route(QStringLiteral("/v1/squares/<arg>/brightness"),
+    //     modelRowHandler("brightness", ShelfModel::Brightness));
+    m_httpServer->route(QStringLiteral("/v1/squares/<arg>/averageColor"),
+        modelRowHandler("averageColor", Qt::EditRole));
 #endif
 }
 #ifdef HYELICHT_BUILD_ONBOARD
-std::function<void(const QHttpServerRequest &, QHttpServerResponder &)> HttpServer::propHandler(const char *prop)
+std::function<void(const QHttpServerRequest &, QHttpServerResponder &)> HttpServer::propHandler(const char *prop,
+    ShelfModel::Command::Type type)
 {
     return [=](const QHttpServerRequest &request, QHttpServerResponder &responder) {
         QHttpHeaders headers;
         headers.replaceOrAppend(QHttpHeaders::WellKnownHeader::Allow, QStringLiteral("GET, PUT"));
 
         if (request.method() == QHttpServerRequest::Method::Get) {
-            propToJSon(responder, headers, m_model, prop);
+            snapshotToJson(responder, headers, prop, type);
         } else if (request.method() == QHttpServerRequest::Method::Put) {
-            jsonToProp(request, responder, headers, m_model, prop);
+            jsonToProp(request, responder, headers, m_model, prop, type);
         } else {
             responder.write(headers, QHttpServerResponder::StatusCode::MethodNotAllowed);
         }
@@ -299,17 +532,32 @@ std::function<void(const QHttpServerRequest &, QHttpServerResponder &)> HttpServ
     };
 }
 
-std::function<void(const QHttpServerRequest &, QHttpServerResponder &)> HttpServer::modelRowHandler(const char *prop,
-    const int index, const int role)
+std::function<void(int, const QHttpServerRequest &, QHttpServerResponder &)> HttpServer::modelRowHandler(const char *prop,
+    const int role)
 {
-    return [=](const QHttpServerRequest &request, QHttpServerResponder &responder) {
+    return [=](int index, const QHttpServerRequest &request, QHttpServerResponder &responder) {
         QHttpHeaders headers;
         headers.replaceOrAppend(QHttpHeaders::WellKnownHeader::Allow, QStringLiteral("GET, PUT"));
 
-        const QModelIndex &modelIndex = m_model->index(index, 0);
+        if (!m_model || index < 0 || index >= m_model->rowCount()) {
+            responder.write(headers, QHttpServerResponder::StatusCode::NotFound);
+            return;
+        }
 
         if (request.method() == QHttpServerRequest::Method::Get) {
-            QJsonObject response {{QLatin1StringView(prop), QJsonValue::fromVariant(modelIndex.data(role))}};
+            QJsonObject response;
+
+            if (role == Qt::EditRole) {
+                const auto snapshot {m_model->snapshot()};
+
+                if (index < snapshot->squares.size()) {
+                    response = squareToJson(snapshot->squares.at(index));
+                }
+            } else {
+                response.insert(QLatin1StringView(prop),
+                    QJsonValue::fromVariant(m_model->index(index, 0).data(role)));
+            }
+
             responder.write(QJsonDocument {response}, headers);
             return;
         } else if (request.method() == QHttpServerRequest::Method::Put && role == Qt::EditRole) {
@@ -317,9 +565,18 @@ std::function<void(const QHttpServerRequest &, QHttpServerResponder &)> HttpServ
             const QJsonDocument &document = QJsonDocument::fromJson(request.body(), &jsonStatus);
 
             if (jsonStatus.error == QJsonParseError::NoError && document.object().size() >= 1) {
-                if (m_model->setData(modelIndex, document.object().begin().value().toVariant())) {
-                    QJsonObject response {{QLatin1StringView(prop), QJsonValue::fromVariant(modelIndex.data(role))}};
-                    responder.write(QJsonDocument {response}, headers);
+                const QVariant &value {document.object().begin().value().toVariant()};
+
+                if (value.value<QColor>().isValid()) {
+                    ShelfModel::Command command {ShelfModel::Command::SetSquareColor, value};
+                    command.square = index;
+
+                    if (!m_model->postCommand(command)) {
+                        responder.write(headers, QHttpServerResponder::StatusCode::ServiceUnavailable);
+                        return;
+                    }
+
+                    responder.write(QJsonDocument {squareToJson(value.value<QColor>().rgb())}, headers);
                     return;
                 }
             }
@@ -327,35 +584,45 @@ std::function<void(const QHttpServerRequest &, QHttpServerResponder &)> HttpServ
             responder.write(headers, QHttpServerResponder::StatusCode::MethodNotAllowed);
         }
 
-        responder.write(headers, QHttpServerResponder::StatusCode::MethodNotAllowed);
+        responder.write(headers, QHttpServerResponder::StatusCode::BadRequest);
     };
 }
 
-void HttpServer::propToJSon(QHttpServerResponder &responder, const QHttpHeaders &headers,
-    const QObject *obj, const char *name)
+void HttpServer::snapshotToJson(QHttpServerResponder &responder, const QHttpHeaders &headers,
+    const char *name, ShelfModel::Command::Type type)
 {
-    if (!obj) {
-        responder.write(headers, QHttpServerResponder::StatusCode::BadRequest);
-    }
-
-    const int propIndex {obj->metaObject()->indexOfProperty(name)};
-
-    if (propIndex == -1) {
+    if (!m_model) {
         responder.write(headers, QHttpServerResponder::StatusCode::BadRequest);
+        return;
     }
 
-    const QMetaProperty &metaProp {obj->metaObject()->property(propIndex)};
-
-    if (!metaProp.isReadable()) {
-        responder.write(headers, QHttpServerResponder::StatusCode::BadRequest);
+    const auto snapshot {m_model->snapshot()};
+    QJsonValue value;
+
+    switch (type) {
+        case ShelfModel::Command::SetEnabled:
+            value = snapshot->enabled;
+            break;
+        case ShelfModel::Command::SetBrightness:
+            value = snapshot->brightness;
+            break;
+        case ShelfModel::Command::SetAverageColor:
+            value = QColor {snapshot->averageColor}.name(QColor::HexRgb);
+            break;
+        case ShelfModel::Command::SetAnimating:
+            value = snapshot->animating;
+            break;
+        default:
+            responder.write(headers, QHttpServerResponder::StatusCode::BadRequest);
+            return;
     }
 
-    QJsonObject response {{QLatin1StringView(name), QJsonValue::fromVariant(obj->property(name))}};
+    QJsonObject response {{QLatin1StringView(name), value}};
     responder.write(QJsonDocument {response}, headers);
 }
 
 void HttpServer::jsonToProp(const QHttpServerRequest &request, QHttpServerResponder &responder,
-    const QHttpHeaders &headers, QObject *obj, const char *name)
+    const QHttpHeaders &headers, ShelfModel *obj, const char *name, ShelfModel::Command::Type type)
 {
     if (!obj) {
         responder.write(headers, QHttpServerResponder::StatusCode::BadRequest);
@@ -383,8 +650,18 @@ void HttpServer::jsonToProp(const QHttpServerRequest &request, QHttpServerRespon
         if (body.contains(latin1Name)) {
             const QVariant &value {body.value(latin1Name)};
 
-            if (value.canConvert(metaProp.metaType())) {
-                obj->setProperty(name, value);
+            QVariant converted {value};
+
+            if (converted.convert(metaProp.metaType()) && (metaProp.metaType().id() != QMetaType::QColor
+                || converted.value<QColor>().isValid())) {
+                if (!obj->postCommand(ShelfModel::Command {type, converted})) {
+                    responder.write(headers, QHttpServerResponder::StatusCode::ServiceUnavailable);
+                    return;
+                }
+
+                QJsonObject response {{QLatin1StringView(name), QJsonValue::fromVariant(converted)}};
+                responder.write(QJsonDocument {response}, headers);
+                return;
             }
         }
     } else {
@@ -398,21 +675,62 @@ void HttpServer::jsonToProp(const QHttpServerRequest &request, QHttpServerRespon
 }
 #endif
 
-QJsonObject HttpServer::rowToJson(const QModelIndex &modelIndex)
+QJsonObject HttpServer::squareToJson(QRgb color)
+{
+    // For now only expose the color, and not e.g. the per-square brightness.
+    return QJsonObject {{QStringLiteral("averageColor"), QColor {color}.name(QColor::HexRgb)}};
+}
+
+QJsonObject HttpServer::animationToJson(const AbstractAnimation *animation)
 {
-    const QHash<int, QByteArray> &roles = m_model->roleNames();
+    QJsonObject animationObj {{QStringLiteral("name"), animation->name()}};
+
+    const QMetaObject *metaObject {animation->metaObject()};
 
-    QJsonObject rowObj;
+    for (int i {AbstractAnimation::staticMetaObject.propertyCount()}; i < metaObject->propertyCount(); ++i) {
+        const QMetaProperty &metaProp {metaObject->property(i)};
+        const QVariant &value {metaProp.read(animation)};
 
-    for (const int role : roles.keys()) {
-        // For now only expose this role, and not e.g. the per-square brightness.
-        // if (role >= Qt::UserRole) {
-        if (role == ShelfModel::AverageColor) {
-            rowObj.insert(QLatin1StringView(roles[role]), QJsonValue::fromVariant(modelIndex.data(role)));
+        if (metaProp.isEnumType()) {
+            animationObj.insert(QLatin1StringView(metaProp.name()),
+                QLatin1StringView(metaProp.enumerator().valueToKey(value.toInt())));
+        } else {
+            animationObj.insert(QLatin1StringView(metaProp.name()), QJsonValue::fromVariant(value));
+        }
+    }
+
+    return animationObj;
+}
+
+bool HttpServer::jsonToAnimationProperty(const QMetaProperty &property, const QJsonValue &json,
+    QVariant *value)
+{
+    // Enum values may be given by name or number, but must exist.
+    if (property.isEnumType()) {
+        const QMetaEnum &enumerator {property.enumerator()};
+        bool ok {false};
+        int enumValue {-1};
+
+        if (json.isString()) {
+            enumValue = enumerator.keyToValue(json.toString().toUtf8().constData(), &ok);
+        } else if (json.isDouble()) {
+            enumValue = json.toInt();
+            ok = enumerator.valueToKey(enumValue);
         }
+
+        *value = enumValue;
+
+        return ok;
+    }
+
+    *value = json.toVariant();
+
+    if (!value->convert(property.metaType())) {
+        return false;
     }
 
-    return rowObj;
+    // Any string converts to a color, if only an invalid one.
+    return property.metaType().id() != QMetaType::QColor || value->value<QColor>().isValid();
 }
 
 QHash<int, QVariant> HttpServer::jsonToModelRole(const QJsonDocument &document, const QString &roleName)
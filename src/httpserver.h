@@ -207,15 +207,19 @@ class HttpServer : public QObject, public QQmlParserStatus
     private:
         void updateServer();
 #ifdef HYELICHT_BUILD_ONBOARD
-        std::function<void(const QHttpServerRequest &, QHttpServerResponder &)> propHandler(const char *prop);
-        std::function<void(const QHttpServerRequest &, QHttpServerResponder &)> modelRowHandler(const char *prop,
-            const int index, const int role);
-        void propToJSon(QHttpServerResponder &responder, const QHttpHeaders &headers,
-            const QObject *obj, const char *name);
+        std::function<void(const QHttpServerRequest &, QHttpServerResponder &)> propHandler(const char *prop,
+            ShelfModel::Command::Type type);
+        std::function<void(int, const QHttpServerRequest &, QHttpServerResponder &)> modelRowHandler(const char *prop,
+            const int role);
+        void snapshotToJson(QHttpServerResponder &responder, const QHttpHeaders &headers,
+            const char *name, ShelfModel::Command::Type type);
         void jsonToProp(const QHttpServerRequest &request, QHttpServerResponder &responder,
-            const QHttpHeaders &headers, QObject *obj, const char *name);
+            const QHttpHeaders &headers, ShelfModel *model, const char *name, ShelfModel::Command::Type type);
 #endif
-        QJsonObject rowToJson(const QModelIndex &modelIndex);
+        static QJsonObject squareToJson(QRgb color);
+        QJsonObject animationToJson(const AbstractAnimation *animation);
+        static bool jsonToAnimationProperty(const QMetaProperty &property, const QJsonValue &json,
+            QVariant *value);
         QHash<int, QVariant> jsonToModelRole(const QJsonDocument &document,
             const QString &roleName);
 
@@ -230,6 +234,7 @@ class HttpServer : public QObject, public QQmlParserStatus
 #endif
 
         QPointer<ShelfModel> m_model;
+        bool m_routesRegistered;
 
         bool m_createdByQml;
         bool m_complete;
@@ -0,0 +1,203 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+// Bakes an animation into a clip file for playback with ClipAnimation.
+
+#include "animations/animationclip.h"
+#include "animations/fireanimation.h"
+#include "animationcatalog.h"
+#include "debug.h"
+#include "shelfmodel.h"
+#include "version.h"
+
+#include <KAboutData>
+#include <KLocalizedString>
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+
+#include <memory>
+
+namespace {
+
+std::unique_ptr<AbstractAnimation> createAnimation(const QString &name)
+{
+    if (name == QLatin1String("fire")) {
+        return std::make_unique<FireAnimation>();
+    }
+
+    // Any other animation is provided by a plugin.
+    return std::unique_ptr<AbstractAnimation>(AnimationCatalog::self()->create(name));
+}
+
+bool setProperties(AbstractAnimation *animation, const QStringList &assignments)
+{
+    for (const QString &assignment : assignments) {
+        const qsizetype separator {assignment.indexOf(QLatin1Char('='))};
+
+        if (separator < 1) {
+            qCCritical(HYELICHT) << i18n("Invalid property assignment, expected name=value: %1", assignment);
+            return false;
+        }
+
+        const QString name {assignment.left(separator)};
+
+        if (!animation->setProperty(name.toUtf8().constData(), assignment.mid(separator + 1))) {
+            qCCritical(HYELICHT) << i18n("Animation '%1' has no property '%2' that accepts: %3",
+                animation->name(), name, assignment.mid(separator + 1));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app {argc, argv};
+
+    KLocalizedString::setApplicationDomain("hyelicht");
+
+    KAboutData aboutData {Hyelicht::createAboutData(QStringLiteral("hyelicht-bake"),
+        QStringLiteral("hyelicht animation clip baker"))};
+    KAboutData::setApplicationData(aboutData);
+
+    QCommandLineOption animationOption {
+        {QStringLiteral("a"), QStringLiteral("animation")},
+        xi18nc("@option", "Animation to bake: fire, or the id of an animation plugin (e.g. flames, noise)"),
+        QStringLiteral("name"),
+        QStringLiteral("flames")
+    };
+
+    QCommandLineOption propertyOption {
+        {QStringLiteral("p"), QStringLiteral("property")},
+        xi18nc("@option", "Set a property of the animation, e.g. effect=Aurora (repeatable)"),
+        QStringLiteral("name=value")
+    };
+
+    QCommandLineOption rowsOption {
+        QStringLiteral("rows"),
+        xi18nc("@option", "Number of shelf rows"),
+        QStringLiteral("rows"),
+        QStringLiteral("4")
+    };
+
+    QCommandLineOption columnsOption {
+        QStringLiteral("columns"),
+        xi18nc("@option", "Number of shelf columns"),
+        QStringLiteral("columns"),
+        QStringLiteral("5")
+    };
+
+    QCommandLineOption densityOption {
+        QStringLiteral("density"),
+        xi18nc("@option", "Number of LEDs per compartment"),
+        QStringLiteral("leds"),
+        QStringLiteral("20")
+    };
+
+    QCommandLineOption wallThicknessOption {
+        QStringLiteral("wall-thickness"),
+        xi18nc("@option", "Number of LEDs per wall"),
+        QStringLiteral("leds"),
+        QStringLiteral("1")
+    };
+
+    QCommandLineOption framesOption {
+        {QStringLiteral("f"), QStringLiteral("frames")},
+        xi18nc("@option", "Number of frames in the clip"),
+        QStringLiteral("frames"),
+        QStringLiteral("300")
+    };
+
+    QCommandLineOption intervalOption {
+        {QStringLiteral("i"), QStringLiteral("interval")},
+        xi18nc("@option", "Time between frames in milliseconds"),
+        QStringLiteral("ms"),
+        QStringLiteral("33")
+    };
+
+    QCommandLineOption warmupOption {
+        QStringLiteral("warmup"),
+        xi18nc("@option", "Time to run the animation before recording, in milliseconds"),
+        QStringLiteral("ms"),
+        QStringLiteral("2000")
+    };
+
+    QCommandLineOption crossfadeOption {
+        QStringLiteral("crossfade"),
+        xi18nc("@option", "Number of frames blended across the loop point"),
+        QStringLiteral("frames"),
+        QStringLiteral("30")
+    };
+
+    QCommandLineParser parser;
+
+    parser.addOptions({
+        animationOption,
+        propertyOption,
+        rowsOption,
+        columnsOption,
+        densityOption,
+        wallThicknessOption,
+        framesOption,
+        intervalOption,
+        warmupOption,
+        crossfadeOption
+    });
+
+    parser.addPositionalArgument(QStringLiteral("file"),
+        i18nc("@option", "Clip file to write"));
+
+    aboutData.setupCommandLine(&parser);
+    parser.process(app);
+    aboutData.processCommandLine(&parser);
+
+    if (parser.positionalArguments().size() != 1) {
+        qCCritical(HYELICHT) << i18n("No clip file specified.");
+        return 1;
+    }
+
+    std::unique_ptr<AbstractAnimation> animation {createAnimation(parser.value(animationOption))};
+
+    if (!animation) {
+        qCCritical(HYELICHT) << i18n("Unknown animation: %1", parser.value(animationOption));
+        return 1;
+    }
+
+    if (!setProperties(animation.get(), parser.values(propertyOption))) {
+        return 1;
+    }
+
+    // Derives the strip length and compartments the same way as the shelf.
+    ShelfModel shelfModel;
+    shelfModel.setRows(parser.value(rowsOption).toInt());
+    shelfModel.setColumns(parser.value(columnsOption).toInt());
+    shelfModel.setDensity(parser.value(densityOption).toInt());
+    shelfModel.setWallThickness(parser.value(wallThicknessOption).toInt());
+
+    AnimationClip::BakeOptions options;
+    options.count = shelfModel.ledCount();
+    options.squares = shelfModel.squareRanges();
+    options.frames = parser.value(framesOption).toInt();
+    options.interval = parser.value(intervalOption).toInt();
+    options.warmup = parser.value(warmupOption).toInt();
+    options.crossfade = parser.value(crossfadeOption).toInt();
+
+    const QString fileName {parser.positionalArguments().constFirst()};
+
+    if (!AnimationClip::bake(animation.get(), options, fileName)) {
+        return 1;
+    }
+
+    QTextStream(stdout) << i18n("Baked %1 frames of '%2' for %3 LEDs into: %4",
+        options.frames, animation->name(), options.count, fileName) << Qt::endl;
+
+    return 0;
+}
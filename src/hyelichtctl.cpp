@@ -19,6 +19,7 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QRegularExpression>
+#include <QUrl>
 
 int main(int argc, char *argv[])
 {
@@ -114,9 +115,12 @@ int main(int argc, char *argv[])
                 )};
 
                 for (const QString &key : keys) {
+                    const QJsonValue &value {response.object().value(key)};
+
                     out << QStringLiteral("%1 = %2")
                         .arg(key.leftJustified(longestKey.length()))
-                        .arg(response.object().value(key).toVariant().toString())
+                        .arg(value.isArray() ? value.toVariant().toStringList().join(QStringLiteral(", "))
+                            : value.toVariant().toString())
                         << Qt::endl;
                 }
             }
@@ -131,14 +135,22 @@ int main(int argc, char *argv[])
         QObject::connect(reply, &QNetworkReply::finished, qApp, handleReply(reply));
     };
 
-    auto put = [=, &networkAccessManager](const QString &resource, const QString &prop,
-        const QVariant &value) {
-        QJsonObject body {{prop, QJsonValue::fromVariant(value)}};
+    auto putObject = [=, &networkAccessManager](const QString &resource, const QJsonObject &body) {
         const QUrl url {urlTemplate.arg(resource)};
         QNetworkReply *reply {networkAccessManager->put(QNetworkRequest(url),
             QJsonDocument(body).toJson())};
         QObject::connect(reply, &QNetworkReply::finished, qApp, handleReply(reply));
     };
+
+    auto put = [=](const QString &resource, const QString &prop, const QVariant &value) {
+        putObject(resource, QJsonObject {{prop, QJsonValue::fromVariant(value)}});
+    };
+
+    auto deleteResource = [=, &networkAccessManager](const QString &resource) {
+        const QUrl url {urlTemplate.arg(resource)};
+        QNetworkReply *reply {networkAccessManager->deleteResource(QNetworkRequest(url))};
+        QObject::connect(reply, &QNetworkReply::finished, qApp, handleReply(reply));
+    };
     auto commandStatus = [=]() {
         if (args.length() == 1) {
             get(QStringLiteral("shelf"));
@@ -226,6 +238,46 @@ int main(int argc, char *argv[])
         }
     };
 
+    auto commandScenes = [=]() {
+        if (args.length() == 1) {
+            get(QStringLiteral("scenes"));
+        } else {
+            exitWithError(i18n("Too many arguments."));
+        }
+    };
+
+    auto commandScene = [=]() {
+        if (args.length() == 1) {
+            exitWithError(i18n("No scene specified."));
+        } else if (args.length() == 2 || (args.length() == 3 && args.at(2) == QStringLiteral("fade"))) {
+            putObject(QStringLiteral("shelf/scene"), QJsonObject {
+                {QStringLiteral("scene"), args.at(1)},
+                {QStringLiteral("animate"), args.length() == 3}
+            });
+        } else if (args.length() == 3) {
+            exitWithError(i18n("Not a valid argument: %1", args.at(2).trimmed()));
+        } else {
+            exitWithError(i18n("Too many arguments."));
+        }
+    };
+
+    auto commandSaveRemoveScene = [=](bool save) {
+        if (args.length() == 1) {
+            exitWithError(i18n("No scene specified."));
+        } else if (args.length() == 2) {
+            const QString &resource {QStringLiteral("scenes/%1")
+                .arg(QString::fromLatin1(QUrl::toPercentEncoding(args.at(1))))};
+
+            if (save) {
+                putObject(resource, QJsonObject {});
+            } else {
+                deleteResource(resource);
+            }
+        } else {
+            exitWithError(i18n("Too many arguments."));
+        }
+    };
+
     const QString &command {args.at(0)};
 
     if (command == QStringLiteral("status")) {
@@ -242,6 +294,14 @@ int main(int argc, char *argv[])
         commandColor();
     } else if (command == QStringLiteral("animating")) {
         commandShelfGenericBool(QStringLiteral("animating"));
+    } else if (command == QStringLiteral("scenes")) {
+        commandScenes();
+    } else if (command == QStringLiteral("scene")) {
+        commandScene();
+    } else if (command == QStringLiteral("save-scene")) {
+        commandSaveRemoveScene(true);
+    } else if (command == QStringLiteral("remove-scene")) {
+        commandSaveRemoveScene(false);
     } else {
         qCCritical(HYELICHTCTL) << i18n("Unknown command: %1", command.trimmed());
         return 1;
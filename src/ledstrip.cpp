@@ -5,20 +5,73 @@
 
 #include "ledstrip.h"
 #include "debug_ledstrip.h"
+#include "spscqueue.h"
 
 #include <KLocalizedString>
 
+#include <QDeadlineTimer>
+#include <QSemaphore>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <time.h>
 
 #define APA102_HEADER_BYTES 4
 #define LED_BRIGHTNESS_MASK 0x1F
 #define LED_BRIGHTNESS_HIGH_BITS 0xE0
 
+namespace {
+
+const qint64 statisticsInterval {10000000000}; // Nanoseconds.
+
+// Sleeping is only accurate to about this much, so the rest is spun away.
+const qint64 spinTime {200000}; // Nanoseconds.
+
+const int pollTimeout {100}; // Milliseconds; how quickly a stop request is noticed.
+
+inline qint64 now()
+{
+    return QDeadlineTimer::current(Qt::PreciseTimer).deadlineNSecs();
+}
+
+}
+
+// Frames queued by showAt, handed to the output thread and back in slots
+// whose buffers are reused.
+struct LedStrip::FrameQueue
+{
+    static const int Length {8};
+
+    struct Slot {
+        QVector<uint32_t> data;
+        spi_ioc_transfer message[3];
+        qint64 presentationTime;
+    };
+
+    FrameQueue()
+    {
+        for (int i {0}; i < Length; ++i) {
+            freeFrames.push(i);
+        }
+    }
+
+    Slot frames[Length];
+    SpscQueue<int, Length + 1> pendingFrames; // To the output thread, in order.
+    SpscQueue<int, Length + 1> freeFrames; // Back to the producer.
+    QSemaphore pendingCount;
+
+    std::unique_ptr<QThread> thread;
+    std::atomic<bool> stopping {false};
+    std::atomic<int> dropped {0};
+};
+
 LedStrip::LedStrip(QObject *parent)
     : LedStrip(1, parent)
 {
@@ -34,12 +87,14 @@ LedStrip::LedStrip(int count, QObject *parent)
     , m_count {count}
     , m_gammaCorrection {false}
     , m_gamma {2.6}
-    , m_gammaCorrectedData {nullptr}
     , m_hsvBrightness {false}
-    , m_brightnessCorrectedData {nullptr}
+    , m_globalBrightness {1.0}
+    , m_outputData {nullptr}
     , m_header {nullptr}
     , m_footer {nullptr}
     , m_data {nullptr}
+    , m_capacity {0}
+    , m_generation {0}
     , m_savedData {nullptr}
     , m_savedSize(0)
     , m_createdByQml {false}
@@ -52,6 +107,11 @@ LedStrip::LedStrip(int count, QObject *parent)
     }
 
     updateData(m_count);
+    updateBrightnessLut();
+
+    m_updateTimer.setSingleShot(true);
+    m_updateTimer.setInterval(0);
+    QObject::connect(&m_updateTimer, &QTimer::timeout, this, &LedStrip::show);
 }
 
 LedStrip::~LedStrip()
@@ -61,9 +121,9 @@ LedStrip::~LedStrip()
         m_data = nullptr;
     }
 
-    if (m_gammaCorrectedData) {
-        free(m_gammaCorrectedData);
-        m_gammaCorrectedData = nullptr;
+    if (m_outputData) {
+        free(m_outputData);
+        m_outputData = nullptr;
     }
 
     disconnect();
@@ -81,7 +141,7 @@ void LedStrip::setEnabled(bool enabled)
 
         if (!m_enabled) {
             disconnect();
-        } if (!m_createdByQml || m_complete) {
+        } else if (!m_createdByQml || m_complete) {
             connect();
         }
 
@@ -144,16 +204,18 @@ void LedStrip::setCount(int count)
     }
 
     if (m_count != count) {
-        if ((!m_createdByQml || m_complete) && m_enabled) {
-            updateData(count);
+        updateData(count);
 
-            m_count = count;
+        m_count = count;
 
-            connect();
-        } else {
-            updateData(count);
-
-            m_count = count;
+        if ((!m_createdByQml || m_complete) && m_enabled) {
+            // An open connection only needs its message buffers resized,
+            // there is no need to reopen the device.
+            if (m_connected) {
+                updateMessage();
+            } else {
+                connect();
+            }
         }
 
         Q_EMIT countChanged();
@@ -171,7 +233,7 @@ void LedStrip::setGammaCorrection(bool gammaCorrection)
         m_gammaCorrection = gammaCorrection;
 
         if ((!m_createdByQml || m_complete)) {
-            updateData(m_count);
+            updateLut();
 
             if (m_enabled) {
                 show();
@@ -214,18 +276,60 @@ void LedStrip::setHsvBrightness(bool hsvBrightness)
     if (m_hsvBrightness != hsvBrightness) {
         m_hsvBrightness = hsvBrightness;
 
-        if ((!m_createdByQml || m_complete)) {
-            updateData(m_count);
-
-            if (m_enabled) {
-                show();
-            }
+        if ((!m_createdByQml || m_complete) && m_enabled) {
+            show();
         }
 
         Q_EMIT hsvBrightnessChanged();
     }
 }
 
+qreal LedStrip::globalBrightness() const
+{
+    return m_globalBrightness;
+}
+
+void LedStrip::setGlobalBrightness(qreal brightness)
+{
+    brightness = std::clamp(brightness, 0.0, 1.0);
+
+    if (m_globalBrightness != brightness) {
+        m_globalBrightness = brightness;
+
+        updateBrightnessLut();
+
+        Q_EMIT globalBrightnessChanged();
+    }
+}
+
+QVector<QPair<int, int>> LedStrip::globalBrightnessExemptRanges() const
+{
+    return m_globalBrightnessExemptRanges;
+}
+
+void LedStrip::setGlobalBrightnessExemptRanges(const QVector<QPair<int, int>> &ranges)
+{
+    QVector<QPair<int, int>> sorted {ranges};
+    std::sort(sorted.begin(), sorted.end());
+
+    // Merged, so the output stage can walk them in a single pass.
+    m_globalBrightnessExemptRanges.clear();
+
+    for (const QPair<int, int> &range : std::as_const(sorted)) {
+        if (range.second < range.first) {
+            continue;
+        }
+
+        if (!m_globalBrightnessExemptRanges.isEmpty()
+            && range.first <= m_globalBrightnessExemptRanges.last().second + 1) {
+            m_globalBrightnessExemptRanges.last().second
+                = std::max(m_globalBrightnessExemptRanges.last().second, range.second);
+        } else {
+            m_globalBrightnessExemptRanges.append(range);
+        }
+    }
+}
+
 bool LedStrip::setLed(int index, const QColor &color, int brightness)
 {
     if (index < 0 || index >= m_count) {
@@ -244,6 +348,8 @@ bool LedStrip::setLed(int index, const QColor &color, int brightness)
     ptr[2] = color.green();
     ptr[3] = color.red();
 
+    ++m_generation;
+
     return true;
 }
 
@@ -272,9 +378,43 @@ bool LedStrip::fill(int first, int last, const QColor &color, int brightness)
         ptr[3] = color.red();
     }
 
+    ++m_generation;
+
     return true;
 }
 
+const uint32_t *LedStrip::constData() const
+{
+    return m_data;
+}
+
+uint32_t *LedStrip::data()
+{
+    ++m_generation;
+
+    return m_data;
+}
+
+bool LedStrip::loadData(const QByteArray &data)
+{
+    if (data.size() != static_cast<qsizetype>(m_count * sizeof(uint32_t))) {
+        qCWarning(HYELICHT_LEDSTRIP) << i18n("loadData: Data does not match the strip length: %1",
+            m_count);
+        return false;
+    }
+
+    memcpy(m_data, data.constData(), data.size());
+
+    ++m_generation;
+
+    return true;
+}
+
+quint64 LedStrip::generation() const
+{
+    return m_generation;
+}
+
 QColor LedStrip::color(int index) const
 {
     if (index < 0 || index >= m_count) {
@@ -354,6 +494,8 @@ bool LedStrip::setColor(int index, const QColor &color)
     ptr[2] = color.green();
     ptr[3] = color.red();
 
+    ++m_generation;
+
     return true;
 }
 
@@ -376,6 +518,8 @@ bool LedStrip::setColor(int first, int last, const QColor &color)
         ptr[3] = color.red();
     }
 
+    ++m_generation;
+
     return true;
 }
 
@@ -532,6 +676,9 @@ bool LedStrip::clear(int first, int last)
 
 bool LedStrip::show()
 {
+    // A direct write makes a pending scheduled one redundant.
+    m_updateTimer.stop();
+
     if (m_createdByQml && !m_complete) {
         return false;
     }
@@ -544,42 +691,14 @@ bool LedStrip::show()
         return false;
     }
 
-    if (m_hsvBrightness) {
-        if (!m_brightnessCorrectedData) {
-            return false;
-        }
-
-        for (int i {0}; i < m_count; i++) {
+    const uint32_t *data {processOutput(m_outputData)};
 
-            uint8_t *ptr {reinterpret_cast<uint8_t *>(&m_data[i])};
-            uint8_t *ptr_corrected {reinterpret_cast<uint8_t *>(&m_brightnessCorrectedData[i])};
-            ptr_corrected[0] = (static_cast<int>(LED_MAX_BRIGHTNESS
-                * QColor(ptr[1], ptr[2], ptr[3]).valueF()) | LED_BRIGHTNESS_HIGH_BITS);
-            ptr_corrected[1] = ptr[1]; // Color data is not affected.
-            ptr_corrected[2] = ptr[2];
-            ptr_corrected[3] = ptr[3];
-        }
+    if (!data) {
+        return false;
     }
 
-    if (m_gammaCorrection) {
-        if (!m_gammaCorrectedData) {
-            return false;
-        }
-
-        for (int i {0}; i < m_count; i++) {
-            uint8_t *ptr {reinterpret_cast<uint8_t *>(m_hsvBrightness ? &m_brightnessCorrectedData[i]
-                : &m_data[i])};
-            uint8_t *ptr_corrected {reinterpret_cast<uint8_t *>(&m_gammaCorrectedData[i])};
-            ptr_corrected[0] = ptr[0]; // No gamma-correction for brightness.
-            ptr_corrected[1] = static_cast<uint8_t>(m_lut[ptr[1]]);
-            ptr_corrected[2] = static_cast<uint8_t>(m_lut[ptr[2]]);
-            ptr_corrected[3] = static_cast<uint8_t>(m_lut[ptr[3]]);
-        }
-    }
+    m_message[1].tx_buf = reinterpret_cast<unsigned long>(data);
 
-    m_message[1].tx_buf = m_gammaCorrection ? reinterpret_cast<unsigned long>(m_gammaCorrectedData)
-        : m_hsvBrightness ? reinterpret_cast<unsigned long>(m_brightnessCorrectedData)
-        : reinterpret_cast<unsigned long>(m_data);
     const int ret {ioctl(m_fd, SPI_IOC_MESSAGE(3), m_message)};
 
     if (ret < 1) {
@@ -591,6 +710,87 @@ bool LedStrip::show()
     return true;
 }
 
+void LedStrip::update()
+{
+    if (!m_updateTimer.isActive()) {
+        m_updateTimer.start();
+    }
+}
+
+bool LedStrip::showAt(qint64 presentationTime)
+{
+    // Like show, this makes a pending scheduled write redundant.
+    m_updateTimer.stop();
+
+    if (m_createdByQml && !m_complete) {
+        return false;
+    }
+
+    if (!m_enabled || !m_connected) {
+        return false;
+    }
+
+    if (!m_frameQueue) {
+        m_frameQueue.reset(new FrameQueue);
+    }
+
+    FrameQueue *queue {m_frameQueue.get()};
+    int index {0};
+
+    if (!queue->freeFrames.pop(index)) {
+        ++queue->dropped;
+        return false;
+    }
+
+    FrameQueue::Slot &slot {queue->frames[index]};
+
+    // Only allocates when the strip grew.
+    slot.data.resize(m_count);
+
+    const uint32_t *data {processOutput(slot.data.data())};
+
+    if (!data) {
+        queue->freeFrames.push(index);
+        return false;
+    }
+
+    // The stored data keeps changing while the frame waits.
+    if (data != slot.data.constData()) {
+        memcpy(slot.data.data(), data, m_count * sizeof(uint32_t));
+    }
+
+    memcpy(slot.message, m_message, sizeof(m_message));
+    slot.message[1].tx_buf = reinterpret_cast<unsigned long>(slot.data.constData());
+    slot.presentationTime = presentationTime;
+
+    queue->pendingFrames.push(index);
+    queue->pendingCount.release();
+
+    if (!queue->thread) {
+        queue->stopping = false;
+        queue->thread.reset(QThread::create([this]() { presentFrames(); }));
+        queue->thread->setObjectName(QStringLiteral("LedOutputThread"));
+        queue->thread->start(QThread::TimeCriticalPriority);
+    }
+
+    return true;
+}
+
+QVector<LedStrip::Layer> LedStrip::layers() const
+{
+    return m_layers;
+}
+
+void LedStrip::setLayers(const QVector<Layer> &layers)
+{
+    m_layers = layers;
+}
+
+bool LedStrip::updatePending() const
+{
+    return m_updateTimer.isActive();
+}
+
 void LedStrip::save()
 {
     if (!m_savedData) {
@@ -652,6 +852,8 @@ bool LedStrip::restore(RestoreOptions options)
     forgetSavedData();
     Q_EMIT canRestoreChanged();
 
+    ++m_generation;
+
     return true;
 }
 
@@ -724,17 +926,6 @@ void LedStrip::connect()
         return;
     }
 
-    uint32_t footerLength {static_cast<uint32_t>((m_count + 15)/16)};
-    m_footer = static_cast<uint8_t *>(malloc(footerLength));
-
-    if (!m_footer) {
-        disconnect();
-        qCCritical(HYELICHT_LEDSTRIP) << i18n("Error allocating memory for message footer.");
-        return;
-    } else {
-        memset(m_footer, 0xFF, footerLength);
-    }
-
     // Zero-initialize.
     memset(&m_message, 0, sizeof(m_message));
 
@@ -745,22 +936,26 @@ void LedStrip::connect()
     m_message[0].bits_per_word = bits;
 
     // Strip data
-    m_message[1].len = m_count * sizeof(uint32_t);
     m_message[1].speed_hz = m_frequency;
     m_message[1].bits_per_word = bits;
 
     // Footer
-    m_message[2].tx_buf = reinterpret_cast<unsigned long>(m_footer);
-    m_message[2].len = footerLength;
     m_message[2].speed_hz = m_frequency;
     m_message[2].bits_per_word = bits;
 
+    if (!updateMessage()) {
+        disconnect();
+        return;
+    }
+
     m_connected = true;
     Q_EMIT connectedChanged();
 }
 
 void LedStrip::disconnect()
 {
+    stopOutputThread();
+
     if (m_fd > -1) {
         close(m_fd);
         m_fd = -1;
@@ -773,7 +968,7 @@ void LedStrip::disconnect()
 
     if (m_footer) {
         free(m_footer);
-        m_header = nullptr;
+        m_footer = nullptr;
     }
 
     if (m_connected) {
@@ -782,73 +977,94 @@ void LedStrip::disconnect()
     }
 }
 
+bool LedStrip::updateMessage()
+{
+    // Queued frames refer to the current message buffers.
+    stopOutputThread();
+
+    // The footer must supply at least one clock edge per two LEDs for
+    // the data to propagate through the entire strip.
+    const uint32_t footerLength {static_cast<uint32_t>((m_count + 15)/16)};
+    uint8_t *footer {static_cast<uint8_t *>(realloc(m_footer, footerLength))};
+
+    if (!footer) {
+        qCCritical(HYELICHT_LEDSTRIP) << i18n("Error allocating memory for message footer.");
+        return false;
+    }
+
+    m_footer = footer;
+    memset(m_footer, 0xFF, footerLength);
+
+    m_message[1].len = m_count * sizeof(uint32_t);
+
+    m_message[2].tx_buf = reinterpret_cast<unsigned long>(m_footer);
+    m_message[2].len = footerLength;
+
+    return true;
+}
+
 void LedStrip::updateData(int count)
 {
-    // Allocate data array.
+    bool capacityChanged {false};
+
+    // Allocate data array. The array grows geometrically and is never
+    // shrunk, so changing the strip length at runtime rarely causes a
+    // reallocation.
     if (!m_data) {
         m_data = static_cast<uint32_t *>(malloc(count * sizeof(uint32_t)));
 
         if (!m_data) {
             qCCritical(HYELICHT_LEDSTRIP) << i18n("Error allocating memory for the strip data.");
         } else {
-            clear(); // Initialize data.
+            m_capacity = count;
+            capacityChanged = true;
+
+            // Initialize data. Calling `clearInternal()` as `m_count`
+            // may not be updated yet and `clear` uses it.
+            clearInternal(m_data, 0, count - 1);
         }
-    } else if (m_count != count) { // Strip length changed.
-        uint32_t *newData {static_cast<uint32_t *>(malloc(count * sizeof(uint32_t)))};
-
-        // Strip length got longer.
-        if (count > m_count) {
-            memcpy(newData, m_data, m_count * sizeof(uint32_t));
-            // Initialize data for the new LEDs at the end.
-            // Calling `clearInternal()` as `m_count` may not be updated
-            // yet and `clear` adds a bounds check against it.
-            clearInternal(newData, m_count, count - 1);
-        } else { // Strip length got shorter.
-            memcpy(newData, m_data, count * sizeof(uint32_t));
+    } else if (count > m_capacity) { // Strip length outgrew the array.
+        const int capacity {std::max(count, m_capacity * 2)};
+        uint32_t *newData {static_cast<uint32_t *>(malloc(capacity * sizeof(uint32_t)))};
+
+        if (!newData) {
+            qCCritical(HYELICHT_LEDSTRIP) << i18n("Error allocating memory for the strip data.");
+            return;
         }
 
+        memcpy(newData, m_data, m_count * sizeof(uint32_t));
+        // Initialize data for the new LEDs at the end.
+        clearInternal(newData, m_count, count - 1);
+
         free(m_data);
         m_data = newData;
-    }
-
-    // Allocate array for gamma-corrected data.
-    // Gamma correction is performed in `show()`, so we don't need to
-    // initialize `clear()` or handle a resize beyond performing a
-    // new allocation.
-    if (m_gammaCorrection) {
-        if (!m_gammaCorrectedData) {
-            m_gammaCorrectedData = static_cast<uint32_t *>(malloc(count * sizeof(uint32_t)));
-
-            if (!m_gammaCorrectedData) {
-                qCCritical(HYELICHT_LEDSTRIP) << i18n("Error allocating memory for the gamma-corrected strip data.");
-            }
-        } else if (m_count != count) { // Strip length changed.
-            free(m_gammaCorrectedData);
-            m_gammaCorrectedData = static_cast<uint32_t *>(malloc(count * sizeof(uint32_t)));
+        m_capacity = capacity;
+        capacityChanged = true;
+    } else if (count > m_count) { // Strip length got longer within capacity.
+        // Initialize data for the new LEDs at the end.
+        clearInternal(m_data, m_count, count - 1);
+    }
+
+    // Allocate array for the output stage.
+    // Output stage processing is performed in `show()`, so we don't need to
+    // initialize `clear()` or handle a resize beyond performing a new
+    // allocation.
+    if (!m_outputData || capacityChanged) {
+        free(m_outputData);
+        m_outputData = static_cast<uint32_t *>(malloc(m_capacity * sizeof(uint32_t)));
+
+        if (!m_outputData) {
+            qCCritical(HYELICHT_LEDSTRIP) << i18n("Error allocating memory for the output strip data.");
         }
-    } else if (m_gammaCorrectedData) { // Gamma correction was disabled.
-        free(m_gammaCorrectedData);
-        m_gammaCorrectedData = nullptr;
     }
+}
 
-    // Allocate array for HSV-based brightness-corrected data.
-    // Brightness correction is performed in `show()`, so we don't need
-    // to initialize `clear()` or handle a resize beyond performing a
-    // new allocation.
-    if (m_hsvBrightness) {
-        if (!m_brightnessCorrectedData) {
-            m_brightnessCorrectedData = static_cast<uint32_t *>(malloc(count * sizeof(uint32_t)));
-
-            if (!m_brightnessCorrectedData) {
-                qCCritical(HYELICHT_LEDSTRIP) << i18n("Error allocating memory for the HSV-based brightness-corrected strip data.");
-            }
-        } else if (m_count != count) { // Strip length changed.
-            free(m_brightnessCorrectedData);
-            m_brightnessCorrectedData = static_cast<uint32_t *>(malloc(count * sizeof(uint32_t)));
-        }
-    } else if (m_brightnessCorrectedData) { // Gamma correction was disabled.
-        free(m_brightnessCorrectedData);
-        m_brightnessCorrectedData = nullptr;
+void LedStrip::updateBrightnessLut()
+{
+    for (int i {0}; i <= LED_MAX_BRIGHTNESS; ++i) {
+        m_brightnessLut[i] = static_cast<uint8_t>(std::rint(i * m_globalBrightness))
+            | LED_BRIGHTNESS_HIGH_BITS;
+        m_exemptBrightnessLut[i] = i | LED_BRIGHTNESS_HIGH_BITS;
     }
 }
 
@@ -866,8 +1082,155 @@ void LedStrip::updateLut()
     }
 }
 
+const uint32_t *LedStrip::processOutput(uint32_t *buffer)
+{
+    const uint32_t *data {m_data};
+
+    // Layers are blended into the output buffer first; the remaining
+    // processing then continues from there in place.
+    if (!m_layers.isEmpty()) {
+        if (!buffer) {
+            return nullptr;
+        }
+
+        composite(buffer);
+        data = buffer;
+    }
+
+    // All output stage processing is done in a single pass over the strip,
+    // leaving the stored LED data untouched. Without any processing to do,
+    // the stored data is written out directly.
+    if (!m_hsvBrightness && !m_gammaCorrection && m_globalBrightness >= 1.0) {
+        return data;
+    }
+
+    if (!buffer) {
+        return nullptr;
+    }
+
+    const uint8_t *lut {reinterpret_cast<const uint8_t *>(m_lut.constData())};
+
+    auto processLeds = [&](int first, int last, const uint8_t *brightnessLut) {
+        for (int i {first}; i <= last; i++) {
+            const uint8_t *ptr {reinterpret_cast<const uint8_t *>(&data[i])};
+            uint8_t *ptr_out {reinterpret_cast<uint8_t *>(&buffer[i])};
+
+            // Equivalent to scaling by the HSV value component of the color.
+            const int brightness {m_hsvBrightness
+                ? (LED_MAX_BRIGHTNESS * std::max({ptr[1], ptr[2], ptr[3]})) / 255
+                : ptr[0] & LED_BRIGHTNESS_MASK};
+
+            ptr_out[0] = brightnessLut[brightness]; // No gamma-correction for brightness.
+
+            if (m_gammaCorrection) {
+                ptr_out[1] = lut[ptr[1]];
+                ptr_out[2] = lut[ptr[2]];
+                ptr_out[3] = lut[ptr[3]];
+            } else {
+                ptr_out[1] = ptr[1];
+                ptr_out[2] = ptr[2];
+                ptr_out[3] = ptr[3];
+            }
+        }
+    };
+
+    // Exempt ranges are sorted and don't overlap; the LEDs between them are
+    // scaled by the global brightness.
+    int next {0};
+
+    for (const QPair<int, int> &range : std::as_const(m_globalBrightnessExemptRanges)) {
+        const int first {std::max(next, range.first)};
+        const int last {std::min(m_count - 1, range.second)};
+
+        if (first > last) {
+            continue;
+        }
+
+        processLeds(next, first - 1, m_brightnessLut);
+        processLeds(first, last, m_exemptBrightnessLut);
+        next = last + 1;
+    }
+
+    processLeds(next, m_count - 1, m_brightnessLut);
+
+    return buffer;
+}
+
+void LedStrip::composite(uint32_t *buffer)
+{
+    memcpy(buffer, m_data, m_count * sizeof(uint32_t));
+
+    uint8_t *out {reinterpret_cast<uint8_t *>(buffer)};
+
+    // Each blend mode gets its own simple integer loop over the LEDs covered
+    // by the layer, which the compiler can vectorize. Opacity is in 1/256ths.
+    for (const Layer &layer : std::as_const(m_layers)) {
+        if (!layer.source || layer.source->count() < m_count || !layer.source->constData()) {
+            continue;
+        }
+
+        const uint8_t *in {reinterpret_cast<const uint8_t *>(layer.source->constData())};
+        const int opacity {static_cast<int>(std::rint(std::clamp(layer.opacity, 0.0, 1.0) * 256))};
+
+        if (!opacity) {
+            continue;
+        }
+
+        for (const QPair<int, int> &range : layer.ranges) {
+            const int first {std::max(0, range.first) * 4};
+            const int last {std::min(m_count - 1, range.second) * 4};
+
+            switch (layer.mode) {
+                case Replace: {
+                    for (int i {first}; i <= last; i += 4) {
+                        for (int c {1}; c < 4; ++c) {
+                            out[i + c] += ((in[i + c] - out[i + c]) * opacity) >> 8;
+                        }
+                    }
+
+                    break;
+                }
+                case Add: {
+                    for (int i {first}; i <= last; i += 4) {
+                        for (int c {1}; c < 4; ++c) {
+                            out[i + c] = std::min(255, out[i + c] + ((in[i + c] * opacity) >> 8));
+                        }
+                    }
+
+                    break;
+                }
+                case Multiply: {
+                    // Fades the multiplier towards white with decreasing opacity.
+                    for (int i {first}; i <= last; i += 4) {
+                        for (int c {1}; c < 4; ++c) {
+                            const int factor {255 - (((255 - in[i + c]) * opacity) >> 8)};
+                            out[i + c] = (out[i + c] * factor + 127) / 255;
+                        }
+                    }
+
+                    break;
+                }
+                case Alpha: {
+                    // The layer's per-LED brightness doubles as its alpha channel.
+                    for (int i {first}; i <= last; i += 4) {
+                        const int alpha {((in[i] & LED_BRIGHTNESS_MASK) * opacity) / LED_MAX_BRIGHTNESS};
+
+                        for (int c {1}; c < 4; ++c) {
+                            out[i + c] += ((in[i + c] - out[i + c]) * alpha) >> 8;
+                        }
+                    }
+
+                    break;
+                }
+            }
+        }
+    }
+}
+
 void LedStrip::clearInternal(uint32_t *data, int first, int last)
 {
+    ++m_generation;
+
     for (int i {first}; i < last + 1; i++) {
         uint8_t *ptr {reinterpret_cast<uint8_t *>(&data[i])};
         ptr[0] = LED_MAX_BRIGHTNESS | LED_BRIGHTNESS_HIGH_BITS;
@@ -876,3 +1239,105 @@ void LedStrip::clearInternal(uint32_t *data, int first, int last)
         ptr[3] = 0;
     }
 }
+
+void LedStrip::presentFrames()
+{
+    FrameQueue *queue {m_frameQueue.get()};
+
+    // How long a transfer takes, so it can start early enough to complete on
+    // time. Averaged, as it varies with bus contention.
+    qint64 transferTime {0};
+
+    qint64 statisticsStart {now()};
+    qint64 errorSum {0};
+    qint64 earliest {0};
+    qint64 latest {0};
+    int frames {0};
+
+    while (!queue->stopping.load(std::memory_order_relaxed)) {
+        if (!queue->pendingCount.tryAcquire(1, pollTimeout)) {
+            continue;
+        }
+
+        int index {0};
+        queue->pendingFrames.pop(index);
+
+        FrameQueue::Slot &slot {queue->frames[index]};
+        const qint64 start {slot.presentationTime - transferTime};
+
+        // Sleep until shortly before it's time, then spin.
+        for (qint64 remaining {start - now()}; remaining > spinTime; remaining = start - now()) {
+            if (queue->stopping.load(std::memory_order_relaxed)) {
+                break;
+            }
+
+            const qint64 sleep {std::min(remaining - spinTime, pollTimeout * qint64(1000000))};
+            const timespec duration {static_cast<time_t>(sleep / 1000000000), static_cast<long>(sleep % 1000000000)};
+            clock_nanosleep(CLOCK_MONOTONIC, 0, &duration, nullptr);
+        }
+
+        if (queue->stopping.load(std::memory_order_relaxed)) {
+            queue->freeFrames.push(index);
+            break;
+        }
+
+        while (now() < start) {
+        }
+
+        const qint64 before {now()};
+        const int ret {ioctl(m_fd, SPI_IOC_MESSAGE(3), slot.message)};
+        const qint64 after {now()};
+
+        const qint64 presentationTime {slot.presentationTime};
+        queue->freeFrames.push(index);
+
+        if (ret < 1) {
+            qCCritical(HYELICHT_LEDSTRIP) << i18n("Error sending SPI message: %1",
+                QString::fromUtf8(strerror(errno)));
+            continue;
+        }
+
+        transferTime = transferTime ? (transferTime * 7 + (after - before)) / 8 : after - before;
+
+        const qint64 error {after - presentationTime};
+        errorSum += std::abs(error);
+        earliest = frames ? std::min(earliest, error) : error;
+        latest = frames ? std::max(latest, error) : error;
+        ++frames;
+
+        Q_EMIT framePresented(presentationTime, static_cast<int>(error / 1000));
+
+        if (after - statisticsStart >= statisticsInterval) {
+            qCDebug(HYELICHT_LEDSTRIP) << i18n("Presented %1 frames %2 µs off target on average, "
+                "from %3 µs to %4 µs; %5 dropped, transfers take %6 µs.", frames, errorSum / frames / 1000,
+                earliest / 1000, latest / 1000, queue->dropped.exchange(0), transferTime / 1000);
+
+            statisticsStart = after;
+            errorSum = 0;
+            frames = 0;
+        }
+    }
+}
+
+void LedStrip::stopOutputThread()
+{
+    if (!m_frameQueue || !m_frameQueue->thread) {
+        return;
+    }
+
+    FrameQueue *queue {m_frameQueue.get()};
+
+    queue->stopping = true;
+    queue->thread->wait();
+    queue->thread.reset();
+
+    // Discard the frames still waiting; with the thread gone, this thread
+    // may take both ends of the queues.
+    int index {0};
+
+    while (queue->pendingFrames.pop(index)) {
+        queue->freeFrames.push(index);
+    }
+
+    queue->pendingCount.tryAcquire(queue->pendingCount.available());
+}
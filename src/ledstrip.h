@@ -5,9 +5,16 @@
 
 #pragma once
 
+#include "hyelicht_core_export.h"
+
 #include <QColor>
 #include <QObject>
+#include <QPair>
 #include <QQmlParserStatus>
+#include <QTimer>
+#include <QVector>
+
+#include <memory>
 
 #include <linux/spi/spidev.h>
 
@@ -34,14 +41,18 @@
  * - Toggle optional gamma correction (property \ref gammaCorrection).
  * - Toggle whether LED brightness should be based on the HSV value component of the color data
  *   (property \ref hsvBrightness).
+ * - Scale the brightness of the entire strip without touching the LED data (property
+ *   \ref globalBrightness), optionally leaving some ranges out (method
+ *   \ref setGlobalBrightnessExemptRanges).
  * - Write current state to the strip (method \ref show) or clear the strip (method \ref clear).
+ * - Queue the current state to be written at a given time (method \ref showAt).
  * - Save and restore strip state (methods \ref save, \ref restore and others).
  *
  * Implements \c QQmlParserStatus for use from QML.
  *
  * \sa QQmlParserStatus
  */
-class LedStrip : public QObject, public QQmlParserStatus
+class HYELICHT_CORE_EXPORT LedStrip : public QObject, public QQmlParserStatus
 {
     Q_OBJECT
     Q_INTERFACES(QQmlParserStatus)
@@ -150,6 +161,25 @@ class LedStrip : public QObject, public QQmlParserStatus
     */
     Q_PROPERTY(bool hsvBrightness READ hsvBrightness WRITE setHsvBrightness NOTIFY hsvBrightnessChanged)
 
+    //! Brightness scale factor for the entire strip.
+    /*!
+    * Applied to the brightness of every LED during \ref show, in the same pass as
+    * \ref hsvBrightness and \ref gammaCorrection. Changing it does not modify the
+    * stored LED data, which makes it suitable for fading the entire strip.
+    *
+    * LEDs in \ref globalBrightnessExemptRanges keep their own brightness.
+    *
+    * Does not call \ref show automatically.
+    *
+    * Set in a range between \c 0.0 and \c 1.0.
+    *
+    * Defaults to \c 1.0.
+    *
+    * \sa setGlobalBrightness
+    * \sa globalBrightnessChanged
+    */
+    Q_PROPERTY(qreal globalBrightness READ globalBrightness WRITE setGlobalBrightness NOTIFY globalBrightnessChanged)
+
     //! Whether there is saved strip state that can be restored by calling \ref restore().
     /*!
     * \sa canRestoreChanged
@@ -168,6 +198,26 @@ class LedStrip : public QObject, public QQmlParserStatus
         Q_DECLARE_FLAGS(RestoreOptions, RestoreOption)
         Q_FLAG(RestoreOptions)
 
+        //! Used to choose how a \ref Layer is combined with the colors below it.
+        enum BlendMode {
+            Replace,  //!< The layer color replaces the color below, mixed in by the layer opacity.
+            Add,      //!< The layer color is added to the color below.
+            Multiply, //!< The color below is multiplied by the layer color.
+            Alpha     //!< Like \c Replace, additionally weighted by the layer's per-LED brightness.
+        };
+        Q_ENUM(BlendMode)
+
+        //! A layer composited on top of the strip data during output.
+        /*!
+        * \sa setLayers
+        */
+        struct Layer {
+            const LedStrip *source; //!< Strip holding the layer data, at least as long as this strip.
+            BlendMode mode; //!< How to combine the layer with the colors below it.
+            qreal opacity; //!< Layer opacity between \c 0.0 and \c 1.0.
+            QVector<QPair<int, int>> ranges; //!< Ranges of LEDs covered by the layer.
+        };
+
         //! Create a strip of default length.
         /*!
         * Creates a strip with a default \ref count of \c 1.
@@ -367,6 +417,45 @@ class LedStrip : public QObject, public QQmlParserStatus
         */
         void setHsvBrightness(bool hsvBrightness);
 
+        //! The brightness scale factor for the entire strip.
+        /*!
+        * @return Scale factor between \c 0.0 and \c 1.0.
+        * \sa globalBrightness (property)
+        * \sa setGlobalBrightness
+        * \sa globalBrightnessChanged
+        */
+        qreal globalBrightness() const;
+
+        //! Set the brightness scale factor for the entire strip.
+        /*!
+        * Takes effect with the next call to \ref show.
+        *
+        * @param brightness Scale factor between \c 0.0 and \c 1.0.
+        * \sa globalBrightness
+        * \sa globalBrightnessChanged
+        */
+        void setGlobalBrightness(qreal brightness);
+
+        //! Ranges of LEDs not scaled by \ref globalBrightness.
+        /*!
+        * @return A sorted list of non-overlapping ranges.
+        * \sa setGlobalBrightnessExemptRanges
+        */
+        QVector<QPair<int, int>> globalBrightnessExemptRanges() const;
+
+        //! Set ranges of LEDs not scaled by \ref globalBrightness.
+        /*!
+        * Lets parts of the strip that are controlled independently keep their
+        * own brightness while the rest is faded or turned off.
+        *
+        * Takes effect with the next call to \ref show.
+        *
+        * @param ranges A list of ranges of LEDs, in any order.
+        * \sa globalBrightnessExemptRanges
+        * \sa globalBrightness
+        */
+        void setGlobalBrightnessExemptRanges(const QVector<QPair<int, int>> &ranges);
+
         //! Changes a specific LED.
         /*!
         * @param index LED to operate on.
@@ -386,6 +475,56 @@ class LedStrip : public QObject, public QQmlParserStatus
         */
         Q_INVOKABLE bool fill(int first, int last, const QColor &color, int brightness = LED_MAX_BRIGHTNESS);
 
+        //! Direct read access to the strip data.
+        /*!
+        * The data holds \ref count LEDs of four bytes each, in the order they are
+        * written to the strip: brightness (the lower five bits, with the upper three
+        * bits set), blue, green and red.
+        *
+        * The pointer is invalidated by changes to \ref count.
+        *
+        * @return Strip data.
+        * \sa generation
+        */
+        const uint32_t *constData() const;
+
+        //! Direct write access to the strip data.
+        /*!
+        * For painting code that fills large parts of the strip at once and can do
+        * without the bounds checks of the individual painting operations. The data
+        * is laid out as described for \ref constData.
+        *
+        * Counts as a change to the color data for the purposes of \ref generation.
+        * The pointer is invalidated by changes to \ref count.
+        *
+        * @return Strip data.
+        * \sa constData
+        */
+        uint32_t *data();
+
+        //! Replace the strip data with a previously captured copy.
+        /*!
+        * Does not call \ref show.
+        *
+        * @param data Strip data in the format returned by \ref constData. Must hold
+        * exactly \ref count LEDs.
+        * @return Success.
+        * \sa constData
+        */
+        bool loadData(const QByteArray &data);
+
+        //! Counter incremented whenever color data in the strip changes.
+        /*!
+        * Allows callers to cache values derived from the color data, e.g.
+        * per-range averages, and to cheaply tell whether they are stale.
+        *
+        * Changes to brightness data do not increment the counter.
+        *
+        * @return Current generation of the color data.
+        * \sa constData
+        */
+        quint64 generation() const;
+
         //! Retrieves the color of a specific LED.
         /*!
         * @param index LED to operate on.
@@ -486,6 +625,73 @@ class LedStrip : public QObject, public QQmlParserStatus
         */
         Q_INVOKABLE bool show();
 
+        //! Schedule writing the latest state to the LED strip.
+        /*!
+        * Calls \ref show once control returns to the event loop. Multiple calls
+        * made before then, e.g. by several animations painting different parts
+        * of the strip, are coalesced into a single write.
+        *
+        * \sa show
+        * \sa updatePending
+        */
+        Q_INVOKABLE void update();
+
+        //! Write the current state to the LED strip at a given time.
+        /*!
+        * Takes a snapshot of the current state, including output stage processing
+        * and layers, and queues it for an output thread, which writes it out so that
+        * the transfer completes as close to \p presentationTime as possible. Frames
+        * are written in the order they were queued; frames already due are written
+        * right away. Painting can continue as soon as this returns.
+        *
+        * The queue holds eight frames. Queuing into a full queue fails, counting the
+        * frame as dropped.
+        *
+        * Producers should queue frames some time ahead, e.g. a frame interval, so the
+        * output thread can absorb their jitter. Each written frame is reported by
+        * \ref framePresented. Mixing this with \ref show or \ref update may
+        * write frames out of order.
+        *
+        * @param presentationTime When the frame should appear, in nanoseconds of the
+        * QDeadlineTimer clock (\c CLOCK_MONOTONIC).
+        * @return Whether the frame was queued.
+        * \sa framePresented
+        * \sa show
+        */
+        Q_INVOKABLE bool showAt(qint64 presentationTime);
+
+        //! The layers composited on top of the strip data during output.
+        /*!
+        * @return A list of layers, bottom to top.
+        * \sa setLayers
+        */
+        QVector<Layer> layers() const;
+
+        //! Set the layers composited on top of the strip data during output.
+        /*!
+        * Layers are blended in order on top of the stored data in \ref show, as part
+        * of the output stage, leaving the stored data untouched. Only colors are
+        * blended; the per-LED brightness of the stored data is kept.
+        *
+        * The source strips must outlive their use as a layer, or be removed by
+        * calling this again before being destroyed.
+        *
+        * @param layers A list of layers, bottom to top.
+        * \sa layers
+        * \sa show
+        */
+        void setLayers(const QVector<Layer> &layers);
+
+        //! Whether \ref update has been called since the last \ref show.
+        /*!
+        * Lets a RenderLoop write out a frame right away instead of waiting for
+        * the event loop.
+        *
+        * @return Update scheduled.
+        * \sa update
+        */
+        bool updatePending() const;
+
         //! Save current strip state for later restoration.
         /*!
         * \sa forgetSavedData
@@ -590,6 +796,13 @@ class LedStrip : public QObject, public QQmlParserStatus
         */
         void hsvBrightnessChanged();
 
+        //! The brightness scale factor for the entire strip has changed.
+        /*!
+        * \sa globalBrightness
+        * \sa setGlobalBrightness
+        */
+        void globalBrightnessChanged() const;
+
         //! Whether there is saved strip data that can be restored has changed.
         /*!
         * \sa canRestore
@@ -599,12 +812,31 @@ class LedStrip : public QObject, public QQmlParserStatus
         */
         void canRestoreChanged();
 
+        //! A frame queued with \ref showAt has been written to the LED strip.
+        /*!
+        * Emitted on the output thread.
+        *
+        * @param presentationTime When the frame should have appeared, as passed to
+        * \ref showAt.
+        * @param error How late the transfer completed in microseconds; negative if
+        * early.
+        * \sa showAt
+        */
+        void framePresented(qint64 presentationTime, int error) const;
+
     private:
+        struct FrameQueue;
         void connect();
         void disconnect();
+        bool updateMessage();
         void updateData(int count);
         void updateLut();
+        void updateBrightnessLut();
         void clearInternal(uint32_t *data, int first, int last);
+        const uint32_t *processOutput(uint32_t *buffer);
+        void composite(uint32_t *buffer);
+        void presentFrames();
+        void stopOutputThread();
 
         bool m_enabled;
 
@@ -618,19 +850,34 @@ class LedStrip : public QObject, public QQmlParserStatus
         bool m_gammaCorrection;
         long double m_gamma;
         QByteArray m_lut;
-        uint32_t *m_gammaCorrectedData;
 
         bool m_hsvBrightness;
-        uint32_t *m_brightnessCorrectedData;
+
+        qreal m_globalBrightness;
+        uint8_t m_brightnessLut[LED_MAX_BRIGHTNESS + 1];
+        uint8_t m_exemptBrightnessLut[LED_MAX_BRIGHTNESS + 1]; // Unscaled.
+        QVector<QPair<int, int>> m_globalBrightnessExemptRanges;
+
+        QVector<Layer> m_layers;
+
+        // Data as written to the strip, after output stage processing.
+        uint32_t *m_outputData;
 
         uint8_t *m_header;
         spi_ioc_transfer m_message[3];
         uint8_t *m_footer;
 
         uint32_t *m_data;
+        int m_capacity;
+        quint64 m_generation;
         uint32_t *m_savedData;
         int m_savedSize;
 
+        QTimer m_updateTimer;
+
+        // Created on first use by showAt.
+        std::unique_ptr<FrameQueue> m_frameQueue;
+
         bool m_createdByQml;
         bool m_complete;
 };
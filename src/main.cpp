@@ -3,7 +3,10 @@
  * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
  */
 
+#include "animations/clipanimation.h"
 #include "animations/fireanimation.h"
+#include "animationlayer.h"
+#include "animationloader.h"
 #include "debug.h"
 #include "displaycontroller.h"
 #include "httpserver.h"
@@ -11,6 +14,8 @@
 #include "remoteshelfmodel.h"
 #include "settings.h"
 #include "shelfmodel.h"
+#include "shelfzone.h"
+#include "statefile.h"
 #include "version.h"
 
 #include <KAboutData>
@@ -19,6 +24,7 @@
 
 #include <QCommandLineOption>
 #include <QCommandLineParser>
+#include <QElapsedTimer>
 #include <QGuiApplication>
 #include <QIcon>
 #include <QQmlApplicationEngine>
@@ -26,6 +32,7 @@
 #include <QQmlEngine>
 #include <QQmlExtensionPlugin>
 #include <QQmlPropertyMap>
+#include <QStandardPaths>
 
 #ifdef Q_OS_ANDROID
 #include <QColor>
@@ -41,11 +48,46 @@
 #define APPEARANCE_LIGHT_NAVIGATION_BARS 0x00000010
 #endif
 
+#ifdef HYELICHT_BUILD_ONBOARD
+// Writes the persisted shelf state to the LEDs before the QML engine and the
+// ShelfModel have been set up, so the first frame after a restart is the
+// correct one.
+static void showLastState(const QString &stateFileName, const QElapsedTimer &startupTimer)
+{
+    StateFile::State state;
+
+    if (!StateFile::read(stateFileName, &state)) {
+        return;
+    }
+
+    LedStrip ledStrip {static_cast<int>(state.frame.size() / sizeof(uint32_t))};
+    ledStrip.setDeviceName(Settings::spiDeviceName());
+    ledStrip.setFrequency(Settings::spiFrequency());
+    ledStrip.setGammaCorrection(Settings::gammaCorrection());
+    ledStrip.setEnabled(true);
+
+    if (!ledStrip.connected() || !ledStrip.loadData(state.frame)) {
+        return;
+    }
+
+    ledStrip.setGlobalBrightness(state.enabled ? state.brightness : 0.0);
+
+    if (ledStrip.show()) {
+        qCInfo(HYELICHT) << i18n("Restored the last shelf state %1 ms after startup.",
+            startupTimer.elapsed());
+    }
+}
+#endif
+
 #ifdef Q_OS_ANDROID
 Q_DECL_EXPORT
 #endif
 int main(int argc, char *argv[])
 {
+    // Measures the time to correct light after a restart.
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+
     QGuiApplication app {argc, argv};
 
     KLocalizedString::setApplicationDomain("hyelicht");
@@ -148,8 +190,22 @@ int main(int argc, char *argv[])
     options->insert(QStringLiteral("httpApi"), parser.isSet(headlessOption) ? false : Settings::remotingApi());
     options->insert(QStringLiteral("httpListenAddress"), parser.value(httpListenAddressOption));
     options->insert(QStringLiteral("httpPort"), parser.value(httpPortOption));
+
+    const QString stateFileName {Settings::persistState()
+        ? QStandardPaths::writableLocation(QStandardPaths::StateLocation) + QStringLiteral("/shelf.state")
+        : QString()};
+    options->insert(QStringLiteral("stateFileName"), stateFileName);
+
+    if (parser.isSet(onboardOption) && !parser.isSet(simulateShelfOption) && !stateFileName.isEmpty()) {
+        showLastState(stateFileName, startupTimer);
+    }
+
+    options->insert(QStringLiteral("sceneFileName"),
+        QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/scenes"));
 #else
     options->insert(QStringLiteral("onboard"), false);
+    options->insert(QStringLiteral("stateFileName"), QString());
+    options->insert(QStringLiteral("sceneFileName"), QString());
 #endif
     qmlRegisterSingletonInstance(HYELICHT_DOMAIN_NAME, 1, 0, "Startup", options.get());
 
@@ -160,10 +216,14 @@ int main(int argc, char *argv[])
     qmlRegisterType<LedStrip>(HYELICHT_DOMAIN_NAME, 1, 0, "LedStrip");
     qmlRegisterType<RemoteShelfModel>(HYELICHT_DOMAIN_NAME, 1, 0, "RemoteShelfModel");
     qmlRegisterType<ShelfModel>(HYELICHT_DOMAIN_NAME, 1, 0, "ShelfModel");
+    qmlRegisterType<ShelfZone>(HYELICHT_DOMAIN_NAME, 1, 0, "ShelfZone");
 
     const char *animationsDomain = QStringLiteral("%1.animations")
         .arg(QStringLiteral(HYELICHT_DOMAIN_NAME)).toUtf8().constData();
     qmlRegisterUncreatableType<AbstractAnimation>(animationsDomain, 1, 0, "AbstractAnimation", QStringLiteral(""));
+    qmlRegisterType<AnimationLayer>("com.hyerimandeike.hyelicht.animations", 1, 0, "AnimationLayer");
+    qmlRegisterType<AnimationLoader>("com.hyerimandeike.hyelicht.animations", 1, 0, "AnimationLoader");
+    qmlRegisterType<ClipAnimation>("com.hyerimandeike.hyelicht.animations", 1, 0, "ClipAnimation");
     qmlRegisterType<FireAnimation>("com.hyerimandeike.hyelicht.animations", 1, 0, "FireAnimation");
 
     QQmlApplicationEngine engine {&app};
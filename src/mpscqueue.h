@@ -0,0 +1,108 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+//! Lock-free queue handing values from any number of threads to one
+/*!
+ * \ingroup Backend
+ *
+ * A bounded ring buffer for several producers and a single consumer. Neither
+ * side ever blocks: \ref push fails while the queue is full, and \ref pop while
+ * it is empty. Producers claim a slot by advancing a shared index with a
+ * compare-and-swap, then publish the value through the slot's sequence
+ * number, which also tells the consumer the slot is ready. Values come out in
+ * the order their slots were claimed.
+ *
+ * A producer interrupted between claiming and publishing its slot holds up
+ * \ref pop until it resumes, while other producers carry on.
+ *
+ * \tparam T A copyable value type.
+ * \tparam Capacity Number of slots, a power of two.
+ *
+ * \sa SpscQueue
+ */
+template<typename T, std::size_t Capacity>
+class MpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+        "MpscQueue needs a power of two number of slots.");
+
+    public:
+        MpscQueue()
+        {
+            for (std::size_t i {0}; i < Capacity; ++i) {
+                m_slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        //! Append a value.
+        /*!
+        * Safe to call from any thread.
+        *
+        * @param value The value.
+        * @return Whether there was room for the value.
+        */
+        bool push(const T &value)
+        {
+            std::size_t head {m_head.load(std::memory_order_relaxed)};
+
+            for (;;) {
+                Slot &slot {m_slots[head % Capacity]};
+                const std::size_t sequence {slot.sequence.load(std::memory_order_acquire)};
+
+                if (sequence == head) {
+                    // Free; claim it unless another producer was faster.
+                    if (m_head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed)) {
+                        slot.value = value;
+                        slot.sequence.store(head + 1, std::memory_order_release);
+
+                        return true;
+                    }
+                } else if (sequence < head) {
+                    // Still holds a value from the previous lap.
+                    return false;
+                } else {
+                    head = m_head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        //! Take the oldest value.
+        /*!
+        * Only to be called by the consumer.
+        *
+        * @param value Receives the value.
+        * @return Whether there was a value.
+        */
+        bool pop(T &value)
+        {
+            Slot &slot {m_slots[m_tail % Capacity]};
+
+            if (slot.sequence.load(std::memory_order_acquire) != m_tail + 1) {
+                return false;
+            }
+
+            value = std::move(slot.value);
+            slot.sequence.store(m_tail + Capacity, std::memory_order_release);
+            ++m_tail;
+
+            return true;
+        }
+
+    private:
+        struct alignas(64) Slot {
+            std::atomic<std::size_t> sequence; // Lap and state of the slot.
+            T value;
+        };
+
+        alignas(64) std::atomic<std::size_t> m_head {0}; // Claimed by producers.
+        alignas(64) std::size_t m_tail {0}; // Only used by the consumer.
+        Slot m_slots[Capacity];
+};
@@ -253,6 +253,42 @@ void RemoteShelfModel::setTransitionDuration(int duration)
     m_remoteModelIface->setTransitionDuration(duration);
 }
 
+QStringList RemoteShelfModel::scenes() const
+{
+    if (!m_remoteModelIface || !m_remoteModelIface->isInitialized()) {
+        return {};
+    }
+
+    return m_remoteModelIface->scenes();
+}
+
+void RemoteShelfModel::saveScene(const QString &name)
+{
+    if (!m_remoteModelIface || !m_remoteModelIface->isInitialized()) {
+        return;
+    }
+
+    m_remoteModelIface->saveScene(name);
+}
+
+void RemoteShelfModel::recallScene(const QString &name, bool animate)
+{
+    if (!m_remoteModelIface || !m_remoteModelIface->isInitialized()) {
+        return;
+    }
+
+    m_remoteModelIface->recallScene(name, animate);
+}
+
+void RemoteShelfModel::removeScene(const QString &name)
+{
+    if (!m_remoteModelIface || !m_remoteModelIface->isInitialized()) {
+        return;
+    }
+
+    m_remoteModelIface->removeScene(name);
+}
+
 void RemoteShelfModel::classBegin()
 {
     m_createdByQml = true;
@@ -300,6 +336,8 @@ void RemoteShelfModel::updateSource()
         Q_EMIT transitionDurationChanged();
 
         Q_EMIT animatingChanged();
+
+        Q_EMIT scenesChanged();
     }
 
     if (!m_serverAddress.isValid()) {
@@ -376,6 +414,9 @@ void RemoteShelfModel::updateSource()
 
                 QObject::connect(m_remoteModelIface, SIGNAL(animatingChanged(bool)),
                     this, SIGNAL(animatingChanged()));
+
+                QObject::connect(m_remoteModelIface, SIGNAL(scenesChanged(QStringList)),
+                    this, SIGNAL(scenesChanged()));
             }
         );
     }
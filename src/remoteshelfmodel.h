@@ -5,8 +5,11 @@
 
 #pragma once
 
+#include "hyelicht_core_export.h"
+
 #include <QIdentityProxyModel>
 #include <QQmlParserStatus>
+#include <QStringList>
 #include <QUrl>
 
 class RemoteShelfModelIfaceReplica;
@@ -34,7 +37,7 @@ class QRemoteObjectNode;
  * \sa QAbstractListModel
  * \sa QQmlParserStatus
  */
-class RemoteShelfModel : public QIdentityProxyModel, public QQmlParserStatus
+class HYELICHT_CORE_EXPORT RemoteShelfModel : public QIdentityProxyModel, public QQmlParserStatus
 {
     Q_OBJECT
     Q_INTERFACES(QQmlParserStatus)
@@ -87,6 +90,9 @@ class RemoteShelfModel : public QIdentityProxyModel, public QQmlParserStatus
     //! \sa ShelfModel::animating
     Q_PROPERTY(bool animating READ animating WRITE setAnimating NOTIFY animatingChanged)
 
+    //! \sa ShelfModel::scenes
+    Q_PROPERTY(QStringList scenes READ scenes NOTIFY scenesChanged)
+
     public:
         //! Create a remote client to a ShelfModel.
         /*!
@@ -173,6 +179,15 @@ class RemoteShelfModel : public QIdentityProxyModel, public QQmlParserStatus
         //! \sa ShelfModel::setAnimating
         void setAnimating(bool animating);
 
+        //! \sa ShelfModel::scenes
+        QStringList scenes() const;
+        //! \sa ShelfModel::saveScene
+        Q_INVOKABLE void saveScene(const QString &name);
+        //! \sa ShelfModel::recallScene
+        Q_INVOKABLE void recallScene(const QString &name, bool animate = false);
+        //! \sa ShelfModel::removeScene
+        Q_INVOKABLE void removeScene(const QString &name);
+
         //! Implements the \c QQmlParserStatus interface.
         void classBegin() override;
         //! Implements the \c QQmlParserStatus interface.
@@ -225,6 +240,9 @@ class RemoteShelfModel : public QIdentityProxyModel, public QQmlParserStatus
         //! \sa ShelfModel::animatingChanged
         void animatingChanged() const;
 
+        //! \sa ShelfModel::scenesChanged
+        void scenesChanged() const;
+
     private:
         void updateSource();
 
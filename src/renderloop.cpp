@@ -0,0 +1,762 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "renderloop.h"
+#include "abstractanimation.h"
+#include "debug_animations.h"
+#include "framebuffer.h"
+#include "ledstrip.h"
+
+#include <KLocalizedString>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const qint64 statisticsInterval {10000}; // Milliseconds.
+
+const int maximumChange {255}; // Largest change of an LED byte.
+const int minimumAdaptiveFrameRate {10};
+const int adaptationWindow {8}; // Ticks.
+
+}
+
+struct RenderLoop::RenderTarget
+{
+    // Valid until removed; AbstractAnimation stops before it is destroyed.
+    AbstractAnimation *animation;
+
+    // Held by the render thread while rendering the target, and by the GUI
+    // thread to mark it removed.
+    QMutex busy;
+    bool removed;
+
+    // Only used on the render thread, or through the animation's render
+    // state updates.
+    LedStrip canvas;
+    bool hasLedStrip;
+
+    FrameBuffer frames;
+    QMetaObject::Connection ledStripConnection;
+};
+
+RenderLoop::RenderLoop(QObject *parent)
+    : QObject(parent)
+    , m_lastFrame {0}
+    , m_frameTime {0}
+    , m_jitter {0}
+    , m_guiTime {0}
+    , m_droppedFrames {0}
+    , m_loggedDroppedFrames {0}
+    , m_frameRate {60}
+    , m_adaptive {false}
+    , m_effectiveFrameRate {60}
+    , m_adaptation {60, 0, 0}
+    , m_threadAdaptation {60, 0, 0}
+    , m_threaded {false}
+    , m_threadTimer {new QTimer}
+    , m_threadLastFrame {0}
+    , m_threadActive {false}
+    , m_presentPending {false}
+    , m_frameRequested {false}
+    , m_targetsGeneration {0}
+{
+    m_clock.start();
+    m_statisticsClock.start();
+
+    m_timer.setTimerType(Qt::PreciseTimer);
+    m_timer.setInterval(1000 / m_frameRate);
+    QObject::connect(&m_timer, &QTimer::timeout, this, &RenderLoop::tick);
+
+    m_thread.setObjectName(QStringLiteral("RenderThread"));
+
+    m_threadTimer->setTimerType(Qt::PreciseTimer);
+    m_threadTimer->setInterval(1000 / m_frameRate);
+    m_threadTimer->moveToThread(&m_thread);
+    QObject::connect(m_threadTimer, &QTimer::timeout, m_threadTimer,
+        [=]() { renderThreaded(); });
+}
+
+RenderLoop::~RenderLoop()
+{
+    m_thread.quit();
+    m_thread.wait();
+
+    delete m_threadTimer;
+
+    for (const QPointer<AbstractAnimation> &animation : std::as_const(m_animations)) {
+        if (animation) {
+            removeTarget(animation);
+        }
+    }
+
+    // The render thread is gone, so nothing uses these anymore.
+    for (const RetiredTarget &retired : std::as_const(m_retiredTargets)) {
+        delete retired.target;
+    }
+
+    // Hand transitions back to Qt's animation timer.
+    for (const QPointer<QVariantAnimation> &transition : std::as_const(m_runningTransitions)) {
+        if (transition && transition->state() == QAbstractAnimation::Paused) {
+            transition->resume();
+        }
+    }
+}
+
+int RenderLoop::frameRate() const
+{
+    return m_frameRate;
+}
+
+void RenderLoop::setFrameRate(int frameRate)
+{
+    if (frameRate < 1 || frameRate > 240) {
+        qCWarning(HYELICHT_ANIMATIONS) << i18n("setFrameRate: %1 frames per second requested, but must be "
+            "between 1 and 240. Clamping.", frameRate);
+        frameRate = std::clamp(frameRate, 1, 240);
+    }
+
+    if (m_frameRate != frameRate) {
+        m_frameRate = frameRate;
+
+        m_adaptation = {frameRate, 0, 0};
+        m_effectiveFrameRate = frameRate;
+        m_timer.setInterval(1000 / frameRate);
+
+        QMetaObject::invokeMethod(m_threadTimer, [=]() {
+            m_threadAdaptation = {frameRate, 0, 0};
+            m_threadTimer->setInterval(1000 / frameRate);
+        });
+
+        Q_EMIT frameRateChanged();
+    }
+}
+
+LedStrip *RenderLoop::ledStrip() const
+{
+    return m_ledStrip;
+}
+
+void RenderLoop::setLedStrip(LedStrip *ledStrip)
+{
+    if (m_ledStrip != ledStrip) {
+        m_ledStrip = ledStrip;
+
+        Q_EMIT ledStripChanged();
+    }
+}
+
+bool RenderLoop::threaded() const
+{
+    return m_threaded;
+}
+
+void RenderLoop::setThreaded(bool threaded)
+{
+    if (m_threaded == threaded) {
+        return;
+    }
+
+    if (threaded && !m_thread.isRunning()) {
+        m_thread.start();
+    }
+
+    // Move running animations over.
+    for (const QPointer<AbstractAnimation> &animation : std::as_const(m_animations)) {
+        if (animation) {
+            if (threaded) {
+                addTarget(animation);
+            } else {
+                removeTarget(animation);
+            }
+        }
+    }
+
+    m_threaded = threaded;
+
+    updateTimer();
+
+    Q_EMIT threadedChanged();
+}
+
+bool RenderLoop::adaptiveFrameRate() const
+{
+    return m_adaptive;
+}
+
+void RenderLoop::setAdaptiveFrameRate(bool adaptive)
+{
+    if (m_adaptive != adaptive) {
+        m_adaptive = adaptive;
+
+        Q_EMIT adaptiveFrameRateChanged();
+    }
+}
+
+int RenderLoop::effectiveFrameRate() const
+{
+    return m_effectiveFrameRate.load(std::memory_order_relaxed);
+}
+
+bool RenderLoop::running() const
+{
+    return m_timer.isActive() || m_threadActive;
+}
+
+qint64 RenderLoop::frameTime() const
+{
+    return m_frameTime.load(std::memory_order_relaxed);
+}
+
+qint64 RenderLoop::jitter() const
+{
+    return m_jitter.load(std::memory_order_relaxed);
+}
+
+qint64 RenderLoop::guiTime() const
+{
+    return m_guiTime;
+}
+
+qint64 RenderLoop::droppedFrames() const
+{
+    return m_droppedFrames.load(std::memory_order_relaxed);
+}
+
+void RenderLoop::addAnimation(AbstractAnimation *animation)
+{
+    if (!animation || m_animations.contains(animation)) {
+        return;
+    }
+
+    m_animations.append(animation);
+
+    if (m_threaded) {
+        addTarget(animation);
+    }
+
+    updateTimer();
+}
+
+void RenderLoop::removeAnimation(AbstractAnimation *animation)
+{
+    m_animations.removeAll(animation);
+
+    if (m_threaded) {
+        removeTarget(animation);
+    }
+
+    updateTimer();
+}
+
+void RenderLoop::addTransition(QVariantAnimation *transition)
+{
+    if (!transition || m_transitions.contains(transition)) {
+        return;
+    }
+
+    m_transitions.append(transition);
+
+    QObject::connect(transition, &QAbstractAnimation::stateChanged, this,
+        [=](QAbstractAnimation::State newState, QAbstractAnimation::State oldState) {
+            Q_UNUSED(oldState)
+
+            if (newState == QAbstractAnimation::Running) {
+                // Take over from Qt's animation timer; `tick` advances the
+                // transition from here on.
+                transition->pause();
+
+                if (!m_runningTransitions.contains(transition)) {
+                    m_runningTransitions.append(transition);
+                }
+            } else if (newState == QAbstractAnimation::Stopped) {
+                m_runningTransitions.removeAll(transition);
+            }
+
+            updateTimer();
+        }
+    );
+
+    // Take over a transition that is already running.
+    if (transition->state() == QAbstractAnimation::Running) {
+        transition->pause();
+        m_runningTransitions.append(transition);
+
+        updateTimer();
+    }
+}
+
+void RenderLoop::removeTransition(QVariantAnimation *transition)
+{
+    if (!transition || !m_transitions.contains(transition)) {
+        return;
+    }
+
+    transition->disconnect(this);
+
+    m_transitions.removeAll(transition);
+
+    if (m_runningTransitions.removeAll(transition)) {
+        transition->resume();
+    }
+
+    updateTimer();
+}
+
+void RenderLoop::requestFrame()
+{
+    // While ticking, the next tick picks the request up and this call
+    // returns early.
+    if (!m_frameRequested.exchange(true)) {
+        QMetaObject::invokeMethod(this, &RenderLoop::serviceFrameRequest, Qt::QueuedConnection);
+    }
+}
+
+void RenderLoop::serviceFrameRequest()
+{
+    if (m_timer.isActive() || !m_frameRequested.exchange(false)) {
+        return;
+    }
+
+    Q_EMIT frameRequested();
+
+    if (m_ledStrip && m_ledStrip->updatePending()) {
+        m_ledStrip->show();
+    }
+}
+
+void RenderLoop::tick()
+{
+    const qint64 start {m_clock.nsecsElapsed()};
+    int dropped {0};
+    const int delta {advance(m_lastFrame, m_timer.interval(), !m_threaded, &dropped)};
+
+    // State changes go first, so the frame reflects them.
+    if (m_frameRequested.exchange(false)) {
+        Q_EMIT frameRequested();
+    }
+
+    // Animations and transitions may start or stop each other while
+    // rendering, so iterate over copies.
+    const QVector<QPointer<AbstractAnimation>> animations {m_threaded
+        ? QVector<QPointer<AbstractAnimation>>() : m_animations};
+
+    int change {0};
+
+    for (const QPointer<AbstractAnimation> &animation : animations) {
+        if (animation && animation->running()) {
+            animation->m_framePresented = false;
+
+            const qint64 before {m_clock.nsecsElapsed()};
+            animation->renderFrame(animation->nextFrame(delta, dropped));
+
+            if (animation) {
+                animation->updateFrameTime((m_clock.nsecsElapsed() - before) / 1000);
+
+                if (m_adaptive && animation->m_framePresented) {
+                    change = std::max(change, animation->measureChange());
+                }
+            }
+        }
+    }
+
+    const QVector<QPointer<QVariantAnimation>> transitions {m_runningTransitions};
+
+    for (const QPointer<QVariantAnimation> &transition : transitions) {
+        if (transition && transition->state() == QAbstractAnimation::Paused) {
+            transition->setCurrentTime(transition->currentTime() + delta);
+        }
+    }
+
+    // Write out everything painted during this frame at once.
+    if (m_ledStrip && m_ledStrip->updatePending()) {
+        m_ledStrip->show();
+    }
+
+    const qint64 frameTime {(m_clock.nsecsElapsed() - start) / 1000};
+    m_guiTime = m_guiTime ? (m_guiTime * 15 + frameTime) / 16 : frameTime;
+
+    if (!m_threaded) {
+        m_frameTime.store(m_guiTime, std::memory_order_relaxed);
+        logStatistics();
+    }
+
+    // Transitions aren't measured, so they always run at the full rate.
+    const int interval {m_threaded ? 1000 / m_frameRate
+        : adapt(m_adaptation, m_runningTransitions.isEmpty() ? change : maximumChange)};
+
+    if (m_timer.interval() != interval) {
+        m_timer.setInterval(interval);
+    }
+
+    updateTimer();
+}
+
+void RenderLoop::renderThreaded()
+{
+    // Runs on the render thread.
+    const qint64 start {m_clock.nsecsElapsed()};
+    int dropped {0};
+    const int delta {advance(m_threadLastFrame, m_threadTimer->interval(), true, &dropped)};
+
+    bool presented {false};
+    int change {0};
+
+    {
+        // Only held for taking a copy, which drops the one of the previous
+        // frame; targets removed since then can be deleted.
+        QMutexLocker locker(&m_targetsMutex);
+        m_frameTargets = m_targets;
+        ++m_targetsGeneration;
+    }
+
+    for (RenderTarget *target : std::as_const(m_frameTargets)) {
+        QMutexLocker locker(&target->busy);
+
+        if (target->removed) {
+            continue;
+        }
+
+        AbstractAnimation *animation {target->animation};
+
+        // State changes made on the GUI thread since the previous frame.
+        animation->applyUpdates();
+
+        if (!target->hasLedStrip) {
+            continue;
+        }
+
+        animation->m_framePresented = false;
+
+        const qint64 before {m_clock.nsecsElapsed()};
+        animation->renderFrame(animation->nextFrame(delta, dropped));
+        animation->updateFrameTime((m_clock.nsecsElapsed() - before) / 1000);
+
+        if (animation->m_framePresented) {
+            if (m_adaptive.load(std::memory_order_relaxed)) {
+                change = std::max(change, animation->measureChange());
+            }
+
+            const int count {target->canvas.count()};
+
+            memcpy(target->frames.beginWrite(count), target->canvas.constData(),
+                count * sizeof(uint32_t));
+            target->frames.publish();
+
+            presented = true;
+        }
+    }
+
+    const qint64 frameTime {(m_clock.nsecsElapsed() - start) / 1000};
+    const qint64 average {m_frameTime.load(std::memory_order_relaxed)};
+    m_frameTime.store(average ? (average * 15 + frameTime) / 16 : frameTime,
+        std::memory_order_relaxed);
+
+    // Frames rendered before the GUI thread gets around to presenting are
+    // picked up by the pending call, dropping the older ones.
+    if (presented && !m_presentPending.exchange(true)) {
+        QMetaObject::invokeMethod(this, &RenderLoop::present, Qt::QueuedConnection);
+    }
+
+    const int interval {adapt(m_threadAdaptation, change)};
+
+    if (m_threadTimer->interval() != interval) {
+        m_threadTimer->setInterval(interval);
+    }
+}
+
+void RenderLoop::present()
+{
+    m_presentPending = false;
+
+    if (!m_threaded) {
+        return;
+    }
+
+    const qint64 start {m_clock.nsecsElapsed()};
+
+    // Handlers may start or stop animations, so notify them after all
+    // frames have been copied.
+    QVector<QPointer<AbstractAnimation>> presented;
+
+    // Only modified on this thread, so reading doesn't need the lock.
+    for (RenderTarget *target : std::as_const(m_targets)) {
+        if (!target->frames.acquire()) {
+            continue;
+        }
+
+        AbstractAnimation *animation {target->animation};
+        LedStrip *ledStrip {animation->ledStrip()};
+        const QVector<uint32_t> &frame {target->frames.frame()};
+
+        if (!ledStrip) {
+            continue;
+        }
+
+        if (frame.size() != ledStrip->count()) {
+            syncCanvas(target);
+            continue;
+        }
+
+        uint32_t *data {ledStrip->data()};
+
+        // The region may have changed since the frame was rendered; the
+        // current one decides what reaches the strip.
+        for (const QPair<int, int> &range : AbstractAnimation::paintRanges(animation->m_guiRegion,
+            ledStrip->count())) {
+            memcpy(data + range.first, frame.constData() + range.first,
+                (range.second - range.first + 1) * sizeof(uint32_t));
+        }
+
+        ledStrip->update();
+        presented.append(animation);
+    }
+
+    for (const QPointer<AbstractAnimation> &animation : std::as_const(presented)) {
+        if (animation) {
+            Q_EMIT animation->frameComplete();
+        }
+    }
+
+    if (m_ledStrip && m_ledStrip->updatePending()) {
+        m_ledStrip->show();
+    }
+
+    deleteRetiredTargets();
+
+    const qint64 guiTime {(m_clock.nsecsElapsed() - start) / 1000};
+    m_guiTime = m_guiTime ? (m_guiTime * 15 + guiTime) / 16 : guiTime;
+
+    logStatistics();
+}
+
+int RenderLoop::advance(qint64 &lastFrame, int interval, bool measure, int *dropped)
+{
+    const qint64 now {m_clock.nsecsElapsed()};
+    const int delta {static_cast<int>(now / 1000000 - lastFrame / 1000000)};
+
+    // A tick that comes late, e.g. because the thread was busy, replaces
+    // the frames that would have been due in the meantime.
+    *dropped = interval > 0 ? std::max(0, (delta + interval / 2) / interval - 1) : 0;
+
+    if (measure) {
+        m_droppedFrames.fetch_add(*dropped, std::memory_order_relaxed);
+
+        const qint64 deviation {std::abs((now - lastFrame) / 1000 - interval * 1000)};
+        const qint64 average {m_jitter.load(std::memory_order_relaxed)};
+        m_jitter.store(average ? (average * 15 + deviation) / 16 : deviation,
+            std::memory_order_relaxed);
+    }
+
+    lastFrame = now;
+
+    return delta;
+}
+
+int RenderLoop::adapt(Adaptation &adaptation, int change)
+{
+    const int frameRate {m_frameRate.load(std::memory_order_relaxed)};
+
+    // A change of more than a single step would show as stutter at a lowered
+    // rate, so motion gets the full rate right away.
+    if (!m_adaptive.load(std::memory_order_relaxed) || change > 1) {
+        adaptation = {frameRate, 0, 0};
+    } else {
+        ++adaptation.ticks;
+
+        if (!change) {
+            ++adaptation.quietTicks;
+        }
+
+        // When most frames don't change visibly, every other one can be left
+        // out while each remaining frame still changes by a single step at most.
+        if (adaptation.ticks == adaptationWindow) {
+            if (adaptation.quietTicks > adaptationWindow / 2) {
+                adaptation.frameRate = std::max(std::min(minimumAdaptiveFrameRate, frameRate),
+                    adaptation.frameRate / 2);
+            }
+
+            adaptation.ticks = 0;
+            adaptation.quietTicks = 0;
+        }
+    }
+
+    m_effectiveFrameRate.store(adaptation.frameRate, std::memory_order_relaxed);
+
+    return 1000 / adaptation.frameRate;
+}
+
+void RenderLoop::logStatistics()
+{
+    if (m_statisticsClock.elapsed() < statisticsInterval) {
+        return;
+    }
+
+    m_statisticsClock.restart();
+
+    const qint64 droppedFrames {this->droppedFrames()};
+
+    qCDebug(HYELICHT_ANIMATIONS) << i18n("Rendering %1 at %6 frames per second: %2 µs per frame "
+        "with %3 µs jitter, %4 µs per frame on the GUI thread, %5 frames dropped.",
+        m_threaded ? i18n("on the render thread") : i18n("on the GUI thread"),
+        frameTime(), jitter(), guiTime(), droppedFrames - m_loggedDroppedFrames,
+        effectiveFrameRate());
+
+    m_loggedDroppedFrames = droppedFrames;
+}
+
+void RenderLoop::addTarget(AbstractAnimation *animation)
+{
+    RenderTarget *target {new RenderTarget};
+    target->animation = animation;
+    target->removed = false;
+    target->hasLedStrip = false;
+
+    syncCanvas(target);
+
+    target->ledStripConnection = QObject::connect(animation, &AbstractAnimation::ledStripChanged,
+        this, [=]() { syncCanvas(target); });
+
+    // Not rendered on the render thread yet, so nothing to wait for.
+    animation->m_canvas = &target->canvas;
+    animation->setQueueUpdates(true);
+
+    QMutexLocker locker(&m_targetsMutex);
+    m_targets.append(target);
+}
+
+void RenderLoop::removeTarget(AbstractAnimation *animation)
+{
+    const auto it {std::find_if(m_targets.cbegin(), m_targets.cend(),
+        [=](RenderTarget *target) { return target->animation == animation; })};
+
+    if (it == m_targets.cend()) {
+        return;
+    }
+
+    RenderTarget *target {*it};
+
+    {
+        QMutexLocker locker(&m_targetsMutex);
+        m_targets.removeOne(target);
+
+        // The render thread may still hold a copy of the list that
+        // includes the target.
+        m_retiredTargets.append(RetiredTarget {target, m_targetsGeneration});
+    }
+
+    {
+        // Only waits if the render thread is in the middle of rendering this
+        // animation, which may be destroyed once this returns.
+        QMutexLocker locker(&target->busy);
+        target->removed = true;
+    }
+
+    QObject::disconnect(target->ledStripConnection);
+
+    animation->m_canvas = nullptr;
+    animation->setQueueUpdates(false);
+
+    deleteRetiredTargets();
+}
+
+void RenderLoop::deleteRetiredTargets()
+{
+    QMutexLocker locker(&m_targetsMutex);
+
+    // Retired before the render thread took its current copy of the list.
+    m_retiredTargets.removeIf([=](const RetiredTarget &retired) {
+        if (retired.generation < m_targetsGeneration) {
+            delete retired.target;
+            return true;
+        }
+
+        return false;
+    });
+}
+
+void RenderLoop::syncCanvas(RenderTarget *target)
+{
+    LedStrip *ledStrip {target->animation->ledStrip()};
+
+    // Start out from what the strip shows, for animations that don't
+    // repaint everything on every frame.
+    QVector<uint32_t> frame;
+
+    if (ledStrip) {
+        frame.resize(ledStrip->count());
+        memcpy(frame.data(), ledStrip->constData(), ledStrip->count() * sizeof(uint32_t));
+    }
+
+    target->animation->updateRenderState([target, hasLedStrip = ledStrip != nullptr, frame]() {
+        target->hasLedStrip = hasLedStrip;
+
+        if (hasLedStrip) {
+            target->canvas.setCount(frame.size());
+            memcpy(target->canvas.data(), frame.constData(), frame.size() * sizeof(uint32_t));
+        }
+    });
+}
+
+void RenderLoop::updateTimer()
+{
+    m_animations.removeIf([](const QPointer<AbstractAnimation> &animation) {
+        return animation.isNull();
+    });
+
+    const auto isNull = [](const QPointer<QVariantAnimation> &transition) {
+        return transition.isNull();
+    };
+
+    m_transitions.removeIf(isNull);
+    m_runningTransitions.removeIf(isNull);
+
+    const bool animate {!m_animations.isEmpty()};
+
+    if (!m_runningTransitions.isEmpty() || (animate && !m_threaded)) {
+        if (!m_timer.isActive()) {
+            m_adaptation = {m_frameRate, 0, 0};
+            m_lastFrame = m_clock.nsecsElapsed();
+            m_timer.start(1000 / m_frameRate);
+        }
+    } else if (m_timer.isActive()) {
+        m_timer.stop();
+
+        // Left for a tick that won't come anymore.
+        if (m_frameRequested.load()) {
+            QMetaObject::invokeMethod(this, &RenderLoop::serviceFrameRequest, Qt::QueuedConnection);
+        }
+    }
+
+    const bool threadActive {animate && m_threaded};
+
+    if (m_threadActive != threadActive) {
+        m_threadActive = threadActive;
+
+        if (m_threadActive) {
+            QMetaObject::invokeMethod(m_threadTimer, [=]() {
+                m_threadAdaptation = {m_frameRate, 0, 0};
+                m_threadLastFrame = m_clock.nsecsElapsed();
+                m_threadTimer->start(1000 / m_frameRate);
+            });
+        } else {
+            QMetaObject::invokeMethod(m_threadTimer, [=]() {
+                m_threadTimer->stop();
+
+                // Let go of the targets of the last frame, so removed ones
+                // can be deleted while idle.
+                {
+                    QMutexLocker locker(&m_targetsMutex);
+                    m_frameTargets.clear();
+                    ++m_targetsGeneration;
+                }
+
+                QMetaObject::invokeMethod(this, &RenderLoop::deleteRetiredTargets, Qt::QueuedConnection);
+            });
+        }
+    }
+}
@@ -0,0 +1,396 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "hyelicht_core_export.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QThread>
+#include <QTimer>
+#include <QVariantAnimation>
+#include <QVector>
+
+#include <atomic>
+
+class AbstractAnimation;
+class LedStrip;
+
+//! Fixed-rate render loop driving animations and transitions
+/*!
+ * \ingroup Animation
+ *
+ * Ticks at \ref frameRate while there is anything to render. On each tick it:
+ *
+ * 0. Emits \ref frameRequested if a frame was asked for with \ref requestFrame,
+ *    so pending state changes are applied together at the start of the frame.
+ * 1. Calls AbstractAnimation::renderFrame on every running animation with the
+ *    time elapsed since the previous frame and the frame index.
+ * 2. Advances every running transition registered with \ref addTransition by the
+ *    same amount of time.
+ * 3. Writes the frame out to \ref ledStrip with a single LedStrip::show call, if
+ *    any of the above requested one using LedStrip::update.
+ *
+ * This keeps animation frames, brightness and color transitions and SPI output
+ * aligned, and makes frame pacing measurable (see \ref frameTime).
+ *
+ * When a tick comes late because the loop can't keep up, the frames that were
+ * due in the meantime are dropped and counted (see \ref droppedFrames). The next
+ * frame covers their time, so animations keep running at the right speed and
+ * only lose smoothness.
+ *
+ * The loop stops ticking while no animation or transition is running.
+ *
+ * When \ref threaded is enabled, animations are instead rendered on a separate
+ * render thread at \ref frameRate, each into a private canvas (see
+ * AbstractAnimation::canvas). Completed frames are handed to the GUI thread
+ * through a lock-free FrameBuffer per animation, and a single queued notification
+ * per batch of frames has the GUI thread copy them into the animations' \ref
+ * ledStrip and write them out. Transitions are still advanced on the GUI thread.
+ * This keeps heavy animations from making the GUI laggy and vice versa. Changes
+ * to animations made on the GUI thread are queued and applied on the render
+ * thread before the next frame (see AbstractAnimation::updateRenderState), so
+ * the GUI thread doesn't wait for frames in progress either.
+ *
+ * \ref jitter and \ref guiTime allow comparing both modes.
+ *
+ * With \ref adaptiveFrameRate, the loop measures the largest change of any LED
+ * byte between consecutive frames of each animation, i.e. the visible change in
+ * quantization steps. While most frames don't change visibly, e.g. for slowly
+ * drifting ambient effects, it halves the rate animations are rendered at, down
+ * to a minimum of \c 10 frames per second or \ref frameRate, whichever is lower.
+ * As soon as a frame changes by more than a single step, it returns to \ref
+ * frameRate. Running transitions are always advanced at \ref frameRate. The rate
+ * in effect is reported by \ref effectiveFrameRate.
+ *
+ * \sa AbstractAnimation
+ * \sa ShelfModel
+ */
+class HYELICHT_CORE_EXPORT RenderLoop : public QObject
+{
+    Q_OBJECT
+
+    //! Number of frames rendered per second.
+    /*!
+    * Defaults to \c 60.
+    *
+    * \sa setFrameRate
+    * \sa frameRateChanged
+    */
+    Q_PROPERTY(int frameRate READ frameRate WRITE setFrameRate NOTIFY frameRateChanged)
+
+    //! LedStrip to write frames out to.
+    /*!
+    * Defaults to \c nullptr.
+    *
+    * \sa setLedStrip
+    * \sa ledStripChanged
+    */
+    Q_PROPERTY(LedStrip* ledStrip READ ledStrip WRITE setLedStrip NOTIFY ledStripChanged)
+
+    //! Whether animations are rendered on a separate render thread.
+    /*!
+    * Defaults to \c false.
+    *
+    * \sa setThreaded
+    * \sa threadedChanged
+    */
+    Q_PROPERTY(bool threaded READ threaded WRITE setThreaded NOTIFY threadedChanged)
+
+    //! Whether to lower the frame rate while animations don't change visibly.
+    /*!
+    * Defaults to \c false.
+    *
+    * \sa setAdaptiveFrameRate
+    * \sa adaptiveFrameRateChanged
+    * \sa effectiveFrameRate
+    */
+    Q_PROPERTY(bool adaptiveFrameRate READ adaptiveFrameRate WRITE setAdaptiveFrameRate NOTIFY adaptiveFrameRateChanged)
+
+    public:
+        //! Create a render loop.
+        /*!
+        * @param parent Parent object
+        */
+        explicit RenderLoop(QObject *parent = nullptr);
+        ~RenderLoop() override;
+
+        //! The number of frames rendered per second.
+        /*!
+        * @return Frames per second.
+        * \sa frameRate (property)
+        * \sa setFrameRate
+        * \sa frameRateChanged
+        */
+        int frameRate() const;
+
+        //! Set the number of frames rendered per second.
+        /*!
+        * Clamped to a range of \c 1 to \c 240.
+        *
+        * @param frameRate Frames per second.
+        * \sa frameRate
+        * \sa frameRateChanged
+        */
+        void setFrameRate(int frameRate);
+
+        //! The LedStrip frames are written out to.
+        /*!
+        * @return A LedStrip.
+        * \sa ledStrip (property)
+        * \sa setLedStrip
+        * \sa ledStripChanged
+        */
+        LedStrip *ledStrip() const;
+
+        //! Set the LedStrip to write frames out to.
+        /*!
+        * @param ledStrip A LedStrip.
+        * \sa ledStrip
+        * \sa ledStripChanged
+        */
+        void setLedStrip(LedStrip *ledStrip);
+
+        //! Whether animations are rendered on a separate render thread.
+        /*!
+        * @return Render thread on or off.
+        * \sa threaded (property)
+        * \sa setThreaded
+        * \sa threadedChanged
+        */
+        bool threaded() const;
+
+        //! Set whether animations are rendered on a separate render thread.
+        /*!
+        * Animations that are already running move between threads.
+        *
+        * @param threaded Render thread on or off.
+        * \sa threaded
+        * \sa threadedChanged
+        */
+        void setThreaded(bool threaded);
+
+        //! Whether to lower the frame rate while animations don't change visibly.
+        /*!
+        * @return Adaptive frame rate on or off.
+        * \sa adaptiveFrameRate (property)
+        * \sa setAdaptiveFrameRate
+        * \sa adaptiveFrameRateChanged
+        */
+        bool adaptiveFrameRate() const;
+
+        //! Set whether to lower the frame rate while animations don't change visibly.
+        /*!
+        * @param adaptive Adaptive frame rate on or off.
+        * \sa adaptiveFrameRate
+        * \sa adaptiveFrameRateChanged
+        */
+        void setAdaptiveFrameRate(bool adaptive);
+
+        //! The number of frames per second animations are currently rendered at.
+        /*!
+        * Equals \ref frameRate unless \ref adaptiveFrameRate lowered it.
+        *
+        * @return Frames per second.
+        */
+        int effectiveFrameRate() const;
+
+        //! Whether the loop is currently ticking.
+        /*!
+        * @return Loop running or idle.
+        */
+        bool running() const;
+
+        //! Average time spent rendering a frame.
+        /*!
+        * Covers the animations, transitions and writing out the frame, smoothed over
+        * recent frames. When \ref threaded, covers only the animations.
+        *
+        * @return Duration in microseconds.
+        */
+        qint64 frameTime() const;
+
+        //! Average deviation of the time between animation frames from the frame interval.
+        /*!
+        * Smoothed over recent frames.
+        *
+        * @return Duration in microseconds.
+        * \sa frameRate
+        */
+        qint64 jitter() const;
+
+        //! Average time the GUI thread spends on a frame.
+        /*!
+        * Time the GUI thread can't respond to input or paint the user interface.
+        * Equals \ref frameTime unless \ref threaded. Smoothed over recent frames.
+        *
+        * @return Duration in microseconds.
+        */
+        qint64 guiTime() const;
+
+        //! The number of animation frames dropped because the loop couldn't keep up.
+        /*!
+        * @return Frame count since the loop was created.
+        * \sa AbstractAnimation::Frame::dropped
+        */
+        qint64 droppedFrames() const;
+
+        //! Render frames of an animation.
+        /*!
+        * Called by AbstractAnimation::start.
+        *
+        * @param animation An animation.
+        * \sa removeAnimation
+        */
+        void addAnimation(AbstractAnimation *animation);
+
+        //! Stop rendering frames of an animation.
+        /*!
+        * Called by AbstractAnimation::stop.
+        *
+        * @param animation An animation.
+        * \sa addAnimation
+        */
+        void removeAnimation(AbstractAnimation *animation);
+
+        //! Drive a transition from the loop.
+        /*!
+        * Once registered, the transition is paused by the loop whenever it is
+        * started and advanced on every tick instead, until it finishes or is
+        * stopped. Code observing the transition should treat \c QAbstractAnimation::Paused
+        * like \c QAbstractAnimation::Running.
+        *
+        * @param transition A transition.
+        * \sa removeTransition
+        */
+        void addTransition(QVariantAnimation *transition);
+
+        //! Stop driving a transition from the loop.
+        /*!
+        * @param transition A transition.
+        * \sa addTransition
+        */
+        void removeTransition(QVariantAnimation *transition);
+
+        //! Ask for a frame, e.g. to apply queued state changes.
+        /*!
+        * Safe to call from any thread. \ref frameRequested is emitted on the
+        * GUI thread at the start of the next frame, or right away while the
+        * loop is idle. Requests made before that are merged into one.
+        *
+        * \sa frameRequested
+        */
+        void requestFrame();
+
+    Q_SIGNALS:
+        //! The number of frames rendered per second has changed.
+        /*!
+        * \sa frameRate
+        * \sa setFrameRate
+        */
+        void frameRateChanged() const;
+
+        //! The LedStrip frames are written out to has changed.
+        /*!
+        * \sa ledStrip
+        * \sa setLedStrip
+        */
+        void ledStripChanged() const;
+
+        //! Whether animations are rendered on a separate render thread has changed.
+        /*!
+        * \sa threaded
+        * \sa setThreaded
+        */
+        void threadedChanged() const;
+
+        //! Whether to lower the frame rate while animations don't change visibly has changed.
+        /*!
+        * \sa adaptiveFrameRate
+        * \sa setAdaptiveFrameRate
+        */
+        void adaptiveFrameRateChanged() const;
+
+        //! A frame asked for with \ref requestFrame is about to be rendered.
+        /*!
+        * Changes made to the LedStrip in response are written out with the
+        * frame.
+        *
+        * \sa requestFrame
+        */
+        void frameRequested() const;
+
+    private:
+        struct RenderTarget;
+
+        // A removed target, deleted once the render thread took a copy of the
+        // target list without it.
+        struct RetiredTarget {
+            RenderTarget *target;
+            quint64 generation;
+        };
+
+        // Frame rate adaptation state of the thread rendering animations.
+        struct Adaptation {
+            int frameRate;
+            int ticks;
+            int quietTicks;
+        };
+
+        void tick();
+        void serviceFrameRequest();
+        void renderThreaded();
+        void present();
+        void updateTimer();
+        int advance(qint64 &lastFrame, int interval, bool measure, int *dropped);
+        int adapt(Adaptation &adaptation, int change);
+        void logStatistics();
+
+        void addTarget(AbstractAnimation *animation);
+        void removeTarget(AbstractAnimation *animation);
+        void deleteRetiredTargets();
+        void syncCanvas(RenderTarget *target);
+
+        QTimer m_timer;
+        QElapsedTimer m_clock;
+        qint64 m_lastFrame;
+        std::atomic<qint64> m_frameTime;
+        std::atomic<qint64> m_jitter;
+        qint64 m_guiTime;
+        std::atomic<qint64> m_droppedFrames;
+        qint64 m_loggedDroppedFrames;
+        QElapsedTimer m_statisticsClock;
+
+        std::atomic<int> m_frameRate;
+        QPointer<LedStrip> m_ledStrip;
+
+        std::atomic<bool> m_adaptive;
+        std::atomic<int> m_effectiveFrameRate;
+        Adaptation m_adaptation;
+        Adaptation m_threadAdaptation; // Only used on the render thread.
+
+        bool m_threaded;
+        QThread m_thread;
+        QTimer *m_threadTimer; // Lives on the render thread.
+        qint64 m_threadLastFrame; // Only used on the render thread.
+        bool m_threadActive;
+        std::atomic<bool> m_presentPending;
+        std::atomic<bool> m_frameRequested;
+
+        // Modified on the GUI thread while holding the mutex; the render thread
+        // holds it only to take a copy at the start of each frame.
+        QMutex m_targetsMutex;
+        QVector<RenderTarget *> m_targets;
+        QVector<RenderTarget *> m_frameTargets; // Only used on the render thread.
+        quint64 m_targetsGeneration; // Copies taken by the render thread.
+        QVector<RetiredTarget> m_retiredTargets;
+
+        QVector<QPointer<AbstractAnimation>> m_animations;
+        QVector<QPointer<QVariantAnimation>> m_transitions;
+        QVector<QPointer<QVariantAnimation>> m_runningTransitions;
+};
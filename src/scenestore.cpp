@@ -0,0 +1,285 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "scenestore.h"
+#include "debug.h"
+
+#include <KLocalizedString>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const char sceneMagic[4] {'H', 'Y', 'S', 'C'};
+const quint32 sceneVersion {1};
+
+struct SceneHeader {
+    char magic[4];
+    quint32 version;
+    quint32 checksum; // Over everything following this field.
+    quint32 count; // Number of scenes.
+};
+
+static_assert(sizeof(SceneHeader) == 16, "Unexpected scene file header size");
+
+// Followed by the UTF-8 name padded to four bytes, then the LED data.
+struct SceneRecord {
+    quint16 nameSize;
+    quint16 reserved;
+    float brightness;
+    quint32 count; // Number of LEDs.
+};
+
+static_assert(sizeof(SceneRecord) == 12, "Unexpected scene record size");
+
+const qint64 checksumOffset {offsetof(SceneHeader, count)};
+
+inline qint64 padded(qint64 size)
+{
+    return (size + 3) & ~qint64(3);
+}
+
+quint32 checksum(const char *data, qint64 size)
+{
+    return qChecksum(QByteArrayView(data + checksumOffset, size - checksumOffset));
+}
+
+}
+
+SceneStore::SceneStore(const QString &fileName)
+{
+    setFileName(fileName);
+}
+
+SceneStore::~SceneStore()
+{
+}
+
+QString SceneStore::fileName() const
+{
+    return m_fileName;
+}
+
+bool SceneStore::setFileName(const QString &fileName)
+{
+    if (m_fileName == fileName) {
+        return true;
+    }
+
+    m_fileName = fileName;
+    m_scenes.clear();
+
+    return load();
+}
+
+QStringList SceneStore::names() const
+{
+    QStringList names;
+    names.reserve(m_scenes.size());
+
+    for (const Scene &scene : m_scenes) {
+        names.append(scene.name);
+    }
+
+    return names;
+}
+
+const SceneStore::Scene *SceneStore::scene(const QString &name) const
+{
+    for (const Scene &scene : m_scenes) {
+        if (scene.name == name) {
+            return &scene;
+        }
+    }
+
+    return nullptr;
+}
+
+bool SceneStore::insert(const Scene &scene)
+{
+    if (scene.name.isEmpty() || scene.frame.isEmpty()
+        || scene.name.toUtf8().size() > std::numeric_limits<quint16>::max()) {
+        return false;
+    }
+
+    const QVector<Scene> previous {m_scenes};
+
+    auto it {std::find_if(m_scenes.begin(), m_scenes.end(),
+        [&](const Scene &other) { return other.name == scene.name; })};
+
+    if (it != m_scenes.end()) {
+        *it = scene;
+    } else {
+        m_scenes.append(scene);
+    }
+
+    // Keep memory in line with the file.
+    if (!save()) {
+        m_scenes = previous;
+        return false;
+    }
+
+    return true;
+}
+
+bool SceneStore::remove(const QString &name)
+{
+    const QVector<Scene> previous {m_scenes};
+
+    auto it {std::find_if(m_scenes.begin(), m_scenes.end(),
+        [&](const Scene &scene) { return scene.name == name; })};
+
+    if (it == m_scenes.end()) {
+        return false;
+    }
+
+    m_scenes.erase(it);
+
+    // Keep memory in line with the file.
+    if (!save()) {
+        m_scenes = previous;
+        return false;
+    }
+
+    return true;
+}
+
+bool SceneStore::load()
+{
+    if (m_fileName.isEmpty()) {
+        return true;
+    }
+
+    QFile file {m_fileName};
+
+    if (!file.exists()) {
+        return true;
+    }
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(HYELICHT) << i18n("Unable to open the scene file: %1", file.errorString());
+        return false;
+    }
+
+    const QByteArray data {file.readAll()};
+    const qint64 size {data.size()};
+
+    const auto invalid = [&]() {
+        qCWarning(HYELICHT) << i18n("Ignoring invalid scene file: %1", m_fileName);
+        m_scenes.clear();
+        return false;
+    };
+
+    if (size < static_cast<qint64>(sizeof(SceneHeader))) {
+        return invalid();
+    }
+
+    const SceneHeader *header {reinterpret_cast<const SceneHeader *>(data.constData())};
+
+    if (memcmp(header->magic, sceneMagic, sizeof(sceneMagic)) != 0
+        || header->version != sceneVersion
+        || header->checksum != checksum(data.constData(), size)) {
+        return invalid();
+    }
+
+    qint64 offset {sizeof(SceneHeader)};
+
+    for (quint32 i {0}; i < header->count; ++i) {
+        if (offset + static_cast<qint64>(sizeof(SceneRecord)) > size) {
+            return invalid();
+        }
+
+        SceneRecord record;
+        memcpy(&record, data.constData() + offset, sizeof(SceneRecord));
+        offset += sizeof(SceneRecord);
+
+        const qint64 frameSize {record.count * static_cast<qint64>(sizeof(uint32_t))};
+
+        if (!record.nameSize || !record.count || offset + padded(record.nameSize) + frameSize > size) {
+            return invalid();
+        }
+
+        Scene scene;
+        scene.name = QString::fromUtf8(data.constData() + offset, record.nameSize);
+        scene.brightness = std::clamp(static_cast<qreal>(record.brightness), 0.0, 1.0);
+        offset += padded(record.nameSize);
+
+        // A copy of its own, so recalling never touches the file.
+        scene.frame = QByteArray(data.constData() + offset, frameSize);
+        offset += frameSize;
+
+        m_scenes.append(scene);
+    }
+
+    if (offset != size) {
+        return invalid();
+    }
+
+    return true;
+}
+
+bool SceneStore::save() const
+{
+    if (m_fileName.isEmpty()) {
+        return true;
+    }
+
+    qint64 size {sizeof(SceneHeader)};
+
+    for (const Scene &scene : m_scenes) {
+        size += sizeof(SceneRecord) + padded(scene.name.toUtf8().size()) + scene.frame.size();
+    }
+
+    QByteArray data(size, '\0');
+
+    SceneHeader *header {reinterpret_cast<SceneHeader *>(data.data())};
+    memcpy(header->magic, sceneMagic, sizeof(sceneMagic));
+    header->version = sceneVersion;
+    header->count = m_scenes.size();
+
+    qint64 offset {sizeof(SceneHeader)};
+
+    for (const Scene &scene : m_scenes) {
+        const QByteArray name {scene.name.toUtf8()};
+
+        SceneRecord record;
+        record.nameSize = name.size();
+        record.reserved = 0;
+        record.brightness = scene.brightness;
+        record.count = scene.frame.size() / sizeof(uint32_t);
+
+        memcpy(data.data() + offset, &record, sizeof(SceneRecord));
+        offset += sizeof(SceneRecord);
+
+        memcpy(data.data() + offset, name.constData(), name.size());
+        offset += padded(name.size());
+
+        memcpy(data.data() + offset, scene.frame.constData(), scene.frame.size());
+        offset += scene.frame.size();
+    }
+
+    header->checksum = checksum(data.constData(), size);
+
+    QDir().mkpath(QFileInfo(m_fileName).absolutePath());
+
+    // Written to a temporary file first, so a crash never leaves a truncated
+    // file behind.
+    QSaveFile file {m_fileName};
+
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != size || !file.commit()) {
+        qCWarning(HYELICHT) << i18n("Unable to write the scene file: %1", file.errorString());
+        return false;
+    }
+
+    return true;
+}
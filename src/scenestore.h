@@ -0,0 +1,95 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+//! Named scenes kept as ready-to-output LED data in a binary file
+/*!
+ * \ingroup Backend
+ *
+ * A scene is a complete frame of LED data as returned by LedStrip::constData,
+ * along with the shelf brightness to show it at. Recalling a scene is a single
+ * copy into the strip, so it takes effect with the next frame no matter how
+ * many compartments it paints.
+ *
+ * All scenes are loaded into memory when the file is set, and the file is
+ * rewritten atomically whenever a scene is stored or removed. It consists of a
+ * fixed-size header followed by one record per scene, each holding the name,
+ * brightness and LED data.
+ *
+ * \sa ShelfModel::sceneFileName
+ */
+class SceneStore
+{
+    public:
+        //! A stored scene.
+        struct Scene {
+            QString name; //!< Name used to recall the scene.
+            qreal brightness {1.0}; //!< The shelf brightness level.
+            QByteArray frame; //!< LED data, four bytes per LED.
+        };
+
+        //! Create a scene store.
+        /*!
+        * @param fileName Path to the scene file.
+        */
+        explicit SceneStore(const QString &fileName = QString());
+        ~SceneStore();
+
+        //! Path to the scene file.
+        QString fileName() const;
+
+        //! Set the path to the scene file and load the scenes stored in it.
+        /*!
+        * A missing file makes for an empty store.
+        *
+        * @param fileName Path to the scene file, or an empty string to keep
+        * scenes in memory only.
+        * @return \c false if the file exists but is invalid.
+        */
+        bool setFileName(const QString &fileName);
+
+        //! The names of the stored scenes, in the order they were first stored.
+        QStringList names() const;
+
+        //! Look up a scene.
+        /*!
+        * The pointer is invalidated by \ref insert and \ref remove.
+        *
+        * @param name Name of the scene.
+        * @return The scene, or \c nullptr if there is none by this name.
+        */
+        const Scene *scene(const QString &name) const;
+
+        //! Store a scene, replacing one of the same name.
+        /*!
+        * Nothing changes if the file cannot be written.
+        *
+        * @param scene Scene to store. The name must not be empty.
+        * @return Whether the scene was stored and written to the file.
+        */
+        bool insert(const Scene &scene);
+
+        //! Remove a scene.
+        /*!
+        * Nothing changes if the file cannot be written.
+        *
+        * @param name Name of the scene.
+        * @return Whether a scene was removed and the file written.
+        */
+        bool remove(const QString &name);
+
+    private:
+        bool load();
+        bool save() const;
+
+        QString m_fileName;
+        QVector<Scene> m_scenes;
+};
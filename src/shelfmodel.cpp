@@ -14,7 +14,19 @@
 #include <QMetaEnum>
 #include <QRemoteObjectHost>
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+
+namespace {
+
+// LED data holds the global brightness bits followed by blue, green and red.
+inline QRgb ledRgb(const uint8_t *led)
+{
+    return qRgb(led[3], led[2], led[1]);
+}
+
+}
 
 ShelfModel::ShelfModel(QObject *parent)
     : QAbstractListModel(parent)
@@ -24,20 +36,82 @@ ShelfModel::ShelfModel(QObject *parent)
     , m_columns {5}
     , m_density {20}
     , m_wallThickness {1}
+    , m_squareCount {m_rows * m_columns}
+    , m_updatingGeometry {false}
+    , m_squareColorsValid {false}
+    , m_squareColorsGeneration {0}
+    , m_squareColorSums {0, 0, 0}
+    , m_dirtyFirst {-1}
+    , m_dirtyLast {-1}
+    , m_hasZones {false}
     , m_brightness {1.0}
+    , m_appliedBrightness {0.0}
+    , m_targetBrightness {0.0}
     , m_animateBrightnessTransitions {true}
     , m_pendingBrightnessTransition {false}
+    , m_fromLightness {0.0}
+    , m_toLightness {0.0}
     , m_averageColor {QStringLiteral("white")}
     , m_animateAverageColorTransitions {true}
     , m_transitionDuration {400}
+    , m_transitionEasing {EasingTable::forType(QEasingCurve::Linear)}
     , m_animating {false}
     , m_remotingEnabled {true}
     , m_listenAddress {QStringLiteral("tcp://0.0.0.0:8042")}
     , m_remotingServer {nullptr}
+    , m_timelinePosition {-1}
+    , m_applyingTimeline {false}
+    , m_applyingCommands {false}
     , m_createdByQml {false}
     , m_complete {false}
 {
+    updateSquareRanges();
+
+    // Coalesces the view updates for frames painted by several zones.
+    m_squaresChangedTimer.setSingleShot(true);
+    m_squaresChangedTimer.setInterval(0);
+
+    QObject::connect(&m_squaresChangedTimer, &QTimer::timeout, this,
+        [=]() {
+            emitSquaresChanged();
+            Q_EMIT averageColorChanged(averageColor());
+        }
+    );
+
+    // Coalesces the changes of a frame into one snapshot.
+    m_snapshotTimer.setSingleShot(true);
+    m_snapshotTimer.setInterval(0);
+
+    QObject::connect(&m_snapshotTimer, &QTimer::timeout, this, &ShelfModel::publishSnapshot);
+
+    QObject::connect(this, &QAbstractItemModel::dataChanged, this, &ShelfModel::scheduleSnapshot);
+    QObject::connect(this, &QAbstractItemModel::modelReset, this, &ShelfModel::scheduleSnapshot);
+    QObject::connect(this, &ShelfModel::enabledChanged, this, &ShelfModel::scheduleSnapshot);
+    QObject::connect(this, &ShelfModel::brightnessChanged, this, &ShelfModel::scheduleSnapshot);
+    QObject::connect(this, &ShelfModel::averageColorChanged, this, &ShelfModel::scheduleSnapshot);
+    QObject::connect(this, &ShelfModel::animatingChanged, this, &ShelfModel::scheduleSnapshot);
+
+    // Persisting the state is throttled rather than done on every change,
+    // e.g. while animating or during transitions.
+    m_stateWriteTimer.setSingleShot(true);
+    m_stateWriteTimer.setInterval(1000);
+
+    QObject::connect(&m_stateWriteTimer, &QTimer::timeout, this, &ShelfModel::writeState);
+
+    QObject::connect(this, &ShelfModel::enabledChanged, this, &ShelfModel::scheduleStateWrite);
+    QObject::connect(this, &ShelfModel::brightnessChanged, this, &ShelfModel::scheduleStateWrite);
+    QObject::connect(this, &ShelfModel::averageColorChanged, this, &ShelfModel::scheduleStateWrite);
+    QObject::connect(this, &ShelfModel::animatingChanged, this, &ShelfModel::scheduleStateWrite);
+
+    // Transitions advance in step with animation frames.
+    m_renderLoop.addTransition(&m_brightnessTransition);
+    m_renderLoop.addTransition(&m_averageColorTransition);
+
+    // Transitions run from 0.0 to 1.0; the values in between are looked up
+    // in `syncBrightness` and below rather than interpolated as QVariant.
     m_brightnessTransition.setDuration(m_transitionDuration);
+    m_brightnessTransition.setStartValue(0.0);
+    m_brightnessTransition.setEndValue(1.0);
 
     QObject::connect(&m_brightnessTransition, &QVariantAnimation::valueChanged, this,
         [=](const QVariant &value) {
@@ -45,13 +119,18 @@ ShelfModel::ShelfModel(QObject *parent)
 
             // Ignore `valueChanged` emissions stemming from calls to
             // `setStartValue`/`setEndValue`.
-            if (m_brightnessTransition.state() != QAbstractAnimation::Running) {
+            if (m_brightnessTransition.state() == QAbstractAnimation::Stopped) {
                 return;
             }
 
-            syncBrightness();
+            // Written out by the render loop.
+            syncBrightness(false /* show */);
 
-            Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0));
+            if (m_ledStrip) {
+                m_ledStrip->update();
+            }
+
+            Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0), {AverageBrightness});
         }
     );
 
@@ -67,12 +146,14 @@ ShelfModel::ShelfModel(QObject *parent)
     );
 
     m_averageColorTransition.setDuration(m_transitionDuration);
+    m_averageColorTransition.setStartValue(0.0);
+    m_averageColorTransition.setEndValue(1.0);
 
     QObject::connect(&m_averageColorTransition, &QVariantAnimation::valueChanged, this,
-        [=](const QVariant &value) {
+        [=]() {
             // Ignore `valueChanged` emissions stemming from calls to
             // `setStartValue`/`setEndValue`.
-            if (m_averageColorTransition.state() != QAbstractAnimation::Running) {
+            if (m_averageColorTransition.state() == QAbstractAnimation::Stopped) {
                 return;
             }
 
@@ -80,16 +161,102 @@ ShelfModel::ShelfModel(QObject *parent)
                 return;
             }
 
-            setRangesToColor(value.value<QColor>());
-            m_ledStrip->show();
+            const ColorSpace::Oklab &color {ColorSpace::mix(m_fromColor, m_toColor,
+                transitionProgress(m_averageColorTransition))};
 
-            Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0));
+            setRangesToColor(QColor {ColorSpace::fromOklab(color)});
+            m_ledStrip->update();
+
+            emitSquaresChanged();
+        }
+    );
+
+    m_renderLoop.addTransition(&m_sceneTransition);
+
+    m_sceneTransition.setDuration(m_transitionDuration);
+    m_sceneTransition.setStartValue(0.0);
+    m_sceneTransition.setEndValue(1.0);
+
+    QObject::connect(&m_sceneTransition, &QVariantAnimation::valueChanged, this,
+        [=]() {
+            if (m_sceneTransition.state() == QAbstractAnimation::Stopped || !m_ledStrip) {
+                return;
+            }
+
+            paintScene(transitionProgress(m_sceneTransition));
+            m_ledStrip->update();
+
+            emitSquaresChanged();
+        }
+    );
+
+    QObject::connect(&m_sceneTransition, &QVariantAnimation::finished, this,
+        [=]() {
+            m_sceneFrom.clear();
+            m_sceneFromColors.clear();
+            m_sceneToColors.clear();
+        }
+    );
+
+    // Queued state changes are applied at the start of a frame.
+    QObject::connect(&m_renderLoop, &RenderLoop::frameRequested, this, &ShelfModel::applyCommands);
+
+    // Only the clock of the timeline; the values are looked up by time.
+    m_renderLoop.addTransition(&m_timelineClock);
+
+    m_timelineClock.setStartValue(0.0);
+    m_timelineClock.setEndValue(1.0);
+
+    // Values change on every frame while playing, which is more often than
+    // anyone needs to hear about it.
+    m_timelineNotifyTimer.setSingleShot(true);
+    m_timelineNotifyTimer.setInterval(100);
+
+    QObject::connect(&m_timelineNotifyTimer, &QTimer::timeout, this,
+        [=]() {
+            Q_EMIT brightnessChanged(m_brightness);
+            Q_EMIT averageColorChanged(averageColor());
+        }
+    );
+
+    QObject::connect(&m_timelineClock, &QVariantAnimation::valueChanged, this,
+        [=]() {
+            if (m_timelineClock.state() != QAbstractAnimation::Stopped) {
+                applyTimeline(m_timelineClock.currentTime());
+            }
+        }
+    );
+
+    QObject::connect(&m_timelineClock, &QVariantAnimation::stateChanged, this,
+        [=](const QAbstractAnimation::State newState, const QAbstractAnimation::State oldState) {
+            if (newState == QAbstractAnimation::Stopped) {
+                m_timelinePosition = -1;
+                m_timelineNotifyTimer.stop();
+
+                Q_EMIT brightnessChanged(m_brightness);
+                Q_EMIT averageColorChanged(averageColor());
+                Q_EMIT timelineRunningChanged(false);
+            } else if (oldState == QAbstractAnimation::Stopped) {
+                Q_EMIT timelineRunningChanged(true);
+            }
         }
     );
+
+    // Readers always find a snapshot.
+    publishSnapshot();
 }
 
 ShelfModel::~ShelfModel()
 {
+    // Don't lose the last change on shutdown.
+    if (m_stateWriteTimer.isActive()) {
+        writeState();
+    }
+
+    // The layer buffers may go away before the strip does.
+    if (m_ledStrip) {
+        m_ledStrip->setLayers({});
+    }
 }
 
 LedStrip *ShelfModel::ledStrip() const
@@ -102,7 +269,15 @@ void ShelfModel::setLedStrip(LedStrip *ledStrip)
     if (m_ledStrip != ledStrip) {
         beginResetModel();
 
+        if (m_ledStrip) {
+            m_ledStrip->disconnect(this);
+            m_ledStrip->setLayers({});
+        }
+
         m_ledStrip = ledStrip;
+        m_squareColorsValid = false;
+
+        m_renderLoop.setLedStrip(m_ledStrip);
 
         if (m_animation) {
             m_animation->setLedStrip(m_ledStrip);
@@ -119,6 +294,12 @@ void ShelfModel::setLedStrip(LedStrip *ledStrip)
             // shelf.
             QObject::connect(m_ledStrip, &LedStrip::countChanged, this,
                 [=]() {
+                    // Geometry changes made through the model repaint the
+                    // strip and notify views on their own.
+                    if (m_updatingGeometry) {
+                        return;
+                    }
+
                     beginResetModel();
 
                     if (!m_createdByQml || m_complete) {
@@ -131,6 +312,8 @@ void ShelfModel::setLedStrip(LedStrip *ledStrip)
 
                     endResetModel();
 
+                    updateZones();
+
                     Q_EMIT averageColorChanged(averageColor());
                 }
             );
@@ -150,6 +333,8 @@ bool ShelfModel::enabled() const
 void ShelfModel::setEnabled(bool enabled)
 {
     if (m_enabled != enabled) {
+        interruptTimeline();
+
         m_enabled = enabled;
 
         if (!m_createdByQml || m_complete) {
@@ -175,11 +360,12 @@ void ShelfModel::setEnabled(bool enabled)
                     // us to fade out with the animation still running when the
                     // shelf is disabled.
                     transitionToCurrentBrightness();
+                    updateLayers();
                 } else {
                     syncBrightness(false /* show */);
                     updateAnimation();
 
-                    m_ledStrip->show();
+                    showLedStrip();
 
                     Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0));
                 }
@@ -216,15 +402,7 @@ void ShelfModel::setRows(int rows)
     }
 
     if (m_rows != rows) {
-        m_rows = rows;
-
-        if ((!m_createdByQml || m_complete) && m_ledStrip) {
-            beginResetModel();
-
-            updateLedStrip();
-
-            endResetModel();
-        }
+        updateGeometry(rows, m_columns, m_density, m_wallThickness);
 
         Q_EMIT rowsChanged(m_rows);
     }
@@ -251,15 +429,7 @@ void ShelfModel::setColumns(int columns)
     }
 
     if (m_columns != columns) {
-        m_columns = columns;
-
-        if ((!m_createdByQml || m_complete) && m_ledStrip) {
-            beginResetModel();
-
-            updateLedStrip();
-
-            endResetModel();
-        }
+        updateGeometry(m_rows, columns, m_density, m_wallThickness);
 
         Q_EMIT columnsChanged(m_columns);
     }
@@ -286,15 +456,7 @@ void ShelfModel::setDensity(int density)
     }
 
     if (m_density != density) {
-        m_density = density;
-
-        if ((!m_createdByQml || m_complete) && m_ledStrip) {
-            beginResetModel();
-
-            updateLedStrip();
-
-            endResetModel();
-        }
+        updateGeometry(m_rows, m_columns, density, m_wallThickness);
 
         Q_EMIT densityChanged(m_density);
     }
@@ -321,15 +483,7 @@ void ShelfModel::setWallThickness(int thickness)
     }
 
     if (m_wallThickness != thickness) {
-        m_wallThickness = thickness;
-
-        if ((!m_createdByQml || m_complete) && m_ledStrip) {
-            beginResetModel();
-
-            updateLedStrip();
-
-            endResetModel();
-        }
+        updateGeometry(m_rows, m_columns, m_density, thickness);
 
         Q_EMIT wallThicknessChanged(m_wallThickness);
     }
@@ -343,6 +497,8 @@ qreal ShelfModel::brightness() const
 void ShelfModel::setBrightness(qreal brightness)
 {
     if (m_brightness != brightness) {
+        interruptTimeline();
+
         if ((!m_createdByQml || m_complete) && m_ledStrip) {
             if (m_animateBrightnessTransitions) {
                 m_brightnessTransition.stop();
@@ -358,21 +514,13 @@ void ShelfModel::setBrightness(qreal brightness)
 
                 m_brightness = brightness;
 
-                qreal currentAverageBrightness {0.0};
-
-                for (int i {0}; i < rowCount(); ++i) {
-                    const QPair <int, int> &range {rowIndexToRange(i)};
-                    currentAverageBrightness += m_ledStrip->brightnessAverage(range.first, range.second);
-                }
-
-                currentAverageBrightness = (currentAverageBrightness / rowCount()) / LED_MAX_BRIGHTNESS;
+                // The brightness last written to the strip, which is where the
+                // transition needs to pick up from.
+                const qreal currentAverageBrightness {m_appliedBrightness};
                 const qreal delta {std::abs(brightness - currentAverageBrightness)
                     ? std::abs(brightness - currentAverageBrightness) : 0};
 
-                m_brightnessTransition.setDuration(m_transitionDuration * delta);
-                m_brightnessTransition.setStartValue(currentAverageBrightness);
-                m_brightnessTransition.setEndValue(brightness);
-                m_brightnessTransition.start();
+                startBrightnessTransition(currentAverageBrightness, brightness, delta);
             } else {
                 m_brightness = brightness;
 
@@ -384,12 +532,12 @@ void ShelfModel::setBrightness(qreal brightness)
                     syncBrightness();
                 }
 
-                Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0));
+                Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0), {AverageBrightness});
             }
         } else {
             m_brightness = brightness;
 
-            Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0));
+            Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0), {AverageBrightness});
         }
 
         Q_EMIT brightnessChanged(m_brightness);
@@ -406,13 +554,13 @@ void ShelfModel::setAnimateBrightnessTransitions(bool animate)
     if (m_animateBrightnessTransitions != animate) {
         m_animateBrightnessTransitions = animate;
 
-        if (!animate && m_brightnessTransition.state() == QAbstractAnimation::Running) {
+        if (!animate && m_brightnessTransition.state() != QAbstractAnimation::Stopped) {
             m_brightnessTransition.stop();
 
             // Calls `LedStrip::show`.
             syncBrightness();
 
-            Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0));
+            Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0), {AverageBrightness});
         }
 
         Q_EMIT animateBrightnessTransitionsChanged(m_animateBrightnessTransitions);
@@ -425,31 +573,29 @@ QColor ShelfModel::averageColor() const
         return m_averageColor;
     }
 
-    if (m_averageColorTransition.state() == QAbstractAnimation::Running) {
+    if (m_averageColorTransition.state() != QAbstractAnimation::Stopped) {
         return m_averageColor;
     }
 
-    int r {0};
-    int g {0};
-    int b {0};
+    updateSquareColors();
 
-    for (int i {0}; i < rowCount(); ++i) {
-        const QPair <int, int> &range {rowIndexToRange(i)};
-        const QColor &color {m_ledStrip->colorAverage(range.first, range.second)};
-        r += color.red() * color.red();
-        g += color.green() * color.green();
-        b += color.blue() * color.blue();
+    if (m_squareColors.isEmpty()) {
+        return m_averageColor;
     }
 
+    const qint64 count {m_squareColors.size()};
+
     return QColor {
-        static_cast<int>(std::sqrt(r / rowCount())),
-        static_cast<int>(std::sqrt(g / rowCount())),
-        static_cast<int>(std::sqrt(b / rowCount()))
+        static_cast<int>(std::sqrt(m_squareColorSums[0] / count)),
+        static_cast<int>(std::sqrt(m_squareColorSums[1] / count)),
+        static_cast<int>(std::sqrt(m_squareColorSums[2] / count))
     };
 }
 
 void ShelfModel::setAverageColor(const QColor &color)
 {
+    interruptTimeline();
+
     if (!m_ledStrip) {
         if (m_averageColor != color) {
             setAnimating(false);
@@ -465,6 +611,8 @@ void ShelfModel::setAverageColor(const QColor &color)
         m_averageColor = color;
 
         if (!m_createdByQml || m_complete) {
+            finishSceneTransition();
+
             const bool wasAnimating = m_animating;
 
             if (wasAnimating) {
@@ -478,16 +626,16 @@ void ShelfModel::setAverageColor(const QColor &color)
             if (m_animateAverageColorTransitions && m_enabled && averageColor() != QStringLiteral("black")) {
                 if (wasAnimating) {
                     setRangesToColor(averageColor());
-                    m_ledStrip->show();
-                    Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0));
+                    showLedStrip();
+                    emitSquaresChanged();
                 }
 
                 // Implicitly enable the shelf.
                 setEnabled(true);
 
                 m_averageColorTransition.stop();
-                m_averageColorTransition.setStartValue(averageColor());
-                m_averageColorTransition.setEndValue(color);
+                m_fromColor = ColorSpace::toOklab(averageColor().rgb());
+                m_toColor = ColorSpace::toOklab(color.rgb());
                 m_averageColorTransition.start();
             } else {
                 setRangesToColor(color);
@@ -498,10 +646,9 @@ void ShelfModel::setAverageColor(const QColor &color)
                     // model indices.
                     setEnabled(true);
                 } else {
-                    m_ledStrip->show();
-                    Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0));
+                    showLedStrip();
+                    emitSquaresChanged();
                 }
-
             }
         } else {
             Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0));
@@ -521,16 +668,16 @@ void ShelfModel::setAnimateAverageColorTransitions(bool animate)
     if (m_animateAverageColorTransitions != animate) {
         m_animateAverageColorTransitions = animate;
 
-        if (!animate && m_averageColorTransition.state() == QAbstractAnimation::Running) {
+        if (!animate && m_averageColorTransition.state() != QAbstractAnimation::Stopped) {
             m_averageColorTransition.stop();
 
             setRangesToColor(m_averageColor);
 
             if (m_enabled) {
-                m_ledStrip->show();
+                showLedStrip();
             }
 
-            Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0));
+            emitSquaresChanged();
         }
 
         Q_EMIT animateAverageColorTransitionsChanged(m_animateAverageColorTransitions);
@@ -549,11 +696,59 @@ void ShelfModel::setTransitionDuration(int duration)
 
         m_brightnessTransition.setDuration(m_transitionDuration);
         m_averageColorTransition.setDuration(m_transitionDuration);
+        m_sceneTransition.setDuration(m_transitionDuration);
 
         Q_EMIT transitionDurationChanged(m_transitionDuration);
     }
 }
 
+int ShelfModel::frameRate() const
+{
+    return m_renderLoop.frameRate();
+}
+
+void ShelfModel::setFrameRate(int frameRate)
+{
+    if (m_renderLoop.frameRate() != frameRate) {
+        m_renderLoop.setFrameRate(frameRate);
+
+        Q_EMIT frameRateChanged(m_renderLoop.frameRate());
+    }
+}
+
+bool ShelfModel::threadedRendering() const
+{
+    return m_renderLoop.threaded();
+}
+
+void ShelfModel::setThreadedRendering(bool threaded)
+{
+    if (m_renderLoop.threaded() != threaded) {
+        m_renderLoop.setThreaded(threaded);
+
+        Q_EMIT threadedRenderingChanged(m_renderLoop.threaded());
+    }
+}
+
+bool ShelfModel::adaptiveFrameRate() const
+{
+    return m_renderLoop.adaptiveFrameRate();
+}
+
+void ShelfModel::setAdaptiveFrameRate(bool adaptive)
+{
+    if (m_renderLoop.adaptiveFrameRate() != adaptive) {
+        m_renderLoop.setAdaptiveFrameRate(adaptive);
+
+        Q_EMIT adaptiveFrameRateChanged(m_renderLoop.adaptiveFrameRate());
+    }
+}
+
+RenderLoop *ShelfModel::renderLoop()
+{
+    return &m_renderLoop;
+}
+
 AbstractAnimation *ShelfModel::animation() const
 {
     return m_animation;
@@ -563,6 +758,12 @@ void ShelfModel::setAnimation(AbstractAnimation *animation)
 {
     if (m_animation != animation) {
         if (m_animation) {
+            // Restores the strip through the connection below, before the
+            // new animation saves it.
+            if (m_animation->running()) {
+                m_animation->stop();
+            }
+
             m_animation->disconnect(this);
         }
 
@@ -576,26 +777,31 @@ void ShelfModel::setAnimation(AbstractAnimation *animation)
                 }
             );
 
-            QObject::connect(m_animation, &AbstractAnimation::stateChanged, this,
-                [=](QTimeLine::State newState) {
-                    if (newState == QTimeLine::Running) {
+            QObject::connect(m_animation, &AbstractAnimation::runningChanged, this,
+                [=](bool running) {
+                    if (running) {
                         if (m_ledStrip) {
                             m_ledStrip->save();
 
                             if (m_pendingBrightnessTransition) {
-                                const qreal from {m_enabled ? 0.0 : m_brightness};
-                                m_ledStrip->setBrightness(0, m_ledStrip->count() - 1,
-                                    std::rint(LED_MAX_BRIGHTNESS * from));
+                                m_appliedBrightness = m_enabled ? 0.0 : m_brightness;
+                                m_ledStrip->setGlobalBrightness(m_appliedBrightness);
                             }
                         }
                     } else {
                         // Don't write out to the strip if we didn't restore any old
                         // data or if we're not enabled.
                         if (m_ledStrip->restore(LedStrip::RestoreColor)) {
-                            m_ledStrip->show();
+                            // Restoring covers the entire strip, including
+                            // compartments owned by zones.
+                            for (ShelfZone *zone : std::as_const(m_zones)) {
+                                zone->repaint();
+                            }
+
+                            showLedStrip();
                         }
 
-                        Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0));
+                        emitSquaresChanged();
                         Q_EMIT averageColorChanged(averageColor());
                     }
                 }
@@ -604,8 +810,7 @@ void ShelfModel::setAnimation(AbstractAnimation *animation)
             QObject::connect(m_animation, &AbstractAnimation::frameComplete, this,
                 [=]() {
                     if (m_enabled) {
-                        Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0));
-                        Q_EMIT averageColorChanged(averageColor());
+                        scheduleSquaresChanged();
 
                         if (m_pendingBrightnessTransition) {
                             transitionToCurrentBrightness();
@@ -617,6 +822,8 @@ void ShelfModel::setAnimation(AbstractAnimation *animation)
             );
 
             m_animation->setLedStrip(m_ledStrip);
+            m_animation->setRenderLoop(&m_renderLoop);
+            m_animation->setRegion(m_hasZones ? modelRanges() : QVector<QPair<int, int>>());
 
             updateAnimation();
         } else {
@@ -635,6 +842,8 @@ bool ShelfModel::animating() const
 void ShelfModel::setAnimating(bool animating)
 {
     if (m_animating != animating) {
+        interruptTimeline();
+
         m_animating = animating;
 
         if (!m_createdByQml || m_complete) {
@@ -673,7 +882,7 @@ int ShelfModel::rowCount(const QModelIndex &parent) const
         return 0;
     }
 
-    return m_rows * m_columns;
+    return m_squareCount;
 }
 
 QVariant ShelfModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -703,7 +912,10 @@ QVariant ShelfModel::data(const QModelIndex &index, int role) const
         return QVariant {};
     }
 
-    if (!m_enabled && role != AverageBrightness) {
+    // Zones keep their compartments lit while the shelf is off.
+    const bool zoneOwned {m_hasZones && m_zoneOwned.value(index.row())};
+
+    if (!m_enabled && role != AverageBrightness && !zoneOwned) {
         return QColor {QStringLiteral("black")};
     }
 
@@ -712,25 +924,24 @@ QVariant ShelfModel::data(const QModelIndex &index, int role) const
     switch (role) {
         case Qt::DisplayRole:
         case Qt::EditRole:
-            return m_ledStrip->colorAverage(range.first, range.second).name(QColor::HexRgb);
+            return squareColor(index.row()).name(QColor::HexRgb);
         case Qt::DecorationRole:
         case AverageColor:
-            return m_ledStrip->colorAverage(range.first, range.second);
+            return squareColor(index.row());
         case AverageRed:
-            return m_ledStrip->colorAverage(range.first, range.second).red();
+            return squareColor(index.row()).red();
         case AverageGreen:
-            return m_ledStrip->colorAverage(range.first, range.second).green();
+            return squareColor(index.row()).green();
         case AverageBlue:
-            return m_ledStrip->colorAverage(range.first, range.second).blue();
+            return squareColor(index.row()).blue();
         case AverageBrightness:
-            const int averageBrightness {m_ledStrip->brightnessAverage(range.first,
-                range.second)};
-
-            if (averageBrightness == 0) {
-                return 0.0;
-            } else {
-                return std::rint(LED_MAX_BRIGHTNESS / averageBrightness);
+            // Zones set their own brightness, exempt from the shelf's.
+            if (zoneOwned) {
+                return static_cast<qreal>(m_ledStrip->brightnessAverage(range.first,
+                    range.second)) / LED_MAX_BRIGHTNESS;
             }
+
+            return m_appliedBrightness;
     }
 
     return QVariant {};
@@ -756,12 +967,20 @@ bool ShelfModel::setData(const QModelIndex &index, const QVariant &value, int ro
         return false;
     }
 
-    const QColor &newColor {value.value<QColor>()};
+    interruptTimeline();
 
-    const QPair<int, int> &range {rowIndexToRange(index.row())};
-    const QColor &color {m_ledStrip->colorAverage(range.first, range.second)};
+    if (!paintSquare(index.row(), value.value<QColor>())) {
+        return false;
+    }
+
+    finishPaintingSquares();
+
+    return true;
+}
 
-    if (color == newColor) {
+bool ShelfModel::paintSquare(int index, const QColor &color)
+{
+    if (squareColor(index) == color) {
         return false;
     }
 
@@ -770,8 +989,23 @@ bool ShelfModel::setData(const QModelIndex &index, const QVariant &value, int ro
         setAnimating(false);
     }
 
-    m_ledStrip->setColor(range.first, range.second, newColor);
-    m_ledStrip->show();
+    finishSceneTransition();
+
+    // Painting a single square updates the cached square colors in
+    // place, rather than requiring another pass over the strip.
+    updateSquareColors();
+
+    const QPair<int, int> &range {rowIndexToRange(index)};
+    m_ledStrip->setColor(range.first, range.second, color);
+
+    setSquareColor(index, color.rgb());
+
+    return true;
+}
+
+void ShelfModel::finishPaintingSquares()
+{
+    showLedStrip();
 
     // If the entire shelf was painted black, set the overall state
     // to disabled automatically. `setEnabled(true)` will repaint
@@ -785,12 +1019,10 @@ bool ShelfModel::setData(const QModelIndex &index, const QVariant &value, int ro
     } else if (!m_enabled) {
         setEnabled(true);
     } else {
-        Q_EMIT dataChanged(index, index);
+        emitSquaresChanged();
     }
 
     Q_EMIT averageColorChanged(averageColor());
-
-    return true;
 }
 
 bool ShelfModel::remotingEnabled() const
@@ -829,117 +1061,1355 @@ void ShelfModel::setListenAddress(const QUrl &url)
     }
 }
 
-void ShelfModel::classBegin()
+QString ShelfModel::stateFileName() const
 {
-    m_createdByQml = true;
+    return m_stateFile.fileName();
 }
 
-void ShelfModel::componentComplete()
+void ShelfModel::setStateFileName(const QString &fileName)
 {
-    m_complete = true;
+    if (m_stateFile.fileName() != fileName) {
+        m_stateFile.setFileName(fileName);
 
-    updateLedStrip();
-    updateAnimation();
-    syncBrightness(); // Calls `LedStrip::show`.
-    updateRemoting();
+        scheduleStateWrite();
+
+        Q_EMIT stateFileNameChanged();
+    }
 }
 
-QPair<int, int> ShelfModel::rowIndexToRange(const int rowIndex) const
+QString ShelfModel::sceneFileName() const
 {
-    const int row {rowIndex / m_columns};
-    const int indexInRow {row % 2 == 0 ? (m_columns - 1) - std::max(0,
-        rowIndex - (row * m_columns)) : rowIndex - (row * m_columns)};
-    const int rowLength {m_columns * m_density + (m_columns - 1) * m_wallThickness};
-    const int first {(std::max(0, (m_rows - 1) - row) * rowLength)
-        + std::max(0, indexInRow * m_density) + (indexInRow * m_wallThickness)};
-
-    return QPair<int, int>(first, first + m_density - 1);
+    return m_sceneStore.fileName();
 }
 
-void ShelfModel::transitionToCurrentBrightness()
+void ShelfModel::setSceneFileName(const QString &fileName)
 {
-    const qreal from {m_enabled ? 0.0 : m_brightness};
-    const qreal to {m_enabled ? m_brightness : 0.0};
-    const qreal delta {std::abs(m_brightness - to) ? std::abs(m_brightness - to) : 1.0};
+    if (m_sceneStore.fileName() != fileName) {
+        m_sceneStore.setFileName(fileName);
 
-    m_brightnessTransition.setDuration(m_transitionDuration * delta);
-    m_brightnessTransition.setStartValue(from);
-    m_brightnessTransition.setEndValue(to);
-    m_brightnessTransition.start();
+        Q_EMIT sceneFileNameChanged();
+        Q_EMIT scenesChanged(scenes());
+    }
 }
 
-void ShelfModel::syncBrightness(bool show /* Defaults to true */)
+QStringList ShelfModel::scenes() const
 {
-    if (!m_ledStrip) {
-        return;
+    return m_sceneStore.names();
+}
+
+bool ShelfModel::saveScene(const QString &name)
+{
+    if (!m_ledStrip || name.isEmpty()) {
+        return false;
     }
 
-    if (m_brightnessTransition.state() == QAbstractAnimation::Running) {
-        m_ledStrip->setBrightness(0, m_ledStrip->count() - 1,
-            std::rint(LED_MAX_BRIGHTNESS * m_brightnessTransition.currentValue().toReal()));
-    } else {
-        m_ledStrip->setBrightness(0, m_ledStrip->count() - 1,
-            m_enabled ? std::rint(LED_MAX_BRIGHTNESS * m_brightness) : 0);
+    // Store where a crossfade is headed rather than a blend.
+    finishSceneTransition();
+
+    SceneStore::Scene scene;
+    scene.name = name;
+    scene.brightness = m_brightness;
+    scene.frame = QByteArray(reinterpret_cast<const char *>(m_ledStrip->constData()),
+        m_ledStrip->count() * sizeof(uint32_t));
+
+    const bool added {!m_sceneStore.scene(name)};
+
+    if (!m_sceneStore.insert(scene)) {
+        return false;
     }
 
-    if (show) { // Defaults to true.
-        m_ledStrip->show();
+    if (added) {
+        Q_EMIT scenesChanged(scenes());
     }
+
+    return true;
 }
 
-void ShelfModel::setRangesToColor(const QColor &color)
+bool ShelfModel::recallScene(const QString &name, bool animate)
 {
     if (!m_ledStrip) {
-        return;
+        return false;
     }
 
-    m_ledStrip->clear();
+    const SceneStore::Scene *scene {m_sceneStore.scene(name)};
 
-    for (int i {0}; i < rowCount(); ++i) {
-        const QPair <int, int> &range {rowIndexToRange(i)};
-        m_ledStrip->setColor(range.first, range.second, color);
+    if (!scene) {
+        qCWarning(HYELICHT) << i18n("No scene named: %1", name);
+        return false;
     }
-}
 
-void ShelfModel::abortTransitions()
-{
-    if (m_averageColorTransition.state() == QAbstractAnimation::Running) {
-        m_averageColorTransition.stop();
-        setRangesToColor(m_averageColor);
+    if (scene->frame.size() != static_cast<qsizetype>(m_ledStrip->count() * sizeof(uint32_t))) {
+        qCWarning(HYELICHT) << i18n("Scene %1 was stored for a shelf of a different size.", name);
+        return false;
     }
 
-    if (m_brightnessTransition.state() == QAbstractAnimation::Running) {
-        m_brightnessTransition.stop();
+    interruptTimeline();
+
+    if (m_animating) {
+        // `setAnimating(false)` will cause a call to `LedStrip::restore`,
+        // but we don't want to briefly restore an old frame before showing
+        // the scene.
+        m_ledStrip->forgetSavedData();
+        setAnimating(false);
     }
-}
 
-void ShelfModel::updateLedStrip()
-{
-    m_ledStrip->setCount((m_columns * m_density + (m_columns - 1)
-        * m_wallThickness) * m_rows);
+    abortTransitions();
 
-    if (!m_animating) {
-        setRangesToColor(m_averageColor);
+    const bool wasEnabled {m_enabled};
+    const bool newBrightness {m_brightness != scene->brightness};
+
+    m_enabled = true;
+    m_brightness = scene->brightness;
+
+    // Kept by implicit sharing, so this doesn't copy the LED data.
+    m_sceneTo = scene->frame;
+
+    if (animate && (m_transitionDuration > 0)) {
+        m_sceneFrom = QByteArray(reinterpret_cast<const char *>(m_ledStrip->constData()),
+            m_sceneTo.size());
+        prepareSceneTransition();
+
+        m_sceneTransition.start();
+
+        // Picks up from the brightness last written to the strip, i.e. fades
+        // in from black if the shelf was off.
+        if (m_animateBrightnessTransitions) {
+            const qreal delta {std::abs(m_brightness - m_appliedBrightness)};
+
+            startBrightnessTransition(m_appliedBrightness, m_brightness, delta);
+        } else {
+            syncBrightness(false /* show */);
+        }
+
+        m_ledStrip->update();
+    } else {
+        // A single copy, shown right away.
+        paintScene(1.0);
+        syncBrightness(); // Calls `LedStrip::show`.
+    }
+
+    if (!wasEnabled) {
+        // Starts the layers.
+        updateAnimation();
+    }
+
+    emitSquaresChanged();
+    Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0), {AverageBrightness});
+
+    if (!wasEnabled) {
+        Q_EMIT enabledChanged(m_enabled);
+    }
+
+    if (newBrightness) {
+        Q_EMIT brightnessChanged(m_brightness);
     }
+
+    Q_EMIT averageColorChanged(averageColor());
+
+    return true;
 }
 
-void ShelfModel::updateAnimation()
+bool ShelfModel::removeScene(const QString &name)
 {
-    if (!m_animation) {
-        return;
+    if (!m_sceneStore.remove(name)) {
+        return false;
     }
 
-    if (m_enabled && m_animating) {
-        if (m_animation->state() != QTimeLine::Running) {
-            m_animation->start();
-        }
-    } else if (m_brightnessTransition.state() != QAbstractAnimation::Running) {
-        if (m_animation->state() == QTimeLine::Running) {
+    Q_EMIT scenesChanged(scenes());
+
+    return true;
+}
+
+bool ShelfModel::playTimeline(const Timeline &timeline)
+{
+    if (!m_ledStrip || timeline.isEmpty()) {
+        return false;
+    }
+
+    stopTimeline();
+    abortTransitions();
+
+    m_timeline = timeline;
+    m_timeline.rewind();
+    m_timelinePosition = -1;
+
+    // Implicitly enable the shelf.
+    setEnabled(true);
+
+    // Whatever is due at the start shows right away, the rest on the
+    // frames to come.
+    applyTimeline(0);
+
+    m_timelineClock.setDuration(std::max<qint64>(1, m_timeline.duration()));
+    m_timelineClock.setLoopCount(m_timeline.loop() ? -1 : 1);
+    m_timelineClock.start();
+
+    return true;
+}
+
+void ShelfModel::stopTimeline()
+{
+    if (m_timelineClock.state() != QAbstractAnimation::Stopped) {
+        m_timelineClock.stop();
+    }
+}
+
+bool ShelfModel::timelineRunning() const
+{
+    return m_timelineClock.state() != QAbstractAnimation::Stopped;
+}
+
+const Timeline &ShelfModel::timeline() const
+{
+    return m_timeline;
+}
+
+qint64 ShelfModel::timelinePosition() const
+{
+    return m_timelinePosition;
+}
+
+SnapshotPublisher<ShelfModel::Snapshot>::Reader ShelfModel::snapshot() const
+{
+    return m_snapshots.read();
+}
+
+bool ShelfModel::postCommand(const Command &command)
+{
+    if (!m_commands.push(command)) {
+        return false;
+    }
+
+    m_renderLoop.requestFrame();
+
+    return true;
+}
+
+void ShelfModel::classBegin()
+{
+    m_createdByQml = true;
+}
+
+void ShelfModel::componentComplete()
+{
+    m_complete = true;
+
+    updateLedStrip(); // Calls `updateZones`.
+
+    // Pick up where we left off before showing anything.
+    if (restoreState()) {
+        for (ShelfZone *zone : std::as_const(m_zones)) {
+            zone->repaint();
+        }
+    }
+
+    updateAnimation();
+    syncBrightness(); // Calls `LedStrip::show`.
+    updateRemoting();
+}
+
+QPair<int, int> ShelfModel::rowIndexToRange(const int rowIndex) const
+{
+    return m_squareRanges.at(rowIndex);
+}
+
+void ShelfModel::updateSquareRanges()
+{
+    const int rowLength {m_columns * m_density + (m_columns - 1) * m_wallThickness};
+
+    m_squareRanges.resize(m_rows * m_columns);
+
+    for (int i {0}; i < m_squareRanges.size(); ++i) {
+        const int row {i / m_columns};
+        const int indexInRow {row % 2 == 0 ? (m_columns - 1) - std::max(0,
+            i - (row * m_columns)) : i - (row * m_columns)};
+        const int first {(std::max(0, (m_rows - 1) - row) * rowLength)
+            + std::max(0, indexInRow * m_density) + (indexInRow * m_wallThickness)};
+
+        m_squareRanges[i] = QPair<int, int>(first, first + m_density - 1);
+    }
+
+    m_squareColorsValid = false;
+}
+
+void ShelfModel::updateSquareColors() const
+{
+    if (!m_ledStrip) {
+        return;
+    }
+
+    if (m_squareColorsValid && m_squareColorsGeneration == m_ledStrip->generation()) {
+        return;
+    }
+
+    const uint8_t *data {reinterpret_cast<const uint8_t *>(m_ledStrip->constData())};
+    const int count {m_ledStrip->count()};
+    const bool resized {m_squareColors.size() != m_squareRanges.size()};
+
+    if (resized) {
+        m_squareColors.resize(m_squareRanges.size());
+    }
+
+    m_squareColorSums[0] = 0;
+    m_squareColorSums[1] = 0;
+    m_squareColorSums[2] = 0;
+
+    // A single pass over the squares in the strip. Averages are the root mean
+    // square of the channel values.
+    for (int i {0}; i < m_squareRanges.size(); ++i) {
+        const QPair<int, int> &range {m_squareRanges.at(i)};
+        QRgb color {qRgb(0, 0, 0)};
+
+        if (range.second < count) {
+            quint32 r {0};
+            quint32 g {0};
+            quint32 b {0};
+
+            for (int led {range.first}; led <= range.second; ++led) {
+                const uint8_t *ptr {data + (led * sizeof(uint32_t))};
+                b += ptr[1] * ptr[1];
+                g += ptr[2] * ptr[2];
+                r += ptr[3] * ptr[3];
+            }
+
+            const quint32 leds {static_cast<quint32>(range.second - range.first + 1)};
+
+            color = qRgb(static_cast<int>(std::sqrt(r / leds)),
+                static_cast<int>(std::sqrt(g / leds)),
+                static_cast<int>(std::sqrt(b / leds)));
+        }
+
+        if (resized || m_squareColors.at(i) != color) {
+            m_squareColors[i] = color;
+            markSquareDirty(i);
+        }
+
+        m_squareColorSums[0] += qRed(color) * qRed(color);
+        m_squareColorSums[1] += qGreen(color) * qGreen(color);
+        m_squareColorSums[2] += qBlue(color) * qBlue(color);
+    }
+
+    m_squareColorsValid = true;
+    m_squareColorsGeneration = m_ledStrip->generation();
+}
+
+QColor ShelfModel::squareColor(int index) const
+{
+    updateSquareColors();
+
+    if (index < 0 || index >= m_squareColors.size()) {
+        return QColor {QStringLiteral("black")};
+    }
+
+    return QColor {m_squareColors.at(index)};
+}
+
+void ShelfModel::setSquareColor(int index, QRgb color)
+{
+    const QRgb oldColor {m_squareColors.at(index)};
+
+    m_squareColorSums[0] += qRed(color) * qRed(color) - qRed(oldColor) * qRed(oldColor);
+    m_squareColorSums[1] += qGreen(color) * qGreen(color) - qGreen(oldColor) * qGreen(oldColor);
+    m_squareColorSums[2] += qBlue(color) * qBlue(color) - qBlue(oldColor) * qBlue(oldColor);
+
+    m_squareColors[index] = color;
+    m_squareColorsGeneration = m_ledStrip->generation();
+
+    markSquareDirty(index);
+}
+
+void ShelfModel::markSquareDirty(int index) const
+{
+    m_dirtyFirst = (m_dirtyFirst == -1) ? index : std::min(m_dirtyFirst, index);
+    m_dirtyLast = std::max(m_dirtyLast, index);
+}
+
+void ShelfModel::emitSquaresChanged()
+{
+    updateSquareColors();
+
+    if (m_dirtyFirst == -1) {
+        return;
+    }
+
+    const int first {m_dirtyFirst};
+    const int last {std::min(m_dirtyLast, rowCount() - 1)};
+
+    m_dirtyFirst = -1;
+    m_dirtyLast = -1;
+
+    if (first <= last) {
+        Q_EMIT dataChanged(index(first, 0), index(last, 0));
+    }
+}
+
+void ShelfModel::scheduleSquaresChanged()
+{
+    if (!m_squaresChangedTimer.isActive()) {
+        m_squaresChangedTimer.start();
+    }
+}
+
+QQmlListProperty<ShelfZone> ShelfModel::zones()
+{
+    return QQmlListProperty<ShelfZone>(this, nullptr, &ShelfModel::zonesAppend,
+        &ShelfModel::zonesCount, &ShelfModel::zonesAt, &ShelfModel::zonesClear);
+}
+
+void ShelfModel::addZone(ShelfZone *zone)
+{
+    if (!zone || m_zones.contains(zone)) {
+        return;
+    }
+
+    m_zones.append(zone);
+
+    QObject::connect(zone, &ShelfZone::firstColumnChanged, this, &ShelfModel::updateZones);
+    QObject::connect(zone, &ShelfZone::columnsChanged, this, &ShelfModel::updateZones);
+    QObject::connect(zone, &ShelfZone::enabledChanged, this, &ShelfModel::updateZones);
+    QObject::connect(zone, &ShelfZone::painted, this, &ShelfModel::scheduleSquaresChanged);
+
+    QObject::connect(zone, &QObject::destroyed, this,
+        [=]() {
+            m_zones.removeAll(zone);
+            updateZones();
+        }
+    );
+
+    updateZones();
+}
+
+void ShelfModel::clearZones()
+{
+    for (ShelfZone *zone : std::as_const(m_zones)) {
+        zone->disconnect(this);
+        zone->setShelfModel(nullptr);
+    }
+
+    m_zones.clear();
+
+    updateZones();
+}
+
+QQmlListProperty<AnimationLayer> ShelfModel::layers()
+{
+    return QQmlListProperty<AnimationLayer>(this, nullptr, &ShelfModel::layersAppend,
+        &ShelfModel::layersCount, &ShelfModel::layersAt, &ShelfModel::layersClear);
+}
+
+void ShelfModel::addLayer(AnimationLayer *layer)
+{
+    if (!layer || m_layers.contains(layer)) {
+        return;
+    }
+
+    m_layers.append(layer);
+
+    QObject::connect(layer, &AnimationLayer::enabledChanged, this, &ShelfModel::updateLayers);
+    QObject::connect(layer, &AnimationLayer::animationChanged, this, &ShelfModel::updateLayers);
+    QObject::connect(layer, &AnimationLayer::blendModeChanged, this, &ShelfModel::updateLayers);
+    QObject::connect(layer, &AnimationLayer::opacityChanged, this, &ShelfModel::updateLayers);
+
+    // Layer frames are written out by the render loop along with the
+    // rest of the shelf.
+    QObject::connect(layer, &AnimationLayer::painted, this,
+        [=]() {
+            if (m_ledStrip) {
+                m_ledStrip->update();
+            }
+        }
+    );
+
+    QObject::connect(layer, &QObject::destroyed, this,
+        [=]() {
+            m_layers.removeAll(layer);
+            updateLayers();
+        }
+    );
+
+    updateLayers();
+}
+
+void ShelfModel::clearLayers()
+{
+    for (AnimationLayer *layer : std::as_const(m_layers)) {
+        layer->disconnect(this);
+        layer->updateAnimation(nullptr, 0, {}, false /* run */);
+    }
+
+    m_layers.clear();
+
+    updateLayers();
+}
+
+QVector<QPair<int, int>> ShelfModel::squareRanges() const
+{
+    return m_squareRanges;
+}
+
+int ShelfModel::ledCount() const
+{
+    return (m_columns * m_density + (m_columns - 1) * m_wallThickness) * m_rows;
+}
+
+QVector<QPair<int, int>> ShelfModel::columnRanges(int firstColumn, int columns) const
+{
+    QVector<QPair<int, int>> ranges;
+
+    const int lastColumn {std::min(firstColumn + columns, m_columns) - 1};
+
+    if (firstColumn < 0 || firstColumn > lastColumn) {
+        return ranges;
+    }
+
+    ranges.reserve(m_rows * (lastColumn - firstColumn + 1));
+
+    for (int row {0}; row < m_rows; ++row) {
+        for (int column {firstColumn}; column <= lastColumn; ++column) {
+            ranges.append(rowIndexToRange(row * m_columns + column));
+        }
+    }
+
+    // Boards alternate in direction, so sort before merging neighbors.
+    std::sort(ranges.begin(), ranges.end());
+
+    int merged {0};
+
+    for (int i {1}; i < ranges.size(); ++i) {
+        if (ranges.at(i).first == ranges.at(merged).second + 1) {
+            ranges[merged].second = ranges.at(i).second;
+        } else {
+            ranges[++merged] = ranges.at(i);
+        }
+    }
+
+    ranges.resize(merged + 1);
+
+    return ranges;
+}
+
+void ShelfModel::updateZones()
+{
+    const int squares {m_rows * m_columns};
+    QVector<bool> owned(squares, false);
+
+    for (const ShelfZone *zone : std::as_const(m_zones)) {
+        if (!zone->enabled()) {
+            continue;
+        }
+
+        const int lastColumn {std::min(zone->firstColumn() + zone->columns(), m_columns) - 1};
+
+        for (int row {0}; row < m_rows; ++row) {
+            for (int column {zone->firstColumn()}; column <= lastColumn; ++column) {
+                owned[row * m_columns + column] = true;
+            }
+        }
+    }
+
+    const QVector<bool> previouslyOwned {m_zoneOwned};
+    const bool hadZones {m_hasZones};
+
+    m_zoneOwned = owned;
+    m_hasZones = owned.contains(true);
+
+    if ((m_createdByQml && !m_complete) || !m_ledStrip) {
+        return;
+    }
+
+    if (m_animation) {
+        m_animation->setRegion(m_hasZones ? modelRanges() : QVector<QPair<int, int>>());
+    }
+
+    // Walls are not part of any zone, and would otherwise keep showing the
+    // last frame of a full-strip animation.
+    if (m_hasZones && !hadZones) {
+        clearWalls();
+    }
+
+    // Compartments given back by zones take on the full-shelf color, and
+    // drop the zone's brightness.
+    if (previouslyOwned.size() == squares) {
+        for (int i {0}; i < squares; ++i) {
+            if (previouslyOwned.at(i) && !owned.at(i)) {
+                const QPair<int, int> &range {rowIndexToRange(i)};
+                m_ledStrip->setBrightness(range.first, range.second, LED_MAX_BRIGHTNESS);
+
+                if (!m_animating) {
+                    m_ledStrip->setColor(range.first, range.second, m_averageColor);
+                }
+            }
+        }
+    }
+
+    syncBrightness(false /* show */);
+
+    for (ShelfZone *zone : std::as_const(m_zones)) {
+        if (zone->shelfModel() != this) {
+            zone->setShelfModel(this); // Calls `ShelfZone::updateRanges`.
+        } else {
+            zone->updateRanges();
+        }
+    }
+
+    updateAnimation();
+
+    m_ledStrip->update();
+
+    scheduleSquaresChanged();
+}
+
+void ShelfModel::clearWalls()
+{
+    if (m_wallThickness < 1) {
+        return;
+    }
+
+    const int rowLength {m_columns * m_density + (m_columns - 1) * m_wallThickness};
+
+    for (const QPair<int, int> &range : std::as_const(m_squareRanges)) {
+        // Every compartment but the last on a board is followed by a wall.
+        if ((range.first % rowLength) + m_density < rowLength) {
+            m_ledStrip->clear(range.second + 1, range.second + m_wallThickness);
+        }
+    }
+}
+
+QVector<QPair<int, int>> ShelfModel::modelRanges() const
+{
+    if (!m_ledStrip) {
+        return {};
+    }
+
+    if (!m_hasZones) {
+        return {QPair<int, int>(0, m_ledStrip->count() - 1)};
+    }
+
+    QVector<QPair<int, int>> ranges;
+
+    for (int i {0}; i < m_zoneOwned.size(); ++i) {
+        if (!m_zoneOwned.at(i)) {
+            ranges.append(rowIndexToRange(i));
+        }
+    }
+
+    return ranges;
+}
+
+bool ShelfModel::ownsSquares() const
+{
+    return !m_hasZones || m_zoneOwned.contains(false);
+}
+
+void ShelfModel::zonesAppend(QQmlListProperty<ShelfZone> *list, ShelfZone *zone)
+{
+    static_cast<ShelfModel *>(list->object)->addZone(zone);
+}
+
+qsizetype ShelfModel::zonesCount(QQmlListProperty<ShelfZone> *list)
+{
+    return static_cast<ShelfModel *>(list->object)->m_zones.size();
+}
+
+ShelfZone *ShelfModel::zonesAt(QQmlListProperty<ShelfZone> *list, qsizetype index)
+{
+    return static_cast<ShelfModel *>(list->object)->m_zones.at(index);
+}
+
+void ShelfModel::zonesClear(QQmlListProperty<ShelfZone> *list)
+{
+    static_cast<ShelfModel *>(list->object)->clearZones();
+}
+
+void ShelfModel::updateLayers()
+{
+    if ((m_createdByQml && !m_complete) || !m_ledStrip) {
+        return;
+    }
+
+    // Like the animation, layers keep running while the shelf fades out.
+    const bool run {m_enabled || m_brightnessTransition.state() != QAbstractAnimation::Stopped};
+    const QVector<QPair<int, int>> ranges {modelRanges()};
+
+    QVector<LedStrip::Layer> layers;
+
+    for (AnimationLayer *layer : std::as_const(m_layers)) {
+        const bool active {run && layer->enabled() && layer->animation() && !ranges.isEmpty()};
+
+        if (layer->animation()) {
+            layer->animation()->setSquares(m_squareRanges);
+        }
+
+        layer->updateAnimation(&m_renderLoop, m_ledStrip->count(), ranges, active);
+
+        if (active) {
+            layers.append({layer->buffer(), layer->blendMode(), layer->opacity(), ranges});
+        }
+    }
+
+    if (layers.isEmpty() && m_ledStrip->layers().isEmpty()) {
+        return;
+    }
+
+    m_ledStrip->setLayers(layers);
+    m_ledStrip->update();
+}
+
+void ShelfModel::layersAppend(QQmlListProperty<AnimationLayer> *list, AnimationLayer *layer)
+{
+    static_cast<ShelfModel *>(list->object)->addLayer(layer);
+}
+
+qsizetype ShelfModel::layersCount(QQmlListProperty<AnimationLayer> *list)
+{
+    return static_cast<ShelfModel *>(list->object)->m_layers.size();
+}
+
+AnimationLayer *ShelfModel::layersAt(QQmlListProperty<AnimationLayer> *list, qsizetype index)
+{
+    return static_cast<ShelfModel *>(list->object)->m_layers.at(index);
+}
+
+void ShelfModel::layersClear(QQmlListProperty<AnimationLayer> *list)
+{
+    static_cast<ShelfModel *>(list->object)->clearLayers();
+}
+
+void ShelfModel::transitionToCurrentBrightness()
+{
+    const qreal from {m_enabled ? 0.0 : m_brightness};
+    const qreal to {m_enabled ? m_brightness : 0.0};
+    const qreal delta {std::abs(m_brightness - to) ? std::abs(m_brightness - to) : 1.0};
+
+    startBrightnessTransition(from, to, delta);
+}
+
+void ShelfModel::startBrightnessTransition(qreal from, qreal to, qreal delta)
+{
+    m_targetBrightness = to;
+    m_fromLightness = ColorSpace::toLightness(from);
+    m_toLightness = ColorSpace::toLightness(to);
+
+    m_brightnessTransition.setDuration(m_transitionDuration * delta);
+    m_brightnessTransition.start();
+}
+
+qreal ShelfModel::transitionProgress(const QVariantAnimation &transition) const
+{
+    const int duration {transition.duration()};
+
+    return m_transitionEasing->valueForProgress(duration > 0
+        ? static_cast<qreal>(transition.currentTime()) / duration : 1.0);
+}
+
+void ShelfModel::syncBrightness(bool show /* Defaults to true */)
+{
+    if (!m_ledStrip) {
+        return;
+    }
+
+    if (m_brightnessTransition.state() != QAbstractAnimation::Stopped) {
+        const qreal progress {transitionProgress(m_brightnessTransition)};
+
+        // Lands on the target exactly, which a round trip through lightness
+        // may miss by a rounding error.
+        m_appliedBrightness = progress >= 1.0 ? m_targetBrightness
+            : ColorSpace::fromLightness(m_fromLightness * (1.0 - progress) + m_toLightness * progress);
+    } else {
+        m_appliedBrightness = m_enabled ? m_brightness : 0.0;
+    }
+
+    // Compartments owned by zones keep the brightness the zones give them,
+    // also while the shelf is turned off or fading.
+    QVector<QPair<int, int>> zoneRanges;
+
+    for (int i {0}; m_hasZones && i < std::min(m_zoneOwned.size(), m_squareRanges.size()); ++i) {
+        if (m_zoneOwned.at(i)) {
+            zoneRanges.append(rowIndexToRange(i));
+        }
+    }
+
+    // Applied by the strip's output stage, leaving the LED data untouched.
+    m_ledStrip->setGlobalBrightnessExemptRanges(zoneRanges);
+    m_ledStrip->setGlobalBrightness(m_appliedBrightness);
+
+    if (show) { // Defaults to true.
+        showLedStrip();
+    }
+}
+
+void ShelfModel::setRangesToColor(const QColor &color)
+{
+    if (!m_ledStrip) {
+        return;
+    }
+
+    // Leave the compartments owned by zones alone.
+    if (m_hasZones) {
+        for (const QPair<int, int> &range : modelRanges()) {
+            m_ledStrip->setColor(range.first, range.second, color);
+        }
+
+        return;
+    }
+
+    m_ledStrip->clear();
+
+    for (int i {0}; i < rowCount(); ++i) {
+        const QPair <int, int> &range {rowIndexToRange(i)};
+        m_ledStrip->setColor(range.first, range.second, color);
+    }
+}
+
+void ShelfModel::abortTransitions()
+{
+    finishSceneTransition();
+
+    if (m_averageColorTransition.state() != QAbstractAnimation::Stopped) {
+        m_averageColorTransition.stop();
+        setRangesToColor(m_averageColor);
+    }
+
+    if (m_brightnessTransition.state() != QAbstractAnimation::Stopped) {
+        m_brightnessTransition.stop();
+    }
+}
+
+void ShelfModel::applyTimeline(qint64 time)
+{
+    if (!m_ledStrip) {
+        return;
+    }
+
+    m_applyingTimeline = true;
+
+    // Don't skip what is due at the very end when starting over.
+    if (time < m_timelinePosition) {
+        applyTimeline(m_timeline.duration());
+        m_applyingTimeline = true;
+    }
+
+    m_timelinePosition = time;
+    m_timeline.advance(time, &m_timelineUpdate);
+
+    if (!m_timelineUpdate.colors.isEmpty()) {
+        // Disable animation implicitly.
+        if (m_animating) {
+            m_ledStrip->forgetSavedData();
+            setAnimating(false);
+        }
+
+        updateSquareColors();
+
+        for (const QPair<int, QRgb> &color : std::as_const(m_timelineUpdate.colors)) {
+            // Leave the compartments owned by zones alone.
+            if (color.first >= rowCount() || (m_hasZones && m_zoneOwned.value(color.first))) {
+                continue;
+            }
+
+            const QPair<int, int> &range {rowIndexToRange(color.first)};
+            m_ledStrip->setColor(range.first, range.second, QColor {color.second});
+
+            setSquareColor(color.first, color.second);
+        }
+
+        emitSquaresChanged();
+    }
+
+    if (m_timelineUpdate.hasBrightness) {
+        m_brightness = m_timelineUpdate.brightness;
+        syncBrightness(false /* show */);
+
+        Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0), {AverageBrightness});
+    }
+
+    for (const Timeline::Event &event : std::as_const(m_timelineUpdate.events)) {
+        switch (event.type) {
+            case Timeline::Event::Animating:
+                setAnimating(event.value.toBool());
+                break;
+            case Timeline::Event::Scene:
+                recallScene(event.value.toString());
+                break;
+        }
+    }
+
+    if (!m_timelineUpdate.colors.isEmpty() || m_timelineUpdate.hasBrightness) {
+        m_ledStrip->update();
+
+        if (!m_timelineNotifyTimer.isActive()) {
+            m_timelineNotifyTimer.start();
+        }
+    }
+
+    m_applyingTimeline = false;
+}
+
+void ShelfModel::interruptTimeline()
+{
+    if (!m_applyingTimeline) {
+        stopTimeline();
+    }
+}
+
+void ShelfModel::scheduleSnapshot()
+{
+    if (!m_snapshotTimer.isActive()) {
+        m_snapshotTimer.start();
+    }
+}
+
+void ShelfModel::publishSnapshot()
+{
+    Snapshot *snapshot {m_snapshots.beginWrite()};
+
+    snapshot->enabled = m_enabled;
+    snapshot->animating = m_animating;
+    snapshot->brightness = m_brightness;
+    snapshot->averageColor = averageColor().rgb();
+    snapshot->rows = m_rows;
+    snapshot->columns = m_columns;
+
+    updateSquareColors();
+
+    // Copied rather than shared, so the snapshot keeps its own buffer for
+    // reuse.
+    snapshot->squares.resize(rowCount());
+
+    for (int i {0}; i < snapshot->squares.size(); ++i) {
+        snapshot->squares[i] = i < m_squareColors.size() ? m_squareColors.at(i) : qRgb(0, 0, 0);
+    }
+
+    m_snapshots.publish();
+}
+
+void ShelfModel::applyCommands()
+{
+    m_drainedCommands.clear();
+
+    Command command;
+
+    while (m_commands.pop(command)) {
+        m_drainedCommands.append(command);
+    }
+
+    // Walk backwards to keep only the last change to each property, and to
+    // drop compartment colors painted over later anyway.
+    bool seen[Command::RecallScene + 1] {};
+    bool repainted {false};
+
+    m_keptCommands.clear();
+    m_commandedSquares.fill(false, rowCount());
+
+    for (auto it {m_drainedCommands.crbegin()}; it != m_drainedCommands.crend(); ++it) {
+        switch (it->type) {
+            case Command::SetSquareColor:
+                if (repainted || it->square < 0 || it->square >= rowCount()
+                    || m_commandedSquares.at(it->square)) {
+                    continue;
+                }
+
+                m_commandedSquares[it->square] = true;
+                break;
+            case Command::SetAverageColor:
+                if (seen[it->type] || repainted) {
+                    continue;
+                }
+
+                repainted = true;
+                break;
+            case Command::RecallScene:
+                if (seen[it->type]) {
+                    continue;
+                }
+
+                // Painted over later, but the scene's brightness still
+                // applies unless changed later as well.
+                if (repainted) {
+                    const SceneStore::Scene *scene {m_sceneStore.scene(it->value.toString())};
+
+                    if (scene && !seen[Command::SetBrightness]) {
+                        seen[Command::SetBrightness] = true;
+                        m_keptCommands.append(Command {Command::SetBrightness, scene->brightness});
+                    }
+
+                    seen[it->type] = true;
+                    continue;
+                }
+
+                repainted = true;
+                break;
+            default:
+                if (seen[it->type]) {
+                    continue;
+                }
+        }
+
+        seen[it->type] = true;
+        m_keptCommands.append(*it);
+    }
+
+    // Compartment colors are painted one after another, then shown and
+    // announced once, before any other command sees the result.
+    bool paintedSquares {false};
+
+    const auto finishPainting = [&]() {
+        if (paintedSquares) {
+            finishPaintingSquares();
+            paintedSquares = false;
+        }
+    };
+
+    // The render loop writes the strip out once after this, rather than
+    // each command showing it.
+    m_applyingCommands = true;
+
+    for (auto it {m_keptCommands.crbegin()}; it != m_keptCommands.crend(); ++it) {
+        if (it->type != Command::SetSquareColor) {
+            finishPainting();
+        }
+
+        switch (it->type) {
+            case Command::SetEnabled:
+                setEnabled(it->value.toBool());
+                break;
+            case Command::SetBrightness:
+                setBrightness(it->value.toReal());
+                break;
+            case Command::SetAverageColor:
+                setAverageColor(it->value.value<QColor>());
+                break;
+            case Command::SetSquareColor:
+                if (m_ledStrip && it->value.canConvert(QMetaType(QMetaType::QColor))) {
+                    interruptTimeline();
+                    paintedSquares = paintSquare(it->square, it->value.value<QColor>()) || paintedSquares;
+                }
+
+                break;
+            case Command::SetAnimating:
+                setAnimating(it->value.toBool());
+                break;
+            case Command::RecallScene:
+                recallScene(it->value.toString(), it->animate);
+                break;
+        }
+    }
+
+    finishPainting();
+
+    m_applyingCommands = false;
+}
+
+void ShelfModel::showLedStrip()
+{
+    if (m_applyingCommands) {
+        m_ledStrip->update();
+    } else {
+        m_ledStrip->show();
+    }
+}
+
+void ShelfModel::finishSceneTransition()
+{
+    if (m_sceneTransition.state() != QAbstractAnimation::Stopped) {
+        m_sceneTransition.stop();
+        paintScene(1.0);
+    }
+
+    m_sceneFrom.clear();
+    m_sceneFromColors.clear();
+    m_sceneToColors.clear();
+}
+
+void ShelfModel::prepareSceneTransition()
+{
+    const int count {static_cast<int>(m_sceneTo.size() / sizeof(uint32_t))};
+
+    m_sceneFromColors.resize(count);
+    m_sceneToColors.resize(count);
+
+    const uint8_t *from {reinterpret_cast<const uint8_t *>(m_sceneFrom.constData())};
+    const uint8_t *to {reinterpret_cast<const uint8_t *>(m_sceneTo.constData())};
+
+    // Converted once, so the frames of the crossfade only mix and convert
+    // back.
+    for (int i {0}; i < count; ++i) {
+        m_sceneFromColors[i] = ColorSpace::toOklab(ledRgb(from + i * 4));
+        m_sceneToColors[i] = ColorSpace::toOklab(ledRgb(to + i * 4));
+    }
+}
+
+void ShelfModel::paintScene(qreal progress)
+{
+    if (!m_ledStrip || m_sceneTo.size() != static_cast<qsizetype>(m_ledStrip->count() * sizeof(uint32_t))) {
+        return;
+    }
+
+    const bool blend {progress < 1.0 && m_sceneFrom.size() == m_sceneTo.size()
+        && m_sceneToColors.size() * static_cast<qsizetype>(sizeof(uint32_t)) == m_sceneTo.size()};
+
+    const uint8_t *from {reinterpret_cast<const uint8_t *>(m_sceneFrom.constData())};
+    const uint8_t *to {reinterpret_cast<const uint8_t *>(m_sceneTo.constData())};
+    uint8_t *data {reinterpret_cast<uint8_t *>(m_ledStrip->data())};
+
+    // Leave the compartments owned by zones alone.
+    for (const QPair<int, int> &range : modelRanges()) {
+        const int first {range.first * 4};
+        const int end {(range.second + 1) * 4};
+
+        if (!blend) {
+            memcpy(data + first, to + first, end - first);
+            continue;
+        }
+
+        for (int i {first}; i < end; i += 4) {
+            // The brightness byte is taken as is.
+            data[i] = to[i];
+
+            if (memcmp(from + i + 1, to + i + 1, 3) == 0) {
+                memcpy(data + i + 1, to + i + 1, 3);
+                continue;
+            }
+
+            const QRgb color {ColorSpace::fromOklab(ColorSpace::mix(m_sceneFromColors.at(i / 4),
+                m_sceneToColors.at(i / 4), progress))};
+
+            data[i + 1] = qBlue(color);
+            data[i + 2] = qGreen(color);
+            data[i + 3] = qRed(color);
+        }
+    }
+}
+
+void ShelfModel::updateLedStrip()
+{
+    m_squareCount = m_rows * m_columns;
+
+    if (!m_ledStrip) {
+        return;
+    }
+
+    finishSceneTransition();
+
+    // Compartment indices no longer match those of the timeline.
+    stopTimeline();
+
+    m_updatingGeometry = true;
+    m_ledStrip->setCount(ledCount());
+    m_updatingGeometry = false;
+
+    if (!m_animating) {
+        setRangesToColor(m_averageColor);
+    }
+
+    updateZones();
+}
+
+void ShelfModel::updateGeometry(int rows, int columns, int density, int wallThickness)
+{
+    const int oldRows {m_rows};
+    const int oldColumns {m_columns};
+    const bool layoutChanged {m_density != density || m_wallThickness != wallThickness};
+
+    if ((m_createdByQml && !m_complete) || !m_ledStrip) {
+        const bool reset {!m_createdByQml || m_complete};
+
+        if (reset) {
+            beginResetModel();
+        }
+
+        m_rows = rows;
+        m_columns = columns;
+        m_density = density;
+        m_wallThickness = wallThickness;
+        m_squareCount = m_rows * m_columns;
+        updateSquareRanges();
+
+        if (reset) {
+            endResetModel();
+        }
+
+        return;
+    }
+
+    // Remember the square colors so we can repaint them at their new
+    // positions in the strip. While animating the animation takes
+    // care of the strip contents.
+    QVector<QColor> colors;
+
+    if (!m_animating) {
+        colors = squareColors();
+    }
+
+    m_rows = rows;
+    m_columns = columns;
+    m_density = density;
+    m_wallThickness = wallThickness;
+    updateSquareRanges();
+
+    m_updatingGeometry = true;
+    m_ledStrip->setCount(ledCount());
+    m_updatingGeometry = false;
+
+    if (!m_animating) {
+        m_ledStrip->clear();
+
+        for (int i {0}; i < m_rows * m_columns; ++i) {
+            const int row {i / m_columns};
+            const int column {i % m_columns};
+            const QPair<int, int> &range {rowIndexToRange(i)};
+
+            // New squares are filled with the last full-shelf color.
+            m_ledStrip->setColor(range.first, range.second,
+                (row < oldRows && column < oldColumns)
+                ? colors.at(row * oldColumns + column) : m_averageColor);
+        }
+    }
+
+    // Resizing and clearing the strip resets the brightness of LEDs.
+    syncBrightness(); // Calls `LedStrip::show`.
+
+    // Columns are inserted or removed at the end of each board. Boards
+    // are processed top to bottom, so the boards above the one being
+    // processed already have the new number of columns.
+    for (int row {0}; row < oldRows && columns != oldColumns; ++row) {
+        if (columns > oldColumns) {
+            beginInsertRows(QModelIndex(), row * columns + oldColumns, row * columns + columns - 1);
+            m_squareCount += columns - oldColumns;
+            endInsertRows();
+        } else {
+            beginRemoveRows(QModelIndex(), row * columns + columns, row * columns + oldColumns - 1);
+            m_squareCount -= oldColumns - columns;
+            endRemoveRows();
+        }
+    }
+
+    // Boards are added or removed at the bottom of the shelf.
+    if (rows > oldRows) {
+        beginInsertRows(QModelIndex(), oldRows * columns, rows * columns - 1);
+        m_squareCount = rows * columns;
+        endInsertRows();
+    } else if (rows < oldRows) {
+        beginRemoveRows(QModelIndex(), rows * columns, oldRows * columns - 1);
+        m_squareCount = rows * columns;
+        endRemoveRows();
+    }
+
+    // Zones span columns, so their compartments may have moved.
+    updateZones();
+
+    // Square colors were carried over, so there's nothing for views to
+    // update unless the squares are backed by different LEDs now.
+    updateSquareColors();
+    m_dirtyFirst = -1;
+    m_dirtyLast = -1;
+
+    if (layoutChanged || m_animating) {
+        Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0));
+    }
+
+    Q_EMIT averageColorChanged(averageColor());
+}
+
+QVector<QColor> ShelfModel::squareColors() const
+{
+    updateSquareColors();
+
+    QVector<QColor> colors;
+    colors.reserve(m_squareColors.size());
+
+    for (const QRgb color : m_squareColors) {
+        colors.append(QColor {color});
+    }
+
+    return colors;
+}
+
+void ShelfModel::updateAnimation()
+{
+    updateLayers();
+
+    if (!m_animation) {
+        return;
+    }
+
+    m_animation->setSquares(m_squareRanges);
+
+    // Zones may cover the entire shelf.
+    if (m_enabled && m_animating && ownsSquares()) {
+        if (!m_animation->running()) {
+            finishSceneTransition();
+            m_animation->start();
+        }
+    } else if (m_brightnessTransition.state() == QAbstractAnimation::Stopped) {
+        if (m_animation->running()) {
             m_animation->stop();
         }
     }
 }
 
+bool ShelfModel::restoreState()
+{
+    if (m_stateFile.fileName().isEmpty() || !m_ledStrip) {
+        return false;
+    }
+
+    StateFile::State state;
+
+    if (!StateFile::read(m_stateFile.fileName(), &state)) {
+        return false;
+    }
+
+    if (!m_ledStrip->loadData(state.frame)) {
+        return false;
+    }
+
+    m_enabled = state.enabled;
+    m_brightness = state.brightness;
+    m_averageColor = state.averageColor;
+    m_animating = state.animating && m_animation
+        && state.animation == m_animation->metaObject()->className();
+
+    qCInfo(HYELICHT) << i18n("Restored shelf state from: %1", m_stateFile.fileName());
+
+    Q_EMIT enabledChanged(m_enabled);
+    Q_EMIT brightnessChanged(m_brightness);
+    Q_EMIT animatingChanged(m_animating);
+    Q_EMIT averageColorChanged(averageColor());
+
+    return true;
+}
+
+void ShelfModel::scheduleStateWrite()
+{
+    if (m_stateFile.fileName().isEmpty() || (m_createdByQml && !m_complete)) {
+        return;
+    }
+
+    if (!m_stateWriteTimer.isActive()) {
+        m_stateWriteTimer.start();
+    }
+}
+
+void ShelfModel::writeState()
+{
+    if (!m_ledStrip) {
+        return;
+    }
+
+    StateFile::State state;
+    state.enabled = m_enabled;
+    state.animating = m_animating;
+    state.brightness = m_brightness;
+    state.averageColor = m_averageColor;
+
+    if (m_animation) {
+        state.animation = m_animation->metaObject()->className();
+    }
+
+    m_stateFile.write(state, m_ledStrip->constData(), m_ledStrip->count());
+}
+
 void ShelfModel::updateRemoting()
 {
     if (!m_remotingEnabled && m_remotingServer) {
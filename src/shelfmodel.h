@@ -5,16 +5,30 @@
 
 #pragma once
 
+#include "hyelicht_core_export.h"
+
 #include <QAbstractListModel>
 #include <QColor>
 #include <QPointer>
+#include <QQmlListProperty>
 #include <QQmlParserStatus>
 #include <QRemoteObjectHost>
+#include <QTimer>
 #include <QUrl>
 #include <QVariantAnimation>
 
 #include "abstractanimation.h"
+#include "animationlayer.h"
+#include "colorspace.h"
+#include "easingtable.h"
 #include "ledstrip.h"
+#include "mpscqueue.h"
+#include "renderloop.h"
+#include "scenestore.h"
+#include "shelfzone.h"
+#include "snapshotpublisher.h"
+#include "statefile.h"
+#include "timeline.h"
 
 //! Data model and business logic specific to the Hyelicht shelf
 /*!
@@ -34,6 +48,10 @@
  * This allows running the onboard GUI out of process and also enables the
  * PC/Android offboard instances of the application.
  *
+ * The shelf can be split into independently controlled ShelfZone instances
+ * using the \ref zones property. Additional animations can be stacked on top
+ * of the shelf using AnimationLayer instances in the \ref layers property.
+ *
  * Communication between RemoteShelfModel and ShelfModel is implemented using
  * [Qt Remote Objects](https://doc.qt.io/qt-5/qtremoteobjects-index.html).
  *
@@ -44,7 +62,7 @@
  * \sa QAbstractListModel
  * \sa QQmlParserStatus
  */
-class ShelfModel : public QAbstractListModel, public QQmlParserStatus
+class HYELICHT_CORE_EXPORT ShelfModel : public QAbstractListModel, public QQmlParserStatus
 {
     Q_OBJECT
     Q_INTERFACES(QQmlParserStatus)
@@ -146,6 +164,9 @@ class ShelfModel : public QAbstractListModel, public QQmlParserStatus
 
     //! Toggle animated transitions between brightness levels.
     /*!
+    * Transitions fade evenly in perceived lightness rather than in brightness
+    * level, see ColorSpace::toLightness.
+    *
     * Defaults to \c true.
     *
     * \sa setAnimateBrightnessTransitions
@@ -175,6 +196,8 @@ class ShelfModel : public QAbstractListModel, public QQmlParserStatus
 
     //! Toggle animated transitions between full-shelf color fills.
     /*!
+    * Colors are interpolated in the OKLab color space, see ColorSpace.
+    *
     * Defaults to \c true.
     *
     * \sa setAnimateAverageColorTransitions
@@ -202,6 +225,45 @@ class ShelfModel : public QAbstractListModel, public QQmlParserStatus
     */
     Q_PROPERTY(int transitionDuration READ transitionDuration WRITE setTransitionDuration NOTIFY transitionDurationChanged)
 
+    //! Number of frames per second rendered for the \ref animation, zones and transitions.
+    /*!
+    * All of them are rendered by a single RenderLoop, which writes each frame out to
+    * \ref ledStrip at once.
+    *
+    * Defaults to \c 60.
+    *
+    * \sa setFrameRate
+    * \sa frameRateChanged
+    * \sa renderLoop
+    */
+    Q_PROPERTY(int frameRate READ frameRate WRITE setFrameRate NOTIFY frameRateChanged)
+
+    //! Whether the \ref animation and zones are rendered on a separate render thread.
+    /*!
+    * Keeps rendering from competing with the user interface, network APIs and
+    * remoting on the GUI thread. See RenderLoop::threaded.
+    *
+    * Defaults to \c false.
+    *
+    * \sa setThreadedRendering
+    * \sa threadedRenderingChanged
+    * \sa renderLoop
+    */
+    Q_PROPERTY(bool threadedRendering READ threadedRendering WRITE setThreadedRendering NOTIFY threadedRenderingChanged)
+
+    //! Whether to lower the frame rate while the \ref animation and zones don't change visibly.
+    /*!
+    * Saves CPU time and SPI bandwidth on slow ambient effects. See
+    * RenderLoop::adaptiveFrameRate.
+    *
+    * Defaults to \c false.
+    *
+    * \sa setAdaptiveFrameRate
+    * \sa adaptiveFrameRateChanged
+    * \sa renderLoop
+    */
+    Q_PROPERTY(bool adaptiveFrameRate READ adaptiveFrameRate WRITE setAdaptiveFrameRate NOTIFY adaptiveFrameRateChanged)
+
     //! Animation to operate on \ref ledStrip.
     /*!
     * When set, the animation will be started or stopped based on the value of \ref animating.
@@ -228,6 +290,30 @@ class ShelfModel : public QAbstractListModel, public QQmlParserStatus
     */
     Q_PROPERTY(bool animating READ animating WRITE setAnimating NOTIFY animatingChanged)
 
+    //! Independently controlled zones of the shelf.
+    /*!
+    * Enabled zones own the compartments they span. Painting operations and the
+    * \ref animation of the model only affect the remaining compartments, and so
+    * do \ref brightness and \ref enabled.
+    *
+    * \sa ShelfZone
+    * \sa addZone
+    * \sa clearZones
+    */
+    Q_PROPERTY(QQmlListProperty<ShelfZone> zones READ zones)
+
+    //! Animations composited on top of the shelf.
+    /*!
+    * Layers are blended on top of the painted compartments and the \ref animation
+    * in order, covering the compartments not owned by \ref zones. They run while
+    * the shelf is \ref enabled, independent of \ref animating.
+    *
+    * \sa AnimationLayer
+    * \sa addLayer
+    * \sa clearLayers
+    */
+    Q_PROPERTY(QQmlListProperty<AnimationLayer> layers READ layers)
+
     //! Toggle the remoting API server.
     /*!
     * When enabled acts as an API server for instances of RemoteShelfModel, which act as
@@ -255,6 +341,49 @@ class ShelfModel : public QAbstractListModel, public QQmlParserStatus
     */
     Q_PROPERTY(QUrl listenAddress READ listenAddress WRITE setListenAddress NOTIFY listenAddressChanged)
 
+    //! Path to a file persisting the shelf state across restarts.
+    /*!
+    * When set, the last frame, \ref enabled, \ref brightness, \ref averageColor and
+    * \ref animating are written to this file shortly after they change, and restored
+    * from it when the model is first set up. See StateFile.
+    *
+    * Defaults to an empty string, which disables persistence.
+    *
+    * \sa setStateFileName
+    * \sa stateFileNameChanged
+    */
+    Q_PROPERTY(QString stateFileName READ stateFileName WRITE setStateFileName NOTIFY stateFileNameChanged)
+
+    //! Path to a file storing the \ref scenes.
+    /*!
+    * The scenes in the file are loaded into memory when this is set. See
+    * SceneStore.
+    *
+    * Defaults to an empty string, which keeps scenes in memory only.
+    *
+    * \sa setSceneFileName
+    * \sa sceneFileNameChanged
+    */
+    Q_PROPERTY(QString sceneFileName READ sceneFileName WRITE setSceneFileName NOTIFY sceneFileNameChanged)
+
+    //! Names of the stored scenes.
+    /*!
+    * A scene is a snapshot of the shelf, stored with \ref saveScene and shown
+    * again with \ref recallScene.
+    *
+    * \sa scenesChanged
+    * \sa sceneFileName
+    */
+    Q_PROPERTY(QStringList scenes READ scenes NOTIFY scenesChanged)
+
+    //! Whether a Timeline is being played back.
+    /*!
+    * \sa playTimeline
+    * \sa stopTimeline
+    * \sa timelineRunningChanged
+    */
+    Q_PROPERTY(bool timelineRunning READ timelineRunning NOTIFY timelineRunningChanged)
+
     public:
         //! Non-standard model data roles offered by this model.
         enum AdditionalRoles : int {
@@ -266,6 +395,34 @@ class ShelfModel : public QAbstractListModel, public QQmlParserStatus
         };
         Q_ENUM(AdditionalRoles)
 
+        //! A change to the shelf state queued with \ref postCommand.
+        struct Command {
+            enum Type {
+                SetEnabled, //!< Calls \ref setEnabled with \c value.
+                SetBrightness, //!< Calls \ref setBrightness with \c value.
+                SetAverageColor, //!< Calls \ref setAverageColor with \c value.
+                SetSquareColor, //!< Paints \c square with \c value like \ref setData.
+                SetAnimating, //!< Calls \ref setAnimating with \c value.
+                RecallScene //!< Calls \ref recallScene with \c value and \c animate.
+            };
+
+            Type type {SetEnabled}; //!< What changes.
+            QVariant value; //!< The value to change to.
+            int square {-1}; //!< Index of the compartment, for \c SetSquareColor.
+            bool animate {false}; //!< Whether to crossfade, for \c RecallScene.
+        };
+
+        //! The shelf state as of a frame, see \ref snapshot.
+        struct Snapshot {
+            bool enabled {false}; //!< See \ref enabled.
+            bool animating {false}; //!< See \ref animating.
+            qreal brightness {0.0}; //!< See \ref brightness.
+            QRgb averageColor {0}; //!< See \ref averageColor.
+            int rows {0}; //!< See \ref rows.
+            int columns {0}; //!< See \ref columns.
+            QVector<QRgb> squares; //!< Color of each compartment, by index.
+        };
+
         //! Create a shelf model.
         /*!
         * @param parent Parent object
@@ -544,6 +701,64 @@ class ShelfModel : public QAbstractListModel, public QQmlParserStatus
         */
         void setTransitionDuration(int duration);
 
+        //! The number of frames per second rendered for the \ref animation, zones and transitions.
+        /*!
+        * @return Frames per second.
+        * \sa frameRate (property)
+        * \sa setFrameRate
+        * \sa frameRateChanged
+        */
+        int frameRate() const;
+
+        //! Set the number of frames per second rendered for the \ref animation, zones and transitions.
+        /*!
+        * @param frameRate Frames per second.
+        * \sa frameRate
+        * \sa frameRateChanged
+        */
+        void setFrameRate(int frameRate);
+
+        //! Whether the \ref animation and zones are rendered on a separate render thread.
+        /*!
+        * @return Render thread on or off.
+        * \sa threadedRendering (property)
+        * \sa setThreadedRendering
+        * \sa threadedRenderingChanged
+        */
+        bool threadedRendering() const;
+
+        //! Set whether the \ref animation and zones are rendered on a separate render thread.
+        /*!
+        * @param threaded Render thread on or off.
+        * \sa threadedRendering
+        * \sa threadedRenderingChanged
+        */
+        void setThreadedRendering(bool threaded);
+
+        //! Whether to lower the frame rate while the \ref animation and zones don't change visibly.
+        /*!
+        * @return Adaptive frame rate on or off.
+        * \sa adaptiveFrameRate (property)
+        * \sa setAdaptiveFrameRate
+        * \sa adaptiveFrameRateChanged
+        */
+        bool adaptiveFrameRate() const;
+
+        //! Set whether to lower the frame rate while the \ref animation and zones don't change visibly.
+        /*!
+        * @param adaptive Adaptive frame rate on or off.
+        * \sa adaptiveFrameRate
+        * \sa adaptiveFrameRateChanged
+        */
+        void setAdaptiveFrameRate(bool adaptive);
+
+        //! The RenderLoop rendering the \ref animation, zones and transitions.
+        /*!
+        * @return A RenderLoop.
+        * \sa frameRate
+        */
+        RenderLoop *renderLoop();
+
         //! The animation operating on \ref ledStrip.
         /*!
         * @return An AbstractAnimation.
@@ -590,6 +805,87 @@ class ShelfModel : public QAbstractListModel, public QQmlParserStatus
         */
         void setAnimating(bool animating);
 
+        //! The independently controlled zones of the shelf.
+        /*!
+        * @return A QML list property.
+        * \sa zones (property)
+        * \sa addZone
+        * \sa clearZones
+        */
+        QQmlListProperty<ShelfZone> zones();
+
+        //! Add a zone to the shelf.
+        /*!
+        * @param zone A ShelfZone.
+        * \sa zones
+        * \sa clearZones
+        */
+        void addZone(ShelfZone *zone);
+
+        //! Remove all zones from the shelf.
+        /*!
+        * The compartments owned by the zones are returned to the model.
+        *
+        * \sa zones
+        * \sa addZone
+        */
+        void clearZones();
+
+        //! The ranges of LEDs in \ref ledStrip covered by each shelf compartment.
+        /*!
+        * @return A list of LED ranges, in the order of the rows of the model.
+        * \sa AbstractAnimation::squares
+        */
+        QVector<QPair<int, int>> squareRanges() const;
+
+        //! The number of LEDs the shelf needs in \ref ledStrip.
+        /*!
+        * Covers all compartments and the walls between them in each row.
+        *
+        * @return Number of LEDs.
+        * \sa rows
+        * \sa columns
+        * \sa density
+        * \sa wallThickness
+        */
+        int ledCount() const;
+
+        //! The ranges of LEDs in \ref ledStrip spanned by a range of columns.
+        /*!
+        * Covers the compartments in the given columns on all boards, with adjacent
+        * ranges merged.
+        *
+        * @param firstColumn First column.
+        * @param columns Number of columns.
+        * @return A list of LED ranges, sorted by index.
+        * \sa ShelfZone
+        */
+        QVector<QPair<int, int>> columnRanges(int firstColumn, int columns) const;
+
+        //! The animations composited on top of the shelf.
+        /*!
+        * @return A QML list property.
+        * \sa layers (property)
+        * \sa addLayer
+        * \sa clearLayers
+        */
+        QQmlListProperty<AnimationLayer> layers();
+
+        //! Add a layer on top of the shelf.
+        /*!
+        * @param layer An AnimationLayer.
+        * \sa layers
+        * \sa clearLayers
+        */
+        void addLayer(AnimationLayer *layer);
+
+        //! Remove all layers from the shelf.
+        /*!
+        * \sa layers
+        * \sa addLayer
+        */
+        void clearLayers();
+
         //! Whether to enable the remoting API server.
         /*!
         * @return Server on or off.
@@ -635,6 +931,171 @@ class ShelfModel : public QAbstractListModel, public QQmlParserStatus
         */
         void setListenAddress(const QUrl &url);
 
+        //! Path to the file persisting the shelf state across restarts.
+        /*!
+        * @return File path.
+        * \sa stateFileName (property)
+        * \sa setStateFileName
+        * \sa stateFileNameChanged
+        */
+        QString stateFileName() const;
+
+        //! Set the path to the file persisting the shelf state across restarts.
+        /*!
+        * @param fileName File path, or an empty string to disable persistence.
+        * \sa stateFileName
+        * \sa stateFileNameChanged
+        */
+        void setStateFileName(const QString &fileName);
+
+        //! Path to the file storing the scenes.
+        /*!
+        * @return File path.
+        * \sa sceneFileName (property)
+        * \sa setSceneFileName
+        * \sa sceneFileNameChanged
+        */
+        QString sceneFileName() const;
+
+        //! Set the path to the file storing the scenes.
+        /*!
+        * Replaces the scenes in memory with those stored in the file.
+        *
+        * @param fileName File path, or an empty string to keep scenes in memory only.
+        * \sa sceneFileName
+        * \sa sceneFileNameChanged
+        */
+        void setSceneFileName(const QString &fileName);
+
+        //! The names of the stored scenes.
+        /*!
+        * @return Scene names, in the order they were first stored.
+        * \sa scenes (property)
+        * \sa scenesChanged
+        */
+        QStringList scenes() const;
+
+        //! Store what the shelf currently shows as a scene.
+        /*!
+        * Captures the LED data of the current frame, including a running
+        * \ref animation, along with \ref brightness. Replaces a scene of the same
+        * name.
+        *
+        * @param name Name of the scene.
+        * @return Success.
+        * \sa recallScene
+        * \sa removeScene
+        */
+        Q_INVOKABLE bool saveScene(const QString &name);
+
+        //! Show a stored scene.
+        /*!
+        * Stops the \ref animation, enables the shelf and applies the brightness
+        * of the scene. Without \p animate the scene is copied to the strip as a
+        * whole and shown with the next frame; with it, the shelf crossfades to the
+        * scene over \ref transitionDuration.
+        *
+        * Compartments owned by \ref zones are left alone. Scenes stored for a
+        * shelf of a different size can't be recalled.
+        *
+        * @param name Name of the scene.
+        * @param animate Whether to crossfade to the scene.
+        * @return Success.
+        * \sa saveScene
+        * \sa scenes
+        */
+        Q_INVOKABLE bool recallScene(const QString &name, bool animate = false);
+
+        //! Remove a stored scene.
+        /*!
+        * @param name Name of the scene.
+        * @return Success.
+        * \sa saveScene
+        * \sa scenes
+        */
+        Q_INVOKABLE bool removeScene(const QString &name);
+
+        //! Play back a timeline.
+        /*!
+        * Replaces a timeline being played back and enables the shelf. The
+        * timeline is advanced by the render loop along with the \ref animation
+        * and transitions.
+        *
+        * While the timeline plays, \ref brightnessChanged and
+        * \ref averageColorChanged are emitted at most ten times a second,
+        * and once more when it stops.
+        *
+        * Changes made to the shelf in other ways while the timeline plays,
+        * e.g. through \ref setData, \ref setBrightness or \ref setEnabled, stop
+        * it, as does a change to the shelf geometry.
+        *
+        * @param timeline The timeline to play, see Timeline::fromJson.
+        * @return \c false if the timeline is empty.
+        * \sa stopTimeline
+        * \sa timelineRunning
+        */
+        bool playTimeline(const Timeline &timeline);
+
+        //! Stop playing back the timeline.
+        /*!
+        * The shelf keeps showing what the timeline last applied.
+        *
+        * \sa playTimeline
+        * \sa timelineRunning
+        */
+        Q_INVOKABLE void stopTimeline();
+
+        //! Whether a timeline is being played back.
+        /*!
+        * @return Playing or not.
+        * \sa timelineRunning (property)
+        * \sa timelineRunningChanged
+        */
+        bool timelineRunning() const;
+
+        //! The timeline played back last.
+        /*!
+        * @return A Timeline, empty if none was played yet.
+        * \sa playTimeline
+        * \sa timelinePosition
+        */
+        const Timeline &timeline() const;
+
+        //! The playback position in the timeline.
+        /*!
+        * @return Milliseconds from the start of the current loop, or \c -1
+        * if no timeline is being played back.
+        * \sa playTimeline
+        */
+        qint64 timelinePosition() const;
+
+        //! Queue a change to the shelf state.
+        /*!
+        * Safe to call from any thread, and never blocks. Queued changes are
+        * applied on the GUI thread at the start of the next frame of the
+        * render loop, in the order they were queued. Of several changes to
+        * the same property, or to the color of the same compartment, only
+        * the last one is applied, so a burst of changes costs a single frame.
+        * Changes to the colors of compartments are also dropped in favor of a
+        * later full-shelf color fill or scene. A scene followed by a color
+        * fill only has its brightness applied. The strip is written out once,
+        * after all changes are applied.
+        *
+        * @param command The change.
+        * @return \c false if the queue is full.
+        */
+        bool postCommand(const Command &command);
+
+        //! The shelf state as of the last frame.
+        /*!
+        * Safe to call from any thread, and never blocks or recomputes
+        * anything. A new snapshot is published once per frame in which the
+        * state changed, so reading it has no effect on painting.
+        *
+        * @return A reader for the snapshot, valid for as long as it is held.
+        */
+        SnapshotPublisher<Snapshot>::Reader snapshot() const;
+
         //! \sa \c QAbstractItemModel::roleNames
         QHash<int, QByteArray> roleNames() const override;
 
@@ -751,6 +1212,30 @@ class ShelfModel : public QAbstractListModel, public QQmlParserStatus
         */
         void transitionDurationChanged(int duration) const;
 
+        //! The number of frames per second rendered has changed.
+        /*!
+        * @param frameRate Frames per second.
+        * \sa frameRate
+        * \sa setFrameRate
+        */
+        void frameRateChanged(int frameRate) const;
+
+        //! Whether the \ref animation and zones are rendered on a separate render thread has changed.
+        /*!
+        * @param threaded Render thread on or off.
+        * \sa threadedRendering
+        * \sa setThreadedRendering
+        */
+        void threadedRenderingChanged(bool threaded) const;
+
+        //! Whether to lower the frame rate while the \ref animation and zones don't change visibly has changed.
+        /*!
+        * @param adaptive Adaptive frame rate on or off.
+        * \sa adaptiveFrameRate
+        * \sa setAdaptiveFrameRate
+        */
+        void adaptiveFrameRateChanged(bool adaptive) const;
+
         //! The animation operating on \ref ledStrip has changed.
         /*!
         * \sa animation
@@ -780,15 +1265,83 @@ class ShelfModel : public QAbstractListModel, public QQmlParserStatus
         */
         void listenAddressChanged() const;
 
+        //! The path to the file persisting the shelf state has changed.
+        /*!
+        * \sa stateFileName
+        * \sa setStateFileName
+        */
+        void stateFileNameChanged() const;
+
+        //! The path to the file storing the scenes has changed.
+        /*!
+        * \sa sceneFileName
+        * \sa setSceneFileName
+        */
+        void sceneFileNameChanged() const;
+
+        //! Scenes have been stored or removed.
+        /*!
+        * @param scenes The names of the stored scenes.
+        * \sa scenes
+        */
+        void scenesChanged(const QStringList &scenes) const;
+
+        //! A timeline has started or stopped playing back.
+        /*!
+        * @param running Playing or not.
+        * \sa timelineRunning
+        */
+        void timelineRunningChanged(bool running) const;
+
     private:
         inline QPair<int, int> rowIndexToRange(const int rowIndex) const;
         void transitionToCurrentBrightness();
+        void startBrightnessTransition(qreal from, qreal to, qreal delta);
+        qreal transitionProgress(const QVariantAnimation &transition) const;
         void syncBrightness(bool show = true);
         void setRangesToColor(const QColor &color);
         void abortTransitions();
+        void finishSceneTransition();
+        void prepareSceneTransition();
+        void paintScene(qreal progress);
+        void applyTimeline(qint64 time);
+        void interruptTimeline();
+        void applyCommands();
+        void scheduleSnapshot();
+        void publishSnapshot();
         void updateLedStrip();
+        void updateGeometry(int rows, int columns, int density, int wallThickness);
+        QVector<QColor> squareColors() const;
+        void updateSquareRanges();
+        void updateSquareColors() const;
+        QColor squareColor(int index) const;
+        void setSquareColor(int index, QRgb color);
+        bool paintSquare(int index, const QColor &color);
+        void finishPaintingSquares();
+        void markSquareDirty(int index) const;
+        void emitSquaresChanged();
+        void showLedStrip();
+        void scheduleSquaresChanged();
+        void updateZones();
+        void clearWalls();
+        QVector<QPair<int, int>> modelRanges() const;
+        bool ownsSquares() const;
+        static void zonesAppend(QQmlListProperty<ShelfZone> *list, ShelfZone *zone);
+        static qsizetype zonesCount(QQmlListProperty<ShelfZone> *list);
+        static ShelfZone *zonesAt(QQmlListProperty<ShelfZone> *list, qsizetype index);
+        static void zonesClear(QQmlListProperty<ShelfZone> *list);
+
+        void updateLayers();
+
+        static void layersAppend(QQmlListProperty<AnimationLayer> *list, AnimationLayer *layer);
+        static qsizetype layersCount(QQmlListProperty<AnimationLayer> *list);
+        static AnimationLayer *layersAt(QQmlListProperty<AnimationLayer> *list, qsizetype index);
+        static void layersClear(QQmlListProperty<AnimationLayer> *list);
         void updateAnimation();
         void updateRemoting();
+        bool restoreState();
+        void scheduleStateWrite();
+        void writeState();
 
         QPointer<LedStrip> m_ledStrip;
 
@@ -798,18 +1351,45 @@ class ShelfModel : public QAbstractListModel, public QQmlParserStatus
         int m_columns;
         int m_density;
         int m_wallThickness;
+        int m_squareCount;
+        bool m_updatingGeometry;
+        QVector<QPair<int, int>> m_squareRanges;
+
+        // Per-square colors derived from the strip contents, kept in sync
+        // with the strip using `LedStrip::generation`.
+        mutable QVector<QRgb> m_squareColors;
+        mutable bool m_squareColorsValid;
+        mutable quint64 m_squareColorsGeneration;
+        mutable qint64 m_squareColorSums[3];
+        mutable int m_dirtyFirst;
+        mutable int m_dirtyLast;
+        QTimer m_squaresChangedTimer;
+
+        QList<ShelfZone *> m_zones;
+        QVector<bool> m_zoneOwned;
+        bool m_hasZones;
+
+        QList<AnimationLayer *> m_layers;
 
         qreal m_brightness;
+        qreal m_appliedBrightness;
         qreal m_targetBrightness;
         bool m_animateBrightnessTransitions;
         bool m_pendingBrightnessTransition;
         QVariantAnimation m_brightnessTransition;
+        qreal m_fromLightness; // Brightness transitions run in perceived lightness.
+        qreal m_toLightness;
 
         QColor m_averageColor;
         bool m_animateAverageColorTransitions;
         QVariantAnimation m_averageColorTransition;
+        ColorSpace::Oklab m_fromColor;
+        ColorSpace::Oklab m_toColor;
 
         int m_transitionDuration;
+        const EasingTable *m_transitionEasing;
+
+        RenderLoop m_renderLoop;
 
         QPointer<AbstractAnimation> m_animation;
         bool m_animating;
@@ -818,6 +1398,32 @@ class ShelfModel : public QAbstractListModel, public QQmlParserStatus
         QUrl m_listenAddress;
         QRemoteObjectHost *m_remotingServer;
 
+        StateFile m_stateFile;
+        QTimer m_stateWriteTimer;
+
+        SceneStore m_sceneStore;
+        QVariantAnimation m_sceneTransition;
+        QByteArray m_sceneFrom; // LED data when the crossfade started.
+        QByteArray m_sceneTo;
+        QVector<ColorSpace::Oklab> m_sceneFromColors; // Of each LED, for the crossfade.
+        QVector<ColorSpace::Oklab> m_sceneToColors;
+
+        Timeline m_timeline;
+        Timeline::Update m_timelineUpdate; // Reused from frame to frame.
+        QVariantAnimation m_timelineClock;
+        qint64 m_timelinePosition;
+        bool m_applyingTimeline;
+        QTimer m_timelineNotifyTimer; // Throttles change signals while playing.
+
+        MpscQueue<Command, 256> m_commands;
+        QVector<Command> m_drainedCommands; // Reused from frame to frame.
+        QVector<Command> m_keptCommands; // In reverse order.
+        QVector<bool> m_commandedSquares;
+        bool m_applyingCommands;
+
+        SnapshotPublisher<Snapshot> m_snapshots;
+        QTimer m_snapshotTimer;
+
         bool m_createdByQml;
         bool m_complete;
 };
@@ -0,0 +1,421 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "shelfzone.h"
+#include "debug.h"
+#include "ledstrip.h"
+#include "shelfmodel.h"
+
+#include <KLocalizedString>
+
+#include <algorithm>
+#include <cmath>
+
+ShelfZone::ShelfZone(QObject *parent)
+    : QObject(parent)
+    , m_shelfModel {nullptr}
+    , m_firstColumn {0}
+    , m_columns {1}
+    , m_enabled {true}
+    , m_brightness {1.0}
+    , m_fromLightness {0.0}
+    , m_toLightness {0.0}
+    , m_averageColor {QStringLiteral("white")}
+    , m_transitionDuration {400}
+    , m_animating {false}
+{
+    // Transitions run from 0.0 to 1.0, like those of ShelfModel; the values
+    // in between are looked up in `appliedBrightness` and `appliedColor`.
+    m_brightnessTransition.setDuration(m_transitionDuration);
+    m_brightnessTransition.setStartValue(0.0);
+    m_brightnessTransition.setEndValue(1.0);
+
+    QObject::connect(&m_brightnessTransition, &QVariantAnimation::valueChanged, this,
+        [=]() {
+            // Ignore `valueChanged` emissions stemming from calls to
+            // `setStartValue`/`setEndValue`.
+            if (m_brightnessTransition.state() == QAbstractAnimation::Stopped) {
+                return;
+            }
+
+            if (!active()) {
+                return;
+            }
+
+            syncBrightness();
+            ledStrip()->update();
+
+            Q_EMIT painted();
+        }
+    );
+
+    m_averageColorTransition.setDuration(m_transitionDuration);
+    m_averageColorTransition.setStartValue(0.0);
+    m_averageColorTransition.setEndValue(1.0);
+
+    QObject::connect(&m_averageColorTransition, &QVariantAnimation::valueChanged, this,
+        [=]() {
+            if (m_averageColorTransition.state() == QAbstractAnimation::Stopped) {
+                return;
+            }
+
+            if (!active() || m_animating) {
+                return;
+            }
+
+            paint(appliedColor());
+            ledStrip()->update();
+
+            Q_EMIT painted();
+        }
+    );
+}
+
+ShelfZone::~ShelfZone()
+{
+}
+
+int ShelfZone::firstColumn() const
+{
+    return m_firstColumn;
+}
+
+void ShelfZone::setFirstColumn(int column)
+{
+    column = std::max(0, column);
+
+    if (m_firstColumn != column) {
+        m_firstColumn = column;
+
+        // ShelfModel reassigns compartments and calls `updateRanges`.
+        Q_EMIT firstColumnChanged();
+    }
+}
+
+int ShelfZone::columns() const
+{
+    return m_columns;
+}
+
+void ShelfZone::setColumns(int columns)
+{
+    if (columns < 1) {
+        qCWarning(HYELICHT) << i18n("setColumns: '%1' columns requested, but cannot be lower than 1."
+            "Setting 1.", columns);
+        columns = 1;
+    }
+
+    if (m_columns != columns) {
+        m_columns = columns;
+
+        // ShelfModel reassigns compartments and calls `updateRanges`.
+        Q_EMIT columnsChanged();
+    }
+}
+
+bool ShelfZone::enabled() const
+{
+    return m_enabled;
+}
+
+void ShelfZone::setEnabled(bool enabled)
+{
+    if (m_enabled != enabled) {
+        m_enabled = enabled;
+
+        if (!m_enabled && m_animation) {
+            m_animation->stop();
+        }
+
+        // ShelfModel reassigns compartments and calls `updateRanges`.
+        Q_EMIT enabledChanged();
+    }
+}
+
+qreal ShelfZone::brightness() const
+{
+    return m_brightness;
+}
+
+void ShelfZone::setBrightness(qreal brightness)
+{
+    brightness = std::clamp(brightness, 0.0, 1.0);
+
+    if (m_brightness != brightness) {
+        const qreal from {appliedBrightness()};
+
+        m_brightness = brightness;
+
+        m_brightnessTransition.stop();
+
+        if (active() && m_transitionDuration > 0) {
+            m_fromLightness = ColorSpace::toLightness(from);
+            m_toLightness = ColorSpace::toLightness(brightness);
+
+            // Scale the duration by the delta, like ShelfModel does.
+            m_brightnessTransition.setDuration(m_transitionDuration * std::abs(brightness - from));
+            m_brightnessTransition.start();
+        } else if (active()) {
+            syncBrightness();
+            ledStrip()->update();
+
+            Q_EMIT painted();
+        }
+
+        Q_EMIT brightnessChanged();
+    }
+}
+
+QColor ShelfZone::averageColor() const
+{
+    return m_averageColor;
+}
+
+void ShelfZone::setAverageColor(const QColor &color)
+{
+    if (m_averageColor != color) {
+        const QColor from {appliedColor()};
+
+        m_averageColor = color;
+
+        m_averageColorTransition.stop();
+
+        if (active() && !m_animating) {
+            if (m_transitionDuration > 0) {
+                m_fromColor = ColorSpace::toOklab(from.rgb());
+                m_toColor = ColorSpace::toOklab(color.rgb());
+                m_averageColorTransition.start();
+            } else {
+                paint(color);
+                ledStrip()->update();
+
+                Q_EMIT painted();
+            }
+        }
+
+        Q_EMIT averageColorChanged();
+    }
+}
+
+int ShelfZone::transitionDuration() const
+{
+    return m_transitionDuration;
+}
+
+void ShelfZone::setTransitionDuration(int duration)
+{
+    if (m_transitionDuration != duration) {
+        m_transitionDuration = duration;
+
+        m_brightnessTransition.setDuration(m_transitionDuration);
+        m_averageColorTransition.setDuration(m_transitionDuration);
+
+        Q_EMIT transitionDurationChanged();
+    }
+}
+
+AbstractAnimation *ShelfZone::animation() const
+{
+    return m_animation;
+}
+
+void ShelfZone::setAnimation(AbstractAnimation *animation)
+{
+    if (m_animation != animation) {
+        if (m_animation) {
+            m_animation->disconnect(this);
+            m_animation->stop();
+        }
+
+        m_animation = animation;
+
+        if (m_animation) {
+            QObject::connect(m_animation, &AbstractAnimation::destroyed, this,
+                [=]() {
+                    Q_EMIT animationChanged();
+                    setAnimating(false);
+                }
+            );
+
+            QObject::connect(m_animation, &AbstractAnimation::frameComplete, this,
+                &ShelfZone::painted);
+
+            updateAnimation();
+        } else if (m_animating) {
+            setAnimating(false);
+        }
+
+        Q_EMIT animationChanged();
+    }
+}
+
+bool ShelfZone::animating() const
+{
+    return m_animating;
+}
+
+void ShelfZone::setAnimating(bool animating)
+{
+    if (m_animating != animating) {
+        m_animating = animating;
+
+        updateAnimation();
+
+        // Go back to the static color.
+        if (!m_animating) {
+            repaint();
+        }
+
+        Q_EMIT animatingChanged();
+    }
+}
+
+ShelfModel *ShelfZone::shelfModel() const
+{
+    return m_shelfModel;
+}
+
+void ShelfZone::setShelfModel(ShelfModel *model)
+{
+    if (m_shelfModel == model) {
+        return;
+    }
+
+    if (m_shelfModel) {
+        m_shelfModel->disconnect(this);
+        m_shelfModel->renderLoop()->removeTransition(&m_brightnessTransition);
+        m_shelfModel->renderLoop()->removeTransition(&m_averageColorTransition);
+    }
+
+    m_shelfModel = model;
+
+    if (m_shelfModel) {
+        // Transitions advance in step with the model's animation frames.
+        m_shelfModel->renderLoop()->addTransition(&m_brightnessTransition);
+        m_shelfModel->renderLoop()->addTransition(&m_averageColorTransition);
+    }
+
+    updateRanges();
+}
+
+QVector<QPair<int, int>> ShelfZone::ranges() const
+{
+    return m_ranges;
+}
+
+void ShelfZone::updateRanges()
+{
+    if (m_shelfModel && m_enabled) {
+        m_ranges = m_shelfModel->columnRanges(m_firstColumn, m_columns);
+    } else {
+        m_ranges.clear();
+    }
+
+    if (m_animation) {
+        m_animation->setRegion(m_ranges);
+    }
+
+    updateAnimation();
+    repaint();
+}
+
+void ShelfZone::repaint()
+{
+    if (!active()) {
+        return;
+    }
+
+    if (!m_animating || !m_animation) {
+        paint(m_averageColor);
+    }
+
+    syncBrightness();
+    ledStrip()->update();
+
+    Q_EMIT painted();
+}
+
+LedStrip *ShelfZone::ledStrip() const
+{
+    return m_shelfModel ? m_shelfModel->ledStrip() : nullptr;
+}
+
+bool ShelfZone::active() const
+{
+    return m_enabled && !m_ranges.isEmpty() && ledStrip();
+}
+
+void ShelfZone::paint(const QColor &color)
+{
+    LedStrip *strip {ledStrip()};
+
+    for (const QPair<int, int> &range : std::as_const(m_ranges)) {
+        strip->setColor(range.first, range.second, color);
+    }
+}
+
+qreal ShelfZone::appliedBrightness() const
+{
+    if (m_brightnessTransition.state() == QAbstractAnimation::Stopped) {
+        return m_brightness;
+    }
+
+    const qreal progress {m_brightnessTransition.currentValue().toReal()};
+
+    // Lands on the target exactly, which a round trip through lightness
+    // may miss by a rounding error.
+    return progress >= 1.0 ? m_brightness
+        : ColorSpace::fromLightness(m_fromLightness * (1.0 - progress) + m_toLightness * progress);
+}
+
+QColor ShelfZone::appliedColor() const
+{
+    if (m_averageColorTransition.state() == QAbstractAnimation::Stopped) {
+        return m_averageColor;
+    }
+
+    const qreal progress {m_averageColorTransition.currentValue().toReal()};
+
+    if (progress >= 1.0) {
+        return m_averageColor;
+    }
+
+    return QColor {ColorSpace::fromOklab(ColorSpace::mix(m_fromColor, m_toColor, progress))};
+}
+
+void ShelfZone::syncBrightness()
+{
+    LedStrip *strip {ledStrip()};
+
+    // Exempt from ShelfModel::brightness in the strip's output stage.
+    const qreal brightness {appliedBrightness()};
+
+    const int value {static_cast<int>(std::rint(LED_MAX_BRIGHTNESS * brightness))};
+
+    for (const QPair<int, int> &range : std::as_const(m_ranges)) {
+        strip->setBrightness(range.first, range.second, value);
+    }
+}
+
+void ShelfZone::updateAnimation()
+{
+    if (!m_animation) {
+        return;
+    }
+
+    // Keeps running while the rest of the shelf is turned off.
+    if (active() && m_animating) {
+        m_animation->setRegion(m_ranges);
+        m_animation->setLedStrip(ledStrip());
+        m_animation->setRenderLoop(m_shelfModel->renderLoop());
+        m_animation->setSquares(m_shelfModel->squareRanges());
+
+        if (!m_animation->running()) {
+            m_animation->start();
+        }
+    } else if (m_animation->running()) {
+        m_animation->stop();
+    }
+}
@@ -0,0 +1,407 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "hyelicht_core_export.h"
+
+#include <QColor>
+#include <QObject>
+#include <QPair>
+#include <QPointer>
+#include <QVariantAnimation>
+#include <QVector>
+
+#include "abstractanimation.h"
+#include "colorspace.h"
+
+class LedStrip;
+class ShelfModel;
+
+//! An independently controlled group of shelf compartments
+/*!
+ * \ingroup Backend
+ *
+ * A zone spans a range of columns across all boards of the shelf managed by a
+ * ShelfModel, and has its own brightness, color, animation and transitions.
+ * For example, a zone could run a FireAnimation on the left half of the shelf
+ * while the right half shows a static color.
+ *
+ * Zones are added to a ShelfModel via its ShelfModel::zones property. Enabled
+ * zones take ownership of the compartments they span; the ShelfModel's own
+ * painting operations and animation only affect the remaining compartments. All zones paint into the same LedStrip. Their animations
+ * and transitions are rendered by the ShelfModel::renderLoop, which writes
+ * each frame out together with the rest of the shelf.
+ *
+ * The zone \ref brightness is independent of ShelfModel::brightness, which the
+ * LedStrip applies during output to the compartments not owned by zones only.
+ * Turning the ShelfModel off or fading it leaves the zones alone.
+ *
+ * \sa ShelfModel
+ * \sa AbstractAnimation
+ */
+class HYELICHT_CORE_EXPORT ShelfZone : public QObject
+{
+    Q_OBJECT
+
+    //! First column spanned by this zone.
+    /*!
+    * Defaults to \c 0.
+    *
+    * \sa setFirstColumn
+    * \sa firstColumnChanged
+    * \sa columns
+    */
+    Q_PROPERTY(int firstColumn READ firstColumn WRITE setFirstColumn NOTIFY firstColumnChanged)
+
+    //! Number of columns spanned by this zone.
+    /*!
+    * Columns outside of the shelf are ignored.
+    *
+    * Defaults to \c 1.
+    *
+    * \sa setColumns
+    * \sa columnsChanged
+    * \sa firstColumn
+    */
+    Q_PROPERTY(int columns READ columns WRITE setColumns NOTIFY columnsChanged)
+
+    //! Toggle the zone.
+    /*!
+    * A disabled zone releases its compartments back to the ShelfModel.
+    *
+    * Defaults to \c true.
+    *
+    * \sa setEnabled
+    * \sa enabledChanged
+    */
+    Q_PROPERTY(bool enabled READ enabled WRITE setEnabled NOTIFY enabledChanged)
+
+    //! The zone brightness level.
+    /*!
+    * Zone brightness is set in a range between \c 0.0 and \c 1.0.
+    *
+    * Defaults to \c 1.0.
+    *
+    * \sa setBrightness
+    * \sa brightnessChanged
+    * \sa transitionDuration
+    */
+    Q_PROPERTY(qreal brightness READ brightness WRITE setBrightness NOTIFY brightnessChanged)
+
+    //! The color of the compartments in this zone while not animating.
+    /*!
+    * Defaults to \c white.
+    *
+    * \sa setAverageColor
+    * \sa averageColorChanged
+    * \sa transitionDuration
+    */
+    Q_PROPERTY(QColor averageColor READ averageColor WRITE setAverageColor NOTIFY averageColorChanged)
+
+    //! Duration in milliseconds for an animated fade between brightness levels or colors.
+    /*!
+    * Can be set to \c 0 to change to new brightness levels or colors immediately.
+    *
+    * Defaults to \c 400.
+    *
+    * \sa setTransitionDuration
+    * \sa transitionDurationChanged
+    */
+    Q_PROPERTY(int transitionDuration READ transitionDuration WRITE setTransitionDuration NOTIFY transitionDurationChanged)
+
+    //! Animation to run in this zone.
+    /*!
+    * The animation is confined to the LEDs of this zone using AbstractAnimation::region.
+    *
+    * Defaults to \c nullptr.
+    *
+    * \sa setAnimation
+    * \sa animationChanged
+    * \sa animating
+    */
+    Q_PROPERTY(AbstractAnimation* animation READ animation WRITE setAnimation NOTIFY animationChanged)
+
+    //! Toggle the \ref animation.
+    /*!
+    * Defaults to \c false.
+    *
+    * \sa setAnimating
+    * \sa animatingChanged
+    * \sa animation
+    */
+    Q_PROPERTY(bool animating READ animating WRITE setAnimating NOTIFY animatingChanged)
+
+    public:
+        //! Create a shelf zone.
+        /*!
+        * @param parent Parent object
+        */
+        explicit ShelfZone(QObject *parent = nullptr);
+        ~ShelfZone() override;
+
+        //! The first column spanned by this zone.
+        /*!
+        * @return Column index.
+        * \sa firstColumn (property)
+        * \sa setFirstColumn
+        * \sa firstColumnChanged
+        */
+        int firstColumn() const;
+
+        //! Set the first column spanned by this zone.
+        /*!
+        * @param column Column index.
+        * \sa firstColumn
+        * \sa firstColumnChanged
+        */
+        void setFirstColumn(int column);
+
+        //! The number of columns spanned by this zone.
+        /*!
+        * @return Number of columns.
+        * \sa columns (property)
+        * \sa setColumns
+        * \sa columnsChanged
+        */
+        int columns() const;
+
+        //! Set the number of columns spanned by this zone.
+        /*!
+        * Cannot be lower than \c 1.
+        *
+        * @param columns Number of columns.
+        * \sa columns
+        * \sa columnsChanged
+        */
+        void setColumns(int columns);
+
+        //! Whether the zone is on.
+        /*!
+        * @return Zone on or off.
+        * \sa enabled (property)
+        * \sa setEnabled
+        * \sa enabledChanged
+        */
+        bool enabled() const;
+
+        //! Turn the zone on or off.
+        /*!
+        * @param enabled Zone on or off.
+        * \sa enabled
+        * \sa enabledChanged
+        */
+        void setEnabled(bool enabled);
+
+        //! The zone brightness level.
+        /*!
+        * @return Brightness level between \c 0.0 and \c 1.0.
+        * \sa brightness (property)
+        * \sa setBrightness
+        * \sa brightnessChanged
+        */
+        qreal brightness() const;
+
+        //! Set the zone brightness level.
+        /*!
+        * @param brightness Brightness level between \c 0.0 and \c 1.0.
+        * \sa brightness
+        * \sa brightnessChanged
+        */
+        void setBrightness(qreal brightness);
+
+        //! The color of the compartments in this zone while not animating.
+        /*!
+        * @return Color.
+        * \sa averageColor (property)
+        * \sa setAverageColor
+        * \sa averageColorChanged
+        */
+        QColor averageColor() const;
+
+        //! Set the color of the compartments in this zone.
+        /*!
+        * @param color Color.
+        * \sa averageColor
+        * \sa averageColorChanged
+        */
+        void setAverageColor(const QColor &color);
+
+        //! The duration in milliseconds for an animated fade between brightness levels or colors.
+        /*!
+        * @return Duration in milliseconds.
+        * \sa transitionDuration (property)
+        * \sa setTransitionDuration
+        * \sa transitionDurationChanged
+        */
+        int transitionDuration() const;
+
+        //! Set the duration in milliseconds for an animated fade between brightness levels or colors.
+        /*!
+        * @param duration Duration in milliseconds.
+        * \sa transitionDuration
+        * \sa transitionDurationChanged
+        */
+        void setTransitionDuration(int duration);
+
+        //! The animation to run in this zone.
+        /*!
+        * @return An animation.
+        * \sa animation (property)
+        * \sa setAnimation
+        * \sa animationChanged
+        */
+        AbstractAnimation *animation() const;
+
+        //! Set the animation to run in this zone.
+        /*!
+        * @param animation An animation.
+        * \sa animation
+        * \sa animationChanged
+        */
+        void setAnimation(AbstractAnimation *animation);
+
+        //! Whether the \ref animation is running.
+        /*!
+        * @return Animation on or off.
+        * \sa animating (property)
+        * \sa setAnimating
+        * \sa animatingChanged
+        */
+        bool animating() const;
+
+        //! Turn the \ref animation on or off.
+        /*!
+        * @param animating Animation on or off.
+        * \sa animating
+        * \sa animatingChanged
+        */
+        void setAnimating(bool animating);
+
+        //! The ShelfModel this zone belongs to.
+        /*!
+        * Set by ShelfModel once the zone has been added to it and the model is ready.
+        *
+        * @return A ShelfModel, or \c nullptr.
+        */
+        ShelfModel *shelfModel() const;
+
+        //! Attach this zone to a ShelfModel.
+        /*!
+        * Called by ShelfModel.
+        *
+        * @param model A ShelfModel, or \c nullptr.
+        */
+        void setShelfModel(ShelfModel *model);
+
+        //! The ranges of LEDs covered by this zone.
+        /*!
+        * @return A list of LED ranges.
+        */
+        QVector<QPair<int, int>> ranges() const;
+
+        //! Recalculate the ranges of LEDs covered by this zone and repaint it.
+        /*!
+        * Called by ShelfModel when the shelf geometry or the set of zones changes.
+        */
+        void updateRanges();
+
+        //! Repaint the zone.
+        /*!
+        * Paints \ref averageColor unless animating and applies the current brightness.
+        */
+        void repaint();
+
+    Q_SIGNALS:
+        //! The first column spanned by this zone has changed.
+        /*!
+        * \sa firstColumn
+        * \sa setFirstColumn
+        */
+        void firstColumnChanged() const;
+
+        //! The number of columns spanned by this zone has changed.
+        /*!
+        * \sa columns
+        * \sa setColumns
+        */
+        void columnsChanged() const;
+
+        //! The zone has been turned on or off.
+        /*!
+        * \sa enabled
+        * \sa setEnabled
+        */
+        void enabledChanged() const;
+
+        //! The zone brightness level has changed.
+        /*!
+        * \sa brightness
+        * \sa setBrightness
+        */
+        void brightnessChanged() const;
+
+        //! The color of the compartments in this zone has changed.
+        /*!
+        * \sa averageColor
+        * \sa setAverageColor
+        */
+        void averageColorChanged() const;
+
+        //! The duration in milliseconds for an animated fade has changed.
+        /*!
+        * \sa transitionDuration
+        * \sa setTransitionDuration
+        */
+        void transitionDurationChanged() const;
+
+        //! The animation to run in this zone has changed.
+        /*!
+        * \sa animation
+        * \sa setAnimation
+        */
+        void animationChanged() const;
+
+        //! Whether the \ref animation is running has changed.
+        /*!
+        * \sa animating
+        * \sa setAnimating
+        */
+        void animatingChanged() const;
+
+        //! The zone has painted new data into the LedStrip.
+        void painted() const;
+
+    private:
+        LedStrip *ledStrip() const;
+        bool active() const;
+        void paint(const QColor &color);
+        qreal appliedBrightness() const;
+        QColor appliedColor() const;
+        void syncBrightness();
+        void updateAnimation();
+
+        QPointer<ShelfModel> m_shelfModel;
+        QVector<QPair<int, int>> m_ranges;
+
+        int m_firstColumn;
+        int m_columns;
+        bool m_enabled;
+
+        qreal m_brightness;
+        QVariantAnimation m_brightnessTransition;
+        qreal m_fromLightness; // Brightness transitions run in perceived lightness.
+        qreal m_toLightness;
+
+        QColor m_averageColor;
+        QVariantAnimation m_averageColorTransition;
+        ColorSpace::Oklab m_fromColor;
+        ColorSpace::Oklab m_toColor;
+
+        int m_transitionDuration;
+
+        QPointer<AbstractAnimation> m_animation;
+        bool m_animating;
+};
@@ -0,0 +1,228 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include <QVector>
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+//! Lock-free publication of immutable snapshots to any number of readers
+/*!
+ * \ingroup Backend
+ *
+ * A single writer fills a snapshot obtained from \ref beginWrite and makes it
+ * current with \ref publish, a single atomic pointer swap. Readers on any
+ * thread get the current snapshot from \ref read and can look at it for as
+ * long as they hold on to the returned Reader, without ever blocking the
+ * writer or each other, or seeing a snapshot change underneath them.
+ *
+ * Replaced snapshots are reclaimed by epoch: each reader announces the epoch
+ * it started reading in, and the writer reuses a replaced snapshot once every
+ * announced epoch is newer than its replacement. Reused snapshots keep their
+ * allocated memory, so after a few publications the writer stops allocating.
+ *
+ * Readers announce themselves in one of a fixed number of slots. Reads are
+ * expected to be short; only if more than \p Slots readers are reading at
+ * once does a reader wait for one of them to finish.
+ *
+ * \tparam T A default-constructible value type.
+ * \tparam Slots Number of concurrent readers.
+ *
+ * \sa FrameBuffer
+ */
+template<typename T, int Slots = 32>
+class SnapshotPublisher
+{
+    public:
+        //! Access to a snapshot, held for as long as the reader exists.
+        class Reader
+        {
+            public:
+                Reader(Reader &&other)
+                    : m_slot {other.m_slot}
+                    , m_value {other.m_value}
+                {
+                    other.m_slot = nullptr;
+                }
+
+                Reader(const Reader &) = delete;
+                Reader &operator=(const Reader &) = delete;
+
+                ~Reader()
+                {
+                    if (m_slot) {
+                        m_slot->store(Free, std::memory_order_release);
+                    }
+                }
+
+                //! Whether anything was published yet.
+                explicit operator bool() const
+                {
+                    return m_value;
+                }
+
+                //! The snapshot.
+                const T &operator*() const
+                {
+                    return *m_value;
+                }
+
+                //! The snapshot.
+                const T *operator->() const
+                {
+                    return m_value;
+                }
+
+            private:
+                friend class SnapshotPublisher;
+
+                Reader(std::atomic<quint64> *slot, const T *value)
+                    : m_slot {slot}
+                    , m_value {value}
+                {
+                }
+
+                std::atomic<quint64> *m_slot;
+                const T *m_value;
+        };
+
+        SnapshotPublisher()
+            : m_current {nullptr}
+            , m_epoch {1}
+            , m_write {nullptr}
+        {
+            for (Slot &slot : m_slots) {
+                slot.epoch.store(Free, std::memory_order_relaxed);
+            }
+        }
+
+        //! Destroys all snapshots; there must be no readers left.
+        ~SnapshotPublisher()
+        {
+            delete m_current.load();
+            delete m_write;
+
+            for (const Retired &retired : std::as_const(m_retired)) {
+                delete retired.value;
+            }
+
+            qDeleteAll(m_free);
+        }
+
+        //! The snapshot to fill for the next \ref publish.
+        /*!
+        * Only to be called by the writer. May hold the contents of an older
+        * snapshot, which saves reallocating its members.
+        *
+        * @return A snapshot no reader can see.
+        */
+        T *beginWrite()
+        {
+            if (!m_write) {
+                m_write = m_free.isEmpty() ? new T : m_free.takeLast();
+            }
+
+            return m_write;
+        }
+
+        //! Make the snapshot filled since \ref beginWrite the current one.
+        /*!
+        * Only to be called by the writer.
+        */
+        void publish()
+        {
+            if (!m_write) {
+                return;
+            }
+
+            T *replaced {m_current.exchange(m_write)};
+            m_write = nullptr;
+
+            // Readers announcing this epoch or a later one can only see the
+            // new snapshot.
+            const quint64 epoch {m_epoch.fetch_add(1) + 1};
+
+            if (replaced) {
+                m_retired.append(Retired {replaced, epoch});
+            }
+
+            reclaim();
+        }
+
+        //! The current snapshot.
+        /*!
+        * Safe to call from any thread.
+        *
+        * @return A reader for the current snapshot, which converts to
+        *     \c false if nothing was published yet.
+        */
+        Reader read() const
+        {
+            // Spread concurrent readers over the slots.
+            static std::atomic<unsigned int> next {0};
+            unsigned int i {next.fetch_add(1, std::memory_order_relaxed)};
+
+            for (;; ++i) {
+                std::atomic<quint64> &slot {m_slots[i % Slots].epoch};
+                quint64 expected {Free};
+
+                if (slot.compare_exchange_strong(expected, Claimed)) {
+                    // Announced before looking at the pointer, which the
+                    // writer relies on when reclaiming.
+                    slot.store(m_epoch.load());
+
+                    return Reader(&slot, m_current.load());
+                }
+            }
+        }
+
+    private:
+        static const quint64 Free {0};
+        static const quint64 Claimed {std::numeric_limits<quint64>::max()};
+
+        struct alignas(64) Slot {
+            std::atomic<quint64> epoch; // Free, Claimed or the announced epoch.
+        };
+
+        struct Retired {
+            T *value;
+            quint64 epoch; // The epoch it was replaced in.
+        };
+
+        void reclaim()
+        {
+            quint64 oldest {Claimed};
+
+            for (const Slot &slot : m_slots) {
+                const quint64 epoch {slot.epoch.load()};
+
+                if (epoch != Free && epoch < oldest) {
+                    oldest = epoch;
+                }
+            }
+
+            m_retired.removeIf([&](const Retired &retired) {
+                if (retired.epoch <= oldest) {
+                    m_free.append(retired.value);
+                    return true;
+                }
+
+                return false;
+            });
+        }
+
+        std::atomic<T *> m_current;
+        std::atomic<quint64> m_epoch;
+        mutable Slot m_slots[Slots];
+
+        // Only used by the writer.
+        T *m_write;
+        QVector<Retired> m_retired;
+        QVector<T *> m_free;
+};
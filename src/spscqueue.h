@@ -0,0 +1,79 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+//! Lock-free queue handing values from one thread to another
+/*!
+ * \ingroup Backend
+ *
+ * A bounded ring buffer for a single producer and a single consumer. Neither
+ * side ever blocks: \ref push fails while the queue is full, and \ref pop while
+ * it is empty. Each side only writes its own index, which the other reads, so
+ * no atomic read-modify-write operations are needed. The indices sit on
+ * separate cache lines so the two threads don't contend for one.
+ *
+ * \tparam T A copyable value type.
+ * \tparam Capacity Number of slots; holds one value less.
+ *
+ * \sa FrameBuffer
+ */
+template<typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity >= 2, "SpscQueue needs at least two slots.");
+
+    public:
+        //! Append a value.
+        /*!
+        * Only to be called by the producer.
+        *
+        * @param value The value.
+        * @return Whether there was room for the value.
+        */
+        bool push(const T &value)
+        {
+            const std::size_t head {m_head.load(std::memory_order_relaxed)};
+            const std::size_t next {(head + 1) % Capacity};
+
+            if (next == m_tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+
+            m_items[head] = value;
+            m_head.store(next, std::memory_order_release);
+
+            return true;
+        }
+
+        //! Take the oldest value.
+        /*!
+        * Only to be called by the consumer.
+        *
+        * @param value Receives the value.
+        * @return Whether there was a value.
+        */
+        bool pop(T &value)
+        {
+            const std::size_t tail {m_tail.load(std::memory_order_relaxed)};
+
+            if (tail == m_head.load(std::memory_order_acquire)) {
+                return false;
+            }
+
+            value = m_items[tail];
+            m_tail.store((tail + 1) % Capacity, std::memory_order_release);
+
+            return true;
+        }
+
+    private:
+        alignas(64) std::atomic<std::size_t> m_head {0}; // Written by the producer.
+        alignas(64) std::atomic<std::size_t> m_tail {0}; // Written by the consumer.
+        alignas(64) T m_items[Capacity];
+};
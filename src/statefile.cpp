@@ -0,0 +1,341 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "statefile.h"
+#include "debug.h"
+
+#include <KLocalizedString>
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include <sys/mman.h>
+
+namespace {
+
+const char stateMagic[4] {'H', 'Y', 'S', 'T'};
+const quint32 stateVersion {2};
+
+enum StateFlag : quint32 {
+    Enabled = 0x1,
+    Animating = 0x2
+};
+
+struct StateHeader {
+    char magic[4];
+    quint32 version;
+    quint32 checksum; // Over everything following this field.
+    quint32 generation; // Incremented on every write; the newest slot wins.
+    quint32 count;
+    quint32 flags;
+    float brightness;
+    QRgb averageColor;
+    char animation[32];
+};
+
+static_assert(sizeof(StateHeader) == 64, "Unexpected state file header size");
+
+const qint64 checksumOffset {offsetof(StateHeader, generation)};
+
+quint32 checksum(const uchar *data, qint64 size)
+{
+    return qChecksum(QByteArrayView(data + checksumOffset, size - checksumOffset));
+}
+
+qint64 slotSize(int count)
+{
+    return static_cast<qint64>(sizeof(StateHeader)) + count * static_cast<qint64>(sizeof(uint32_t));
+}
+
+// Whether a slot of a file of fileSize bytes holds a complete write.
+bool slotValid(const uchar *slot, qint64 fileSize)
+{
+    const StateHeader *header {reinterpret_cast<const StateHeader *>(slot)};
+
+    return memcmp(header->magic, stateMagic, sizeof(stateMagic)) == 0
+        && header->version == stateVersion
+        && header->count > 0
+        && fileSize == 2 * slotSize(header->count)
+        && header->checksum == checksum(slot, slotSize(header->count));
+}
+
+// The slot holding the newest complete write, or -1 if there is none.
+int newestSlot(const uchar *data, qint64 fileSize)
+{
+    int newest {-1};
+    quint32 generation {0};
+
+    for (int i {0}; i < 2; ++i) {
+        const uchar *slot {data + i * fileSize / 2};
+
+        if (slotValid(slot, fileSize)) {
+            const quint32 slotGeneration {reinterpret_cast<const StateHeader *>(slot)->generation};
+
+            // Compared as a difference to survive wrapping around.
+            if (newest == -1 || static_cast<qint32>(slotGeneration - generation) > 0) {
+                newest = i;
+                generation = slotGeneration;
+            }
+        }
+    }
+
+    return newest;
+}
+
+}
+
+StateFile::StateFile(const QString &fileName)
+    : m_fileName {fileName}
+    , m_hasPending {false}
+    , m_stopping {false}
+    , m_file {fileName}
+    , m_data {nullptr}
+    , m_size {0}
+    , m_slot {-1}
+    , m_generation {0}
+{
+}
+
+StateFile::~StateFile()
+{
+    // Writes out what is still pending.
+    stopThread();
+    unmap();
+}
+
+QString StateFile::fileName() const
+{
+    return m_fileName;
+}
+
+void StateFile::setFileName(const QString &fileName)
+{
+    if (m_fileName != fileName) {
+        // Pending state still goes to the previous file.
+        stopThread();
+        unmap();
+
+        m_fileName = fileName;
+        m_file.setFileName(fileName);
+    }
+}
+
+bool StateFile::write(const State &state, const uint32_t *data, int count)
+{
+    if (m_fileName.isEmpty() || !data || count < 1) {
+        return false;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+
+        m_pending = state;
+        m_pending.frame = QByteArray(reinterpret_cast<const char *>(data), count * sizeof(uint32_t));
+        m_hasPending = true;
+    }
+
+    if (!m_thread) {
+        m_thread.reset(QThread::create([this]() { run(); }));
+        m_thread->setObjectName(QStringLiteral("StateFileThread"));
+        m_thread->start(QThread::LowPriority);
+    } else {
+        m_wake.wakeOne();
+    }
+
+    return true;
+}
+
+void StateFile::run()
+{
+    State state;
+
+    for (;;) {
+        {
+            QMutexLocker locker(&m_mutex);
+
+            while (!m_hasPending && !m_stopping) {
+                m_wake.wait(&m_mutex);
+            }
+
+            // Only stops once nothing is left to write.
+            if (!m_hasPending) {
+                return;
+            }
+
+            std::swap(state, m_pending);
+            m_hasPending = false;
+        }
+
+        writeSlot(state);
+    }
+}
+
+void StateFile::stopThread()
+{
+    if (!m_thread) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+    }
+
+    m_wake.wakeOne();
+    m_thread->wait();
+    m_thread.reset();
+
+    m_stopping = false;
+}
+
+bool StateFile::writeSlot(const State &state)
+{
+    const int count {static_cast<int>(state.frame.size() / sizeof(uint32_t))};
+    const qint64 size {2 * slotSize(count)};
+
+    if (!m_data || m_size != size) {
+        if (!map(size)) {
+            return false;
+        }
+    } else if (msync(m_data, m_size, MS_SYNC) != 0) {
+        // The previous write must have reached storage before the slot it
+        // left behind is overwritten. Writes are far enough apart that its
+        // writeback is normally long done, and this thread may wait if not.
+        qCWarning(HYELICHT) << i18n("Unable to sync the state file: %1",
+            QString::fromUtf8(strerror(errno)));
+        return false;
+    }
+
+    // Never touch the slot holding the newest complete state.
+    const int slot {m_slot == 0 ? 1 : 0};
+    uchar *slotData {m_data + slot * slotSize(count)};
+
+    StateHeader *header {reinterpret_cast<StateHeader *>(slotData)};
+    memcpy(header->magic, stateMagic, sizeof(stateMagic));
+    header->version = stateVersion;
+    header->generation = m_generation + 1;
+    header->count = count;
+    header->flags = (state.enabled ? Enabled : 0) | (state.animating ? Animating : 0);
+    header->brightness = state.brightness;
+    header->averageColor = state.averageColor.rgba();
+    memset(header->animation, 0, sizeof(header->animation));
+    memcpy(header->animation, state.animation.constData(),
+        std::min(static_cast<size_t>(state.animation.size()), sizeof(header->animation) - 1));
+
+    memcpy(slotData + sizeof(StateHeader), state.frame.constData(), state.frame.size());
+
+    header->checksum = checksum(slotData, slotSize(count));
+
+    // Schedule writeback without blocking on it.
+    if (msync(m_data, m_size, MS_ASYNC) != 0) {
+        qCWarning(HYELICHT) << i18n("Unable to sync the state file: %1",
+            QString::fromUtf8(strerror(errno)));
+        return false;
+    }
+
+    m_slot = slot;
+    ++m_generation;
+
+    return true;
+}
+
+bool StateFile::read(const QString &fileName, State *state)
+{
+    QFile file {fileName};
+
+    if (!file.exists() || !file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const qint64 size {file.size()};
+
+    if (size < 2 * slotSize(1)) {
+        return false;
+    }
+
+    const uchar *data {file.map(0, size)};
+
+    if (!data) {
+        return false;
+    }
+
+    const int slot {newestSlot(data, size)};
+
+    if (slot == -1) {
+        qCWarning(HYELICHT) << i18n("Ignoring invalid state file: %1", fileName);
+        return false;
+    }
+
+    const uchar *slotData {data + slot * size / 2};
+    const StateHeader *header {reinterpret_cast<const StateHeader *>(slotData)};
+
+    state->enabled = header->flags & Enabled;
+    state->animating = header->flags & Animating;
+    state->brightness = std::clamp(static_cast<qreal>(header->brightness), 0.0, 1.0);
+    state->averageColor = QColor::fromRgba(header->averageColor);
+    state->animation = QByteArray(header->animation,
+        strnlen(header->animation, sizeof(header->animation)));
+    state->frame = QByteArray(reinterpret_cast<const char *>(slotData + sizeof(StateHeader)),
+        header->count * sizeof(uint32_t));
+
+    return true;
+}
+
+bool StateFile::map(qint64 size)
+{
+    unmap();
+
+    QDir().mkpath(QFileInfo(m_file).absolutePath());
+
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        qCWarning(HYELICHT) << i18n("Unable to open the state file: %1", m_file.errorString());
+        return false;
+    }
+
+    // Changing the number of LEDs invalidates both slots; until the next
+    // write completes, there is nothing to restore.
+    if (m_file.size() != size && !m_file.resize(size)) {
+        qCWarning(HYELICHT) << i18n("Unable to resize the state file: %1", m_file.errorString());
+        m_file.close();
+        return false;
+    }
+
+    m_data = m_file.map(0, size);
+
+    if (!m_data) {
+        qCWarning(HYELICHT) << i18n("Unable to map the state file: %1", m_file.errorString());
+        m_file.close();
+        return false;
+    }
+
+    m_size = size;
+
+    // Continue after the newest state already in the file.
+    m_slot = newestSlot(m_data, m_size);
+    m_generation = m_slot == -1 ? 0
+        : reinterpret_cast<const StateHeader *>(m_data + m_slot * m_size / 2)->generation;
+
+    return true;
+}
+
+void StateFile::unmap()
+{
+    if (m_data) {
+        m_file.unmap(m_data);
+        m_data = nullptr;
+        m_size = 0;
+        m_slot = -1;
+        m_generation = 0;
+    }
+
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+}
@@ -0,0 +1,115 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "hyelicht_core_export.h"
+
+#include <QByteArray>
+#include <QColor>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <memory>
+
+//! Persists the last shown shelf state in a memory-mapped binary file
+/*!
+ * \ingroup Backend
+ *
+ * Stores the LED strip data of the last frame along with the shelf state needed
+ * to show it again (on/off, brightness, full-shelf color and animation), so it
+ * can be restored immediately after a restart.
+ *
+ * The file holds two slots, each a fixed-size header followed by the raw LED
+ * data as returned by LedStrip::constData. Writes alternate between the slots
+ * and never touch the one holding the newest complete state, so losing power
+ * mid-write at worst loses the state being written; reading picks the slot
+ * with the highest generation whose checksum matches.
+ *
+ * Writes are done on a thread of their own, so \ref write never waits for
+ * storage. The thread keeps the file mapped into memory, copies each state into
+ * the mapping and hands it to the kernel for writeback, waiting for the
+ * previous writeback before reusing its slot. States passed in while the thread
+ * is busy replace each other, so only the newest one is written.
+ *
+ * \sa ShelfModel::stateFileName
+ */
+class HYELICHT_CORE_EXPORT StateFile
+{
+    public:
+        //! The shelf state stored alongside the LED data.
+        struct State {
+            bool enabled {false}; //!< Whether the shelf was on.
+            bool animating {false}; //!< Whether the animation was running.
+            qreal brightness {1.0}; //!< The shelf brightness level while on.
+            QColor averageColor {QStringLiteral("white")}; //!< The last full-shelf color fill.
+            QByteArray animation; //!< Class name of the animation.
+            QByteArray frame; //!< LED data, four bytes per LED.
+        };
+
+        //! Create a state file.
+        /*!
+        * @param fileName Path to the state file.
+        */
+        explicit StateFile(const QString &fileName = QString());
+        ~StateFile();
+
+        //! Path to the state file.
+        QString fileName() const;
+
+        //! Set the path to the state file.
+        /*!
+        * Unmaps and closes a previously used file.
+        *
+        * @param fileName Path to the state file.
+        */
+        void setFileName(const QString &fileName);
+
+        //! Write state to the file.
+        /*!
+        * Copies the state and returns; the writer thread writes it out. The
+        * file is resized and remapped when the number of LEDs changes.
+        *
+        * @param state Shelf state, without \c frame.
+        * @param data LED data.
+        * @param count Number of LEDs in \p data.
+        * @return Whether the state was queued for writing.
+        */
+        bool write(const State &state, const uint32_t *data, int count);
+
+        //! Read state from a file.
+        /*!
+        * @param fileName Path to the state file.
+        * @param state Filled with the stored state.
+        * @return \c true if the file exists and is valid.
+        */
+        static bool read(const QString &fileName, State *state);
+
+    private:
+        void run();
+        void stopThread();
+        bool writeSlot(const State &state);
+        bool map(qint64 size);
+        void unmap();
+
+        QString m_fileName;
+
+        std::unique_ptr<QThread> m_thread;
+        QMutex m_mutex; // Guards the members up to m_stopping.
+        QWaitCondition m_wake;
+        State m_pending;
+        bool m_hasPending;
+        bool m_stopping;
+
+        // Only used by the writer thread, or while it isn't running.
+        QFile m_file;
+        uchar *m_data;
+        qint64 m_size;
+        int m_slot; // Holding the newest complete state, or -1.
+        quint32 m_generation;
+};
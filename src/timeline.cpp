@@ -0,0 +1,292 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#include "timeline.h"
+
+#include <KLocalizedString>
+
+#include <QJsonArray>
+#include <QMetaEnum>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+inline qreal interpolate(qreal from, qreal to, qreal progress)
+{
+    return from + (to - from) * progress;
+}
+
+inline ColorSpace::Oklab interpolate(const ColorSpace::Oklab &from, const ColorSpace::Oklab &to,
+    qreal progress)
+{
+    return ColorSpace::mix(from, to, progress);
+}
+
+bool parseColor(const QJsonValue &value, ColorSpace::Oklab *color)
+{
+    const QColor parsed {QColor::fromString(value.toString())};
+
+    if (!parsed.isValid()) {
+        return false;
+    }
+
+    *color = ColorSpace::toOklab(parsed.rgb());
+
+    return true;
+}
+
+template<typename Point>
+void appendPoint(QVector<Point> &points, const Point &point)
+{
+    // Keyframes at the same time replace each other.
+    if (!points.isEmpty() && points.constLast().time == point.time) {
+        points.last() = point;
+    } else {
+        points.append(point);
+    }
+}
+
+}
+
+void Timeline::Update::clear()
+{
+    hasBrightness = false;
+    colors.clear();
+    events.clear();
+}
+
+Timeline::Timeline()
+    : m_duration {0}
+    , m_loop {false}
+    , m_nextEvent {0}
+    , m_time {-1}
+{
+}
+
+Timeline::~Timeline()
+{
+}
+
+bool Timeline::fromJson(const QJsonObject &json, int squares, Timeline *timeline, QString *errorString)
+{
+    const QJsonValue &keyframesValue {json.value(QStringLiteral("keyframes"))};
+
+    if (!keyframesValue.isArray() || keyframesValue.toArray().isEmpty()) {
+        *errorString = i18n("A timeline needs a list of keyframes.");
+        return false;
+    }
+
+    // Keyframes may be listed in any order; those at the same time apply in
+    // the order listed.
+    QVector<QJsonObject> keyframes;
+
+    for (const QJsonValue &value : keyframesValue.toArray()) {
+        if (!value.isObject() || !value.toObject().value(QStringLiteral("time")).isDouble()
+            || value.toObject().value(QStringLiteral("time")).toDouble() < 0.0) {
+            *errorString = i18n("Every keyframe needs a time of zero or more milliseconds.");
+            return false;
+        }
+
+        keyframes.append(value.toObject());
+    }
+
+    std::stable_sort(keyframes.begin(), keyframes.end(),
+        [](const QJsonObject &a, const QJsonObject &b) {
+            return a.value(QStringLiteral("time")).toDouble() < b.value(QStringLiteral("time")).toDouble();
+        });
+
+    const QMetaEnum easingTypes {QMetaEnum::fromType<QEasingCurve::Type>()};
+
+    Timeline result;
+    result.m_loop = json.value(QStringLiteral("loop")).toBool();
+    result.m_colors.resize(squares);
+    result.m_lastColors.resize(squares);
+
+    for (const QJsonObject &keyframe : std::as_const(keyframes)) {
+        const qint64 time {std::llround(keyframe.value(QStringLiteral("time")).toDouble())};
+        result.m_duration = std::max(result.m_duration, time);
+
+        const EasingTable *easing {EasingTable::forType(QEasingCurve::Linear)};
+
+        if (keyframe.contains(QStringLiteral("easing"))) {
+            bool ok {false};
+            const int type {easingTypes.keyToValue(keyframe.value(QStringLiteral("easing")).toString()
+                .toLatin1().constData(), &ok)};
+
+            // Curves that need more than a type aren't supported.
+            if (!ok || type >= QEasingCurve::BezierSpline) {
+                *errorString = i18n("Unknown easing curve: %1", keyframe.value(QStringLiteral("easing")).toString());
+                return false;
+            }
+
+            easing = EasingTable::forType(static_cast<QEasingCurve::Type>(type));
+        }
+
+        if (keyframe.contains(QStringLiteral("brightness"))) {
+            const QJsonValue &brightness {keyframe.value(QStringLiteral("brightness"))};
+
+            if (!brightness.isDouble() || brightness.toDouble() < 0.0 || brightness.toDouble() > 1.0) {
+                *errorString = i18n("Brightness must be between 0.0 and 1.0.");
+                return false;
+            }
+
+            appendPoint(result.m_brightness.points, Track<qreal>::Point {time, brightness.toDouble(), easing});
+        }
+
+        if (keyframe.contains(QStringLiteral("averageColor"))) {
+            ColorSpace::Oklab color;
+
+            if (!parseColor(keyframe.value(QStringLiteral("averageColor")), &color)) {
+                *errorString = i18n("Not a valid color: %1", keyframe.value(QStringLiteral("averageColor")).toString());
+                return false;
+            }
+
+            for (Track<ColorSpace::Oklab> &track : result.m_colors) {
+                appendPoint(track.points, Track<ColorSpace::Oklab>::Point {time, color, easing});
+            }
+        }
+
+        if (keyframe.contains(QStringLiteral("squares"))) {
+            const QJsonValue &squaresValue {keyframe.value(QStringLiteral("squares"))};
+
+            if (!squaresValue.isObject()) {
+                *errorString = i18n("Squares must map square indices to colors.");
+                return false;
+            }
+
+            const QJsonObject &colors {squaresValue.toObject()};
+
+            for (auto it {colors.constBegin()}; it != colors.constEnd(); ++it) {
+                bool ok {false};
+                const int square {it.key().toInt(&ok)};
+                ColorSpace::Oklab color;
+
+                if (!ok || square < 0 || square >= squares) {
+                    *errorString = i18n("Not a valid square index: %1", it.key());
+                    return false;
+                }
+
+                if (!parseColor(it.value(), &color)) {
+                    *errorString = i18n("Not a valid color: %1", it.value().toString());
+                    return false;
+                }
+
+                appendPoint(result.m_colors[square].points, Track<ColorSpace::Oklab>::Point {time, color, easing});
+            }
+        }
+
+        if (keyframe.contains(QStringLiteral("animating"))) {
+            result.m_events.append(Event {time, Event::Animating,
+                keyframe.value(QStringLiteral("animating")).toBool()});
+        }
+
+        if (keyframe.contains(QStringLiteral("scene"))) {
+            result.m_events.append(Event {time, Event::Scene,
+                keyframe.value(QStringLiteral("scene")).toString()});
+        }
+    }
+
+    *timeline = result;
+    timeline->rewind();
+
+    return true;
+}
+
+bool Timeline::isEmpty() const
+{
+    return m_brightness.points.isEmpty() && m_events.isEmpty()
+        && std::all_of(m_colors.cbegin(), m_colors.cend(),
+            [](const Track<ColorSpace::Oklab> &track) { return track.points.isEmpty(); });
+}
+
+qint64 Timeline::duration() const
+{
+    return m_duration;
+}
+
+bool Timeline::loop() const
+{
+    return m_loop;
+}
+
+void Timeline::rewind()
+{
+    m_brightness.next = 0;
+    m_brightness.done = false;
+
+    for (Track<ColorSpace::Oklab> &track : m_colors) {
+        track.next = 0;
+        track.done = false;
+    }
+
+    // Colors are fully opaque, so this makes sure the first ones are reported.
+    m_lastColors.fill(0);
+
+    m_nextEvent = 0;
+    m_time = -1;
+}
+
+void Timeline::advance(qint64 time, Update *update)
+{
+    update->clear();
+
+    if (time < m_time) {
+        rewind();
+    }
+
+    m_time = time;
+
+    update->hasBrightness = sample(m_brightness, time, &update->brightness);
+
+    for (int i {0}; i < m_colors.size(); ++i) {
+        ColorSpace::Oklab lab;
+
+        if (!sample(m_colors[i], time, &lab)) {
+            continue;
+        }
+
+        const QRgb color {ColorSpace::fromOklab(lab)};
+
+        if (color != m_lastColors.at(i)) {
+            m_lastColors[i] = color;
+            update->colors.append(qMakePair(i, color));
+        }
+    }
+
+    while (m_nextEvent < m_events.size() && m_events.at(m_nextEvent).time <= time) {
+        update->events.append(m_events.at(m_nextEvent));
+        ++m_nextEvent;
+    }
+}
+
+template<typename T>
+bool Timeline::sample(Track<T> &track, qint64 time, T *value)
+{
+    if (track.done || track.points.isEmpty() || time < track.points.constFirst().time) {
+        return false;
+    }
+
+    while (track.next < track.points.size() && track.points.at(track.next).time <= time) {
+        ++track.next;
+    }
+
+    if (track.next == track.points.size()) {
+        *value = track.points.constLast().value;
+        track.done = true;
+
+        return true;
+    }
+
+    const typename Track<T>::Point &from {track.points.at(track.next - 1)};
+    const typename Track<T>::Point &to {track.points.at(track.next)};
+    const qreal progress {to.easing->valueForProgress(static_cast<qreal>(time - from.time)
+        / (to.time - from.time))};
+
+    *value = interpolate(from.value, to.value, progress);
+
+    return true;
+}
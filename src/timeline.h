@@ -0,0 +1,146 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ * SPDX-FileCopyrightText: 2021-2024 Eike Hein <sho@eikehein.com>
+ */
+
+#pragma once
+
+#include "hyelicht_core_export.h"
+
+#include "colorspace.h"
+#include "easingtable.h"
+
+#include <QColor>
+#include <QJsonObject>
+#include <QPair>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+//! A sequence of keyframes for the shelf, played back by ShelfModel
+/*!
+ * \ingroup Backend
+ *
+ * Describes timed changes to the shelf brightness, the colors of individual
+ * compartments and the animation, e.g. a wake-up light or a color sequence.
+ * A timeline is uploaded once and then played back on the RenderLoop, so its
+ * timing is exact to the frame and independent of the network.
+ *
+ * Timelines are read from JSON of this form:
+ *
+ * \code{.json}
+ * {
+ *     "loop": false,
+ *     "keyframes": [
+ *         {"time": 0, "brightness": 0.0, "averageColor": "#ff4000"},
+ *         {"time": 600000, "brightness": 1.0, "averageColor": "#ffd0a0", "easing": "InOutSine"},
+ *         {"time": 610000, "squares": {"0": "red", "4": "blue"}},
+ *         {"time": 620000, "animating": true}
+ *     ]
+ * }
+ * \endcode
+ *
+ * Times are in milliseconds from the start. Brightness and colors are eased
+ * towards from the previous keyframe setting them, using the named
+ * \c QEasingCurve::Type given with the keyframe, and hold once their last
+ * keyframe has passed. \c averageColor sets every compartment, \c squares
+ * the given ones. \c animating and \c scene (see ShelfModel::recallScene)
+ * take effect the moment their keyframe is reached.
+ *
+ * Colors are eased in the OKLab color space (see ColorSpace) and curves are
+ * looked up in an EasingTable. Parsing does all the work up front, so
+ * advancing the timeline per frame neither parses nor allocates.
+ *
+ * \sa ShelfModel::playTimeline
+ */
+class HYELICHT_CORE_EXPORT Timeline
+{
+    public:
+        //! A change taking effect at a single point in time.
+        struct Event {
+            enum Type {
+                Animating, //!< Sets ShelfModel::animating to \c value.
+                Scene //!< Recalls the scene named \c value.
+            };
+
+            qint64 time {0}; //!< Milliseconds from the start.
+            Type type {Animating}; //!< What changes.
+            QVariant value; //!< The value to change to.
+        };
+
+        //! Changes to apply to the shelf for a frame, see \ref advance.
+        struct Update {
+            bool hasBrightness {false}; //!< Whether \c brightness is set.
+            qreal brightness {0.0}; //!< The brightness level to apply.
+            QVector<QPair<int, QRgb>> colors; //!< Compartments whose color changed, by index.
+            QVector<Event> events; //!< Events reached, in order.
+
+            //! Clear for reuse, keeping the allocated memory.
+            void clear();
+        };
+
+        //! Create an empty timeline.
+        Timeline();
+        ~Timeline();
+
+        //! Read a timeline from JSON.
+        /*!
+        * @param json A timeline in the format described above.
+        * @param squares Number of compartments of the shelf.
+        * @param timeline Filled with the timeline.
+        * @param errorString Set to why \p json is invalid.
+        * @return Whether \p json is a valid timeline.
+        */
+        static bool fromJson(const QJsonObject &json, int squares, Timeline *timeline, QString *errorString);
+
+        //! Whether the timeline has no keyframes.
+        bool isEmpty() const;
+
+        //! The time of the last keyframe in milliseconds.
+        qint64 duration() const;
+
+        //! Whether the timeline starts over after the last keyframe.
+        bool loop() const;
+
+        //! Go back to the start, so all keyframes apply again.
+        void rewind();
+
+        //! Advance the timeline.
+        /*!
+        * Only reports changes since the previous call. A \p time before that
+        * of the previous call rewinds the timeline first, as when looping.
+        *
+        * @param time Milliseconds from the start.
+        * @param update Filled with the changes, after being cleared.
+        */
+        void advance(qint64 time, Update *update);
+
+    private:
+        template<typename T>
+        struct Track {
+            struct Point {
+                qint64 time;
+                T value;
+                const EasingTable *easing; // Towards this point.
+            };
+
+            QVector<Point> points;
+            int next {0}; // The first point not yet passed.
+            bool done {false}; // Holding the last value.
+        };
+
+        template<typename T>
+        static bool sample(Track<T> &track, qint64 time, T *value);
+
+        qint64 m_duration;
+        bool m_loop;
+
+        Track<qreal> m_brightness;
+        QVector<Track<ColorSpace::Oklab>> m_colors;
+        QVector<QRgb> m_lastColors;
+
+        QVector<Event> m_events;
+        int m_nextEvent;
+
+        qint64 m_time;
+};